@@ -6,11 +6,16 @@ CONFIG += ordered
 SUBDIRS += wallet
 
 #NEBLIO_CONFIG += Tests
+#NEBLIO_CONFIG += Benchmarks
 
 contains( NEBLIO_CONFIG, Tests ) {
     SUBDIRS += wallet/test
 }
 
+contains( NEBLIO_CONFIG, Benchmarks ) {
+    SUBDIRS += wallet/bench
+}
+
 contains( NEBLIO_CONFIG, NoWallet ) {
     SUBDIRS += wallet/test
     SUBDIRS -= wallet
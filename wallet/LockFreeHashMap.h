@@ -0,0 +1,507 @@
+#ifndef LOCKFREEHASHMAP_H
+#define LOCKFREEHASHMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * The lookups in progress in all the LockFreeHashMaps, for their writers to know when no reader can
+ * still see the entries they unlinked.
+ *
+ * Each thread announces its lookups in a slot of its own, padded to its own cache lines, by storing
+ * there the global epoch at which the lookup began; so a lookup only writes to memory of its thread.
+ * A writer that unlinked some entries bumps the epoch, and waits for every slot to be either idle or
+ * in the new epoch; a lookup that began after that can't find the entries anymore. Nested lookups,
+ * like a lookup in another map from a visit() callback, are counted in the outermost one.
+ *
+ * Slots are never freed; a thread gives its slot back when it exits, for the next thread to reuse.
+ */
+class LockFreeReaders
+{
+    struct Slot
+    {
+        char                  padBefore[64];
+        std::atomic<uint64_t> epoch; // when the lookup in progress began, or 0 if there's none
+        std::atomic<bool>     inUse;
+        Slot*                 next;
+        char                  padAfter[64];
+
+        Slot() : epoch(0), inUse(true), next(nullptr) {}
+    };
+
+    struct ThreadSlot
+    {
+        Slot*    slot;
+        unsigned depth;
+
+        ThreadSlot() : slot(nullptr), depth(0)
+        {
+            for (Slot* s = Head().load(std::memory_order_acquire); s != nullptr; s = s->next) {
+                bool expected = false;
+                if (s->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    slot = s;
+                    return;
+                }
+            }
+            slot       = new Slot;
+            slot->next = Head().load(std::memory_order_relaxed);
+            while (!Head().compare_exchange_weak(slot->next, slot, std::memory_order_release)) {
+            }
+        }
+        ~ThreadSlot()
+        {
+            slot->epoch.store(0, std::memory_order_release);
+            slot->inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    static std::atomic<uint64_t>& Epoch()
+    {
+        static std::atomic<uint64_t> epoch(1);
+        return epoch;
+    }
+    static std::atomic<Slot*>& Head()
+    {
+        static std::atomic<Slot*> head(nullptr);
+        return head;
+    }
+    static ThreadSlot& ThisThread()
+    {
+        static thread_local ThreadSlot threadSlot;
+        return threadSlot;
+    }
+
+public:
+    static void BeginRead()
+    {
+        ThreadSlot& t = ThisThread();
+        if (t.depth++ == 0) {
+            t.slot->epoch.store(Epoch().load(std::memory_order_acquire), std::memory_order_relaxed);
+            // orders the announcement before the loads of the lookup, against Synchronize()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    static void EndRead()
+    {
+        ThreadSlot& t = ThisThread();
+        if (--t.depth == 0) {
+            t.slot->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Waits for the lookups that may have found entries unlinked before this call to end. The lookups
+     * of the calling thread are skipped; they must not be in the map being written.
+     */
+    static void Synchronize()
+    {
+        const Slot*    self     = ThisThread().slot;
+        const uint64_t newEpoch = Epoch().fetch_add(1, std::memory_order_seq_cst) + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const Slot* s = Head().load(std::memory_order_acquire); s != nullptr; s = s->next) {
+            if (s == self) {
+                continue;
+            }
+            while (true) {
+                const uint64_t e = s->epoch.load(std::memory_order_acquire);
+                if (e == 0 || e >= newEpoch) {
+                    break;
+                }
+                boost::this_thread::yield();
+            }
+        }
+    }
+};
+
+/**
+ * A hash map for a single writer and many readers, where readers never lock.
+ *
+ * Entries are immutable nodes, and the open-addressing table holds atomic pointers to them; a writer
+ * publishes a node with a release store after it's fully constructed, and a reader follows it with an
+ * acquire load. Replacing the value of an existing key publishes a new node, so a reader that found the
+ * old node still reads the old (intact) value.
+ *
+ * Nodes that were replaced or erased, and tables retired when the table grew, are freed by the writer
+ * once there are more of them than live entries (and at least INITIAL_CAPACITY), after a grace period
+ * that LockFreeReaders tracks. That bounds the garbage by the size of the map, and costs the writer
+ * amortized O(1) per write.
+ *
+ * Writers are serialized by an internal mutex. clear(), setInternalMap() and assignment must not run
+ * concurrently with readers, which matches how the block index is rebuilt on startup.
+ */
+template <typename K, typename V, typename Hasher = std::hash<K>>
+class LockFreeHashMap
+{
+    struct Node
+    {
+        K key;
+        V value;
+        Node(const K& k, const V& v) : key(k), value(v) {}
+    };
+
+    struct Table
+    {
+        std::size_t                                 mask;
+        std::unique_ptr<std::atomic<const Node*>[]> slots;
+
+        explicit Table(std::size_t capacity)
+            : mask(capacity - 1), slots(new std::atomic<const Node*>[capacity])
+        {
+            for (std::size_t i = 0; i < capacity; i++) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        std::size_t capacity() const { return mask + 1; }
+    };
+
+    static constexpr std::size_t INITIAL_CAPACITY = 1024;
+
+    // marks a slot whose entry was erased; probing continues past it
+    static const Node* Tombstone()
+    {
+        static const char dummy = 0;
+        return reinterpret_cast<const Node*>(&dummy);
+    }
+
+    std::vector<std::unique_ptr<Table>>      tables;  // back() is the live table, the rest are retired
+    std::vector<std::unique_ptr<const Node>> garbage; // replaced or erased nodes; writer only
+    std::atomic<const Table*>                table;
+    std::atomic<std::size_t>                 elements;
+    std::size_t                              usedSlots; // elements + tombstones; writer only
+    Hasher                                   hasher;
+    mutable boost::mutex                     writerMtx;
+
+    const Node* findNode(const K& key) const;
+    void        insertIntoTable(Table& t, const Node* node);
+    void        growIfNeeded();
+    void        retire(const Node* node);
+    void        reclaimIfNeeded();
+    void        reset();
+
+public:
+    using MapType     = std::map<K, V>;
+    using key_type    = K;
+    using mapped_type = V;
+    using value_type  = std::pair<K, V>;
+
+    LockFreeHashMap();
+    LockFreeHashMap(const std::map<K, V>& rhs);
+    LockFreeHashMap(const LockFreeHashMap<K, V, Hasher>& rhs);
+    ~LockFreeHashMap();
+    LockFreeHashMap<K, V, Hasher>& operator=(const LockFreeHashMap<K, V, Hasher>& rhs);
+
+    void        set(const K& key, const V& value);
+    std::size_t erase(const K& key);
+    bool        exists(const K& key) const;
+    std::size_t size() const;
+    bool        empty() const;
+
+    /** Lock-free lookup that copies the value out */
+    boost::optional<V> get(const K& key) const;
+
+    /**
+     * Lock-free lookup that calls f with the stored value, without copying it, if the key exists.
+     * Returns whether it does. The value may be freed once f returns if the key was replaced or erased
+     * meanwhile, so f must not keep a reference to it, and must not write to the map.
+     */
+    template <typename F>
+    bool visit(const K& key, F&& f) const;
+
+    /** The replaced or erased entries that aren't freed yet */
+    std::size_t garbageSize() const;
+
+    void           clear();
+    std::map<K, V> getInternalMap() const;
+    void           setInternalMap(const std::map<K, V>& TheMap);
+    void           setInternalMap(std::map<K, V>&& TheMap);
+};
+
+template <typename K, typename V, typename Hasher>
+constexpr std::size_t LockFreeHashMap<K, V, Hasher>::INITIAL_CAPACITY;
+
+template <typename K, typename V, typename Hasher>
+LockFreeHashMap<K, V, Hasher>::LockFreeHashMap()
+    : table(nullptr), elements(0), usedSlots(0)
+{
+    reset();
+}
+
+template <typename K, typename V, typename Hasher>
+LockFreeHashMap<K, V, Hasher>::LockFreeHashMap(const std::map<K, V>& rhs)
+    : table(nullptr), elements(0), usedSlots(0)
+{
+    setInternalMap(rhs);
+}
+
+template <typename K, typename V, typename Hasher>
+LockFreeHashMap<K, V, Hasher>::LockFreeHashMap(const LockFreeHashMap<K, V, Hasher>& rhs)
+    : table(nullptr), elements(0), usedSlots(0)
+{
+    setInternalMap(rhs.getInternalMap());
+}
+
+template <typename K, typename V, typename Hasher>
+LockFreeHashMap<K, V, Hasher>::~LockFreeHashMap()
+{
+    reset();
+}
+
+template <typename K, typename V, typename Hasher>
+LockFreeHashMap<K, V, Hasher>& LockFreeHashMap<K, V, Hasher>::
+                               operator=(const LockFreeHashMap<K, V, Hasher>& rhs)
+{
+    if (this != &rhs) {
+        setInternalMap(rhs.getInternalMap());
+    }
+    return *this;
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::reset()
+{
+    // the live nodes are only owned through the live table
+    if (!tables.empty()) {
+        const Table& t = *tables.back();
+        for (std::size_t i = 0; i < t.capacity(); i++) {
+            const Node* node = t.slots[i].load(std::memory_order_relaxed);
+            if (node != nullptr && node != Tombstone()) {
+                delete node;
+            }
+        }
+    }
+    tables.clear();
+    garbage.clear();
+    tables.emplace_back(new Table(INITIAL_CAPACITY));
+    usedSlots = 0;
+    elements.store(0, std::memory_order_relaxed);
+    table.store(tables.back().get(), std::memory_order_release);
+}
+
+// must be called between LockFreeReaders::BeginRead() and EndRead()
+template <typename K, typename V, typename Hasher>
+const typename LockFreeHashMap<K, V, Hasher>::Node*
+LockFreeHashMap<K, V, Hasher>::findNode(const K& key) const
+{
+    const Table* t = table.load(std::memory_order_acquire);
+    std::size_t  i = hasher(key) & t->mask;
+    for (std::size_t probes = 0; probes <= t->mask; probes++, i = (i + 1) & t->mask) {
+        const Node* node = t->slots[i].load(std::memory_order_acquire);
+        if (node == nullptr) {
+            return nullptr;
+        }
+        if (node != Tombstone() && node->key == key) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::insertIntoTable(Table& t, const Node* node)
+{
+    std::size_t i = hasher(node->key) & t.mask;
+    while (true) {
+        const Node* current = t.slots[i].load(std::memory_order_relaxed);
+        if (current == nullptr) {
+            t.slots[i].store(node, std::memory_order_release);
+            return;
+        }
+        i = (i + 1) & t.mask;
+    }
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::growIfNeeded()
+{
+    const Table& current = *tables.back();
+    // keep the load factor below 1/2 so that probe sequences stay short
+    if (2 * (usedSlots + 1) <= current.capacity()) {
+        return;
+    }
+    std::size_t newCapacity = current.capacity();
+    while (4 * (elements.load(std::memory_order_relaxed) + 1) > newCapacity) {
+        newCapacity *= 2;
+    }
+    std::unique_ptr<Table> newTable(new Table(newCapacity));
+    for (std::size_t i = 0; i < current.capacity(); i++) {
+        const Node* node = current.slots[i].load(std::memory_order_relaxed);
+        if (node != nullptr && node != Tombstone()) {
+            insertIntoTable(*newTable, node);
+        }
+    }
+    usedSlots = elements.load(std::memory_order_relaxed);
+    tables.push_back(std::move(newTable));
+    // the old table stays alive in `tables` for readers that still probe it, until the next reclaim
+    table.store(tables.back().get(), std::memory_order_release);
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::retire(const Node* node)
+{
+    garbage.emplace_back(node);
+    reclaimIfNeeded();
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::reclaimIfNeeded()
+{
+    if (garbage.size() <= std::max(INITIAL_CAPACITY, elements.load(std::memory_order_relaxed))) {
+        return;
+    }
+    // the garbage is unlinked already; only the lookups in progress may still read it
+    LockFreeReaders::Synchronize();
+    garbage.clear();
+    tables.erase(tables.begin(), tables.end() - 1);
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::set(const K& key, const V& value)
+{
+    boost::lock_guard<boost::mutex> lock(writerMtx);
+
+    const Node* newNode = new Node(key, value);
+
+    // replacing an existing key swaps the slot to the new node; the old node is freed later
+    Table&      t = *tables.back();
+    std::size_t i = hasher(key) & t.mask;
+    for (std::size_t probes = 0; probes <= t.mask; probes++, i = (i + 1) & t.mask) {
+        const Node* node = t.slots[i].load(std::memory_order_relaxed);
+        if (node == nullptr) {
+            break;
+        }
+        if (node != Tombstone() && node->key == key) {
+            t.slots[i].store(newNode, std::memory_order_release);
+            retire(node);
+            return;
+        }
+    }
+
+    growIfNeeded();
+    insertIntoTable(*tables.back(), newNode);
+    usedSlots++;
+    elements.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hasher>
+std::size_t LockFreeHashMap<K, V, Hasher>::erase(const K& key)
+{
+    boost::lock_guard<boost::mutex> lock(writerMtx);
+
+    Table&      t = *tables.back();
+    std::size_t i = hasher(key) & t.mask;
+    for (std::size_t probes = 0; probes <= t.mask; probes++, i = (i + 1) & t.mask) {
+        const Node* node = t.slots[i].load(std::memory_order_relaxed);
+        if (node == nullptr) {
+            return 0;
+        }
+        if (node != Tombstone() && node->key == key) {
+            t.slots[i].store(Tombstone(), std::memory_order_release);
+            elements.fetch_sub(1, std::memory_order_relaxed);
+            retire(node);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+template <typename K, typename V, typename Hasher>
+bool LockFreeHashMap<K, V, Hasher>::exists(const K& key) const
+{
+    LockFreeReaders::BeginRead();
+    const bool result = findNode(key) != nullptr;
+    LockFreeReaders::EndRead();
+    return result;
+}
+
+template <typename K, typename V, typename Hasher>
+std::size_t LockFreeHashMap<K, V, Hasher>::size() const
+{
+    return elements.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hasher>
+bool LockFreeHashMap<K, V, Hasher>::empty() const
+{
+    return size() == 0;
+}
+
+template <typename K, typename V, typename Hasher>
+boost::optional<V> LockFreeHashMap<K, V, Hasher>::get(const K& key) const
+{
+    boost::optional<V> result;
+    visit(key, [&result](const V& value) { result = value; });
+    return result;
+}
+
+template <typename K, typename V, typename Hasher>
+template <typename F>
+bool LockFreeHashMap<K, V, Hasher>::visit(const K& key, F&& f) const
+{
+    LockFreeReaders::BeginRead();
+    try {
+        const Node* node = findNode(key);
+        if (node != nullptr) {
+            f(node->value);
+        }
+        LockFreeReaders::EndRead();
+        return node != nullptr;
+    } catch (...) {
+        LockFreeReaders::EndRead();
+        throw;
+    }
+}
+
+template <typename K, typename V, typename Hasher>
+std::size_t LockFreeHashMap<K, V, Hasher>::garbageSize() const
+{
+    boost::lock_guard<boost::mutex> lock(writerMtx);
+    return garbage.size();
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::clear()
+{
+    boost::lock_guard<boost::mutex> lock(writerMtx);
+    reset();
+}
+
+template <typename K, typename V, typename Hasher>
+std::map<K, V> LockFreeHashMap<K, V, Hasher>::getInternalMap() const
+{
+    boost::lock_guard<boost::mutex> lock(writerMtx);
+
+    std::map<K, V> result;
+    const Table&   t = *tables.back();
+    for (std::size_t i = 0; i < t.capacity(); i++) {
+        const Node* node = t.slots[i].load(std::memory_order_relaxed);
+        if (node != nullptr && node != Tombstone()) {
+            result.insert(std::make_pair(node->key, node->value));
+        }
+    }
+    return result;
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::setInternalMap(const std::map<K, V>& TheMap)
+{
+    clear();
+    for (const auto& p : TheMap) {
+        set(p.first, p.second);
+    }
+}
+
+template <typename K, typename V, typename Hasher>
+void LockFreeHashMap<K, V, Hasher>::setInternalMap(std::map<K, V>&& TheMap)
+{
+    setInternalMap(static_cast<const std::map<K, V>&>(TheMap));
+    TheMap.clear();
+}
+
+#endif // LOCKFREEHASHMAP_H
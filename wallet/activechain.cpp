@@ -0,0 +1,71 @@
+#include "activechain.h"
+
+#include "blockindex.h"
+
+CBlockIndex* ActiveChain::operator[](int nHeight) const
+{
+    boost::shared_lock<MutexType> lock(mtx);
+    if (nHeight < 0 || nHeight >= static_cast<int>(vChain.size()))
+        return nullptr;
+    return vChain[nHeight];
+}
+
+CBlockIndex* ActiveChain::Genesis() const
+{
+    boost::shared_lock<MutexType> lock(mtx);
+    return vChain.empty() ? nullptr : vChain.front();
+}
+
+CBlockIndex* ActiveChain::Tip() const
+{
+    boost::shared_lock<MutexType> lock(mtx);
+    return vChain.empty() ? nullptr : vChain.back();
+}
+
+int ActiveChain::Height() const
+{
+    boost::shared_lock<MutexType> lock(mtx);
+    return static_cast<int>(vChain.size()) - 1;
+}
+
+bool ActiveChain::Contains(const CBlockIndex* pindex) const
+{
+    if (!pindex)
+        return false;
+    boost::shared_lock<MutexType> lock(mtx);
+    return pindex->nHeight >= 0 && pindex->nHeight < static_cast<int>(vChain.size()) &&
+           vChain[pindex->nHeight] == pindex;
+}
+
+CBlockIndex* ActiveChain::Next(const CBlockIndex* pindex) const
+{
+    if (!pindex)
+        return nullptr;
+    boost::shared_lock<MutexType> lock(mtx);
+    const int nNext = pindex->nHeight + 1;
+    if (pindex->nHeight < 0 || nNext >= static_cast<int>(vChain.size()) ||
+        vChain[pindex->nHeight] != pindex)
+        return nullptr;
+    return vChain[nNext];
+}
+
+void ActiveChain::SetTip(CBlockIndex* pindex)
+{
+    boost::unique_lock<MutexType> lock(mtx);
+    if (!pindex) {
+        vChain.clear();
+        return;
+    }
+    vChain.resize(pindex->nHeight + 1);
+    // only the blocks after the fork point have to be replaced
+    while (pindex && vChain[pindex->nHeight] != pindex) {
+        vChain[pindex->nHeight] = pindex;
+        pindex                  = boost::atomic_load(&pindex->pprev).get();
+    }
+}
+
+void ActiveChain::clear()
+{
+    boost::unique_lock<MutexType> lock(mtx);
+    vChain.clear();
+}
@@ -0,0 +1,49 @@
+#ifndef ACTIVECHAIN_H
+#define ACTIVECHAIN_H
+
+#include <boost/thread.hpp>
+#include <vector>
+
+class CBlockIndex;
+
+/**
+ * The blocks of the main chain in a contiguous vector indexed by height, so that height lookups and
+ * main-chain membership checks are O(1) instead of walking pprev/pnext.
+ *
+ * Block index objects are owned by mapBlockIndex and live until the index is rebuilt, so the raw
+ * pointers returned here stay valid after the internal lock is released.
+ */
+class ActiveChain
+{
+    using MutexType = boost::shared_mutex;
+
+    std::vector<CBlockIndex*> vChain;
+    mutable MutexType         mtx;
+
+public:
+    /** Returns the block at height nHeight, or nullptr if the height is out of range */
+    CBlockIndex* operator[](int nHeight) const;
+
+    /** Returns the genesis block, or nullptr if the chain is empty */
+    CBlockIndex* Genesis() const;
+
+    /** Returns the tip of the chain, or nullptr if the chain is empty */
+    CBlockIndex* Tip() const;
+
+    /** Returns the height of the tip, or -1 if the chain is empty */
+    int Height() const;
+
+    /** Whether pindex is part of this chain */
+    bool Contains(const CBlockIndex* pindex) const;
+
+    /** Returns the successor of pindex in this chain, or nullptr if pindex isn't in the chain or is
+     * the tip */
+    CBlockIndex* Next(const CBlockIndex* pindex) const;
+
+    /** Makes pindex the new tip by following pprev back to the fork point; nullptr clears the chain */
+    void SetTip(CBlockIndex* pindex);
+
+    void clear();
+};
+
+#endif // ACTIVECHAIN_H
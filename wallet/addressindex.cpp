@@ -0,0 +1,219 @@
+#include "addressindex.h"
+
+#include "base58.h"
+#include "block.h"
+#include "globals.h"
+#include "optionalindex.h"
+#include "txdb.h"
+#include "txindex.h"
+#include "util.h"
+
+#include <map>
+
+bool fAddressIndex = false;
+bool fSpentIndex   = false;
+
+std::string GetAddressIndexKey(const CScript& scriptPubKey)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(scriptPubKey, dest)) {
+        return "";
+    }
+    return CBitcoinAddress(dest).ToString();
+}
+
+/** a transaction spent by the block, with the height of the block that contains it */
+struct CAddressIndexPrevTx
+{
+    CTransaction tx;
+    int          nHeight;
+};
+
+static bool FetchPrevTxForAddressIndex(const ITxDB& txdb, const uint256& hash,
+                                       std::map<uint256, CAddressIndexPrevTx>& cache,
+                                       const CAddressIndexPrevTx*&             prevTx)
+{
+    auto it = cache.find(hash);
+    if (it == cache.end()) {
+        CAddressIndexPrevTx fetched;
+        CTxIndex            txindex;
+        if (!txdb.ReadDiskTx(hash, fetched.tx, txindex)) {
+            return error("Failed to read transaction %s for the address index", hash.ToString().c_str());
+        }
+        const CBlockIndex* pindex = LookupBlockIndex(txindex.pos.nBlockPos);
+        if (!pindex) {
+            return error("Failed to find the block of transaction %s for the address index",
+                         hash.ToString().c_str());
+        }
+        fetched.nHeight = pindex->nHeight;
+        it              = cache.insert(std::make_pair(hash, std::move(fetched))).first;
+    }
+    prevTx = &it->second;
+    return true;
+}
+
+bool GetAddressIndexDelta(const CBlock& block, int nHeight, const ITxDB& txdb,
+                          CAddressIndexDelta& delta)
+{
+    // transactions of the block may spend each other, so they're all in the cache from the start
+    std::map<uint256, CAddressIndexPrevTx> cache;
+    for (const CTransaction& tx : block.vtx) {
+        cache[tx.GetHash()] = CAddressIndexPrevTx{tx, nHeight};
+    }
+
+    for (const CTransaction& tx : block.vtx) {
+        const uint256 txid = tx.GetHash();
+
+        if (!tx.IsCoinBase()) {
+            for (uint32_t i = 0; i < tx.vin.size(); i++) {
+                const COutPoint&           prevout = tx.vin[i].prevout;
+                const CAddressIndexPrevTx* prevTx  = nullptr;
+                if (!FetchPrevTxForAddressIndex(txdb, prevout.hash, cache, prevTx)) {
+                    return false;
+                }
+                if (prevout.n >= prevTx->tx.vout.size()) {
+                    return error("GetAddressIndexDelta(): prevout %s is out of range",
+                                 prevout.ToString().c_str());
+                }
+
+                const CTxOut&     prevOut = prevTx->tx.vout[prevout.n];
+                const std::string address = GetAddressIndexKey(prevOut.scriptPubKey);
+                delta.spends.push_back(std::make_pair(
+                    prevout, CSpentIndexValue(txid, i, nHeight, prevOut.nValue, address)));
+                if (address.empty()) {
+                    continue;
+                }
+                delta.entries.push_back(std::make_pair(
+                    address, CAddressIndexEntry(txid, i, nHeight, -prevOut.nValue, true)));
+                delta.spentOutputs.push_back(std::make_pair(
+                    address, CAddressUnspentEntry(prevout, prevOut.nValue, prevTx->nHeight,
+                                                  prevOut.scriptPubKey)));
+            }
+        }
+
+        for (uint32_t i = 0; i < tx.vout.size(); i++) {
+            const CTxOut&     out     = tx.vout[i];
+            const std::string address = GetAddressIndexKey(out.scriptPubKey);
+            if (address.empty()) {
+                continue;
+            }
+            delta.entries.push_back(
+                std::make_pair(address, CAddressIndexEntry(txid, i, nHeight, out.nValue, false)));
+            delta.createdOutputs.push_back(std::make_pair(
+                address,
+                CAddressUnspentEntry(COutPoint(txid, i), out.nValue, nHeight, out.scriptPubKey)));
+        }
+    }
+    return true;
+}
+
+static bool AddAddressUnspentOutputs(
+    CTxDB& txdb, const std::vector<std::pair<std::string, CAddressUnspentEntry>>& outputs)
+{
+    for (const auto& output : outputs) {
+        if (!txdb.AddAddressUnspentOutput(output.first, output.second)) {
+            return error("Failed to add unspent output %s of address %s",
+                         output.second.outpoint.ToString().c_str(), output.first.c_str());
+        }
+    }
+    return true;
+}
+
+static bool EraseAddressUnspentOutputs(
+    CTxDB& txdb, const std::vector<std::pair<std::string, CAddressUnspentEntry>>& outputs)
+{
+    for (const auto& output : outputs) {
+        // a missing output means the index doesn't match the chain
+        if (!txdb.EraseAddressUnspentOutput(output.first, output.second)) {
+            return error("Failed to remove unspent output %s of address %s",
+                         output.second.outpoint.ToString().c_str(), output.first.c_str());
+        }
+    }
+    return true;
+}
+
+bool ApplyAddressIndexDelta(CTxDB& txdb, const CAddressIndexDelta& delta, bool fUndo, bool fAddresses,
+                            bool fSpent)
+{
+    if (fAddresses) {
+        for (const auto& entry : delta.entries) {
+            const bool fResult = fUndo ? txdb.EraseAddressIndexEntry(entry.first, entry.second)
+                                       : txdb.AddAddressIndexEntry(entry.first, entry.second);
+            if (!fResult) {
+                return error("Failed to update the history of address %s with transaction %s",
+                             entry.first.c_str(), entry.second.txid.ToString().c_str());
+            }
+        }
+
+        // outputs created and spent in the same block are in both lists, so they're always added
+        // before they're removed
+        if (!fUndo) {
+            if (!AddAddressUnspentOutputs(txdb, delta.createdOutputs) ||
+                !EraseAddressUnspentOutputs(txdb, delta.spentOutputs)) {
+                return false;
+            }
+        } else {
+            if (!AddAddressUnspentOutputs(txdb, delta.spentOutputs) ||
+                !EraseAddressUnspentOutputs(txdb, delta.createdOutputs)) {
+                return false;
+            }
+        }
+    }
+
+    if (fSpent) {
+        for (const auto& spend : delta.spends) {
+            const bool fResult = fUndo ? txdb.EraseSpentIndex(spend.first)
+                                       : txdb.WriteSpentIndex(spend.first, spend.second);
+            if (!fResult) {
+                return error("Failed to update the spent index of output %s",
+                             spend.first.ToString().c_str());
+            }
+        }
+    }
+    return true;
+}
+
+namespace {
+class CAddressIndexes : public COptionalIndex
+{
+public:
+    enum Parts
+    {
+        ADDRESSES = 0,
+        SPENT     = 1,
+    };
+
+    CAddressIndexes()
+        : COptionalIndex("address/spent index",
+                         {{"address index", &fAddressIndex, &CTxDB::IsAddressIndexComplete,
+                           &CTxDB::WriteAddressIndexComplete, &CTxDB::ClearAddressIndex},
+                          {"spent index", &fSpentIndex, &CTxDB::IsSpentIndexComplete,
+                           &CTxDB::WriteSpentIndexComplete, &CTxDB::ClearSpentIndex}})
+    {
+    }
+
+protected:
+    bool ApplyBlock(const CBlock& block, int nHeight, CTxDB& txdb, bool fUndo,
+                    unsigned int partsMask) const override
+    {
+        CAddressIndexDelta delta;
+        return GetAddressIndexDelta(block, nHeight, txdb, delta) &&
+               ApplyAddressIndexDelta(txdb, delta, fUndo, HasPart(partsMask, ADDRESSES),
+                                      HasPart(partsMask, SPENT));
+    }
+};
+
+const CAddressIndexes addressIndexes;
+} // namespace
+
+bool ConnectBlockAddressIndex(const CBlock& block, int nHeight, CTxDB& txdb)
+{
+    return addressIndexes.UpdateWithBlock(block, nHeight, txdb, false);
+}
+
+bool DisconnectBlockAddressIndex(const CBlock& block, int nHeight, CTxDB& txdb)
+{
+    return addressIndexes.UpdateWithBlock(block, nHeight, txdb, true);
+}
+
+bool InitAddressIndex() { return addressIndexes.Init(); }
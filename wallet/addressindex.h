@@ -0,0 +1,169 @@
+#ifndef ADDRESSINDEX_H
+#define ADDRESSINDEX_H
+
+#include "outpoint.h"
+#include "script.h"
+#include "serialize.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CTxDB;
+class ITxDB;
+
+/**
+ * The optional address index (-addressindex) and spent index (-spentindex), meant for block explorers.
+ * The address index keeps, in the txdb and keyed by address:
+ *   - the history of the address: every output it received and every input that spent one of them
+ *   - the unspent outputs of the address
+ * The spent index keeps, for every spent output, the input that spent it.
+ *
+ * Both are maintained and built like the other optional indexes (see optionalindex.h), in the same
+ * pass. Only outputs with a single address (pubkey, pubkey hash, script hash and cold stake scripts,
+ * the latter by their owner) are indexed by address.
+ */
+
+/**
+ * An output received by an address (nAmount >= 0), or an input spending one of them (nAmount < 0).
+ * The height is serialized first and big-endian, so that the entries of an address are sorted by
+ * height in the db and a range of heights can be read with a cursor.
+ */
+class CAddressIndexEntry
+{
+public:
+    /** the format of the entries; an index with another one is rebuilt */
+    static const int CURRENT_VERSION = 2;
+
+    uint256  txid;
+    uint32_t nIndex  = 0; // the index of the output, or of the input for spends
+    int32_t  nHeight = 0;
+    int64_t  nAmount = 0;
+    bool     fSpend  = false;
+
+    CAddressIndexEntry() = default;
+    CAddressIndexEntry(const uint256& txidIn, uint32_t nIndexIn, int nHeightIn, int64_t nAmountIn,
+                       bool fSpendIn)
+        : txid(txidIn), nIndex(nIndexIn), nHeight(nHeightIn), nAmount(nAmountIn), fSpend(fSpendIn)
+    {
+    }
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+                        uint32_t nHeightBigEndian = static_cast<uint32_t>(nHeight);
+                        MakeBigEndian(nHeightBigEndian);
+                        READWRITE(nHeightBigEndian);
+                        if (fRead) {
+                            FromBigEndianToThisEndianness(nHeightBigEndian);
+                            const_cast<CAddressIndexEntry*>(this)->nHeight =
+                                static_cast<int32_t>(nHeightBigEndian);
+                        }
+                        READWRITE(txid);
+                        READWRITE(nIndex);
+                        READWRITE(nAmount);
+                        READWRITE(fSpend);
+                       )
+    // clang-format on
+
+    friend bool operator==(const CAddressIndexEntry& a, const CAddressIndexEntry& b)
+    {
+        return a.txid == b.txid && a.nIndex == b.nIndex && a.nHeight == b.nHeight &&
+               a.nAmount == b.nAmount && a.fSpend == b.fSpend;
+    }
+};
+
+/** An unspent output of an address; scripts with an address are short, so it fits in a dupsort value */
+class CAddressUnspentEntry
+{
+public:
+    COutPoint outpoint;
+    int64_t   nValue  = 0;
+    int32_t   nHeight = 0;
+    CScript   scriptPubKey;
+
+    CAddressUnspentEntry() = default;
+    CAddressUnspentEntry(const COutPoint& outpointIn, int64_t nValueIn, int nHeightIn,
+                         const CScript& scriptPubKeyIn)
+        : outpoint(outpointIn), nValue(nValueIn), nHeight(nHeightIn), scriptPubKey(scriptPubKeyIn)
+    {
+    }
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+                        READWRITE(outpoint);
+                        READWRITE(nValue);
+                        READWRITE(nHeight);
+                        READWRITE(scriptPubKey);
+                       )
+    // clang-format on
+
+    friend bool operator==(const CAddressUnspentEntry& a, const CAddressUnspentEntry& b)
+    {
+        return a.outpoint == b.outpoint && a.nValue == b.nValue && a.nHeight == b.nHeight &&
+               a.scriptPubKey == b.scriptPubKey;
+    }
+};
+
+/** The input that spent an output; the value and the address are those of the spent output */
+class CSpentIndexValue
+{
+public:
+    uint256     txid;
+    uint32_t    nInputIndex = 0;
+    int32_t     nHeight     = 0;
+    int64_t     nValue      = 0;
+    std::string address;
+
+    CSpentIndexValue() = default;
+    CSpentIndexValue(const uint256& txidIn, uint32_t nInputIndexIn, int nHeightIn, int64_t nValueIn,
+                     const std::string& addressIn)
+        : txid(txidIn), nInputIndex(nInputIndexIn), nHeight(nHeightIn), nValue(nValueIn),
+          address(addressIn)
+    {
+    }
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+                        READWRITE(txid);
+                        READWRITE(nInputIndex);
+                        READWRITE(nHeight);
+                        READWRITE(nValue);
+                        READWRITE(address);
+                       )
+    // clang-format on
+};
+
+/** The changes a block makes to the address and spent indexes */
+class CAddressIndexDelta
+{
+public:
+    std::vector<std::pair<std::string, CAddressIndexEntry>>   entries;
+    std::vector<std::pair<std::string, CAddressUnspentEntry>> createdOutputs;
+    std::vector<std::pair<std::string, CAddressUnspentEntry>> spentOutputs;
+    std::vector<std::pair<COutPoint, CSpentIndexValue>>       spends;
+};
+
+/** whether the indexes are maintained (-addressindex, -spentindex); set on startup */
+extern bool fAddressIndex;
+extern bool fSpentIndex;
+
+/** The address an output is indexed by, or an empty string if it has none */
+std::string GetAddressIndexKey(const CScript& scriptPubKey);
+
+/** Collects the changes of a block at height nHeight; the outputs it spends must be in the txdb */
+bool GetAddressIndexDelta(const CBlock& block, int nHeight, const ITxDB& txdb,
+                          CAddressIndexDelta& delta);
+
+/** Applies the changes to the enabled index tables, or reverts them if fUndo */
+bool ApplyAddressIndexDelta(CTxDB& txdb, const CAddressIndexDelta& delta, bool fUndo, bool fAddresses,
+                            bool fSpent);
+
+/** The address and spent indexes as the parts of one optional index; see optionalindex.h */
+bool ConnectBlockAddressIndex(const CBlock& block, int nHeight, CTxDB& txdb);
+bool DisconnectBlockAddressIndex(const CBlock& block, int nHeight, CTxDB& txdb);
+bool InitAddressIndex();
+
+#endif // ADDRESSINDEX_H
@@ -0,0 +1,182 @@
+#include "bench/bench.h"
+
+#include "json_spirit.h"
+#include "util.h"
+
+#undef printf
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+static std::atomic<uint64_t> allocationCount{0};
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    while (true) {
+        if (void* p = std::malloc(size == 0 ? 1 : size)) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+namespace benchmark {
+
+uint64_t GetAllocationCount() { return allocationCount.load(std::memory_order_relaxed); }
+
+State::State(const std::string& Name, clock::duration MaxElapsed, uint64_t MaxIterations)
+    : name(Name), maxElapsed(MaxElapsed), maxIterations(MaxIterations), count(0), countMask(0),
+      beginAllocations(0), lastAllocations(0)
+{
+}
+
+bool State::KeepRunning()
+{
+    if (count == 0) {
+        beginAllocations = lastAllocations = GetAllocationCount();
+        beginTime = lastTime = clock::now();
+        ++count;
+        return true;
+    }
+    if (maxIterations != 0) {
+        if (count < maxIterations) {
+            ++count;
+            return true;
+        }
+        lastTime        = clock::now();
+        lastAllocations = GetAllocationCount();
+        return false;
+    }
+    // reading the clock isn't free, so it's only done once every (countMask + 1) iterations; the
+    // mask grows while an interval is much shorter than the time budget
+    if ((count & countMask) != 0) {
+        ++count;
+        return true;
+    }
+    const clock::time_point now = clock::now();
+    if (now - beginTime >= maxElapsed) {
+        lastTime        = now;
+        lastAllocations = GetAllocationCount();
+        return false;
+    }
+    if ((now - lastTime) * 16 < maxElapsed && countMask < (UINT64_C(1) << 40)) {
+        countMask = ((countMask << 1) | 1);
+    }
+    lastTime = now;
+    ++count;
+    return true;
+}
+
+BenchRunner::BenchmarkMap& BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarksMap;
+    return benchmarksMap;
+}
+
+BenchRunner::BenchRunner(const std::string& name, BenchFunction func)
+{
+    benchmarks().insert(std::make_pair(name, func));
+}
+
+std::vector<std::string> BenchRunner::GetNames()
+{
+    std::vector<std::string> names;
+    for (const auto& p : benchmarks()) {
+        names.push_back(p.first);
+    }
+    return names;
+}
+
+static double ToSeconds(clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
+
+void BenchRunner::RunAll(const RunOptions& options)
+{
+    const unsigned     epochs = std::max(1u, options.epochs);
+    json_spirit::Array jsonResults;
+
+    std::printf("#Benchmark,Iterations,Total(s),Average(ns),Allocations/iteration,Median(ns),Min(ns),"
+                "Max(ns)\n");
+    for (const auto& p : benchmarks()) {
+        if (!options.filter.empty() && p.first.find(options.filter) == std::string::npos)
+            continue;
+
+        uint64_t            iterations  = 0;
+        uint64_t            allocations = 0;
+        clock::duration     elapsed(0);
+        std::vector<double> epochNs; // the time per iteration of each epoch
+        for (unsigned i = 0; i < epochs; i++) {
+            State state(p.first, options.maxElapsed / epochs, options.iterations);
+            p.second(state);
+            iterations += state.getIterations();
+            allocations += state.getAllocations();
+            elapsed += state.getElapsed();
+            if (state.getIterations() > 0) {
+                epochNs.push_back(ToSeconds(state.getElapsed()) * 1e9 / state.getIterations());
+            }
+        }
+
+        std::vector<double> sorted(epochNs);
+        std::sort(sorted.begin(), sorted.end());
+        const std::size_t n       = sorted.size();
+        const double      total   = ToSeconds(elapsed);
+        const double      average = iterations > 0 ? total * 1e9 / iterations : 0.;
+        const double      allocationsPerIteration =
+            iterations > 0 ? static_cast<double>(allocations) / iterations : 0.;
+        const double median = n > 0 ? (sorted[(n - 1) / 2] + sorted[n / 2]) / 2 : 0.;
+        const double min    = n > 0 ? sorted.front() : 0.;
+        const double max    = n > 0 ? sorted.back() : 0.;
+        std::printf("%s,%" PRIu64 ",%.6f,%.1f,%.1f,%.1f,%.1f,%.1f\n", p.first.c_str(), iterations, total,
+                    average, allocationsPerIteration, median, min, max);
+
+        json_spirit::Object result;
+        result.push_back(json_spirit::Pair("name", p.first));
+        result.push_back(json_spirit::Pair("iterations", iterations));
+        result.push_back(json_spirit::Pair("total_s", total));
+        result.push_back(json_spirit::Pair("average_ns", average));
+        result.push_back(json_spirit::Pair("median_ns", median));
+        result.push_back(json_spirit::Pair("min_ns", min));
+        result.push_back(json_spirit::Pair("max_ns", max));
+        result.push_back(json_spirit::Pair("allocations_per_iteration", allocationsPerIteration));
+        result.push_back(
+            json_spirit::Pair("epochs_ns", json_spirit::Array(epochNs.begin(), epochNs.end())));
+        jsonResults.push_back(result);
+    }
+
+    if (options.jsonPath.empty()) {
+        return;
+    }
+    // the settings are stored with the results, as results are only comparable to ones made with the
+    // same settings
+    json_spirit::Object root;
+    root.push_back(json_spirit::Pair("version", FormatFullVersion()));
+    root.push_back(json_spirit::Pair("epochs", static_cast<int>(epochs)));
+    root.push_back(json_spirit::Pair("iterations", options.iterations));
+    root.push_back(json_spirit::Pair(
+        "time_ms",
+        static_cast<int64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(options.maxElapsed).count())));
+    root.push_back(json_spirit::Pair("benchmarks", jsonResults));
+
+    std::ofstream file(options.jsonPath, std::ios::trunc);
+    file << json_spirit::write_formatted(root) << "\n";
+    if (!file.good()) {
+        throw std::runtime_error("Failed to write the results to " + options.jsonPath);
+    }
+}
+} // namespace benchmark
@@ -0,0 +1,95 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+// Simple micro-benchmarking framework, modeled after Bitcoin Core's.
+//
+// Usage:
+//
+// static void CODE_TO_TIME(benchmark::State& state)
+// {
+//     ... do any setup needed...
+//     while (state.KeepRunning()) {
+//        ... do stuff you want to time...
+//     }
+//     ... do any cleanup needed...
+// }
+//
+// BENCHMARK(CODE_TO_TIME);
+//
+// Besides the time, the heap allocations made between the first and the last call to KeepRunning()
+// are counted, by replacing the global operator new of bench_neblio.
+//
+// Every benchmark is run in a number of epochs, each given an equal share of the time (or a fixed
+// number of iterations, for runs that have to do the same work to be compared), so that the spread of
+// the time per iteration between them shows how noisy the result is.
+
+namespace benchmark {
+
+using clock = std::chrono::steady_clock;
+
+class State
+{
+    std::string       name;
+    clock::duration   maxElapsed;
+    uint64_t          maxIterations; // 0 when the time decides
+    clock::time_point beginTime;
+    clock::time_point lastTime;
+    uint64_t          count;
+    uint64_t          countMask;
+    uint64_t          beginAllocations;
+    uint64_t          lastAllocations;
+
+public:
+    State(const std::string& Name, clock::duration MaxElapsed, uint64_t MaxIterations = 0);
+
+    bool KeepRunning();
+
+    uint64_t        getIterations() const { return count; }
+    clock::duration getElapsed() const { return lastTime - beginTime; }
+    uint64_t        getAllocations() const { return lastAllocations - beginAllocations; }
+};
+
+/** the number of calls to operator new so far, from all threads */
+uint64_t GetAllocationCount();
+
+using BenchFunction = std::function<void(State&)>;
+
+struct RunOptions
+{
+    std::string     filter;     // only the benchmarks whose names contain it
+    clock::duration maxElapsed; // for each benchmark, over all epochs
+    unsigned        epochs;
+    uint64_t        iterations; // per epoch; if not 0, the time is ignored
+    std::string     jsonPath;   // where the results are written as JSON too, if not empty
+};
+
+class BenchRunner
+{
+    using BenchmarkMap = std::map<std::string, BenchFunction>;
+    static BenchmarkMap& benchmarks();
+
+public:
+    BenchRunner(const std::string& name, BenchFunction func);
+
+    /** runs the benchmarks and prints the results as CSV; throws if the JSON file can't be written */
+    static void RunAll(const RunOptions& options);
+
+    static std::vector<std::string> GetNames();
+};
+} // namespace benchmark
+
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo);
+#define BENCHMARK(n)                                                                               \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n);
+
+#endif // BENCH_BENCH_H
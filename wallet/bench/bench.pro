@@ -0,0 +1,39 @@
+TEMPLATE = app
+TARGET = bench_neblio
+DEFINES += QT_GUI BOOST_THREAD_USE_LIB BOOST_SPIRIT_THREADSAFE
+CONFIG += no_include_pwd
+CONFIG += thread
+QMAKE_CXXFLAGS += -std=c++11
+
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT += widgets
+    DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0
+}
+
+NEBLIO_TEST += TRUE
+NEBLIO_ROOT = $${PWD}/../..
+VPATH       += $${NEBLIO_ROOT}/wallet $${NEBLIO_ROOT}/wallet/json $${NEBLIO_ROOT}/wallet/qt
+INCLUDEPATH += $${NEBLIO_ROOT}/wallet $${NEBLIO_ROOT}/wallet/json $${NEBLIO_ROOT}/wallet/qt
+
+include($${NEBLIO_ROOT}/wallet/wallet.pri)
+include($${NEBLIO_ROOT}/wallet/wallet-libs.pri)
+
+# block.cpp and validation.cpp have namesakes in the wallet sources, so the objects are kept apart
+CONFIG += object_parallel_to_source
+
+HEADERS += \
+    $${PWD}/bench.h    \
+    $${PWD}/fixtures.h \
+    $${PWD}/replay.h
+
+SOURCES += \
+    $${PWD}/bench_main.cpp \
+    $${PWD}/bench.cpp      \
+    $${PWD}/block.cpp      \
+    $${PWD}/fixtures.cpp   \
+    $${PWD}/ntp1.cpp       \
+    $${PWD}/replay.cpp     \
+    $${PWD}/txdb.cpp       \
+    $${PWD}/validation.cpp
+
+DEFINES += BITCOIN_QT_TEST NEBLIO_BENCHMARKS
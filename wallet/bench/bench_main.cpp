@@ -0,0 +1,95 @@
+#include "bench/bench.h"
+#include "bench/fixtures.h"
+#include "bench/replay.h"
+
+#include "chainparams.h"
+#include "util.h"
+
+#undef printf
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <limits>
+
+static const int64_t DEFAULT_BENCH_TIME_MS = 1000;
+static const int64_t DEFAULT_BENCH_EPOCHS  = 5;
+
+int main(int argc, char** argv)
+{
+    ParseParameters(argc, argv);
+
+    if (mapArgs.exists("-?") || mapArgs.exists("-help")) {
+        std::fprintf(stdout,
+                     "Usage: bench_neblio [options]\n\n"
+                     "Options:\n"
+                     "  -filter=<str>       Only run the benchmarks whose names contain <str>\n"
+                     "  -list               List the benchmarks and exit\n"
+                     "  -time=<ms>          Time spent on each benchmark (default: %d)\n"
+                     "  -epochs=<n>         Runs the time of each benchmark is split in (default: %d)\n"
+                     "  -iterations=<n>     Run every epoch for <n> iterations, whatever the time\n"
+                     "  -output-json=<file> Write the results to <file> as JSON too\n"
+                     "  -datadir=<dir>      Where the database of the benchmarks is created (default: a "
+                     "temporary directory)\n"
+                     "  -replay=<file>      Instead, time the phases of connecting the blocks of a "
+                     "bootstrap file\n"
+                     "  -replayfrom=<n>     The first height timed by -replay (default: 1)\n"
+                     "  -replayto=<n>       The last height connected by -replay (default: all)\n",
+                     static_cast<int>(DEFAULT_BENCH_TIME_MS), static_cast<int>(DEFAULT_BENCH_EPOCHS));
+        return 0;
+    }
+
+    if (mapArgs.exists("-list")) {
+        for (const std::string& name : benchmark::BenchRunner::GetNames()) {
+            std::printf("%s\n", name.c_str());
+        }
+        return 0;
+    }
+
+    // the benchmarks must not touch the data directory of a node
+    boost::filesystem::path tempDataDir;
+    if (!mapArgs.exists("-datadir")) {
+        tempDataDir = boost::filesystem::temp_directory_path() /
+                      boost::filesystem::unique_path("bench_neblio_%%%%-%%%%-%%%%");
+        boost::filesystem::create_directories(tempDataDir);
+        mapArgs.set("-datadir", tempDataDir.string());
+    }
+
+    SelectParams(NetworkType::Mainnet);
+    InitBenchTxDB();
+
+    const int64_t nTimeMs     = std::max<int64_t>(1, GetArg("-time", DEFAULT_BENCH_TIME_MS));
+    const int64_t nEpochs     = std::max<int64_t>(1, GetArg("-epochs", DEFAULT_BENCH_EPOCHS));
+    const int64_t nIterations = std::max<int64_t>(0, GetArg("-iterations", 0));
+
+    benchmark::RunOptions options;
+    options.filter     = GetArg("-filter", std::string());
+    options.maxElapsed = std::chrono::milliseconds(nTimeMs);
+    options.epochs     = static_cast<unsigned>(nEpochs);
+    options.iterations = static_cast<uint64_t>(nIterations);
+    options.jsonPath   = GetArg("-output-json", std::string());
+
+    int result = 0;
+    try {
+        if (mapArgs.exists("-replay")) {
+            benchmark::ReplayOptions replayOptions;
+            replayOptions.file        = GetArg("-replay", std::string());
+            replayOptions.nFromHeight = static_cast<int>(GetArg("-replayfrom", 1));
+            replayOptions.nToHeight =
+                static_cast<int>(GetArg("-replayto", std::numeric_limits<int>::max()));
+            replayOptions.jsonPath    = options.jsonPath;
+            benchmark::RunReplay(replayOptions);
+        } else {
+            benchmark::BenchRunner::RunAll(options);
+        }
+    } catch (const std::exception& ex) {
+        std::fprintf(stderr, "Error: %s\n", ex.what());
+        result = 1;
+    }
+
+    CloseBenchTxDB();
+    if (!tempDataDir.empty()) {
+        boost::filesystem::remove_all(tempDataDir);
+    }
+    return result;
+}
@@ -0,0 +1,110 @@
+#include "bench/bench.h"
+#include "bench/fixtures.h"
+
+#include "block.h"
+#include "blockarena.h"
+#include "serialize.h"
+#include "util.h"
+#include "version.h"
+
+#include <cassert>
+
+static void DeserializeBlock(benchmark::State& state)
+{
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << MakeBenchBlock();
+    const std::vector<char> data(ssBlock.begin(), ssBlock.end());
+
+    while (state.KeepRunning()) {
+        CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+        CBlock      block;
+        stream >> block;
+        assert(block.vtx.size() == BENCH_BLOCK_TX_COUNT + 1);
+    }
+}
+
+static void SerializeBlock(benchmark::State& state)
+{
+    const CBlock block = MakeBenchBlock();
+    CDataStream  stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream.reserve(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+
+    while (state.KeepRunning()) {
+        stream.clear();
+        stream << block;
+        assert(!stream.empty());
+    }
+}
+
+/** reads the block over the one read before it, as blocks are when they're served or verified */
+static void DeserializeBlockArena(benchmark::State& state)
+{
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << MakeBenchBlock();
+    const std::vector<char> data(ssBlock.begin(), ssBlock.end());
+
+    CBlockArena arena;
+    while (state.KeepRunning()) {
+        CDataStream   stream(data, SER_NETWORK, PROTOCOL_VERSION);
+        const CBlock& block = arena.Read(stream);
+        assert(block.vtx.size() == BENCH_BLOCK_TX_COUNT + 1);
+    }
+}
+
+/** a transaction as it's relayed, and checked before it enters the mempool */
+static void SerializeTransaction(benchmark::State& state)
+{
+    const CTransaction tx = MakeBenchBlock().vtx[1];
+    CDataStream        stream(SER_NETWORK, PROTOCOL_VERSION);
+
+    while (state.KeepRunning()) {
+        stream.clear();
+        stream << tx;
+        assert(!stream.empty());
+    }
+}
+
+static void DeserializeTransaction(benchmark::State& state)
+{
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx << MakeBenchBlock().vtx[1];
+    const std::vector<char> data(ssTx.begin(), ssTx.end());
+
+    while (state.KeepRunning()) {
+        CDataStream  stream(data, SER_NETWORK, PROTOCOL_VERSION);
+        CTransaction tx;
+        stream >> tx;
+        assert(tx.vin.size() == 2);
+    }
+}
+
+/** copies a transaction, like SignatureHash() does for every input it checks */
+static void CopyTransaction(benchmark::State& state)
+{
+    const CBlock       block = MakeBenchBlock();
+    const CTransaction tx    = block.vtx[1];
+
+    while (state.KeepRunning()) {
+        CTransaction txTmp(tx);
+        assert(txTmp.vout.size() == 2);
+    }
+}
+
+/** copies every transaction of a block, as when blocks are cached or relayed */
+static void CopyBlock(benchmark::State& state)
+{
+    const CBlock block = MakeBenchBlock();
+
+    while (state.KeepRunning()) {
+        CBlock copy(block);
+        assert(copy.vtx.size() == block.vtx.size());
+    }
+}
+
+BENCHMARK(DeserializeBlock);
+BENCHMARK(SerializeBlock);
+BENCHMARK(DeserializeBlockArena);
+BENCHMARK(SerializeTransaction);
+BENCHMARK(DeserializeTransaction);
+BENCHMARK(CopyTransaction);
+BENCHMARK(CopyBlock);
@@ -0,0 +1,212 @@
+#include "bench/fixtures.h"
+
+#include "hash.h"
+#include "keystore.h"
+#include "script.h"
+#include "serialize.h"
+#include "txdb.h"
+#include "util.h"
+#include "version.h"
+
+#include <memory>
+#include <stdexcept>
+
+static const int      BENCH_SPENDING_TX_COUNT = 250;
+static const unsigned BENCH_KEY_COUNT         = 16;
+static const int64_t  BENCH_OUTPUT_VALUE      = 10 * COIN;
+static const int64_t  BENCH_FEE               = COIN / 100;
+
+CKey MakeBenchKey(unsigned n)
+{
+    const uint256 secret = Hash(BEGIN(n), END(n));
+    CKey          key;
+    key.SetSecret(CSecret(secret.begin(), secret.end()), true);
+    return key;
+}
+
+static CTransaction MakeBenchCoinbase(unsigned int nTime)
+{
+    CTransaction coinbase;
+    coinbase.nTime = nTime;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1000000 << OP_0;
+    coinbase.vout.push_back(CTxOut(0, CScript()));
+    return coinbase;
+}
+
+CBlock MakeBenchBlock()
+{
+    CBlock block;
+    block.nTime = 1600000000;
+    block.vtx.push_back(MakeBenchCoinbase(block.nTime));
+
+    for (int i = 0; i < BENCH_BLOCK_TX_COUNT; i++) {
+        CTransaction tx;
+        tx.nTime = block.nTime;
+        for (unsigned j = 0; j < 2; j++) {
+            CTxIn txin;
+            txin.prevout   = COutPoint(Hash(BEGIN(i), END(i)), j);
+            txin.scriptSig = CScript() << std::vector<unsigned char>(72, static_cast<unsigned char>(i))
+                                       << std::vector<unsigned char>(33, static_cast<unsigned char>(j));
+            tx.vin.push_back(txin);
+        }
+        for (int j = 0; j < 2; j++) {
+            const CKeyID key(uint160(static_cast<uint64_t>(i * 2 + j)));
+            tx.vout.push_back(CTxOut(100000 + j, GetScriptForDestination(key)));
+        }
+        block.vtx.push_back(tx);
+    }
+    return block;
+}
+
+static BenchSpendingBlocks MakeBenchSpendingBlocks()
+{
+    CBasicKeyStore keystore;
+    for (unsigned i = 0; i < BENCH_KEY_COUNT; i++) {
+        keystore.AddKey(MakeBenchKey(i));
+    }
+
+    BenchSpendingBlocks blocks;
+    blocks.funding.nTime = 1600000000;
+    blocks.funding.vtx.push_back(MakeBenchCoinbase(blocks.funding.nTime));
+    blocks.spending.nTime = blocks.funding.nTime + 120;
+    blocks.spending.vtx.push_back(MakeBenchCoinbase(blocks.spending.nTime));
+
+    for (int i = 0; i < BENCH_SPENDING_TX_COUNT; i++) {
+        CTransaction funding;
+        funding.nTime = blocks.funding.nTime;
+        funding.vin.resize(1);
+        funding.vin[0].prevout   = COutPoint(Hash(BEGIN(i), END(i)), 0);
+        funding.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1)
+                                             << std::vector<unsigned char>(33, 2);
+        for (unsigned j = 0; j < 2; j++) {
+            const CKeyID key = MakeBenchKey((i * 2 + j) % BENCH_KEY_COUNT).GetPubKey().GetID();
+            funding.vout.push_back(CTxOut(BENCH_OUTPUT_VALUE, GetScriptForDestination(key)));
+        }
+
+        CTransaction spending;
+        spending.nTime = blocks.spending.nTime;
+        for (unsigned j = 0; j < 2; j++) {
+            spending.vin.push_back(CTxIn(COutPoint(funding.GetHash(), j)));
+            const CKeyID key = MakeBenchKey((i * 2 + j + 1) % BENCH_KEY_COUNT).GetPubKey().GetID();
+            spending.vout.push_back(
+                CTxOut(BENCH_OUTPUT_VALUE - BENCH_FEE / 2, GetScriptForDestination(key)));
+        }
+        for (unsigned j = 0; j < 2; j++) {
+            if (SignSignature(keystore, funding, spending, j) != SignatureState::Verified) {
+                throw std::runtime_error("Failed to sign a transaction of the benchmark blocks");
+            }
+        }
+
+        blocks.funding.vtx.push_back(funding);
+        blocks.spending.vtx.push_back(spending);
+    }
+
+    blocks.funding.hashMerkleRoot  = blocks.funding.GetMerkleRoot();
+    blocks.spending.hashPrevBlock  = blocks.funding.GetHash();
+    blocks.spending.hashMerkleRoot = blocks.spending.GetMerkleRoot();
+    return blocks;
+}
+
+const BenchSpendingBlocks& GetBenchSpendingBlocks()
+{
+    static const BenchSpendingBlocks blocks = MakeBenchSpendingBlocks();
+    return blocks;
+}
+
+static std::unique_ptr<CTxDB> benchTxDB;
+
+void InitBenchTxDB()
+{
+    CTxDB::DB_DIR                         = "bench-txdb";
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB::__deleteDb();
+}
+
+CTxDB& GetBenchTxDB()
+{
+    if (benchTxDB) {
+        return *benchTxDB;
+    }
+
+    benchTxDB.reset(new CTxDB);
+
+    // the block and the index of its transactions are stored the way ConnectBlock() stores them, so
+    // that reading a transaction reads it from within the block
+    const CBlock& funding  = GetBenchSpendingBlocks().funding;
+    const uint256 hash     = funding.GetHash();
+    bool          fWritten = benchTxDB->WriteBlock(hash, funding);
+    unsigned int  nTxPos   = ::GetSerializeSize(CBlock(), SER_DISK, CLIENT_VERSION) -
+                          (2 * GetSizeOfCompactSize(0)) + GetSizeOfCompactSize(funding.vtx.size());
+    for (const CTransaction& tx : funding.vtx) {
+        const CTxIndex txindex(CDiskTxPos(hash, nTxPos), tx.vout.size());
+        fWritten = fWritten && benchTxDB->UpdateTxIndex(tx.GetHash(), txindex);
+        nTxPos += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+    }
+    if (!fWritten) {
+        throw std::runtime_error("Failed to write the funding block to the benchmark database");
+    }
+    return *benchTxDB;
+}
+
+void CloseBenchTxDB()
+{
+    if (benchTxDB) {
+        benchTxDB->Close();
+        benchTxDB.reset();
+    }
+    CTxDB::__deleteDb();
+}
+
+static CTransaction TxFromHex(const std::string& hex)
+{
+    CDataStream  stream(ParseHex(hex), SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction tx;
+    stream >> tx;
+    return tx;
+}
+
+const CTransaction& GetRecordedNTP1Transfer()
+{
+    static const CTransaction tx = TxFromHex(
+        "01000000f554a35a0247b394148396ef78de65f4792e57bb93f9322e0a42f923e52d39530915a96617010000006"
+        "a47304402200cfdd8969cb137ee5a1dde2bed954ab8ae88fb4703125e4ec103b2f21787fa27022079ffc6a52a62"
+        "d1eb8aa78f831faa038fde8549ec446cb0f7427db77c7d3ddb59012103331393f9487ef4b318ae79972f3ccc84b"
+        "15d0718d7e05720c454404e67d51d1affffffff120665b0c7b62c2b7e3b3d3bacd9947eefc5b80d42b9a15a2c84"
+        "bd1f40811411030000006a47304402205c7d97ee153e83c54f5c61221acec7b8b60786fca80e59e45ecbf1736a7"
+        "f459a02207147d019151d91143d6289d37d49b3ad63952830dc42a79bf262ebaee5da6040012103331393f9487e"
+        "f4b318ae79972f3ccc84b15d0718d7e05720c454404e67d51d1affffffff0410270000000000001976a91471877"
+        "06893521dd4d61a843d241c5f52f32d7e6188ac10270000000000001976a9143f7eb8c3da2cbe606fd5d46b11ab"
+        "9211705770db88ac10270000000000000e6a0c4e5401150020120169895242409c0000000000001976a9143f7eb"
+        "8c3da2cbe606fd5d46b11ab9211705770db88ac00000000");
+    return tx;
+}
+
+const std::vector<CTransaction>& GetRecordedNTP1TransferInputs()
+{
+    static const std::vector<CTransaction> inputs{
+        TxFromHex(
+            "01000000d654a35a02b5b4c0f4608d996f7ccf68a74c7832b151fed86376defd0be51570f6695ea42a01000000"
+            "6b483045022100ecbaf16008ccb4c7084d2e28b875adbfcb8cb1012e305ae503b646a075693f340220404eb96a"
+            "b60496c8d52a06a4286e2916e9f70304b1ff3f1663c938cae7f08f01012103331393f9487ef4b318ae79972f3c"
+            "cc84b15d0718d7e05720c454404e67d51d1affffffffebd3fcb84b4019229f8c85e5d0c736f4eb17637cce2453"
+            "69d6a7b51b56a2026b030000006b483045022100b02f6f5d4c0b2e88d5d7226e0f22ed37938b79e242b0f8d626"
+            "0b14e00ab728120220549ecc61e8318105ad9255a54af4ee0966810e42fbf84a9fa7ef7c4892c41c3501210333"
+            "1393f9487ef4b318ae79972f3ccc84b15d0718d7e05720c454404e67d51d1affffffff04102700000000000019"
+            "76a91486061d16eafa0ea7a6be8875fb5bbc09a5f210a588ac10270000000000001976a9143f7eb8c3da2cbe60"
+            "6fd5d46b11ab9211705770db88ac10270000000000000e6a0c4e5401150020120169895252409c000000000000"
+            "1976a9143f7eb8c3da2cbe606fd5d46b11ab9211705770db88ac00000000"),
+        TxFromHex(
+            "010000007c3fa35a0220b900bf90ba01c5e0b560261871c35ec84b2bcf1bb6a4c38f76554a53d9378e01000000"
+            "6b483045022100fa4e87b9bc64d12b757a1ddd8a680239e8b11c8ca6496a212ffa726b0b79c1c202204e39d577"
+            "6ec175580429acdf7f2d80b6ee42c845c64c884f70138811c6931db0012103331393f9487ef4b318ae79972f3c"
+            "cc84b15d0718d7e05720c454404e67d51d1affffffff04946f748b2ec8662ad584e09f6408636effbadf7dc59b"
+            "168a50d028aa0f827a010000006b483045022100c04d60412ff55eae4e735ca2022f84d797a72156c26523a555"
+            "79f5e8f8e7ffd702201c1e361451496b00ef8d47cd0e11fb2a30aca335583bf53b76fec3951a4d557601210333"
+            "1393f9487ef4b318ae79972f3ccc84b15d0718d7e05720c454404e67d51d1affffffff04102700000000000019"
+            "76a9146732468b6fe071d7004a5d9bddaacc3a71423acd88ac10270000000000001976a9143f7eb8c3da2cbe60"
+            "6fd5d46b11ab9211705770db88ac10270000000000000e6a0c4e5401150020120169895c3270110100000000"
+            "001976a9143f7eb8c3da2cbe606fd5d46b11ab9211705770db88ac00000000")};
+    return inputs;
+}
@@ -0,0 +1,58 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include "block.h"
+#include "key.h"
+#include "transaction.h"
+
+#include <vector>
+
+class CTxDB;
+
+// The data the benchmarks run on. The synthetic fixtures are built the same way on every run, from
+// fixed keys and amounts, so that timings can be compared between runs and builds; the recorded
+// fixtures are taken from mainnet.
+
+static const int BENCH_BLOCK_TX_COUNT = 1000;
+
+/** a key made from a fixed secret */
+CKey MakeBenchKey(unsigned n);
+
+/**
+ * A block of pay-to-pubkey-hash transactions with two inputs and two outputs each, the most common
+ * shape on chain. The signatures are fake, but have the size of real ones: too big to be stored inline
+ * in a script, while the scriptPubKeys aren't.
+ */
+CBlock MakeBenchBlock();
+
+/**
+ * Two blocks, the second of which spends the outputs of the first with real signatures. The first is
+ * stored in the database of GetBenchTxDB(), so the second can be connected on top of it.
+ */
+struct BenchSpendingBlocks
+{
+    CBlock funding;
+    CBlock spending;
+};
+
+const BenchSpendingBlocks& GetBenchSpendingBlocks();
+
+/**
+ * Points the database at an empty one in the data directory, which isn't downloaded with QuickSync;
+ * to be called before it's opened, as code under benchmark may open it too (ExtractDestination() does).
+ */
+void InitBenchTxDB();
+
+/** the database of InitBenchTxDB(), with the funding block and its transaction index stored in it */
+CTxDB& GetBenchTxDB();
+
+/** closes and deletes the database of InitBenchTxDB() */
+void CloseBenchTxDB();
+
+/** the mainnet NTP1 transfer 006bd375946e903aa20aced1b411d61d14175488650e1deab3cb5ff8f354467d */
+const CTransaction& GetRecordedNTP1Transfer();
+
+/** the transactions that the inputs of GetRecordedNTP1Transfer() spend, in order */
+const std::vector<CTransaction>& GetRecordedNTP1TransferInputs();
+
+#endif // BENCH_FIXTURES_H
@@ -0,0 +1,122 @@
+#include "bench/bench.h"
+#include "bench/fixtures.h"
+
+#include "ntp1/ntp1checkedint.h"
+#include "ntp1/ntp1script.h"
+#include "ntp1/ntp1transaction.h"
+#include "ntp1/ntp1txout.h"
+
+#include <cassert>
+#include <numeric>
+
+static std::vector<NTP1Int> MakeTokenAmounts()
+{
+    // amounts of the size seen on chain, all below NTP1MaxAmount
+    std::vector<NTP1Int> amounts;
+    for (int i = 0; i < 1000; i++) {
+        amounts.push_back(NTP1Int(999965300) * (i + 1) + i);
+    }
+    return amounts;
+}
+
+static void NTP1IntSum(benchmark::State& state)
+{
+    const std::vector<NTP1Int> amounts = MakeTokenAmounts();
+    while (state.KeepRunning()) {
+        NTP1Int total = std::accumulate(amounts.begin(), amounts.end(), NTP1Int(0));
+        for (const NTP1Int& amount : amounts) {
+            total -= amount;
+        }
+        assert(total == 0);
+    }
+}
+
+static void NTP1CheckedIntSum(benchmark::State& state)
+{
+    const std::vector<NTP1Int>        bigAmounts = MakeTokenAmounts();
+    const std::vector<NTP1CheckedInt> amounts(bigAmounts.begin(), bigAmounts.end());
+    while (state.KeepRunning()) {
+        NTP1CheckedInt total = std::accumulate(amounts.begin(), amounts.end(), NTP1CheckedInt(0));
+        for (const NTP1CheckedInt& amount : amounts) {
+            total -= amount;
+        }
+        assert(total == 0);
+    }
+}
+
+static NTP1TxOut MakeTokenOutput(int64_t nValue, const NTP1Int& amount)
+{
+    NTP1TokenTxData token;
+    token.setAggregationPolicy("aggregable");
+    token.setAmount(amount);
+    token.setDivisibility(7);
+    token.setIssueTxIdHex("66216fa9cc0167568c3e5f8b66e7fe3690072f66a5f41df222327de7af10ff80");
+    token.setLockStatus(true);
+    token.setTokenId("LaA5grPQMDhwvciWFqxwG1ySDqNHAgms1yLrPp");
+    token.setTokenSymbol("NIBBL");
+
+    NTP1TxOut result;
+    result.__manualSet(nValue, "", "", std::vector<NTP1TokenTxData>({token}), "");
+    return result;
+}
+
+static std::pair<CTransaction, NTP1Transaction>
+MakeTransferInput(const CTransaction& tx, const NTP1Int& amount0, const NTP1Int& amount1)
+{
+    NTP1TxOut emptyOutput;
+    emptyOutput.__manualSet(10000, "", "", std::vector<NTP1TokenTxData>(), "");
+
+    NTP1Transaction ntp1tx;
+    ntp1tx.__manualSet(1, tx.GetHash(), std::vector<unsigned char>(), std::vector<NTP1TxIn>{},
+                       std::vector<NTP1TxOut>{MakeTokenOutput(10000, amount0),
+                                              MakeTokenOutput(10000, amount1), emptyOutput,
+                                              emptyOutput},
+                       0, 1520653825000, NTP1TxType_TRANSFER);
+    return std::make_pair(tx, ntp1tx);
+}
+
+/** the recorded mainnet transfer, with the token amounts its inputs had */
+static void NTP1TransferTokens(benchmark::State& state)
+{
+    const CTransaction& tx = GetRecordedNTP1Transfer();
+
+    const std::vector<std::pair<CTransaction, NTP1Transaction>> inputs{
+        MakeTransferInput(GetRecordedNTP1TransferInputs()[0], 100, 999965300),
+        MakeTransferInput(GetRecordedNTP1TransferInputs()[1], 100, 999981100)};
+
+    while (state.KeepRunning()) {
+        NTP1Transaction ntp1tx;
+        ntp1tx.readNTP1DataFromTx(tx, inputs);
+        assert(ntp1tx.getTxOut(1).getToken(0).getAmount() == 999965200);
+    }
+}
+
+static const std::vector<std::string> NTP1ScriptsToParse{
+    "4e5401014e4942424cab10c04e20e0aec73d58c8fbf2a9c26a6dc3ed666c7b80fef2"
+    "15620c817703b1e5d8b1870211ce7cdf50718b4789245fb80f58992019002019f0",
+    "4e5401150020120169895242", "4e5401251f2013", "4e540310050320510420410520e20638b10719",
+    "4e5403200200081f02"};
+
+static void NTP1ParseScript(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        for (const std::string& script : NTP1ScriptsToParse) {
+            NTP1Script::ParseScript(script);
+        }
+    }
+}
+
+static void NTP1ParseScriptLegacy(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        for (const std::string& script : NTP1ScriptsToParse) {
+            NTP1Script::ParseScriptLegacy(script);
+        }
+    }
+}
+
+BENCHMARK(NTP1IntSum);
+BENCHMARK(NTP1CheckedIntSum);
+BENCHMARK(NTP1TransferTokens);
+BENCHMARK(NTP1ParseScript);
+BENCHMARK(NTP1ParseScriptLegacy);
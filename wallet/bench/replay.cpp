@@ -0,0 +1,210 @@
+#include "bench/replay.h"
+
+#include "block.h"
+#include "blockindex.h"
+#include "chainparams.h"
+#include "checkpoints.h"
+#include "globals.h"
+#include "json_spirit.h"
+#include "main.h"
+#include "util.h"
+#include "validationtimes.h"
+
+#undef printf
+
+#include <algorithm>
+#include <boost/filesystem/fstream.hpp>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace benchmark {
+
+/** the time connecting the blocks took, and the part of it that each phase took */
+struct ReplayTimes
+{
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds deserialize{0};
+    uint64_t                 blocks   = 0;
+    uint64_t                 txs      = 0;
+    uint64_t                 rejected = 0;
+};
+
+/** reads the next block of a bootstrap file; returns false at the end of it */
+static bool ReadBootstrapBlock(std::istream& file, CBlock& block, std::chrono::nanoseconds& deserialize)
+{
+    CMessageHeader::MessageStartChars messageStart;
+    if (!file.read(reinterpret_cast<char*>(messageStart), sizeof(messageStart))) {
+        return false;
+    }
+    if (std::memcmp(messageStart, Params().MessageStart(), sizeof(messageStart)) != 0) {
+        throw std::runtime_error("Invalid message start in the bootstrap file at position " +
+                                 std::to_string(static_cast<int64_t>(file.tellg()) - 4));
+    }
+
+    uint32_t nSize = 0;
+    if (!file.read(reinterpret_cast<char*>(&nSize), sizeof(nSize)) || nSize > MAX_BLOCK_SIZE) {
+        throw std::runtime_error("Invalid block size in the bootstrap file");
+    }
+    std::vector<char> serialized(nSize);
+    if (!file.read(serialized.data(), serialized.size())) {
+        throw std::runtime_error("The bootstrap file ends in the middle of a block");
+    }
+
+    const auto  start = std::chrono::steady_clock::now();
+    CDataStream ss(serialized, SER_DISK, CLIENT_VERSION);
+    ss >> block;
+    deserialize = std::chrono::steady_clock::now() - start;
+    return true;
+}
+
+static void PrintReplayTimes(const ReplayOptions& options, const ReplayTimes& times)
+{
+    const uint64_t blocks = std::max<uint64_t>(1, times.blocks);
+
+    std::vector<std::pair<std::string, std::chrono::nanoseconds>> phases;
+    phases.push_back(std::make_pair("Deserialize", times.deserialize));
+    std::chrono::nanoseconds measured = times.deserialize;
+    for (unsigned i = 0; i < static_cast<unsigned>(ValidationPhase::Count); i++) {
+        const ValidationPhase phase = static_cast<ValidationPhase>(i);
+        phases.push_back(std::make_pair(ValidationTimes::PhaseName(phase), ValidationTimes::Get(phase)));
+        measured += phases.back().second;
+    }
+    // the phases don't overlap, so more than the total means one of them was counted twice
+    if (measured > times.total) {
+        throw std::runtime_error("The phases took longer than the total, " +
+                                 std::to_string(measured.count()) + "ns > " +
+                                 std::to_string(times.total.count()) + "ns");
+    }
+    // every block in the range is committed in the total, so nothing committed means it wasn't timed
+    if (times.blocks > 0 && ValidationTimes::Get(ValidationPhase::DbCommit).count() == 0) {
+        throw std::runtime_error("No time was spent committing the blocks to the database");
+    }
+    // whatever the phases don't cover: the block index, the wallets, the locks, and so on
+    phases.push_back(std::make_pair("Other", times.total - measured));
+    phases.push_back(std::make_pair("Total", times.total));
+
+    std::printf("# %" PRIu64 " blocks, %" PRIu64 " transactions, %" PRIu64
+                " rejected, heights %d to %d\n",
+                times.blocks, times.txs, times.rejected, options.nFromHeight, options.nToHeight);
+    // ConnectInputs() doesn't verify the signatures of the blocks up to the last checkpoint, so the
+    // script checks of that part of the range aren't timed at all
+    const int nScriptChecksFrom = Checkpoints::GetTotalBlocksEstimate() + 1;
+    if (options.nFromHeight < nScriptChecksFrom) {
+        std::printf("# note: signatures aren't checked up to the last checkpoint, so %s only covers "
+                    "heights from %d\n",
+                    ValidationTimes::PhaseName(ValidationPhase::ScriptChecks),
+                    std::max(nScriptChecksFrom, options.nFromHeight));
+    }
+    std::printf("#Phase,Total(s),Per block(us),Share(%%)\n");
+
+    json_spirit::Array jsonPhases;
+    for (const auto& p : phases) {
+        const double total    = std::chrono::duration<double>(p.second).count();
+        const double perBlock = std::chrono::duration<double, std::micro>(p.second).count() / blocks;
+        const double share =
+            times.total.count() > 0 ? 100. * p.second.count() / times.total.count() : 0;
+        std::printf("%s,%.6f,%.1f,%.1f\n", p.first.c_str(), total, perBlock, share);
+
+        json_spirit::Object phase;
+        phase.push_back(json_spirit::Pair("name", p.first));
+        phase.push_back(json_spirit::Pair("total_s", total));
+        phase.push_back(json_spirit::Pair("per_block_us", perBlock));
+        phase.push_back(json_spirit::Pair("share_percent", share));
+        jsonPhases.push_back(phase);
+    }
+
+    if (options.jsonPath.empty()) {
+        return;
+    }
+    json_spirit::Object root;
+    root.push_back(json_spirit::Pair("version", FormatFullVersion()));
+    root.push_back(json_spirit::Pair("file", options.file.string()));
+    root.push_back(json_spirit::Pair("from_height", options.nFromHeight));
+    root.push_back(json_spirit::Pair("to_height", options.nToHeight));
+    root.push_back(json_spirit::Pair("blocks", times.blocks));
+    root.push_back(json_spirit::Pair("transactions", times.txs));
+    root.push_back(json_spirit::Pair("rejected", times.rejected));
+    root.push_back(json_spirit::Pair("script_checks_from_height",
+                                     std::max(nScriptChecksFrom, options.nFromHeight)));
+    root.push_back(json_spirit::Pair("phases", jsonPhases));
+
+    std::ofstream file(options.jsonPath, std::ios::trunc);
+    file << json_spirit::write_formatted(root) << "\n";
+    if (!file.good()) {
+        throw std::runtime_error("Failed to write the results to " + options.jsonPath);
+    }
+}
+
+void RunReplay(const ReplayOptions& options)
+{
+    boost::filesystem::ifstream file(options.file, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + options.file.string());
+    }
+
+    if (!LoadBlockIndex()) {
+        throw std::runtime_error("Failed to load the block index");
+    }
+
+    // blocks are committed in batches, as they are when a bootstrap file is imported; with
+    // -ibdbatchsize=0 every block is committed on its own. Nothing else runs, so cs_main is held
+    // throughout, which the batches need
+    LOCK(cs_main);
+    CBlockWriteBatchScope blockWriteBatch;
+
+    ReplayTimes              times;
+    bool                     fTiming = false;
+    CBlock                   block;
+    std::chrono::nanoseconds deserialize;
+    while (ReadBootstrapBlock(file, block, deserialize)) {
+        if (LookupBlockIndex(block.GetHash()) != nullptr) {
+            continue; // the genesis block, or one that came twice
+        }
+
+        // the height of an orphan isn't known until its parent comes
+        const CBlockIndex* pindexPrev = LookupBlockIndex(block.hashPrevBlock);
+        const int          nHeight    = pindexPrev ? pindexPrev->nHeight + 1 : -1;
+        if (nHeight > options.nToHeight) {
+            break;
+        }
+        if (!fTiming && nHeight >= options.nFromHeight) {
+            fTiming = true;
+            ValidationTimes::Reset();
+        }
+
+        SetMockTime(block.nTime + 24 * 60 * 60);
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool fAccepted = ProcessBlock(nullptr, &block);
+        if (fTiming) {
+            times.deserialize += deserialize;
+            times.total += std::chrono::steady_clock::now() - start + deserialize;
+            times.blocks++;
+            times.txs += block.vtx.size();
+            times.rejected += fAccepted ? 0 : 1;
+        }
+    }
+    SetMockTime(0);
+
+    // the last batch would otherwise only be committed when the scope ends, after the times are printed
+    if (fTiming) {
+        const auto start = std::chrono::steady_clock::now();
+        FlushBlockWriteBatch(true);
+        times.total += std::chrono::steady_clock::now() - start;
+    }
+    if (fShutdown) {
+        throw std::runtime_error("Failed to commit the replayed blocks");
+    }
+
+    if (!fTiming) {
+        throw std::runtime_error("The bootstrap file has no blocks from height " +
+                                 std::to_string(options.nFromHeight));
+    }
+    PrintReplayTimes(options, times);
+}
+
+} // namespace benchmark
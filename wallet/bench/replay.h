@@ -0,0 +1,27 @@
+#ifndef BENCH_REPLAY_H
+#define BENCH_REPLAY_H
+
+#include <boost/filesystem/path.hpp>
+#include <string>
+
+namespace benchmark {
+
+struct ReplayOptions
+{
+    boost::filesystem::path file;        // a bootstrap file, as ExportBootstrapBlockchain() writes
+    int                     nFromHeight; // the first height timed; the ones below are connected untimed
+    int                     nToHeight;   // the last height replayed
+    std::string             jsonPath;    // where the results are written as JSON too, if not empty
+};
+
+/**
+ * Connects the blocks of a bootstrap file to the chain of the database in order, as they're imported,
+ * and prints the time spent in each phase of validating the blocks of the range; throws if the file
+ * can't be read. The clock is mocked to a day after each block, so that a replay doesn't depend on
+ * when it's run. Signatures aren't checked up to the last checkpoint, which the output notes.
+ */
+void RunReplay(const ReplayOptions& options);
+
+} // namespace benchmark
+
+#endif // BENCH_REPLAY_H
@@ -0,0 +1,64 @@
+#include "bench/bench.h"
+#include "bench/fixtures.h"
+
+#include "txdb.h"
+#include "txindex.h"
+
+#include <cassert>
+#include <vector>
+
+// Reads from the database of the fixtures, which is small enough to stay in the page cache; so these
+// measure the lookups and the deserialization, not the disk.
+
+static std::vector<uint256> GetFundingTxHashes()
+{
+    std::vector<uint256> hashes;
+    for (const CTransaction& tx : GetBenchSpendingBlocks().funding.vtx) {
+        hashes.push_back(tx.GetHash());
+    }
+    return hashes;
+}
+
+static void TxDBReadTxIndex(benchmark::State& state)
+{
+    const CTxDB&               txdb   = GetBenchTxDB();
+    const std::vector<uint256> hashes = GetFundingTxHashes();
+
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        CTxIndex   txindex;
+        const bool fFound = txdb.ReadTxIndex(hashes[i++ % hashes.size()], txindex);
+        assert(fFound);
+    }
+}
+
+/** a transaction found through its index, as inputs are fetched when they're connected */
+static void TxDBReadDiskTx(benchmark::State& state)
+{
+    const CTxDB&               txdb   = GetBenchTxDB();
+    const std::vector<uint256> hashes = GetFundingTxHashes();
+
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        CTransaction tx;
+        CTxIndex     txindex;
+        const bool   fFound = txdb.ReadDiskTx(hashes[i++ % hashes.size()], tx, txindex);
+        assert(fFound);
+    }
+}
+
+static void TxDBReadBlock(benchmark::State& state)
+{
+    const CTxDB&  txdb = GetBenchTxDB();
+    const uint256 hash = GetBenchSpendingBlocks().funding.GetHash();
+
+    while (state.KeepRunning()) {
+        CBlock     block;
+        const bool fFound = txdb.ReadBlock(hash, block);
+        assert(fFound);
+    }
+}
+
+BENCHMARK(TxDBReadTxIndex);
+BENCHMARK(TxDBReadDiskTx);
+BENCHMARK(TxDBReadBlock);
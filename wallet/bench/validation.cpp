@@ -0,0 +1,122 @@
+#include "bench/bench.h"
+#include "bench/fixtures.h"
+
+#include "block.h"
+#include "blockindex.h"
+#include "chainparams.h"
+#include "script.h"
+#include "txdb.h"
+
+#include <boost/make_shared.hpp>
+#include <cassert>
+
+uint256 SignatureHash(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+
+/** the checks of a block that don't depend on the chain, without its proof of work */
+static void CheckBlockSynthetic(benchmark::State& state)
+{
+    const CTxDB& txdb    = GetBenchTxDB();
+    CBlock       block   = MakeBenchBlock();
+    block.hashMerkleRoot = block.GetMerkleRoot();
+
+    while (state.KeepRunning()) {
+        const bool fValid = block.CheckBlock(txdb, false, true, false);
+        assert(fValid);
+    }
+}
+
+/**
+ * Connects a block of 250 transactions that spend two outputs each, with every signature verified,
+ * on top of the block it spends, without writing its transactions to the database
+ */
+static void ConnectBlockSynthetic(benchmark::State& state)
+{
+    CTxDB& txdb  = GetBenchTxDB();
+    CBlock block = GetBenchSpendingBlocks().spending;
+
+    const CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>(block);
+    pindex->phashBlock               = block.GetHash();
+    pindex->nHeight                  = 1;
+
+    while (state.KeepRunning()) {
+        const bool fConnected = block.ConnectBlock(txdb, pindex, true);
+        assert(fConnected);
+    }
+}
+
+static void SignatureHashSynthetic(benchmark::State& state)
+{
+    const BenchSpendingBlocks& blocks     = GetBenchSpendingBlocks();
+    const CTransaction&        txFrom     = blocks.funding.vtx[1];
+    const CTransaction&        txTo       = blocks.spending.vtx[1];
+    const CScript&             scriptCode = txFrom.vout[txTo.vin[0].prevout.n].scriptPubKey;
+
+    while (state.KeepRunning()) {
+        const uint256 hash = SignatureHash(scriptCode, txTo, 0, SIGHASH_ALL);
+        assert(hash != 0);
+    }
+}
+
+/** the hash of one input of a transaction that spends many, which copies all of them */
+static void SignatureHashManyInputs(benchmark::State& state)
+{
+    const CBlock& funding = GetBenchSpendingBlocks().funding;
+
+    CTransaction txTo;
+    txTo.nTime = funding.nTime;
+    for (std::size_t i = 1; i < funding.vtx.size() && txTo.vin.size() < 100; i++) {
+        txTo.vin.push_back(CTxIn(COutPoint(funding.vtx[i].GetHash(), 0)));
+        txTo.vin.back().scriptSig = CScript() << std::vector<unsigned char>(72, 1)
+                                              << std::vector<unsigned char>(33, 2);
+    }
+    txTo.vout.push_back(CTxOut(COIN, funding.vtx[1].vout[0].scriptPubKey));
+    const CScript& scriptCode = funding.vtx[1].vout[0].scriptPubKey;
+
+    while (state.KeepRunning()) {
+        const uint256 hash = SignatureHash(scriptCode, txTo, 50, SIGHASH_ALL);
+        assert(hash != 0);
+    }
+}
+
+/** the script and the signature of one input, as ConnectInputs() verifies them */
+static void CheckSigSynthetic(benchmark::State& state)
+{
+    const BenchSpendingBlocks& blocks = GetBenchSpendingBlocks();
+    const CTransaction&        txFrom = blocks.funding.vtx[1];
+    const CTransaction&        txTo   = blocks.spending.vtx[1];
+
+    while (state.KeepRunning()) {
+        const bool fValid = VerifySignature(txFrom, txTo, 0, true, false, 0).isOk();
+        assert(fValid);
+    }
+}
+
+static void CheckSigRecorded(benchmark::State& state)
+{
+    const CTransaction& txFrom = GetRecordedNTP1TransferInputs()[0];
+    const CTransaction& txTo   = GetRecordedNTP1Transfer();
+
+    while (state.KeepRunning()) {
+        const bool fValid = VerifySignature(txFrom, txTo, 0, true, false, 0).isOk();
+        assert(fValid);
+    }
+}
+
+/** the scrypt hash of a block header, which is also the hash of the block */
+static void PoWHashGenesis(benchmark::State& state)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+
+    while (state.KeepRunning()) {
+        const uint256 hash = genesis.GetPoWHash();
+        assert(hash == Params().GenesisBlockHash());
+    }
+}
+
+BENCHMARK(CheckBlockSynthetic);
+BENCHMARK(ConnectBlockSynthetic);
+BENCHMARK(SignatureHashSynthetic);
+BENCHMARK(SignatureHashManyInputs);
+BENCHMARK(CheckSigSynthetic);
+BENCHMARK(CheckSigRecorded);
+BENCHMARK(PoWHashGenesis);
@@ -11,6 +11,7 @@
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "validationinterface.h"
 
 #undef printf
 #include <boost/algorithm/string.hpp>
@@ -279,6 +280,9 @@ static const CRPCCommand vRPCCommands[] =
     { "disconnectnode",            &disconnectnode,            true,   false },
     { "setmocktime",               &setmocktime,               false,  false },
     { "getpeerinfo",               &getpeerinfo,               true,   false },
+    { "getmetrics",                &getmetrics,                true,   true  },
+    { "setlockprofiling",          &setlockprofiling,          true,   true  },
+    { "getlockcontention",         &getlockcontention,         true,   true  },
     { "getdifficulty",             &getdifficulty,             true,   false },
     { "getinfo",                   &getinfo,                   true,   false },
     { "getsubsidy",                &getsubsidy,                true,   false },
@@ -343,11 +347,11 @@ static const CRPCCommand vRPCCommands[] =
     { "listaccounts",              &listaccounts,              false,  false },
     { "settxfee",                  &settxfee,                  false,  false },
     { "getblocktemplate",          &getblocktemplate,          true,   false },
-    { "submitblock",               &submitblock,               false,  false },
+    { "submitblock",               &submitblock,               false,  true  },
     { "generateblockwithkey",      &generateblockwithkey,      false,  false },
-    { "generatepos",               &generatepos,               false,  false },
-    { "generate",                  &generate,                  false,  false },
-    { "generatetoaddress",         &generatetoaddress,         false,  false },
+    { "generatepos",               &generatepos,               false,  true  },
+    { "generate",                  &generate,                  false,  true  },
+    { "generatetoaddress",         &generatetoaddress,         false,  true  },
     { "listsinceblock",            &listsinceblock,            false,  false },
     { "dumpprivkey",               &dumpprivkey,               false,  false },
     { "dumppubkey",                &dumppubkey,                false,  false },
@@ -364,7 +368,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getscriptpubkeyfromaddress",&getscriptpubkeyfromaddress,false,  false },
     { "getscriptpubkeyforp2cs",    &getscriptpubkeyforp2cs,    false,  false },
     { "signrawtransaction",        &signrawtransaction,        false,  false },
-    { "sendrawtransaction",        &sendrawtransaction,        false,  false },
+    { "sendrawtransaction",        &sendrawtransaction,        false,  true  },
     { "reservebalance",            &reservebalance,            false,  true  },
     { "resendtx",                  &resendtx,                  false,  true  },
     { "makekeypair",               &makekeypair,               false,  true  },
@@ -372,7 +376,15 @@ static const CRPCCommand vRPCCommands[] =
     { "exportblockchain",          &exportblockchain,          false,  false },
     { "getblockchaininfo",         &getblockchaininfo,         false,  false },
     { "getblockheader",            &getblockheader,            false,  false },
-    { "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, true, false },
+    { "getntp1addressbalances",    &getntp1addressbalances,    false,  false },
+    { "getntp1tokeninfo",          &getntp1tokeninfo,          false,  false },
+    { "getntp1tokenholders",       &getntp1tokenholders,       false,  false },
+    { "getaddresstxids",           &getaddresstxids,           false,  false },
+    { "getaddressutxos",           &getaddressutxos,           false,  false },
+    { "getaddressbalance",         &getaddressbalance,         false,  false },
+    { "getspentinfo",              &getspentinfo,              false,  false },
+    { "getblockfilter",            &getblockfilter,            false,  false },
+    { "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, true, true },
 };
 // clang-format on
 
@@ -1380,6 +1392,18 @@ Array RPCConvertValues(const std::string& strMethod, const std::vector<std::stri
         ConvertTo<Array>(params[3]);
     if (strMethod == "generateblockwithkey" && n > 4)
         ConvertTo<int64_t>(params[4]);
+    if (strMethod == "getaddresstxids" && n > 1)
+        ConvertTo<int64_t>(params[1]);
+    if (strMethod == "getaddresstxids" && n > 2)
+        ConvertTo<int64_t>(params[2]);
+    if (strMethod == "getspentinfo" && n > 1)
+        ConvertTo<int64_t>(params[1]);
+    if (strMethod == "setlockprofiling" && n > 0)
+        ConvertTo<int64_t>(params[0]);
+    if (strMethod == "getlockcontention" && n > 0)
+        ConvertTo<int64_t>(params[0]);
+    if (strMethod == "getlockcontention" && n > 1)
+        ConvertTo<bool>(params[1]);
 
     return params;
 }
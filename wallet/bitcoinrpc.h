@@ -186,6 +186,9 @@ extern json_spirit::Value disconnectnode(const json_spirit::Array& params, bool
 extern json_spirit::Value setmocktime(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value sendalert(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getpeerinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getmetrics(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value setlockprofiling(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getlockcontention(const json_spirit::Array& params, bool fHelp);
 
 // in rpcdump.cpp
 extern json_spirit::Value dumpwallet(const json_spirit::Array& params, bool fHelp);
@@ -293,10 +296,19 @@ extern json_spirit::Value getblockbynumber(const json_spirit::Array& params, boo
 extern json_spirit::Value gettxout(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value exportblockchain(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value waitforblockheight(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getntp1addressbalances(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getntp1tokeninfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getntp1tokenholders(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getaddresstxids(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getaddressutxos(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getaddressbalance(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getspentinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getblockfilter(const json_spirit::Array& params, bool fHelp);
 
 std::vector<NTP1SendTokensOneRecipientData>
      GetNTP1RecipientsVector(const json_spirit::Value& sendTo, boost::shared_ptr<NTP1Wallet> ntp1wallet,
                              bool getDataStrictlyFromNTP1Wallet = true);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, json_spirit::Object& out, bool fIncludeHex);
+std::string GetTokenIDFromTokenName(const std::string& tokenName);
 
 #endif
@@ -1,22 +1,51 @@
 #include "block.h"
 
 #include "NetworkForks.h"
+#include "addressindex.h"
+#include "blockencodings.h"
+#include "blockfilterindex.h"
 #include "blockindex.h"
 #include "blocklocator.h"
 #include "checkpoints.h"
+#include "init.h"
 #include "kernel.h"
 #include "main.h"
 #include "merkle.h"
+#include "metrics.h"
 #include "ntp1/ntp1transaction.h"
+#include "ntp1tokenindex.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "validationtimes.h"
 #include "wallet.h"
 #include "work.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 #include <mutex>
 
+/** The stake outpoint and time aren't kept in memory; they're taken from the coinstake of the block */
+static CDiskBlockIndex MakeDiskBlockIndex(const CBlockIndex* pindex, const CBlock& block)
+{
+    if (block.IsProofOfStake()) {
+        return CDiskBlockIndex(pindex, block.vtx[1].vin[0].prevout, block.vtx[1].nTime);
+    }
+    return CDiskBlockIndex(pindex, COutPoint(), 0);
+}
+
+/** Rewrites the stored index of a block whose data isn't at hand, with hashNext as the next block; the
+ * stake fields are carried over from the stored record */
+static bool RewriteBlockIndex(CTxDB& txdb, const CBlockIndex* pindex, const uint256& hashNext)
+{
+    CDiskBlockIndex stored;
+    if (pindex->IsProofOfStake() && !txdb.ReadBlockIndex(pindex->GetBlockHash(), stored))
+        return error("RewriteBlockIndex() : ReadBlockIndex failed for block %s",
+                     pindex->GetBlockHash().ToString().c_str());
+    CDiskBlockIndex diskindex(pindex, stored.prevoutStake, stored.nStakeTime);
+    diskindex.hashNext = hashNext;
+    return txdb.WriteBlockIndex(diskindex);
+}
+
 void CBlock::print() const
 {
     printf("CBlock(hash=%s, ver=%d, hashPrevBlock=%s, hashMerkleRoot=%s, nTime=%u, nBits=%08x, "
@@ -88,9 +117,8 @@ unsigned int CBlock::GetStakeEntropyBit() const
 {
     // Take last bit of block hash as entropy bit
     unsigned int nEntropyBit = ((GetHash().Get64()) & 1llu);
-    if (fDebug)
-        printf("GetStakeEntropyBit: hashBlock=%s nEntropyBit=%u\n", GetHash().ToString().c_str(),
-               nEntropyBit);
+    LogPrint(LOG_STAKE, "GetStakeEntropyBit: hashBlock=%s nEntropyBit=%u\n",
+             GetHash().ToString().c_str(), nEntropyBit);
     return nEntropyBit;
 }
 
@@ -134,6 +162,11 @@ void CBlock::UpdateTime(const CBlockIndex* /*pindexPrev*/)
 
 bool CBlock::DisconnectBlock(CTxDB& txdb, CBlockIndexSmartPtr& pindex)
 {
+    if (!DisconnectBlockNTP1TokenIndex(*this, pindex->nHeight, txdb))
+        return error("DisconnectBlock() : failed to update the NTP1 token index");
+    if (!DisconnectBlockAddressIndex(*this, pindex->nHeight, txdb))
+        return error("DisconnectBlock() : failed to update the address index");
+
     // Disconnect in reverse order
     for (int i = vtx.size() - 1; i >= 0; i--)
         if (!vtx[i].DisconnectInputs(txdb))
@@ -142,19 +175,17 @@ bool CBlock::DisconnectBlock(CTxDB& txdb, CBlockIndexSmartPtr& pindex)
     // Update block index on disk without changing it in memory.
     // The memory index structure will be changed after the db commits.
     if (pindex->pprev) {
-        CDiskBlockIndex blockindexPrev(boost::atomic_load(&pindex->pprev).get());
-        blockindexPrev.hashNext = 0;
-        if (!txdb.WriteBlockIndex(blockindexPrev))
+        const CBlockIndexSmartPtr pindexPrev = boost::atomic_load(&pindex->pprev);
+        if (!RewriteBlockIndex(txdb, pindexPrev.get(), 0))
             return error("DisconnectBlock() : WriteBlockIndex failed");
 
         // we change the best hash. Remember this is within a transaction and will be reverted in case of
         // failure.
-        txdb.WriteHashBestChain(blockindexPrev.GetBlockHash());
+        txdb.WriteHashBestChain(pindexPrev->GetBlockHash());
     }
 
     // ppcoin: clean up wallet after disconnecting coinstake
-    for (CTransaction& tx : vtx)
-        SyncWithWallets(txdb, tx, this);
+    SyncWithWallets(txdb, *this);
 
     return true;
 }
@@ -509,7 +540,10 @@ bool CBlock::CheckBIP30Attack(CTxDB& txdb, const uint256& hashTx)
 
 bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool fJustCheck)
 {
-    printf("Connecting block: %s\n", this->GetHash().ToString().c_str());
+    static CMetricHistogram& connectHistogram = Metrics().Histogram("neblio_connect_block_seconds");
+    const CMetricTimer       timer(connectHistogram);
+
+    LogPrint(LOG_VALIDATION, "Connecting block: %s\n", this->GetHash().ToString().c_str());
 
     // Check it again in case a previous version let a bad block in, but skip BlockSig checking
     if (!CheckBlock(txdb, !fJustCheck, !fJustCheck, false))
@@ -560,7 +594,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
             return DoS(100, error("ConnectBlock() : too many sigops"));
         }
 
-        CDiskTxPos posThisTx(pindex->blockKeyInDB, nTxPos);
+        CDiskTxPos posThisTx(pindex->GetBlockHash(), nTxPos);
         if (!fJustCheck)
             nTxPos += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
 
@@ -591,6 +625,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
                 nStakeReward = nTxValueOut - nTxValueIn;
 
             if (Params().GetNetForks().isForkActivated(NetworkFork::NETFORK__3_TACHYON, txdb)) {
+                const ValidationPhaseTimer ntp1Timer(ValidationPhase::NTP1);
                 try {
                     if (NTP1Transaction::IsTxNTP1(&tx)) {
                         // check if there are inputs already cached
@@ -612,6 +647,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
             }
 
             if (EnableEnforceUniqueTokenSymbols(txdb)) {
+                const ValidationPhaseTimer ntp1Timer(ValidationPhase::NTP1);
                 try {
                     AssertIssuanceUniquenessInBlock(issuedTokensSymbolsInThisBlock, txdb, tx,
                                                     mapQueuedNTP1Inputs, mapQueuedChanges);
@@ -671,7 +707,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
     // ppcoin: track money supply and mint amount info
     pindex->nMint        = nValueOut - nValueIn + nFees;
     pindex->nMoneySupply = (pindex->pprev ? pindex->pprev->nMoneySupply : 0) + nValueOut - nValueIn;
-    if (!txdb.WriteBlockIndex(CDiskBlockIndex(pindex.get())))
+    if (!txdb.WriteBlockIndex(MakeDiskBlockIndex(pindex.get(), *this)))
         return error("Connect() : WriteBlockIndex for pindex failed");
 
     if (fJustCheck)
@@ -686,6 +722,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
 
     // This scope does NTP1 data writing
     {
+        const ValidationPhaseTimer ntp1Timer(ValidationPhase::NTP1);
         try {
             WriteNTP1BlockTransactionsToDisk(vtx, txdb);
         } catch (std::exception& ex) {
@@ -702,12 +739,20 @@ bool CBlock::ConnectBlock(CTxDB& txdb, const CBlockIndexSmartPtr& pindex, bool f
         }
     }
 
+    {
+        const ValidationPhaseTimer ntp1Timer(ValidationPhase::NTP1);
+        if (!ConnectBlockNTP1TokenIndex(*this, pindex->nHeight, txdb))
+            return error("ConnectBlock() : failed to update the NTP1 token index");
+    }
+    if (!ConnectBlockAddressIndex(*this, pindex->nHeight, txdb))
+        return error("ConnectBlock() : failed to update the address index");
+    if (!ConnectBlockFilterIndex(*this, pindex->nHeight, txdb))
+        return error("ConnectBlock() : failed to update the block filter index");
+
     // Update block index on disk without changing it in memory.
     // The memory index structure will be changed after the db commits.
     if (pindex->pprev) {
-        CDiskBlockIndex blockindexPrev(boost::atomic_load(&pindex->pprev).get());
-        blockindexPrev.hashNext = pindex->GetBlockHash();
-        if (!txdb.WriteBlockIndex(blockindexPrev))
+        if (!RewriteBlockIndex(txdb, boost::atomic_load(&pindex->pprev).get(), pindex->GetBlockHash()))
             return error("ConnectBlock() : WriteBlockIndex failed");
     }
 
@@ -737,6 +782,7 @@ bool CBlock::SetBestChainInner(CTxDB& txdb, const CBlockIndexSmartPtr& pindexNew
 
     // Add to current best branch
     pindexNew->pprev->pnext = pindexNew;
+    chainActive.SetTip(pindexNew.get());
 
     // Delete redundant memory transactions
     for (CTransaction& tx : vtx)
@@ -758,6 +804,7 @@ bool CBlock::SetBestChain(CTxDB& txdb, const CBlockIndexSmartPtr& pindexNew,
         if (createDbTransaction && !txdb.TxnCommit())
             return error("SetBestChain() : TxnCommit failed");
         pindexGenesisBlock = pindexNew;
+        chainActive.SetTip(pindexNew.get());
     } else if (hashPrevBlock == txdb.GetBestBlockHash()) {
         if (!SetBestChainInner(txdb, pindexNew, createDbTransaction))
             return error("SetBestChain() : SetBestChainInner failed");
@@ -861,7 +908,7 @@ bool CBlock::ReadFromDisk(const CBlockIndex* pindex, bool fReadTransactions)
         *this = pindex->GetBlockHeader();
         return true;
     }
-    if (!ReadFromDisk(pindex->blockKeyInDB, fReadTransactions))
+    if (!ReadFromDisk(pindex->GetBlockHash(), fReadTransactions))
         return false;
     if (GetHash() != pindex->GetBlockHash())
         return error("CBlock::ReadFromDisk() : GetHash() doesn't match index");
@@ -874,7 +921,7 @@ bool CBlock::ReadFromDisk(const CBlockIndex* pindex, const ITxDB& txdb, bool fRe
         *this = pindex->GetBlockHeader();
         return true;
     }
-    if (!ReadFromDisk(pindex->blockKeyInDB, txdb, fReadTransactions))
+    if (!ReadFromDisk(pindex->GetBlockHash(), txdb, fReadTransactions))
         return false;
     if (GetHash() != pindex->GetBlockHash())
         return error("CBlock::ReadFromDisk() : GetHash() doesn't match index");
@@ -885,19 +932,10 @@ bool CBlock::IsProofOfStake() const { return (vtx.size() > 1 && vtx[1].IsCoinSta
 
 CBlockIndexSmartPtr CBlock::FindBlockByHeight(int nHeight)
 {
-    CBlockIndexSmartPtr pblockindex;
-    if (nHeight < CTxDB().GetBestChainHeight().value_or(0) / 2) {
-        pblockindex = boost::atomic_load(&pindexGenesisBlock);
-    } else {
-        pblockindex = CTxDB().GetBestBlockIndex();
-    }
-    while (pblockindex->nHeight > nHeight) {
-        pblockindex = pblockindex->pprev;
-    }
-    while (pblockindex->nHeight < nHeight) {
-        pblockindex = pblockindex->pnext;
-    }
-    return pblockindex;
+    const CBlockIndex* pblockindex = chainActive[nHeight];
+    if (!pblockindex)
+        return nullptr;
+    return mapBlockIndex.get(pblockindex->GetBlockHash()).value_or(nullptr);
 }
 
 void CBlock::InvalidChainFound(const CBlockIndexSmartPtr& pindexNew, CTxDB& txdb)
@@ -1023,6 +1061,7 @@ bool CBlock::Reorganize(CTxDB& txdb, const CBlockIndexSmartPtr& pindexNew,
     for (CBlockIndexSmartPtr& pindex : vConnect)
         if (pindex->pprev)
             pindex->pprev->pnext = pindex;
+    chainActive.SetTip(pindexNew.get());
 
     // Resurrect memory transactions that were in the disconnected branch
     for (CTransaction& tx : vResurrect)
@@ -1055,8 +1094,7 @@ bool CBlock::GetCoinAge(uint64_t& nCoinAge) const
 
     if (nCoinAge == 0) // block coin age minimum 1 coin-day
         nCoinAge = 1;
-    if (fDebug)
-        printf("block coin age total nCoinDays=%" PRId64 "\n", nCoinAge);
+    LogPrint(LOG_STAKE, "block coin age total nCoinDays=%" PRId64 "\n", nCoinAge);
     return true;
 }
 
@@ -1067,9 +1105,12 @@ bool CBlock::AddToBlockIndex(uint256 nBlockPos, const uint256& hashProof, CTxDB&
     uint256 hash = GetHash();
     if (mapBlockIndex.exists(hash))
         return error("AddToBlockIndex() : %s already exists", hash.ToString().c_str());
+    // the block index assumes blocks are stored under their hash
+    if (nBlockPos != hash)
+        return error("AddToBlockIndex() : %s isn't stored under its hash", hash.ToString().c_str());
 
     // Construct new block index object
-    CBlockIndexSmartPtr pindexNew = boost::make_shared<CBlockIndex>(nBlockPos, *this);
+    CBlockIndexSmartPtr pindexNew = boost::make_shared<CBlockIndex>(*this);
     if (!pindexNew)
         return error("AddToBlockIndex() : new CBlockIndex failed");
     pindexNew->phashBlock = hash;
@@ -1106,13 +1147,14 @@ bool CBlock::AddToBlockIndex(uint256 nBlockPos, const uint256& hashProof, CTxDB&
 
     // Add to mapBlockIndex
     mapBlockIndex.set(hash, pindexNew);
+    const CDiskBlockIndex diskindex = MakeDiskBlockIndex(pindexNew.get(), *this);
     if (pindexNew->IsProofOfStake())
-        setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        setStakeSeen.insert(std::make_pair(diskindex.prevoutStake, diskindex.nStakeTime));
 
     // Write to disk block index
     if (createDbTransaction && !txdb.TxnBegin())
         return false;
-    txdb.WriteBlockIndex(CDiskBlockIndex(pindexNew.get()));
+    txdb.WriteBlockIndex(diskindex);
     if (createDbTransaction && !txdb.TxnCommit())
         return false;
 
@@ -1141,6 +1183,8 @@ bool CBlock::AddToBlockIndex(uint256 nBlockPos, const uint256& hashProof, CTxDB&
 
 bool CBlock::CheckBlock(const ITxDB& txdb, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
 {
+    const ValidationPhaseTimer timer(ValidationPhase::CheckBlock);
+
     // These are checks that are independent of context
     // that can be verified before saving an orphan block.
 
@@ -1247,7 +1291,7 @@ bool CBlock::CheckBlock(const ITxDB& txdb, bool fCheckPOW, bool fCheckMerkleRoot
     }
 
     // Check merkle root
-    bool merkleRootMutated;
+    bool merkleRootMutated = false;
     if (fCheckMerkleRoot && hashMerkleRoot != GetMerkleRoot(&merkleRootMutated)) {
         reject = CBlockReject(REJECT_INVALID, "bad-txnmrklroot", this->GetHash());
         return DoS(100, error("CheckBlock() : hashMerkleRoot mismatch"));
@@ -1398,11 +1442,22 @@ bool CBlock::AcceptBlock()
     // Relay inventory, but don't relay old inventory during initial block download
     int nBlockEstimate = Checkpoints::GetTotalBlocksEstimate();
     if (CTxDB().GetBestBlockHash() == hash) {
+        // peers that asked for it get the compact block right away, framed once for all of them
+        CSharedMessage cmpctBlockMessage;
         LOCK(cs_vNodes);
         for (CNode* pnode : vNodes)
             if (CTxDB().GetBestChainHeight().value_or(0) >
-                (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
-                pnode->PushInventory(CInv(MSG_BLOCK, hash));
+                (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate)) {
+                if (fCompactBlocks && pnode->fSupportsCompactBlocks && pnode->fCompactBlockAnnounce) {
+                    if (!pnode->AddInventoryKnown(CInv(MSG_BLOCK, hash)))
+                        continue;
+                    if (!cmpctBlockMessage)
+                        cmpctBlockMessage = MakeSharedMessage(
+                            "cmpctblock", CBlockHeaderAndShortTxIDs(*this, GetRand(~uint64_t(0))));
+                    pnode->PushSharedMessage(cmpctBlockMessage);
+                } else
+                    pnode->PushInventory(CInv(MSG_BLOCK, hash));
+            }
     }
 
     return true;
@@ -1439,9 +1494,15 @@ bool CBlock::SignBlock(const CTxDB& txdb, const CWallet& wallet, int64_t nFees,
     if (IsProofOfStake())
         return true;
 
-    CBlockIndexSmartPtr                 pindexBestPtr = txdb.GetBestBlockIndex();
-    const boost::optional<CTransaction> coinStake     = stakeMaker.CreateCoinStake(
-        txdb, wallet, nBits, nFees, nReserveBalance, customInputs, extraPayoutForTest);
+    static CMetricHistogram& stakeSearchHistogram = Metrics().Histogram("neblio_stake_search_seconds");
+
+    CBlockIndexSmartPtr           pindexBestPtr = txdb.GetBestBlockIndex();
+    boost::optional<CTransaction> coinStake;
+    {
+        const CMetricTimer timer(stakeSearchHistogram);
+        coinStake = stakeMaker.CreateCoinStake(txdb, wallet, nBits, nFees, nReserveBalance,
+                                               customInputs, extraPayoutForTest);
+    }
 
     if (!coinStake) {
         return false;
@@ -1712,50 +1773,168 @@ void UpdateWallets(const uint256& prevBestChain)
             // (which is synced with wallet)
             blocksInNewBranch = blocksInNewBranch->pnext;
 
-            // loop over all blocks from the common ancestor, to now, and sync these txs
+            // collect all blocks from the common ancestor, to now; reading them and syncing their txs
+            // is left to the validation interface queue
+            std::vector<CBlockIndexSmartPtr> vBlocksToSync;
+            const uint256                    bestBlockHash = txdb.GetBestBlockHash();
             while (blocksInNewBranch) {
-                CBlock block;
-                if (!block.ReadFromDisk(blocksInNewBranch.get(), txdb)) {
-                    printf("SetBestChain() : ReadFromDisk failed + couldn't sync with wallet\n");
-                    continue;
-                }
-
-                // Watch for transactions paying to me
-                for (CTransaction& tx : block.vtx) {
-                    SyncWithWallets(txdb, tx, &block);
-                }
+                vBlocksToSync.push_back(blocksInNewBranch);
 
-                if (blocksInNewBranch->GetBlockHash() == txdb.GetBestBlockHash()) {
+                if (blocksInNewBranch->GetBlockHash() == bestBlockHash) {
                     break;
                 }
 
                 // pnext is always in the main chain
                 blocksInNewBranch = blocksInNewBranch->pnext;
             }
+
+            // Watch for transactions paying to me
+            SyncWithWallets(txdb, vBlocksToSync);
         } else {
             // this is for genesis
             // Watch for transactions paying to me
-            CBlock genesis = Params().GenesisBlock();
-            for (CTransaction& tx : genesis.vtx) {
-                SyncWithWallets(txdb, tx, &genesis);
-            }
+            SyncWithWallets(txdb, Params().GenesisBlock());
+        }
+    }
+}
+
+namespace {
+struct BlockWriteBatch
+{
+    // batching is allowed in the thread while it has a CBlockWriteBatchScope
+    int      nScopes      = 0;
+    int64_t  nBeganMillis = 0;
+    unsigned nBlocks      = 0;
+    // the best block when the batch began, which the wallets are synced from when it's committed
+    uint256 prevBestChain;
+    // a commit failed, so the blocks after it can't be written either
+    bool fFailed = false;
+};
+
+thread_local BlockWriteBatch blockWriteBatch;
+} // namespace
+
+static uint64_t GetBlockWriteBatchMaxBytes()
+{
+    return static_cast<uint64_t>(std::max<int64_t>(0, GetArg("-ibdbatchsize", 64))) * 1024 * 1024;
+}
+
+// the in-memory chain already has the blocks of the batch, so it can't go on without them on disk
+static void AbortNodeOnBlockWriteBatchFailure(const std::string& strError)
+{
+    fShutdown              = true;
+    std::string strMessage =
+        _("Error: Failed to write blocks to disk; the node must be restarted. See the log for details");
+    strMiscWarning         = strMessage;
+    printf("*** Failed to commit a batch of blocks: %s\n", strError.c_str());
+    uiInterface.ThreadSafeMessageBox(strMessage, "neblio",
+                                     CClientUIInterface::OK | CClientUIInterface::ICON_EXCLAMATION |
+                                         CClientUIInterface::MODAL);
+    StartShutdown();
+}
+
+static bool CommitBlockWriteBatch()
+{
+    BlockWriteBatch& batch = blockWriteBatch;
+
+    const uint64_t nBytes = CTxDB::GetSharedTxnDirtyBytes();
+    const int64_t  nStart = GetTimeMillis();
+    try {
+        CTxDB::SharedTxnCommit();
+    } catch (const std::exception& e) {
+        batch.fFailed = true;
+        AbortNodeOnBlockWriteBatchFailure(e.what());
+        return false;
+    }
+    LogPrint(LOG_DB, "Committed %u blocks (%" PRIu64 " bytes) written in %" PRId64 "ms, in %" PRId64
+                     "ms\n",
+             batch.nBlocks, nBytes, nStart - batch.nBeganMillis, GetTimeMillis() - nStart);
+
+    UpdateWallets(batch.prevBestChain);
+    return true;
+}
+
+bool PrepareBlockWriteBatch(std::size_t nRequiredSize, bool& fBatched)
+{
+    BlockWriteBatch& batch = blockWriteBatch;
+    fBatched               = false;
+    if (batch.nScopes == 0) {
+        return true;
+    }
+    if (batch.fFailed) {
+        return false;
+    }
+
+    const bool fBatch = IsInitialBlockDownload() && !fShutdown && GetBlockWriteBatchMaxBytes() > 0;
+    if (CTxDB::IsSharedTxnOpen()) {
+        // the memory map can only be resized between transactions
+        if (fBatch && !CTxDB::need_resize(CTxDB::GetSharedTxnDirtyBytes() + nRequiredSize)) {
+            fBatched = true;
+            return true;
+        }
+        if (!CommitBlockWriteBatch()) {
+            return false;
         }
     }
+
+    // if a batch can't be begun, the block is written alone
+    if (fBatch && CTxDB::SharedTxnBegin(nRequiredSize)) {
+        batch.nBeganMillis  = GetTimeMillis();
+        batch.nBlocks       = 0;
+        batch.prevBestChain = CTxDB().GetBestBlockHash();
+        fBatched            = true;
+    }
+    return true;
+}
+
+void FlushBlockWriteBatch(bool fForce)
+{
+    if (blockWriteBatch.nScopes == 0) {
+        return;
+    }
+    if (CTxDB::IsSharedTxnOpen() &&
+        (fForce || CTxDB::GetSharedTxnDirtyBytes() >= GetBlockWriteBatchMaxBytes() ||
+         GetTimeMillis() - blockWriteBatch.nBeganMillis >= GetArg("-ibdbatchms", 2000))) {
+        CommitBlockWriteBatch();
+    }
+}
+
+CBlockWriteBatchScope::CBlockWriteBatchScope()
+{
+    AssertLockHeld(cs_main);
+    blockWriteBatch.nScopes++;
+}
+
+CBlockWriteBatchScope::~CBlockWriteBatchScope()
+{
+    try {
+        FlushBlockWriteBatch(true);
+    } catch (std::exception& e) {
+        PrintExceptionContinue(&e, "~CBlockWriteBatchScope()");
+    }
+    blockWriteBatch.nScopes--;
 }
 
 bool CBlock::WriteToDisk(const uint256& nBlockPos, const uint256& hashProof)
 {
     /**
      * @brief txdb
-     * This function writes a whole block in an ACID transaction
+     * This function writes a whole block in an ACID transaction, which, during the initial block
+     * download, may be nested in the transaction of a batch of blocks
      */
 
+    std::size_t req_size = 1000 * ::GetSerializeSize(*this, SER_DISK, CLIENT_VERSION);
+
+    bool fBatched = false;
+    if (!PrepareBlockWriteBatch(req_size, fBatched)) {
+        return error("WriteToDisk() : failed to commit the blocks written before");
+    }
+
     CTxDB txdb;
 
     // before adding the new block, we keep in mind what the current best block is
     const uint256 prevBestChain = txdb.GetBestBlockHash();
 
-    std::size_t req_size = 1000 * ::GetSerializeSize(*this, SER_DISK, CLIENT_VERSION);
     if (!txdb.TxnBegin(req_size)) {
         printf("Failed to start transaction for writing a new block.");
         return false;
@@ -1799,6 +1978,13 @@ bool CBlock::WriteToDisk(const uint256& nBlockPos, const uint256& hashProof)
     success = true;
     txEnder.reset();
 
+    if (fBatched) {
+        // the wallets are synced with the blocks of a batch once they're committed
+        blockWriteBatch.nBlocks++;
+        FlushBlockWriteBatch(false);
+        return true;
+    }
+
     // after having (potentially) updated the best block, we sync with wallets
     UpdateWallets(prevBestChain);
 
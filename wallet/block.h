@@ -208,4 +208,35 @@ private:
                            const bool createDbTransaction = true);
 };
 
+/**
+ * While a thread has a CBlockWriteBatchScope and the initial block download is in progress, the
+ * blocks that WriteToDisk() writes in it go in one LMDB write transaction (CTxDB::SharedTxnBegin()),
+ * instead of a commit per block. The scope must be created with cs_main held, and it's destroyed before
+ * cs_main is released, so a batch never outlives one hold of cs_main: every thread that takes cs_main
+ * finds the blocks in the block index committed, and threads reading without it see the db as of the
+ * last commit. Within the scope, the batch is committed once -ibdbatchsize megabytes were written to it
+ * or it's -ibdbatchms milliseconds old, when the download is done, when the memory map needs to grow,
+ * and when the scope ends.
+ * The wallets are synced with the blocks of a batch when it's committed. A crash loses the blocks of
+ * the batch, and the best chain stays the one of the last commit. If the commit fails, the node shuts
+ * down, as its in-memory chain has blocks that aren't on disk.
+ */
+class CBlockWriteBatchScope
+{
+public:
+    CBlockWriteBatchScope();
+    ~CBlockWriteBatchScope();
+    CBlockWriteBatchScope(const CBlockWriteBatchScope&) = delete;
+    CBlockWriteBatchScope& operator=(const CBlockWriteBatchScope&) = delete;
+};
+
+/**
+ * Called by WriteToDisk(): sets fBatched if the block goes in the batch of this thread, which is begun
+ * if need be. Returns false if the blocks of a batch of this thread couldn't be committed.
+ */
+bool PrepareBlockWriteBatch(std::size_t nRequiredSize, bool& fBatched);
+
+/** commits the batch of blocks of this thread if it's big or old enough, or if fForce */
+void FlushBlockWriteBatch(bool fForce);
+
 #endif // BLOCK_H
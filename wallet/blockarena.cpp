@@ -0,0 +1,30 @@
+#include "blockarena.h"
+
+#include "blockindex.h"
+#include "txdb.h"
+#include "util.h"
+
+void CBlockArena::PrepareForReuse()
+{
+    // what isn't serialized isn't overwritten by a read
+    block.reject = boost::none;
+    block.nDoS   = 0;
+    for (const CTransaction& tx : block.vtx) {
+        tx.reject = boost::none;
+        tx.nDoS   = 0;
+    }
+}
+
+bool CBlockArena::ReadFromDisk(const CBlockIndex* pindex, const CTxDB& txdb)
+{
+    PrepareForReuse();
+    if (!txdb.ReadBlockReusingStorage(pindex->GetBlockHash(), block)) {
+        return false;
+    }
+    if (block.GetHash() != pindex->GetBlockHash()) {
+        return error("CBlockArena::ReadFromDisk() : GetHash() doesn't match index");
+    }
+    return true;
+}
+
+void CBlockArena::Clear() { block = CBlock(); }
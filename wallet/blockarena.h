@@ -0,0 +1,46 @@
+#ifndef BLOCKARENA_H
+#define BLOCKARENA_H
+
+#include "block.h"
+#include "serialize.h"
+
+class CBlockIndex;
+class CTxDB;
+
+/**
+ * Storage for blocks that are only looked at for a moment, like the blocks served to peers, verified on
+ * startup or scanned to build an index. Reading a block allocates every transaction, input, output and
+ * script in it, and all of them are freed again right after. An arena keeps the storage of the last
+ * block it read and reads the next one over it (see SER_REUSE_STORAGE), so going through a sequence of
+ * blocks only allocates when a block has more or bigger parts than the ones before; all of it is freed
+ * at once when the arena is cleared or destroyed.
+ *
+ * A block read is valid until the next read, so an arena isn't shared between threads and nothing may
+ * keep references into its block.
+ */
+class CBlockArena
+{
+    CBlock block;
+
+    void PrepareForReuse();
+
+public:
+    /** reads the block of pindex from the db; false if it can't be read or doesn't match pindex */
+    bool ReadFromDisk(const CBlockIndex* pindex, const CTxDB& txdb);
+
+    template <typename Stream>
+    CBlock& Read(Stream& s)
+    {
+        PrepareForReuse();
+        ::Unserialize(s, block, s.nType | SER_REUSE_STORAGE, s.nVersion);
+        return block;
+    }
+
+    CBlock&       GetBlock() { return block; }
+    const CBlock& GetBlock() const { return block; }
+
+    /** frees the storage of the block */
+    void Clear();
+};
+
+#endif // BLOCKARENA_H
@@ -0,0 +1,155 @@
+#include "blockencodings.h"
+
+#include "globals.h"
+#include "hash.h"
+#include "txmempool.h"
+
+#include <unordered_map>
+
+bool fCompactBlocks = true;
+
+// a transaction takes at least this many bytes, which bounds the number of transactions a block can have
+static const unsigned int MIN_TRANSACTION_SIZE = 60;
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, uint64_t nonceIn)
+    : nonce(nonceIn)
+{
+    header             = block.GetBlockHeader();
+    header.vchBlockSig = block.vchBlockSig;
+    FillShortIDKeys();
+
+    // neither the coinbase nor the coinstake can be in the mempool of the receiver
+    const std::size_t prefilledCount =
+        std::min<std::size_t>(block.IsProofOfStake() ? 2 : 1, block.vtx.size());
+    for (std::size_t i = 0; i < block.vtx.size(); i++) {
+        if (i < prefilledCount) {
+            prefilledTxs.push_back(CPrefilledTransaction(i, block.vtx[i]));
+        } else {
+            shortTxIDs.push_back(GetShortID(block.vtx[i].GetHash()));
+        }
+    }
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortIDKeys()
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << header << nonce;
+    const uint256 hash = ss.GetHash();
+    shortIDKey0        = hash.Get64(0);
+    shortIDKey1        = hash.Get64(1);
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txid) const
+{
+    static_assert(SHORTTXID_SIZE == 6, "short ids are 6 bytes");
+    return SipHash(shortIDKey0, shortIDKey1, txid.begin(), txid.size()) & 0xffffffffffffULL;
+}
+
+ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock,
+                                              const CTxMemPool&                pool)
+{
+    if (cmpctblock.header.IsNull() || cmpctblock.BlockTxCount() == 0 ||
+        cmpctblock.BlockTxCount() > MAX_BLOCK_SIZE / MIN_TRANSACTION_SIZE) {
+        return READ_STATUS_INVALID;
+    }
+
+    header    = cmpctblock.header;
+    hashBlock = header.GetHash();
+    vtx.assign(cmpctblock.BlockTxCount(), CTransaction());
+    vHave.assign(cmpctblock.BlockTxCount(), false);
+
+    // the prefilled transactions come in the order of the block, and take their places first
+    int64_t lastIndex = -1;
+    for (const CPrefilledTransaction& prefilled : cmpctblock.prefilledTxs) {
+        if (prefilled.index <= lastIndex || prefilled.index >= vtx.size() || prefilled.tx.IsNull()) {
+            return READ_STATUS_INVALID;
+        }
+        lastIndex              = prefilled.index;
+        vtx[prefilled.index]   = prefilled.tx;
+        vHave[prefilled.index] = true;
+    }
+
+    // the short ids fill the places left, in order
+    std::unordered_map<uint64_t, uint32_t> shortIDIndexes;
+    shortIDIndexes.reserve(cmpctblock.shortTxIDs.size());
+    uint32_t index = 0;
+    for (uint64_t shortID : cmpctblock.shortTxIDs) {
+        while (vHave[index]) {
+            index++;
+        }
+        if (!shortIDIndexes.insert(std::make_pair(shortID, index)).second) {
+            // two transactions of the block share a short id; there's no telling which is which
+            return READ_STATUS_FAILED;
+        }
+        index++;
+    }
+
+    {
+        LOCK(pool.cs);
+        for (const std::pair<const uint256, CTransaction>& entry : pool.mapTx) {
+            const auto it = shortIDIndexes.find(cmpctblock.GetShortID(entry.first));
+            if (it == shortIDIndexes.end()) {
+                continue;
+            }
+            if (vHave[it->second]) {
+                // two transactions of the mempool share the short id; the one of the block is asked
+                // for, and a third one mustn't take its place
+                vHave[it->second] = false;
+                vtx[it->second]   = CTransaction();
+                shortIDIndexes.erase(it);
+                continue;
+            }
+            vtx[it->second]   = entry.second;
+            vHave[it->second] = true;
+        }
+    }
+    return READ_STATUS_OK;
+}
+
+std::vector<uint32_t> PartiallyDownloadedBlock::GetMissingIndexes() const
+{
+    std::vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < vHave.size(); i++) {
+        if (!vHave[i]) {
+            indexes.push_back(i);
+        }
+    }
+    return indexes;
+}
+
+ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock&                           block,
+                                              const std::vector<CTransaction>& vtxMissing)
+{
+    if (header.IsNull()) {
+        return READ_STATUS_INVALID;
+    }
+
+    std::size_t nextMissing = 0;
+    for (std::size_t i = 0; i < vtx.size(); i++) {
+        if (vHave[i]) {
+            continue;
+        }
+        if (nextMissing >= vtxMissing.size()) {
+            return READ_STATUS_INVALID;
+        }
+        vtx[i]   = vtxMissing[nextMissing++];
+        vHave[i] = true;
+    }
+    if (nextMissing != vtxMissing.size()) {
+        return READ_STATUS_INVALID;
+    }
+
+    block     = header;
+    block.vtx = std::move(vtx);
+    vtx.clear();
+    vHave.clear();
+    header.SetNull();
+
+    // a transaction of the mempool that took the place of another with the same short id shows as a
+    // merkle root mismatch; the peer isn't to blame for that
+    bool fMutated = false;
+    if (block.GetMerkleRoot(&fMutated) != block.hashMerkleRoot || fMutated) {
+        return READ_STATUS_FAILED;
+    }
+    return READ_STATUS_OK;
+}
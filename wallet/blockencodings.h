@@ -0,0 +1,239 @@
+#ifndef BLOCKENCODINGS_H
+#define BLOCKENCODINGS_H
+
+#include "block.h"
+#include "serialize.h"
+#include "transaction.h"
+
+#include <limits>
+#include <vector>
+
+class CTxMemPool;
+
+/** whether blocks are asked for, and announced to peers that want it, as compact blocks */
+extern bool fCompactBlocks;
+
+/** the version of the compact block encoding, negotiated with "sendcmpct" */
+static const uint64_t COMPACT_BLOCKS_ENCODING_VERSION = 1;
+
+/** compact blocks are only sent for blocks this close to the tip; deeper ones are sent in full */
+static const int MAX_CMPCTBLOCK_DEPTH = 10;
+
+/** "getblocktxn" is only answered for blocks this close to the tip */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+
+/** seconds after which a compact block whose "blocktxn" didn't arrive is asked for in full */
+static const int64_t BLOCKTXN_TIMEOUT = 10;
+
+/** short transaction ids are the low 6 bytes of a SipHash of the txid */
+static const unsigned int SHORTTXID_SIZE = 6;
+
+/** Serializes short transaction ids with the 6 bytes they're made of */
+class CShortTxIDList
+{
+    std::vector<uint64_t>& ids;
+
+public:
+    explicit CShortTxIDList(std::vector<uint64_t>& idsIn) : ids(idsIn) {}
+
+    unsigned int GetSerializeSize(int, int = 0) const
+    {
+        return GetSizeOfCompactSize(ids.size()) + ids.size() * SHORTTXID_SIZE;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int, int = 0) const
+    {
+        WriteCompactSize(s, ids.size());
+        for (uint64_t id : ids) {
+            unsigned char bytes[SHORTTXID_SIZE];
+            for (unsigned int i = 0; i < SHORTTXID_SIZE; i++) {
+                bytes[i] = static_cast<unsigned char>(id >> (8 * i));
+            }
+            s.write(reinterpret_cast<const char*>(bytes), SHORTTXID_SIZE);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int, int = 0)
+    {
+        const uint64_t size = ReadCompactSize(s);
+        ids.clear();
+        // the ids are read one by one, so that a bogus size doesn't allocate more than the message holds
+        for (uint64_t n = 0; n < size; n++) {
+            unsigned char bytes[SHORTTXID_SIZE];
+            s.read(reinterpret_cast<char*>(bytes), SHORTTXID_SIZE);
+            uint64_t id = 0;
+            for (unsigned int i = 0; i < SHORTTXID_SIZE; i++) {
+                id |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+            }
+            ids.push_back(id);
+        }
+    }
+};
+
+/** Serializes increasing transaction indexes as the differences between them */
+class CTxIndexList
+{
+    std::vector<uint32_t>& indexes;
+
+public:
+    explicit CTxIndexList(std::vector<uint32_t>& indexesIn) : indexes(indexesIn) {}
+
+    unsigned int GetSerializeSize(int, int = 0) const
+    {
+        unsigned int size = GetSizeOfCompactSize(indexes.size());
+        for (std::size_t i = 0; i < indexes.size(); i++) {
+            size += GetSizeOfCompactSize(indexes[i] - (i == 0 ? 0 : indexes[i - 1] + 1));
+        }
+        return size;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int, int = 0) const
+    {
+        WriteCompactSize(s, indexes.size());
+        for (std::size_t i = 0; i < indexes.size(); i++) {
+            WriteCompactSize(s, indexes[i] - (i == 0 ? 0 : indexes[i - 1] + 1));
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int, int = 0)
+    {
+        const uint64_t size = ReadCompactSize(s);
+        indexes.clear();
+        uint64_t next = 0;
+        for (uint64_t n = 0; n < size; n++) {
+            next += ReadCompactSize(s);
+            if (next > std::numeric_limits<uint32_t>::max()) {
+                throw std::ios_base::failure("CTxIndexList: index out of range");
+            }
+            indexes.push_back(static_cast<uint32_t>(next));
+            next++;
+        }
+    }
+};
+
+/** A transaction of a compact block that's sent in full, with its position in the block */
+class CPrefilledTransaction
+{
+public:
+    uint32_t     index;
+    CTransaction tx;
+
+    CPrefilledTransaction() : index(0) {}
+    CPrefilledTransaction(uint32_t indexIn, const CTransaction& txIn) : index(indexIn), tx(txIn) {}
+
+    IMPLEMENT_SERIALIZE(READWRITE(VARINT(index)); READWRITE(tx);)
+};
+
+/**
+ * A block as its header and signature, a short id for each of its transactions, and the transactions
+ * the receiver can't have in its mempool. The coinbase, and the coinstake of a proof-of-stake block,
+ * are sent in full; the rest is expected to be found in the mempool of the receiver, which asks for
+ * what's missing with "getblocktxn".
+ *
+ * The short ids are keyed by the header and a nonce picked by the sender, so that colliding ids can't
+ * be made for every node at once.
+ */
+class CBlockHeaderAndShortTxIDs
+{
+    uint64_t shortIDKey0;
+    uint64_t shortIDKey1;
+
+    void FillShortIDKeys();
+
+public:
+    // the header and signature of the block; its vtx is empty
+    CBlock                             header;
+    uint64_t                           nonce;
+    std::vector<uint64_t>              shortTxIDs;
+    std::vector<CPrefilledTransaction> prefilledTxs;
+
+    CBlockHeaderAndShortTxIDs() : shortIDKey0(0), shortIDKey1(0), nonce(0) {}
+    CBlockHeaderAndShortTxIDs(const CBlock& block, uint64_t nonceIn);
+
+    uint64_t GetShortID(const uint256& txid) const;
+
+    std::size_t BlockTxCount() const { return shortTxIDs.size() + prefilledTxs.size(); }
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header.nVersion);
+        READWRITE(header.hashPrevBlock);
+        READWRITE(header.hashMerkleRoot);
+        READWRITE(header.nTime);
+        READWRITE(header.nBits);
+        READWRITE(header.nNonce);
+        READWRITE(header.vchBlockSig);
+        READWRITE(nonce);
+        READWRITE(REF(CShortTxIDList(REF(shortTxIDs))));
+        READWRITE(prefilledTxs);
+        if (fRead) {
+            const_cast<CBlockHeaderAndShortTxIDs*>(this)->FillShortIDKeys();
+        })
+    // clang-format on
+};
+
+/** "getblocktxn": the transactions of a block that a compact block couldn't be completed without */
+class BlockTransactionsRequest
+{
+public:
+    uint256               blockhash;
+    std::vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(READWRITE(blockhash); READWRITE(REF(CTxIndexList(REF(indexes))));)
+};
+
+/** "blocktxn": the answer to a "getblocktxn", with the transactions in the order they were asked for */
+class BlockTransactions
+{
+public:
+    uint256                   blockhash;
+    std::vector<CTransaction> txn;
+
+    BlockTransactions() {}
+    explicit BlockTransactions(const BlockTransactionsRequest& req)
+        : blockhash(req.blockhash), txn(req.indexes.size())
+    {
+    }
+
+    IMPLEMENT_SERIALIZE(READWRITE(blockhash); READWRITE(txn);)
+};
+
+enum ReadStatus
+{
+    READ_STATUS_OK,
+    // the peer sent something no honest peer would
+    READ_STATUS_INVALID,
+    // short ids collided, so the block couldn't be put together and has to be downloaded in full
+    READ_STATUS_FAILED,
+};
+
+/**
+ * A block being put together from a compact block, the mempool and the transactions asked from the
+ * peer that sent it.
+ */
+class PartiallyDownloadedBlock
+{
+    CBlock                    header;
+    uint256                   hashBlock;
+    std::vector<CTransaction> vtx; // the transactions of the block, where vHave is set
+    std::vector<bool>         vHave;
+
+public:
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const CTxMemPool& pool);
+
+    const uint256& GetBlockHash() const { return hashBlock; }
+
+    bool IsTxAvailable(std::size_t index) const { return index < vHave.size() && vHave[index]; }
+
+    /** the indexes of the transactions to ask for with "getblocktxn" */
+    std::vector<uint32_t> GetMissingIndexes() const;
+
+    /** completes the block with the missing transactions, in the order GetMissingIndexes() gave */
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransaction>& vtxMissing);
+};
+
+#endif // BLOCKENCODINGS_H
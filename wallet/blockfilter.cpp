@@ -0,0 +1,253 @@
+#include "blockfilter.h"
+
+#include "block.h"
+#include "hash.h"
+#include "script.h"
+#include "serialize.h"
+#include "version.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/** The high 64 bits of x * n, which maps a uniform 64-bit x into [0, n) without a division */
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+    const uint64_t xHi = x >> 32, xLo = x & 0xffffffff;
+    const uint64_t nHi = n >> 32, nLo = n & 0xffffffff;
+
+    const uint64_t hiHi = xHi * nHi;
+    const uint64_t hiLo = xHi * nLo;
+    const uint64_t loHi = xLo * nHi;
+    const uint64_t loLo = xLo * nLo;
+
+    const uint64_t mid = (loLo >> 32) + (hiLo & 0xffffffff) + (loHi & 0xffffffff);
+    return hiHi + (hiLo >> 32) + (loHi >> 32) + (mid >> 32);
+}
+
+/** Appends bits to a byte vector, most significant bit first */
+class BitWriter
+{
+    std::vector<uint8_t>& out;
+    uint8_t               buffer = 0;
+    int                   nBits  = 0;
+
+public:
+    explicit BitWriter(std::vector<uint8_t>& outIn) : out(outIn) {}
+
+    void Write(uint64_t value, int bits)
+    {
+        while (bits > 0) {
+            const int chunk = std::min(8 - nBits, bits);
+            buffer |= static_cast<uint8_t>(((value >> (bits - chunk)) & ((1U << chunk) - 1))
+                                           << (8 - nBits - chunk));
+            nBits += chunk;
+            bits -= chunk;
+            if (nBits == 8) {
+                Flush();
+            }
+        }
+    }
+
+    void Flush()
+    {
+        if (nBits > 0) {
+            out.push_back(buffer);
+            buffer = 0;
+            nBits  = 0;
+        }
+    }
+};
+
+/** Reads bits written by BitWriter; Read() returns false past the end of the data */
+class BitReader
+{
+    const std::vector<uint8_t>& in;
+    std::size_t                 pos;
+    int                         nBitsUsed = 0;
+
+public:
+    BitReader(const std::vector<uint8_t>& inIn, std::size_t start) : in(inIn), pos(start) {}
+
+    bool Read(int bits, uint64_t& value)
+    {
+        value = 0;
+        while (bits > 0) {
+            if (pos >= in.size()) {
+                return false;
+            }
+            const int     chunk = std::min(8 - nBitsUsed, bits);
+            const uint8_t part  = (in[pos] >> (8 - nBitsUsed - chunk)) & ((1U << chunk) - 1);
+            value               = (value << chunk) | part;
+            nBitsUsed += chunk;
+            bits -= chunk;
+            if (nBitsUsed == 8) {
+                pos++;
+                nBitsUsed = 0;
+            }
+        }
+        return true;
+    }
+};
+
+void GolombRiceEncode(BitWriter& writer, uint64_t x)
+{
+    // the quotient in unary, then the remainder in GCS_P bits
+    for (uint64_t q = x >> CBlockFilter::GCS_P; q > 0; q--) {
+        writer.Write(1, 1);
+    }
+    writer.Write(0, 1);
+    writer.Write(x, CBlockFilter::GCS_P);
+}
+
+bool GolombRiceDecode(BitReader& reader, uint64_t& x)
+{
+    uint64_t q = 0;
+    uint64_t bit;
+    while (true) {
+        if (!reader.Read(1, bit)) {
+            return false;
+        }
+        if (!bit) {
+            break;
+        }
+        q++;
+    }
+    uint64_t r;
+    if (!reader.Read(CBlockFilter::GCS_P, r)) {
+        return false;
+    }
+    x = (q << CBlockFilter::GCS_P) + r;
+    return true;
+}
+
+} // namespace
+
+uint64_t CBlockFilter::HashToRange(const Element& element) const
+{
+    // the key is the first 16 bytes of the block hash
+    const uint64_t hash =
+        SipHash(blockHash.Get64(0), blockHash.Get64(1), element.data(), element.size());
+    return MapIntoRange(hash, static_cast<uint64_t>(nElements) * GCS_M);
+}
+
+CBlockFilter::CBlockFilter(const uint256& blockHashIn, const std::vector<Element>& elements)
+    : blockHash(blockHashIn)
+{
+    std::vector<Element> unique;
+    unique.reserve(elements.size());
+    for (const Element& element : elements) {
+        if (!element.empty()) {
+            unique.push_back(element);
+        }
+    }
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    nElements = static_cast<uint32_t>(unique.size());
+
+    std::vector<uint64_t> hashed;
+    hashed.reserve(unique.size());
+    for (const Element& element : unique) {
+        hashed.push_back(HashToRange(element));
+    }
+    std::sort(hashed.begin(), hashed.end());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(ss, nElements);
+    encoded.assign(ss.begin(), ss.end());
+
+    BitWriter writer(encoded);
+    uint64_t  last = 0;
+    for (uint64_t value : hashed) {
+        GolombRiceEncode(writer, value - last);
+        last = value;
+    }
+    writer.Flush();
+}
+
+CBlockFilter::CBlockFilter(const uint256& blockHashIn, std::vector<uint8_t> encodedIn)
+    : blockHash(blockHashIn), encoded(std::move(encodedIn))
+{
+    CDataStream ss(reinterpret_cast<const char*>(encoded.data()),
+                   reinterpret_cast<const char*>(encoded.data() + encoded.size()), SER_NETWORK,
+                   PROTOCOL_VERSION);
+    const uint64_t n = ReadCompactSize(ss);
+    if (n > UINT32_MAX) {
+        throw std::ios_base::failure("CBlockFilter: too many elements");
+    }
+    nElements = static_cast<uint32_t>(n);
+}
+
+bool CBlockFilter::Match(const Element& element) const { return MatchAny({element}); }
+
+bool CBlockFilter::MatchAny(const std::vector<Element>& elements) const
+{
+    if (nElements == 0 || elements.empty()) {
+        return false;
+    }
+
+    std::vector<uint64_t> queries;
+    queries.reserve(elements.size());
+    for (const Element& element : elements) {
+        queries.push_back(HashToRange(element));
+    }
+    std::sort(queries.begin(), queries.end());
+
+    // both lists are sorted, so they're walked together once
+    CDataStream ss(reinterpret_cast<const char*>(encoded.data()),
+                   reinterpret_cast<const char*>(encoded.data() + encoded.size()), SER_NETWORK,
+                   PROTOCOL_VERSION);
+    ReadCompactSize(ss);
+    BitReader reader(encoded, encoded.size() - ss.size());
+
+    auto     query = queries.cbegin();
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < nElements; i++) {
+        uint64_t delta;
+        if (!GolombRiceDecode(reader, delta)) {
+            return false;
+        }
+        value += delta;
+        while (query != queries.cend() && *query < value) {
+            ++query;
+        }
+        if (query == queries.cend()) {
+            return false;
+        }
+        if (*query == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint256 CBlockFilter::GetHash() const { return Hash(encoded.begin(), encoded.end()); }
+
+uint256 CBlockFilter::ComputeHeader(const uint256& prevHeader) const
+{
+    const uint256 filterHash = GetHash();
+    return Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
+
+std::vector<CBlockFilter::Element> GetBasicBlockFilterElements(const CBlock&               block,
+                                                               const std::vector<CScript>& prevScripts)
+{
+    std::vector<CBlockFilter::Element> elements;
+    for (const CTransaction& tx : block.vtx) {
+        for (const CTxOut& out : tx.vout) {
+            const CScript& script = out.scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN) {
+                continue;
+            }
+            elements.push_back(CBlockFilter::Element(script.begin(), script.end()));
+        }
+    }
+    for (const CScript& script : prevScripts) {
+        if (script.empty()) {
+            continue;
+        }
+        elements.push_back(CBlockFilter::Element(script.begin(), script.end()));
+    }
+    return elements;
+}
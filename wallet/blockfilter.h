@@ -0,0 +1,71 @@
+#ifndef BLOCKFILTER_H
+#define BLOCKFILTER_H
+
+#include "uint256.h"
+
+#include <cstdint>
+#include <vector>
+
+class CBlock;
+class CScript;
+
+/**
+ * A BIP158 "basic" block filter: a Golomb-coded set of the output scripts a block creates and of the
+ * output scripts it spends, which light clients download to find out whether a block is relevant to
+ * them without revealing their addresses to the node serving it.
+ *
+ * The elements are hashed with SipHash-2-4, keyed by the block hash, into [0, N * M) and the sorted
+ * differences between them are Golomb-Rice coded with parameter P. The encoding is the number of
+ * elements (compact size) followed by the bit stream, so filters are interchangeable with those of
+ * other BIP158 implementations.
+ */
+class CBlockFilter
+{
+public:
+    using Element = std::vector<unsigned char>;
+
+    static const uint8_t  BASIC_FILTER_TYPE = 0;
+    static const int      GCS_P             = 19;
+    static const uint64_t GCS_M             = 784931;
+
+private:
+    uint256              blockHash;
+    std::vector<uint8_t> encoded;
+    uint32_t             nElements = 0;
+
+    uint64_t HashToRange(const Element& element) const;
+
+public:
+    CBlockFilter() = default;
+
+    /** Builds the filter of a block from its elements; empty elements and duplicates are ignored */
+    CBlockFilter(const uint256& blockHashIn, const std::vector<Element>& elements);
+
+    /** Wraps an encoded filter, e.g. one read from the db; throws if it doesn't start with a count */
+    CBlockFilter(const uint256& blockHashIn, std::vector<uint8_t> encodedIn);
+
+    const uint256&              GetBlockHash() const { return blockHash; }
+    const std::vector<uint8_t>& GetEncoded() const { return encoded; }
+    uint32_t                    GetElementCount() const { return nElements; }
+
+    /** Whether the element may be in the set; false positives happen with a probability of 1/M */
+    bool Match(const Element& element) const;
+
+    /** Whether any of the elements may be in the set; cheaper than calling Match() for each */
+    bool MatchAny(const std::vector<Element>& elements) const;
+
+    /** The double SHA256 of the encoded filter */
+    uint256 GetHash() const;
+
+    /** The header of the filter, which commits to the headers of all the filters before it */
+    uint256 ComputeHeader(const uint256& prevHeader) const;
+};
+
+/**
+ * The elements of the basic filter of a block: the scripts of its outputs, except OP_RETURN ones, and
+ * prevScripts, the scripts of the outputs spent by its inputs; empty scripts are left out on both sides
+ */
+std::vector<CBlockFilter::Element> GetBasicBlockFilterElements(const CBlock&               block,
+                                                               const std::vector<CScript>& prevScripts);
+
+#endif // BLOCKFILTER_H
@@ -0,0 +1,118 @@
+#include "blockfilterindex.h"
+
+#include "block.h"
+#include "blockfilter.h"
+#include "globals.h"
+#include "optionalindex.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <map>
+
+bool fBlockFilterIndex = false;
+bool fPeerBlockFilters = false;
+
+bool BuildBasicBlockFilter(const CBlock& block, const ITxDB& txdb, CBlockFilter& filter)
+{
+    // transactions of the block may spend each other, so they're looked up in the block first
+    std::map<uint256, const CTransaction*> blockTxs;
+    for (const CTransaction& tx : block.vtx) {
+        blockTxs[tx.GetHash()] = &tx;
+    }
+    std::map<uint256, CTransaction> prevTxs;
+
+    std::vector<CScript> prevScripts;
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase()) {
+            continue;
+        }
+        for (const CTxIn& txin : tx.vin) {
+            const CTransaction* prevTx  = nullptr;
+            const auto          itBlock = blockTxs.find(txin.prevout.hash);
+            if (itBlock != blockTxs.end()) {
+                prevTx = itBlock->second;
+            } else {
+                auto itPrev = prevTxs.find(txin.prevout.hash);
+                if (itPrev == prevTxs.end()) {
+                    CTransaction fetched;
+                    if (!txdb.ReadDiskTx(txin.prevout.hash, fetched)) {
+                        return error("Failed to read transaction %s for the block filter index",
+                                     txin.prevout.hash.ToString().c_str());
+                    }
+                    itPrev = prevTxs.insert(std::make_pair(txin.prevout.hash, std::move(fetched))).first;
+                }
+                prevTx = &itPrev->second;
+            }
+            if (txin.prevout.n >= prevTx->vout.size()) {
+                return error("BuildBasicBlockFilter(): prevout %s is out of range",
+                             txin.prevout.ToString().c_str());
+            }
+            prevScripts.push_back(prevTx->vout[txin.prevout.n].scriptPubKey);
+        }
+    }
+
+    filter = CBlockFilter(block.GetHash(), GetBasicBlockFilterElements(block, prevScripts));
+    return true;
+}
+
+bool WriteBlockFilterIndexEntry(const CBlock& block, CTxDB& txdb)
+{
+    const uint256 hash = block.GetHash();
+    if (txdb.ContainsBlockFilter(hash)) {
+        return true;
+    }
+
+    uint256 prevHeader = 0;
+    if (block.hashPrevBlock != 0) {
+        CBlockFilterIndexEntry prevEntry;
+        if (!txdb.ReadBlockFilter(block.hashPrevBlock, prevEntry)) {
+            return error("The block filter of %s, the parent of %s, isn't indexed",
+                         block.hashPrevBlock.ToString().c_str(), hash.ToString().c_str());
+        }
+        prevHeader = prevEntry.header;
+    }
+
+    CBlockFilter filter;
+    if (!BuildBasicBlockFilter(block, txdb, filter)) {
+        return false;
+    }
+
+    CBlockFilterIndexEntry entry;
+    entry.filter     = filter.GetEncoded();
+    entry.filterHash = filter.GetHash();
+    entry.header     = filter.ComputeHeader(prevHeader);
+    if (!txdb.WriteBlockFilter(hash, entry)) {
+        return error("Failed to write the block filter of %s", hash.ToString().c_str());
+    }
+    return true;
+}
+
+namespace {
+class CBlockFilterIndex : public COptionalIndex
+{
+public:
+    CBlockFilterIndex()
+        : COptionalIndex("block filter index",
+                         {{"block filter index", &fBlockFilterIndex, &CTxDB::IsBlockFilterIndexComplete,
+                           &CTxDB::WriteBlockFilterIndexComplete, &CTxDB::ClearBlockFilterIndex}})
+    {
+    }
+
+protected:
+    bool ApplyBlock(const CBlock& block, int /*nHeight*/, CTxDB& txdb, bool fUndo,
+                    unsigned int /*partsMask*/) const override
+    {
+        // the filters of disconnected blocks are kept, as they're still valid if they're reconnected
+        return fUndo || WriteBlockFilterIndexEntry(block, txdb);
+    }
+};
+
+const CBlockFilterIndex blockFilterIndex;
+} // namespace
+
+bool ConnectBlockFilterIndex(const CBlock& block, int nHeight, CTxDB& txdb)
+{
+    return blockFilterIndex.UpdateWithBlock(block, nHeight, txdb, false);
+}
+
+bool InitBlockFilterIndex() { return blockFilterIndex.Init(); }
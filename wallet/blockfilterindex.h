@@ -0,0 +1,58 @@
+#ifndef BLOCKFILTERINDEX_H
+#define BLOCKFILTERINDEX_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+class CBlock;
+class CBlockFilter;
+class CTxDB;
+class ITxDB;
+
+/**
+ * The optional (-blockfilterindex) index of BIP158 basic block filters (see blockfilter.h), so that
+ * light clients can be served precomputed filters (BIP157) instead of the node matching bloom filters
+ * against every transaction for every peer.
+ *
+ * A filter and its header are written for every block connected to the main chain, keyed by block hash,
+ * within the block's db transaction. Both only depend on the block and its ancestors, so they're kept
+ * when a block is disconnected and reused if it's connected again.
+ *
+ * It's maintained and built like the other optional indexes (see optionalindex.h).
+ */
+
+class CBlockFilterIndexEntry
+{
+public:
+    std::vector<uint8_t> filter;
+    uint256              filterHash;
+    uint256              header;
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+                        READWRITE(filter);
+                        READWRITE(filterHash);
+                        READWRITE(header);
+                       )
+    // clang-format on
+};
+
+/** whether the index is maintained (-blockfilterindex); set on startup */
+extern bool fBlockFilterIndex;
+
+/** whether the filters are served to peers (-peerblockfilters); requires the index */
+extern bool fPeerBlockFilters;
+
+/** Builds the basic filter of a block; the outputs it spends must be in the txdb */
+bool BuildBasicBlockFilter(const CBlock& block, const ITxDB& txdb, CBlockFilter& filter);
+
+/** Writes the filter of a block whose parent is already indexed, unless it was indexed before */
+bool WriteBlockFilterIndexEntry(const CBlock& block, CTxDB& txdb);
+
+/** The index as an optional index; see optionalindex.h. Disconnecting a block doesn't change it */
+bool ConnectBlockFilterIndex(const CBlock& block, int nHeight, CTxDB& txdb);
+bool InitBlockFilterIndex();
+
+#endif // BLOCKFILTERINDEX_H
@@ -8,55 +8,45 @@
 CBlockIndex::CBlockIndex()
 {
     phashBlock             = 0;
+    nChainTrust            = 0;
+    hashProof              = 0;
+    hashMerkleRoot         = 0;
     pprev                  = NULL;
     pnext                  = NULL;
-    blockKeyInDB           = 0;
-    nHeight                = 0;
-    nChainTrust            = 0;
     nMint                  = 0;
     nMoneySupply           = 0;
-    nFlags                 = 0;
     nStakeModifier         = 0;
+    nHeight                = 0;
+    nFlags                 = 0;
     nStakeModifierChecksum = 0;
-    hashProof              = 0;
-    prevoutStake.SetNull();
-    nStakeTime = 0;
 
-    nVersion       = 0;
-    hashMerkleRoot = 0;
-    nTime          = 0;
-    nBits          = 0;
-    nNonce         = 0;
+    nVersion = 0;
+    nTime    = 0;
+    nBits    = 0;
+    nNonce   = 0;
 }
 
-CBlockIndex::CBlockIndex(uint256 nBlockPosIn, CBlock& block)
+CBlockIndex::CBlockIndex(const CBlock& block)
 {
     phashBlock             = 0;
+    nChainTrust            = 0;
+    hashProof              = 0;
+    hashMerkleRoot         = block.hashMerkleRoot;
     pprev                  = NULL;
     pnext                  = NULL;
-    blockKeyInDB           = nBlockPosIn;
-    nHeight                = 0;
-    nChainTrust            = 0;
     nMint                  = 0;
     nMoneySupply           = 0;
-    nFlags                 = 0;
     nStakeModifier         = 0;
+    nHeight                = 0;
+    nFlags                 = 0;
     nStakeModifierChecksum = 0;
-    hashProof              = 0;
-    if (block.IsProofOfStake()) {
+    if (block.IsProofOfStake())
         SetProofOfStake();
-        prevoutStake = block.vtx[1].vin[0].prevout;
-        nStakeTime   = block.vtx[1].nTime;
-    } else {
-        prevoutStake.SetNull();
-        nStakeTime = 0;
-    }
 
-    nVersion       = block.nVersion;
-    hashMerkleRoot = block.hashMerkleRoot;
-    nTime          = block.nTime;
-    nBits          = block.nBits;
-    nNonce         = block.nNonce;
+    nVersion = block.nVersion;
+    nTime    = block.nTime;
+    nBits    = block.nBits;
+    nNonce   = block.nNonce;
 }
 
 CBlock CBlockIndex::GetBlockHeader() const
@@ -74,15 +64,14 @@ CBlock CBlockIndex::GetBlockHeader() const
 
 std::string CBlockIndex::ToString() const
 {
-    return strprintf("CBlockIndex(nprev=%p, pnext=%p, nBlockPos=%s nHeight=%d, "
+    return strprintf("CBlockIndex(nprev=%p, pnext=%p, nHeight=%d, "
                      "nMint=%s, nMoneySupply=%s, nFlags=(%s)(%d)(%s), nStakeModifier=%016" PRIx64
-                     ", nStakeModifierChecksum=%08x, hashProof=%s, prevoutStake=(%s), nStakeTime=%d "
+                     ", nStakeModifierChecksum=%08x, hashProof=%s, "
                      "merkle=%s, hashBlock=%s)",
-                     pprev.get(), pnext.get(), blockKeyInDB.ToString().c_str(), nHeight,
-                     FormatMoney(nMint).c_str(), FormatMoney(nMoneySupply).c_str(),
-                     GeneratedStakeModifier() ? "MOD" : "-", GetStakeEntropyBit(),
-                     IsProofOfStake() ? "PoS" : "PoW", nStakeModifier, nStakeModifierChecksum,
-                     hashProof.ToString().c_str(), prevoutStake.ToString().c_str(), nStakeTime,
+                     pprev.get(), pnext.get(), nHeight, FormatMoney(nMint).c_str(),
+                     FormatMoney(nMoneySupply).c_str(), GeneratedStakeModifier() ? "MOD" : "-",
+                     GetStakeEntropyBit(), IsProofOfStake() ? "PoS" : "PoW", nStakeModifier,
+                     nStakeModifierChecksum, hashProof.ToString().c_str(),
                      hashMerkleRoot.ToString().c_str(), GetBlockHash().ToString().c_str());
 }
 
@@ -99,7 +88,7 @@ uint256 CBlockIndex::GetBlockTrust() const
 
 bool CBlockIndex::IsInMainChain(const ITxDB& txdb) const
 {
-    return (pnext || this == txdb.GetBestBlockIndex().get());
+    return (chainActive.Contains(this) || this == txdb.GetBestBlockIndex().get());
 }
 
 bool CBlockIndex::IsSuperMajority(int minVersion, const CBlockIndex* pstart, unsigned int nRequired,
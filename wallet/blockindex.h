@@ -2,7 +2,6 @@
 #define BLOCKINDEX_H
 
 #include "globals.h"
-#include "outpoint.h"
 #include "uint256.h"
 
 class CBlock;
@@ -17,17 +16,24 @@ class CBlock;
 class CBlockIndex
 {
 public:
+    // Fields are grouped by size to avoid padding. The block's key in the db is its hash, and the
+    // stake outpoint/time are only needed when the index is written to or read from disk, so they
+    // live in CDiskBlockIndex only.
     uint256             phashBlock;
+    uint256             nChainTrust; // ppcoin: trust score of block chain
+    uint256             hashProof;
+    uint256             hashMerkleRoot;
     CBlockIndexSmartPtr pprev;
     CBlockIndexSmartPtr pnext;
-    uint256             blockKeyInDB;
-    uint256             nChainTrust; // ppcoin: trust score of block chain
-    int                 nHeight;
 
-    CAmount nMint;
-    CAmount nMoneySupply;
+    CAmount  nMint;
+    CAmount  nMoneySupply;
+    uint64_t nStakeModifier; // hash modifier for proof-of-stake
+
+    int          nHeight;
+    unsigned int nFlags;                 // ppcoin: block index flags
+    unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
 
-    unsigned int nFlags; // ppcoin: block index flags
     enum
     {
         BLOCK_PROOF_OF_STAKE = (1 << 0), // is proof-of-stake block
@@ -35,25 +41,15 @@ public:
         BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
     };
 
-    uint64_t     nStakeModifier;         // hash modifier for proof-of-stake
-    unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
-
-    // proof-of-stake specific fields
-    COutPoint    prevoutStake;
-    unsigned int nStakeTime;
-
-    uint256 hashProof;
-
     // block header
     int          nVersion;
-    uint256      hashMerkleRoot;
     unsigned int nTime;
     unsigned int nBits;
     unsigned int nNonce;
 
     CBlockIndex();
 
-    CBlockIndex(uint256 nBlockPosIn, CBlock& block);
+    explicit CBlockIndex(const CBlock& block);
 
     CBlock GetBlockHeader() const;
 
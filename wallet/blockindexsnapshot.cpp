@@ -0,0 +1,263 @@
+#include "blockindexsnapshot.h"
+
+#include "blockindex.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/make_shared.hpp>
+#include <cstring>
+
+static const char        SNAPSHOT_MAGIC[8]    = {'N', 'E', 'B', 'L', 'B', 'I', 'X', '\0'};
+static const std::size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 4 + 32 + 32 + 8 + 8;
+// hash, hashPrev, nChainTrust, hashProof, hashMerkleRoot; nMint, nMoneySupply, nStakeModifier;
+// nHeight, nFlags, nStakeModifierChecksum, nVersion, nTime, nBits, nNonce
+static const std::size_t SNAPSHOT_BLOCK_RECORD_SIZE = 5 * 32 + 3 * 8 + 7 * 4;
+// prevout hash, prevout n, stake time
+static const std::size_t SNAPSHOT_STAKE_RECORD_SIZE = 32 + 4 + 4;
+static const std::size_t SNAPSHOT_TRAILER_SIZE      = 32;
+
+namespace {
+class SnapshotWriter
+{
+    FILE*       file;
+    CHashWriter hasher;
+    bool        fGood;
+
+public:
+    explicit SnapshotWriter(FILE* fileIn) : file(fileIn), hasher(SER_GETHASH, 0), fGood(true) {}
+
+    void write(const void* data, std::size_t size)
+    {
+        if (fwrite(data, 1, size, file) != size)
+            fGood = false;
+        hasher.write(static_cast<const char*>(data), size);
+    }
+
+    template <typename T>
+    void put(const T& value)
+    {
+        write(&value, sizeof(value));
+    }
+
+    bool finish()
+    {
+        uint256 checksum = hasher.GetHash();
+        if (fwrite(&checksum, 1, sizeof(checksum), file) != sizeof(checksum))
+            fGood = false;
+        return fGood;
+    }
+};
+
+class SnapshotReader
+{
+    const char* pos;
+
+public:
+    explicit SnapshotReader(const char* begin) : pos(begin) {}
+
+    template <typename T>
+    void get(T& value)
+    {
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+    }
+};
+} // namespace
+
+boost::filesystem::path GetBlockIndexSnapshotPath() { return GetDataDir() / "blockindex.snapshot"; }
+
+bool WriteBlockIndexSnapshot(const boost::filesystem::path&    path,
+                             const BlockIndexMapType::MapType& blockIndex,
+                             const StakeSeenSetType& stakeSeen, const uint256& hashBestChain)
+{
+    static_assert(sizeof(uint256) == 32, "The snapshot layout assumes 32-byte hashes");
+
+    // parents have to come before their children so that the reader can link in one pass
+    std::vector<const CBlockIndex*> vSortedByHeight;
+    vSortedByHeight.reserve(blockIndex.size());
+    for (const auto& item : blockIndex) {
+        vSortedByHeight.push_back(item.second.get());
+    }
+    std::stable_sort(vSortedByHeight.begin(), vSortedByHeight.end(),
+                     [](const CBlockIndex* a, const CBlockIndex* b) { return a->nHeight < b->nHeight; });
+
+    const boost::filesystem::path tmpPath = path.string() + ".tmp";
+
+    FILE* file = fopen(tmpPath.string().c_str(), "wb");
+    if (!file)
+        return error("WriteBlockIndexSnapshot() : failed to open %s", tmpPath.string().c_str());
+
+    SnapshotWriter writer(file);
+    writer.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writer.put(BLOCK_INDEX_SNAPSHOT_VERSION);
+    writer.put(Params().GenesisBlockHash());
+    writer.put(hashBestChain);
+    writer.put(static_cast<uint64_t>(vSortedByHeight.size()));
+    writer.put(static_cast<uint64_t>(stakeSeen.size()));
+
+    for (const CBlockIndex* pindex : vSortedByHeight) {
+        const CBlockIndex* pprev = boost::atomic_load(&pindex->pprev).get();
+        writer.put(pindex->GetBlockHash());
+        writer.put(pprev ? pprev->GetBlockHash() : uint256(0));
+        writer.put(pindex->nChainTrust);
+        writer.put(pindex->hashProof);
+        writer.put(pindex->hashMerkleRoot);
+        writer.put(pindex->nMint);
+        writer.put(pindex->nMoneySupply);
+        writer.put(pindex->nStakeModifier);
+        writer.put(pindex->nHeight);
+        writer.put(pindex->nFlags);
+        writer.put(pindex->nStakeModifierChecksum);
+        writer.put(pindex->nVersion);
+        writer.put(pindex->nTime);
+        writer.put(pindex->nBits);
+        writer.put(pindex->nNonce);
+    }
+
+    for (const auto& stake : stakeSeen) {
+        writer.put(stake.first.hash);
+        writer.put(stake.first.n);
+        writer.put(stake.second);
+    }
+
+    const bool fGood = writer.finish();
+    FileCommit(file);
+    fclose(file);
+
+    if (!fGood) {
+        boost::filesystem::remove(tmpPath);
+        return error("WriteBlockIndexSnapshot() : failed to write %s", tmpPath.string().c_str());
+    }
+    if (!RenameOver(tmpPath, path))
+        return error("WriteBlockIndexSnapshot() : failed to rename %s", tmpPath.string().c_str());
+    return true;
+}
+
+static bool ParseBlockIndexSnapshot(const char* begin, std::size_t size,
+                                    const uint256& expectedBestChain, uint64_t expectedEntries,
+                                    BlockIndexMapType::MapType& blockIndex,
+                                    StakeSeenSetType&           stakeSeen)
+{
+    if (size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_TRAILER_SIZE)
+        return error("ReadBlockIndexSnapshot() : file is too small");
+
+    uint256 checksum;
+    std::memcpy(&checksum, begin + size - SNAPSHOT_TRAILER_SIZE, sizeof(checksum));
+    if (Hash(begin, begin + size - SNAPSHOT_TRAILER_SIZE) != checksum)
+        return error("ReadBlockIndexSnapshot() : checksum mismatch");
+
+    if (std::memcmp(begin, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        return error("ReadBlockIndexSnapshot() : invalid magic bytes");
+
+    SnapshotReader reader(begin + sizeof(SNAPSHOT_MAGIC));
+    uint32_t       version;
+    uint256        genesisHash;
+    uint256        hashBestChain;
+    uint64_t       blockCount;
+    uint64_t       stakeCount;
+    reader.get(version);
+    reader.get(genesisHash);
+    reader.get(hashBestChain);
+    reader.get(blockCount);
+    reader.get(stakeCount);
+
+    if (version != BLOCK_INDEX_SNAPSHOT_VERSION)
+        return error("ReadBlockIndexSnapshot() : unsupported version %u", version);
+    if (genesisHash != Params().GenesisBlockHash())
+        return error("ReadBlockIndexSnapshot() : snapshot is for a different network");
+    if (hashBestChain != expectedBestChain || blockCount != expectedEntries)
+        return error("ReadBlockIndexSnapshot() : snapshot is stale (%" PRIu64 " blocks, best %s)",
+                     blockCount, hashBestChain.ToString().c_str());
+    if (size != SNAPSHOT_HEADER_SIZE + blockCount * SNAPSHOT_BLOCK_RECORD_SIZE +
+                    stakeCount * SNAPSHOT_STAKE_RECORD_SIZE + SNAPSHOT_TRAILER_SIZE)
+        return error("ReadBlockIndexSnapshot() : unexpected file size %" PRIszu, size);
+
+    for (uint64_t i = 0; i < blockCount; i++) {
+        uint256 hash;
+        uint256 hashPrev;
+        reader.get(hash);
+        reader.get(hashPrev);
+
+        const CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>();
+        if (!blockIndex.insert(std::make_pair(hash, pindex)).second)
+            return error("ReadBlockIndexSnapshot() : duplicate block %s", hash.ToString().c_str());
+        pindex->phashBlock = hash;
+        if (hashPrev != 0) {
+            const auto it = blockIndex.find(hashPrev);
+            if (it == blockIndex.end())
+                return error("ReadBlockIndexSnapshot() : parent of %s isn't in the snapshot",
+                             hash.ToString().c_str());
+            pindex->pprev = it->second;
+        }
+        reader.get(pindex->nChainTrust);
+        reader.get(pindex->hashProof);
+        reader.get(pindex->hashMerkleRoot);
+        reader.get(pindex->nMint);
+        reader.get(pindex->nMoneySupply);
+        reader.get(pindex->nStakeModifier);
+        reader.get(pindex->nHeight);
+        reader.get(pindex->nFlags);
+        reader.get(pindex->nStakeModifierChecksum);
+        reader.get(pindex->nVersion);
+        reader.get(pindex->nTime);
+        reader.get(pindex->nBits);
+        reader.get(pindex->nNonce);
+    }
+
+    for (uint64_t i = 0; i < stakeCount; i++) {
+        COutPoint    prevout;
+        unsigned int nStakeTime;
+        reader.get(prevout.hash);
+        reader.get(prevout.n);
+        reader.get(nStakeTime);
+        stakeSeen.insert(std::make_pair(prevout, nStakeTime));
+    }
+
+    // pnext only links the main chain, so it's restored by walking back from the best block
+    const auto itBest = blockIndex.find(hashBestChain);
+    if (itBest == blockIndex.end())
+        return error("ReadBlockIndexSnapshot() : best block isn't in the snapshot");
+    for (CBlockIndexSmartPtr pindex = itBest->second; pindex->pprev; pindex = pindex->pprev) {
+        pindex->pprev->pnext = pindex;
+    }
+
+    return true;
+}
+
+bool ReadBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& expectedBestChain,
+                            uint64_t expectedEntries, BlockIndexMapType::MapType& blockIndex,
+                            StakeSeenSetType& stakeSeen)
+{
+    blockIndex.clear();
+    stakeSeen.clear();
+
+    if (!boost::filesystem::exists(path))
+        return false;
+
+    bool fSuccess = false;
+    try {
+        boost::interprocess::file_mapping  mapping(path.string().c_str(),
+                                                   boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+        fSuccess = ParseBlockIndexSnapshot(static_cast<const char*>(region.get_address()),
+                                           region.get_size(), expectedBestChain, expectedEntries,
+                                           blockIndex, stakeSeen);
+    } catch (std::exception& ex) {
+        printf("ReadBlockIndexSnapshot() : failed to map %s: %s\n", path.string().c_str(), ex.what());
+    }
+
+    if (!fSuccess) {
+        // unlink first so that releasing a long chain doesn't recurse through pprev
+        for (const auto& item : blockIndex) {
+            item.second->pprev.reset();
+            item.second->pnext.reset();
+        }
+        blockIndex.clear();
+        stakeSeen.clear();
+    }
+    return fSuccess;
+}
@@ -0,0 +1,45 @@
+#ifndef BLOCKINDEXSNAPSHOT_H
+#define BLOCKINDEXSNAPSHOT_H
+
+#include "globals.h"
+#include "outpoint.h"
+#include "uint256.h"
+
+#include <boost/filesystem/path.hpp>
+#include <set>
+
+/**
+ * A snapshot of the fully linked in-memory block index, written on clean shutdown so that the next
+ * start doesn't have to rebuild it from the block index db.
+ *
+ * Layout (native little-endian, fixed width, so the file is mapped and parsed in place):
+ *   header:  magic, version, genesis hash, best chain hash, block count, stake-seen count
+ *   blocks:  one fixed-size record per block index entry, parents before children
+ *   stakes:  the entries of setStakeSeen
+ *   trailer: double-SHA256 of everything before it
+ *
+ * A snapshot is only used if it was written for the same network, the same best chain and the same
+ * number of block index entries as the db holds, and it's deleted once it has been read, so a run that
+ * doesn't shut down cleanly never leaves a stale snapshot behind.
+ */
+
+using StakeSeenSetType = std::set<std::pair<COutPoint, unsigned int>>;
+
+static const uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
+
+boost::filesystem::path GetBlockIndexSnapshotPath();
+
+bool WriteBlockIndexSnapshot(const boost::filesystem::path&    path,
+                             const BlockIndexMapType::MapType& blockIndex,
+                             const StakeSeenSetType& stakeSeen, const uint256& hashBestChain);
+
+/**
+ * Loads a snapshot into blockIndex and stakeSeen, including pprev/pnext links, chain trust and stake
+ * modifier checksums. Returns false if the snapshot is missing, was written for another state of the
+ * db, or is corrupt; blockIndex and stakeSeen are left empty in that case.
+ */
+bool ReadBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& expectedBestChain,
+                            uint64_t expectedEntries, BlockIndexMapType::MapType& blockIndex,
+                            StakeSeenSetType& stakeSeen);
+
+#endif // BLOCKINDEXSNAPSHOT_H
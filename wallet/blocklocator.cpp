@@ -8,9 +8,9 @@ CBlockLocator::CBlockLocator(const CBlockIndex* pindex) { Set(pindex); }
 
 CBlockLocator::CBlockLocator(uint256 hashBlock)
 {
-    const auto bi = mapBlockIndex.get(hashBlock).value_or(nullptr);
-    if (bi)
-        Set(bi.get());
+    const CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+    if (pindex)
+        Set(pindex);
 }
 
 CBlockLocator::CBlockLocator(const std::vector<uint256>& vHaveIn) { vHave = vHaveIn; }
@@ -41,9 +41,9 @@ int CBlockLocator::GetDistanceBack()
     int nDistance = 0;
     int nStep     = 1;
     BOOST_FOREACH (const uint256& hash, vHave) {
-        const auto bi = mapBlockIndex.get(hash).value_or(nullptr);
-        if (bi) {
-            if (bi->IsInMainChain(CTxDB()))
+        const CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (pindex) {
+            if (pindex->IsInMainChain(CTxDB()))
                 return nDistance;
         }
         nDistance += nStep;
@@ -70,9 +70,9 @@ uint256 CBlockLocator::GetBlockHash()
 {
     // Find the first block the caller has in the main chain
     BOOST_FOREACH (const uint256& hash, vHave) {
-        const auto bi = mapBlockIndex.get(hash).value_or(nullptr);
-        if (bi) {
-            if (bi->IsInMainChain(CTxDB()))
+        const CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (pindex) {
+            if (pindex->IsInMainChain(CTxDB()))
                 return hash;
         }
     }
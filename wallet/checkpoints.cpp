@@ -42,14 +42,13 @@ CBlockIndex* GetLastCheckpoint(const BlockIndexMapType& mapBlockIndex)
 {
     const MapCheckpoints& checkpoints = Params().Checkpoints();
 
-    auto lock = mapBlockIndex.get_shared_lock();
-
     BOOST_REVERSE_FOREACH(const MapCheckpoints::value_type& i, checkpoints)
     {
-        const uint256&                                         hash = i.second;
-        auto val   = mapBlockIndex.get_unsafe(hash).value_or(nullptr);
-        if (val)
-            return val.get();
+        const uint256& hash   = i.second;
+        CBlockIndex*   result = nullptr;
+        mapBlockIndex.visit(hash, [&result](const CBlockIndexSmartPtr& p) { result = p.get(); });
+        if (result)
+            return result;
     }
     return nullptr;
 }
@@ -182,6 +182,103 @@ void cURLTools::GetLargeFileFromHTTPS(const std::string& URL, long ConnectionTim
     }
 }
 
+namespace {
+struct RangeWriteState
+{
+    CURL*                                                curl;
+    uint64_t                                             size;
+    uint64_t                                             received;
+    const std::function<bool(const char*, std::size_t)>* sink;
+};
+
+size_t CurlWrite_CallbackFunc_Range(void* contents, size_t size, size_t nmemb, RangeWriteState* state)
+{
+    const size_t newLength = size * nmemb;
+    if (state->received == 0) {
+        // a server that ignores the range sends the whole file, which mustn't be taken for the range
+        long http_response_code = 0;
+        curl_easy_getinfo(state->curl, CURLINFO_RESPONSE_CODE, &http_response_code);
+        if (http_response_code != 206) {
+            return 0;
+        }
+    }
+    if (newLength > state->size - state->received) {
+        return 0;
+    }
+    if (!(*state->sink)(reinterpret_cast<const char*>(contents), newLength)) {
+        return 0;
+    }
+    state->received += newLength;
+    return newLength;
+}
+} // namespace
+
+void cURLTools::GetFileRangeFromHTTPS(const std::string& URL, long ConnectionTimeout, uint64_t offset,
+                                      uint64_t                                             size,
+                                      const std::function<bool(const char*, std::size_t)>& sink)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    boost::call_once(init_openssl_once_flag, SSL_library_init);
+#else
+    boost::call_once(init_openssl_once_flag, OPENSSL_init_ssl, 0,
+                     static_cast<const ossl_init_settings_st*>(NULL));
+#endif
+
+    boost::call_once(init_curl_global_once_flag, CurlGlobalInit_ThreadSafe);
+
+    if (size == 0) {
+        return;
+    }
+
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        throw std::runtime_error("Failed to initialize curl");
+    }
+    CurlCleaner cleaner(curl);
+
+    RangeWriteState state;
+    state.curl     = curl;
+    state.size     = size;
+    state.received = 0;
+    state.sink     = &sink;
+
+    const std::string range = std::to_string(offset) + "-" + std::to_string(offset + size - 1);
+    const std::string agent = GetUserAgent();
+
+    curl_easy_setopt(curl, CURLOPT_URL, URL.c_str());
+    curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+    curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CurlWrite_CallbackFunc_Range);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, agent.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, true);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, ConnectionTimeout);
+    /* abort if slower than 1k bytes/sec during 60 seconds */
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1000L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+
+    const CURLcode res = curl_easy_perform(curl);
+
+    long http_response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_response_code);
+    if (http_response_code == 200) {
+        throw RangeNotSupportedError("The server of \"" + URL + "\" doesn't support range requests");
+    }
+    if (http_response_code != 206 && http_response_code != 0) {
+        throw std::runtime_error("Error retrieving range " + range + " from URL \"" + URL +
+                                 "\", error code: " + ToString(http_response_code));
+    }
+    if (res != CURLE_OK) {
+        throw std::runtime_error("Error retrieving range " + range + " from URL \"" + URL +
+                                 "\": " + std::string(curl_easy_strerror(res)));
+    }
+    if (state.received != size) {
+        throw std::runtime_error("Incomplete range " + range + " retrieved from URL \"" + URL +
+                                 "\": " + ToString(state.received) + " bytes");
+    }
+}
+
 std::string cURLTools::GetUserAgent()
 {
     std::string agent;
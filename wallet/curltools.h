@@ -6,7 +6,16 @@
 #include <boost/optional.hpp>
 #include <curl/curl.h>
 #include <deque>
+#include <functional>
 #include <set>
+#include <stdexcept>
+
+/** thrown when a server answers a range request with something else than the range */
+class RangeNotSupportedError : public std::runtime_error
+{
+public:
+    explicit RangeNotSupportedError(const std::string& msg) : std::runtime_error(msg) {}
+};
 
 class cURLTools
 {
@@ -33,6 +42,14 @@ public:
                                                        double NowDownloaded, double, double);
     static size_t      CurlWrite_CallbackFunc_File(void* contents, size_t size, size_t nmemb,
                                                    boost::filesystem::fstream* fs);
+    /**
+     * Downloads the size bytes of URL that start at offset with an HTTP range request, and hands them to
+     * sink as they arrive; sink returns false to abort the download. Throws RangeNotSupportedError if
+     * the server doesn't answer with the range.
+     */
+    static void        GetFileRangeFromHTTPS(const std::string& URL, long ConnectionTimeout,
+                                             uint64_t offset, uint64_t size,
+                                             const std::function<bool(const char*, std::size_t)>& sink);
     static std::string GetUserAgent();
 };
 
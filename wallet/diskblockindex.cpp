@@ -26,8 +26,10 @@ std::string CDiskBlockIndex::ToString() const
 {
     std::string str = "CDiskBlockIndex(";
     str += CBlockIndex::ToString();
-    str += strprintf("\n                hashBlock=%s, hashPrev=%s, hashNext=%s)",
+    str += strprintf("\n                hashBlock=%s, hashPrev=%s, hashNext=%s, nBlockPos=%s, "
+                     "prevoutStake=(%s), nStakeTime=%d)",
                      GetBlockHash().ToString().c_str(), hashPrev.ToString().c_str(),
-                     hashNext.ToString().c_str());
+                     hashNext.ToString().c_str(), blockKeyInDB.ToString().c_str(),
+                     prevoutStake.ToString().c_str(), nStakeTime);
     return str;
 }
@@ -2,6 +2,7 @@
 #define DISKBLOCKINDEX_H
 
 #include "blockindex.h"
+#include "outpoint.h"
 #include "uint256.h"
 
 /** Used to marshal pointers into hashes for db storage. */
@@ -13,18 +14,33 @@ private:
 public:
     uint256 hashPrev;
     uint256 hashNext;
+    uint256 blockKeyInDB;
+
+    // proof-of-stake specific fields; not kept in memory by CBlockIndex
+    COutPoint    prevoutStake;
+    unsigned int nStakeTime;
 
     CDiskBlockIndex()
     {
-        hashPrev  = 0;
-        hashNext  = 0;
-        blockHash = 0;
+        hashPrev     = 0;
+        hashNext     = 0;
+        blockHash    = 0;
+        blockKeyInDB = 0;
+        nStakeTime   = 0;
     }
 
-    explicit CDiskBlockIndex(CBlockIndex* pindex) : CBlockIndex(*pindex)
+    /**
+     * The stake fields aren't part of CBlockIndex, so they're given along with it: from the coinstake of
+     * a proof-of-stake block, or null and 0 for a proof-of-work one
+     */
+    CDiskBlockIndex(const CBlockIndex* pindex, const COutPoint& prevoutStakeIn,
+                    unsigned int nStakeTimeIn)
+        : CBlockIndex(*pindex), prevoutStake(prevoutStakeIn), nStakeTime(nStakeTimeIn)
     {
-        hashPrev = (pprev ? pprev->GetBlockHash() : 0);
-        hashNext = (pnext ? pnext->GetBlockHash() : 0);
+        hashPrev     = (pprev ? pprev->GetBlockHash() : 0);
+        hashNext     = (pnext ? pnext->GetBlockHash() : 0);
+        blockHash    = 0;
+        blockKeyInDB = pindex->GetBlockHash();
     }
 
     IMPLEMENT_SERIALIZE(
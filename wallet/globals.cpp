@@ -6,6 +6,7 @@ CTxMemPool mempool;
 
 BlockIndexMapType   mapBlockIndex;
 CBlockIndexSmartPtr pindexGenesisBlock = nullptr;
+ActiveChain         chainActive;
 
 boost::atomic_int64_t nTimeLastBestBlockReceived{0};
 
@@ -1,11 +1,12 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include "activechain.h"
 #include "amount.h"
 #include "chainparams.h"
 #include "sync.h"
 #include "uint256.h"
-#include <ThreadSafeMap.h>
+#include <LockFreeHashMap.h>
 #include <boost/atomic.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -15,7 +16,7 @@ class BestChainState;
 
 using CBlockIndexSmartPtr      = boost::shared_ptr<CBlockIndex>;
 using ConstCBlockIndexSmartPtr = boost::shared_ptr<const CBlockIndex>;
-using BlockIndexMapType        = ThreadSafeMap<uint256, CBlockIndexSmartPtr>;
+using BlockIndexMapType        = LockFreeHashMap<uint256, CBlockIndexSmartPtr>;
 
 extern BestChainState bestChain;
 
@@ -24,6 +25,18 @@ extern CTxMemPool mempool;
 extern CCriticalSection    cs_main;
 extern BlockIndexMapType   mapBlockIndex;
 extern CBlockIndexSmartPtr pindexGenesisBlock;
+/** The main chain indexed by height; kept in sync with pnext links and the best chain in the db */
+extern ActiveChain chainActive;
+
+/** Lock-free lookup in mapBlockIndex that doesn't touch the reference count; returns nullptr if the
+ * block isn't indexed. The returned pointer is valid as long as the block's entry isn't replaced or
+ * erased, which only happens when the block index is rebuilt. */
+inline CBlockIndex* LookupBlockIndex(const uint256& hash)
+{
+    CBlockIndex* result = nullptr;
+    mapBlockIndex.visit(hash, [&result](const CBlockIndexSmartPtr& p) { result = p.get(); });
+    return result;
+}
 
 extern boost::atomic_int64_t nTimeLastBestBlockReceived;
 
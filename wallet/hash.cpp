@@ -85,3 +85,58 @@ void* KDF_SHA512(const void* in, size_t inlen, void* out, size_t* outlen)
     return nullptr;
 #endif
 }
+
+static inline uint64_t RotateLeft(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+static inline void SipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+{
+    v0 += v1;
+    v1 = RotateLeft(v1, 13);
+    v1 ^= v0;
+    v0 = RotateLeft(v0, 32);
+    v2 += v3;
+    v3 = RotateLeft(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = RotateLeft(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = RotateLeft(v1, 17);
+    v1 ^= v2;
+    v2 = RotateLeft(v2, 32);
+}
+
+uint64_t SipHash(uint64_t k0, uint64_t k1, const unsigned char* data, std::size_t size)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const std::size_t fullWords = size / 8;
+    for (std::size_t i = 0; i < fullWords; i++) {
+        uint64_t m = 0;
+        for (int j = 7; j >= 0; j--) {
+            m = (m << 8) | data[i * 8 + j];
+        }
+        v3 ^= m;
+        SipRound(v0, v1, v2, v3);
+        SipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t last = static_cast<uint64_t>(size) << 56;
+    for (std::size_t j = 0; j < size % 8; j++) {
+        last |= static_cast<uint64_t>(data[fullWords * 8 + j]) << (8 * j);
+    }
+    v3 ^= last;
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        SipRound(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
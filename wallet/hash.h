@@ -119,8 +119,21 @@ inline uint160 Hash160(const std::vector<unsigned char>& vch)
     return hash2;
 }
 
+template <unsigned int N>
+inline uint160 Hash160(const prevector<N, unsigned char>& vch)
+{
+    uint256 hash1;
+    SHA256(vch.data(), vch.size(), (unsigned char*)&hash1);
+    uint160 hash2;
+    RIPEMD160((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
+    return hash2;
+}
+
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash);
 
+/** SipHash-2-4 of data with the 128-bit key (k0, k1) */
+uint64_t SipHash(uint64_t k0, uint64_t k1, const unsigned char* data, std::size_t size);
+
 template <typename CTXType, int (*InitFunc)(CTXType*), int (*UpdateFunc)(CTXType*, const void*, size_t),
           int (*FinalFunc)(unsigned char*, CTXType*), unsigned DigestSize>
 class HashCalculator
@@ -129,6 +142,7 @@ class HashCalculator
 
 public:
     HashCalculator() { reset(); }
+    void push_data(const void* data, std::size_t size) { UpdateFunc(&ctx, data, size); }
     void push_data(const std::string& data)
     {
         UpdateFunc(&ctx, reinterpret_cast<const void*>(&data.front()), data.size());
@@ -3,18 +3,26 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include "bitcoinrpc.h"
+#include "blockindexsnapshot.h"
 #include "txdb.h"
 #include "walletdb.h"
 #ifdef NEBLIO_REST
 #include "nebliorest.h"
 #endif
+#include "addressindex.h"
+#include "blockencodings.h"
+#include "blockfilterindex.h"
 #include "checkpoints.h"
 #include "globals.h"
 #include "init.h"
 #include "main.h"
 #include "net.h"
+#include "nodemetrics.h"
+#include "ntp1tokenindex.h"
+#include "txmempool.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "validationinterface.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
@@ -94,6 +102,19 @@ void StartShutdown()
 #endif
 }
 
+static void WriteBlockIndexSnapshotOnShutdown()
+{
+    if (!appInitiated || !GetBoolArg("-blockindexsnapshot", true))
+        return;
+
+    LOCK(cs_main);
+    const int64_t nStart = GetTimeMillis();
+    if (WriteBlockIndexSnapshot(GetBlockIndexSnapshotPath(), mapBlockIndex.getInternalMap(),
+                                setStakeSeen, CTxDB().GetBestBlockHash())) {
+        printf("Wrote block index snapshot in %" PRId64 "ms\n", GetTimeMillis() - nStart);
+    }
+}
+
 void Shutdown(void* /*parg*/)
 {
     static CCriticalSection cs_Shutdown;
@@ -117,9 +138,20 @@ void Shutdown(void* /*parg*/)
         //        CTxDB().Close();
         FlushDBWalletTransient(false);
         StopNode();
+        StopMetricsServer();
+        {
+            // blocks still being written in a batch are committed (and queued for the wallets) by
+            // the thread writing them, which holds cs_main until then
+            LOCK(cs_main);
+        }
+        // deliver whatever is left for the wallets before they're flushed
+        validationInterfaceQueue.Stop();
+        WriteBlockIndexSnapshotOnShutdown();
         FlushDBWalletTransient(true);
         boost::filesystem::remove(GetPidFile());
         UnregisterWallet(pwalletMain);
+        if (pwalletMain)
+            SetLockWaitMetricName(&pwalletMain->cs_wallet, nullptr);
         std::weak_ptr<CWallet> weakWallet = pwalletMain;
         pwalletMain.reset();
         while (weakWallet.lock()) {
@@ -128,6 +160,7 @@ void Shutdown(void* /*parg*/)
         NewThread(ExitTimeout, NULL);
         MilliSleep(50);
         printf("neblio exited\n\n");
+        StopAsyncDebugLog();
         fExit = true;
 #ifndef QT_GUI
         // ensure non-UI client gets exited here, but let Bitcoin-Qt reach 'return 0;' in bitcoin.cpp
@@ -149,7 +182,7 @@ void HandleSIGHUP(int) { fReopenDebugLog = true; }
 //
 // Start
 //
-#if !defined(QT_GUI) && !defined(NEBLIO_UNITTESTS)
+#if !defined(QT_GUI) && !defined(NEBLIO_UNITTESTS) && !defined(NEBLIO_BENCHMARKS)
 bool AppInit(int argc, char* argv[])
 {
     bool fRet = false;
@@ -268,6 +301,8 @@ std::string HelpMessage()
         "  -maxorphanblocks=<n>   " + _("Keep at most <n> unconnectable blocks in memory (default: 750)") + "\n" +
         "  -maxorphantx=<n>       " + _("Keep at most <n> unconnectable transactions in memory (default: 100)") + "\n" +
         "  -dblogsize=<n>         " + _("Set database disk log size in megabytes (default: 100)") + "\n" +
+        "  -ibdbatchsize=<n>      " + _("During the initial block download, commit downloaded blocks to the database together, once <n> megabytes were written; 0 commits every block (default: 64)") + "\n" +
+        "  -ibdbatchms=<n>        " + _("During the initial block download, hold the main lock for about <n> milliseconds at most to write a batch of blocks, and commit it after that, however big it is (default: 2000)") + "\n" +
         "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n" +
         "  -proxy=<ip:port>       " + _("Connect through socks proxy") + "\n" +
         "  -socks=<n>             " + _("Select the version of socks proxy to use (4-5, default: 5)") + "\n" +
@@ -291,7 +326,9 @@ std::string HelpMessage()
         "  -bantime=<n>           " + _("Number of seconds to keep misbehaving peers from reconnecting (default: 86400)") + "\n" +
         "  -maxreceivebuffer=<n>  " + _("Maximum per-connection receive buffer, <n>*1000 bytes (default: 5000)") + "\n" +
         "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 1000)") + "\n" +
+        "  -compactblocks         " + _("Download and relay new blocks as compact blocks, completed from the mempool (default: 1)") + "\n" +
         "  -noquicksync           " + _("Whether QuickSync should be used to quickly sync with the network") + "\n" +
+        "  -quicksyncconnections=<n> " + _("Number of ranges of a QuickSync file downloaded at once (default: 4)") + "\n" +
         "  -coldstaking           " + _("Enable cold-staking for this node (default: true)") + "\n" +
 #ifdef USE_UPNP
 #if USE_UPNP
@@ -312,8 +349,12 @@ std::string HelpMessage()
         "  -rpccookiefile=<file>  " + _("Location of the auth cookie (default: data dir)") + "\n" +
         "  -testnet               " + _("Use the test network") + "\n" +
         "  -debug                 " + _("Output extra debugging information. Implies all other -debug* options") + "\n" +
+        "  -debug=<category>      " + _("Output debugging information of a category; can be given multiple times. Categories:") + " " + LogCategoryNames() + "\n" +
         "  -debugnet              " + _("Output extra network debugging information") + "\n" +
         "  -logtimestamps         " + _("Prepend debug output with timestamp") + "\n" +
+        "  -logratelimit=<n>      " + _("Log at most <n> messages per minute from the same place in the code, 0 for no limit (default: 0)") + "\n" +
+        "  -lockprofile=<n>       " + _("Profile lock contention, timing one in every <n> lock acquisitions; see getlockcontention (default: 0, off)") + "\n" +
+        "  -asynclog              " + _("Write debug.log from a background thread (default: 1)") + "\n" +
         "  -shrinkdebugfile       " + _("Shrink debug.log file on client startup (default: 1 when no -debug)") + "\n" +
         "  -printtoconsole        " + _("Send trace/debug info to console instead of debug.log file") + "\n" +
         "  -uacomment=<cmt>       " + _("Append comment to the user agent string") + "\n" +
@@ -326,6 +367,8 @@ std::string HelpMessage()
         "  -rpcport=<port>        " + _("Listen for JSON-RPC connections on <port> (default: 6326 or testnet: 16326 or regtest: 26326)") + "\n" +
         "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n" +
         "  -rpcconnect=<ip>       " + _("Send commands to node running on <ip> (default: 127.0.0.1)") + "\n" +
+        "  -metricsport=<port>    " + _("Serve metrics in the Prometheus text format at /metrics on <port> (default: off)") + "\n" +
+        "  -metricsbind=<ip>      " + _("Address to serve metrics on, with -metricsport (default: 127.0.0.1)") + "\n" +
         "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n" +
         "  -walletnotify=<cmd>    " + _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)") + "\n" +
         "  -confchange            " + _("Require a confirmations for change (default: 0)") + "\n" +
@@ -333,10 +376,17 @@ std::string HelpMessage()
         "  -alertnotify=<cmd>     " + _("Execute command when a relevant alert is received (%s in cmd is replaced by message)") + "\n" +
         "  -upgradewallet         " + _("Upgrade wallet to latest format") + "\n" +
         "  -keypool=<n>           " + _("Set key pool size to <n> (default: 100)") + "\n" +
+        "  -stakingkeycache=<n>   " + _("While the wallet is unlocked for staking only, keep the keys used for staking decrypted in locked memory for up to <n> seconds, to sign stakes faster (default: 0, off)") + "\n" +
         "  -rescan                " + _("Rescan the block chain for missing wallet transactions") + "\n" +
         "  -salvagewallet         " + _("Attempt to recover private keys from a corrupt wallet.dat") + "\n" +
         "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 2500, 0 = all)") + "\n" +
         "  -checklevel=<n>        " + _("How thorough the block verification is (0-6, default: 1)") + "\n" +
+        "  -blockindexsnapshot    " + _("Write a snapshot of the block index on shutdown and load it on the next start (default: 1)") + "\n" +
+        "  -ntp1index             " + _("Maintain an index of NTP1 token balances of all addresses and token supplies, used by the getntp1address* and getntp1token* RPC calls (default: 0)") + "\n" +
+        "  -addressindex          " + _("Maintain an index of the transactions and unspent outputs of all addresses, used by the getaddress* RPC calls (default: 0)") + "\n" +
+        "  -spentindex            " + _("Maintain an index of the inputs spending all outputs, used by the getspentinfo RPC call (default: 0)") + "\n" +
+        "  -blockfilterindex      " + _("Maintain an index of BIP158 compact block filters, used by the getblockfilter RPC call (default: 0)") + "\n" +
+        "  -peerblockfilters      " + _("Serve compact block filters to peers (BIP157); requires -blockfilterindex (default: 0)") + "\n" +
         "  -loadblock=<file>      " + _("Imports blocks from external blk000?.dat file") + "\n" +
 
         "\n" + _("Block creation options:") + "\n" +
@@ -416,8 +466,14 @@ bool AppInit2()
     // ********************************************************* Step 2: parameter interactions
 
     nNodeLifespan = GetArg("-addrlifespan", 7);
-    fUseFastIndex = GetBoolArg("-fastindex", true);
-    nMinerSleep   = GetArg("-minersleep", 500);
+    fUseFastIndex     = GetBoolArg("-fastindex", true);
+    fNTP1TokenIndex   = GetBoolArg("-ntp1index", false);
+    fAddressIndex     = GetBoolArg("-addressindex", false);
+    fSpentIndex       = GetBoolArg("-spentindex", false);
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", false);
+    fPeerBlockFilters = GetBoolArg("-peerblockfilters", false);
+    fCompactBlocks    = GetBoolArg("-compactblocks", true);
+    nMinerSleep       = GetArg("-minersleep", 500);
 
     CheckpointsMode       = Checkpoints::CPMode_STRICT;
     std::string strCpMode = GetArg("-cppolicy", "strict");
@@ -472,11 +528,35 @@ bool AppInit2()
 
     fDebug = GetBoolArg("-debug");
 
-    // -debug implies fDebug*
-    if (fDebug)
-        fDebugNet = true;
-    else
-        fDebugNet = GetBoolArg("-debugnet");
+    uint32_t nCategories = LOG_NONE;
+    if (fDebug) {
+        nCategories = LOG_ALL;
+    } else {
+        const std::vector<std::string> debugVals =
+            mapMultiArgs.get("-debug").value_or(std::vector<std::string>());
+        for (const std::string& name : debugVals) {
+            uint32_t category = LOG_NONE;
+            if (name == "0")
+                continue;
+            if (!GetLogCategory(name, category)) {
+                InitWarning(strprintf(_("Unknown debug category: '%s'"), name.c_str()));
+                continue;
+            }
+            nCategories |= category;
+        }
+        if (GetBoolArg("-debugnet"))
+            nCategories |= LOG_NET;
+    }
+    nLogCategories = nCategories;
+    fDebug         = (nCategories == LOG_ALL);
+
+    // -debug and -debug=net imply -debugnet
+    fDebugNet = LogAcceptCategory(LOG_NET);
+
+    SetDebugLogRateLimit(static_cast<uint32_t>(std::max<int64_t>(0, GetArg("-logratelimit", 0))));
+    CLockProfiler::SetSampleInterval(static_cast<uint32_t>(std::max<int64_t>(0, GetArg("-lockprofile", 0))));
+    SetLockWaitMetricName(&cs_main, "main");
+    SetLockWaitMetricName(&mempool.cs, "mempool");
 
 #if !defined(WIN32) && !defined(QT_GUI)
     fDaemon = GetBoolArg("-daemon");
@@ -513,6 +593,13 @@ bool AppInit2()
                           "pay if you send a transaction."));
     }
 
+    if (fPeerBlockFilters) {
+        if (!fBlockFilterIndex)
+            return InitError(
+                _("Cannot serve compact block filters to peers without -blockfilterindex."));
+        nLocalServices |= NODE_COMPACT_FILTERS;
+    }
+
     fConfChange       = GetBoolArg("-confchange", false);
     fEnforceCanonical = GetBoolArg("-enforcecanonical", true);
 
@@ -586,6 +673,9 @@ bool AppInit2()
 
     if (GetBoolArg("-shrinkdebugfile", !fDebug))
         ShrinkDebugFile();
+    // after daemonizing, as the writer thread wouldn't survive fork()
+    if (!fPrintToConsole && GetBoolArg("-asynclog", true))
+        StartAsyncDebugLog();
     printf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     printf("neblio version %s (%s)\n", FormatFullVersion().c_str(), CLIENT_DATE.c_str());
     printf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
@@ -797,6 +887,7 @@ bool AppInit2()
             // clear stuff that are loaded before, and reset the blockchain database
             {
                 mapBlockIndex.clear();
+                chainActive.clear();
                 setStakeSeen.clear();
                 CTxDB txdb("r");
                 txdb.init_blockindex(true);
@@ -853,6 +944,36 @@ bool AppInit2()
         return false;
     }
 
+    // the last verification of the latest blocks found a bad one, which is disconnected before any
+    // block is connected after it
+    if (!RollBackToLastVerifiedBlock()) {
+        return InitError(_("Error moving the best chain back to the last verified block; check the log"));
+    }
+
+    if (!InitNTP1TokenIndex()) {
+        if (fRequestShutdown) {
+            printf("Shutdown requested. Exiting.\n");
+            return false;
+        }
+        return InitError(_("Error building the NTP1 token index; check the log"));
+    }
+
+    if (!InitAddressIndex()) {
+        if (fRequestShutdown) {
+            printf("Shutdown requested. Exiting.\n");
+            return false;
+        }
+        return InitError(_("Error building the address index; check the log"));
+    }
+
+    if (!InitBlockFilterIndex()) {
+        if (fRequestShutdown) {
+            printf("Shutdown requested. Exiting.\n");
+            return false;
+        }
+        return InitError(_("Error building the block filter index; check the log"));
+    }
+
     // ********************************************************* Step 8: load wallet
 
     uiInterface.InitMessage(_("Loading wallet..."));
@@ -861,6 +982,7 @@ bool AppInit2()
     bool fFirstRun = true;
     {
         std::shared_ptr<CWallet> wlt = std::make_shared<CWallet>(strWalletFileName);
+        wlt->SetDecryptedKeyLifetime(GetArg("-stakingkeycache", 0));
         std::atomic_store(&pwalletMain, wlt);
     }
     DBErrors nLoadWalletRet = LoadDBWalletTransient(fFirstRun);
@@ -920,6 +1042,7 @@ bool AppInit2()
     printf(" wallet      %15" PRId64 "ms\n", GetTimeMillis() - nStart);
 
     RegisterWallet(pwalletMain);
+    SetLockWaitMetricName(&pwalletMain->cs_wallet, "wallet");
 
     CBlockIndexSmartPtr pindexRescan = CTxDB().GetBestBlockIndex();
     if (GetBoolArg("-rescan") ||
@@ -984,12 +1107,27 @@ bool AppInit2()
     printf("mapWallet.size() = %" PRIszu "\n", pwalletMain->mapWallet.size());
     printf("mapAddressBook.size() = %" PRIszu "\n", pwalletMain->mapAddressBook.size());
 
+    validationInterfaceQueue.Start();
+
     if (!NewThread(StartNode, NULL))
         InitError(_("Error: could not start node"));
 
     if (fServer) {
         NewThread(ThreadRPCServer, NULL);
     }
+
+    {
+        std::string strMetricsError;
+        if (!StartMetricsServer(strMetricsError))
+            return InitError(strMetricsError);
+    }
+
+    // verifying the latest blocks reads them all from disk, so it's done after RPC is up
+    vnThreadsRunning[THREAD_VERIFYBLOCKS]++;
+    if (!NewThread(ThreadVerifyRecentBlocks, NULL)) {
+        printf("Error: NewThread(ThreadVerifyRecentBlocks) failed\n");
+        vnThreadsRunning[THREAD_VERIFYBLOCKS]--;
+    }
     DeleteAuthCookie(); // clear the cookie from the previous session, if it exists
 
     // ********************************************************* Step 12: start rest listenser
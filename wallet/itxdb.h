@@ -44,6 +44,7 @@ public:
     virtual bool ReadDiskTx(const COutPoint& outpoint, CTransaction& tx) const                      = 0;
     virtual bool ReadBlock(const uint256& hash, CBlock& blk, bool fReadTransactions = true) const   = 0;
     virtual bool WriteBlock(const uint256& hash, const CBlock& blk)                                 = 0;
+    virtual bool ReadBlockIndex(const uint256& hash, CDiskBlockIndex& blockindex) const             = 0;
     virtual bool WriteBlockIndex(const CDiskBlockIndex& blockindex)                                 = 0;
     virtual bool ReadHashBestChain(uint256& hashBestChain) const                                    = 0;
     virtual bool WriteHashBestChain(const uint256& hashBestChain)                                   = 0;
@@ -65,11 +65,10 @@ static bool SelectBlockFromCandidates(const vector<pair<int64_t, uint256>>&   vS
     uint256 hashBest  = 0;
     *pindexSelected   = (const CBlockIndex*)0;
     BOOST_FOREACH (const PAIRTYPE(int64_t, uint256) & item, vSortedByTimestamp) {
-        const auto bi = mapBlockIndex.get(item.second).value_or(nullptr);
-        if (!bi)
+        const CBlockIndex* pindex = LookupBlockIndex(item.second);
+        if (!pindex)
             return error("SelectBlockFromCandidates: failed to find block index for candidate block %s",
                          item.second.ToString().c_str());
-        const CBlockIndex* pindex = bi.get();
         if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
             break;
         if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0)
@@ -93,7 +92,7 @@ static bool SelectBlockFromCandidates(const vector<pair<int64_t, uint256>>&   vS
             *pindexSelected = (const CBlockIndex*)pindex;
         }
     }
-    if (fDebug && GetBoolArg("-printstakemodifier"))
+    if (LogAcceptCategory(LOG_STAKE) && GetBoolArg("-printstakemodifier"))
         printf("SelectBlockFromCandidates: selection hash=%s\n", hashBest.ToString().c_str());
     return fSelected;
 }
@@ -125,10 +124,8 @@ bool ComputeNextStakeModifier(const ITxDB& txdb, const CBlockIndex* pindexPrev,
     int64_t nModifierTime = 0;
     if (!GetLastStakeModifier(pindexPrev, nStakeModifier, nModifierTime))
         return error("ComputeNextStakeModifier: unable to get last modifier");
-    if (fDebug) {
-        printf("ComputeNextStakeModifier: prev modifier=0x%016" PRIx64 " time=%s\n", nStakeModifier,
-               DateTimeStrFormat(nModifierTime).c_str());
-    }
+    LogPrint(LOG_STAKE, "ComputeNextStakeModifier: prev modifier=0x%016" PRIx64 " time=%s\n",
+             nStakeModifier, DateTimeStrFormat(nModifierTime).c_str());
     if (nModifierTime / Params().StakeModifierInterval() >=
         pindexPrev->GetBlockTime() / Params().StakeModifierInterval())
         return true;
@@ -165,14 +162,14 @@ bool ComputeNextStakeModifier(const ITxDB& txdb, const CBlockIndex* pindexPrev,
         nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
         // add the selected block from candidates to selected list
         mapSelectedBlocks.insert(make_pair(pindex->GetBlockHash(), pindex));
-        if (fDebug && GetBoolArg("-printstakemodifier"))
+        if (LogAcceptCategory(LOG_STAKE) && GetBoolArg("-printstakemodifier"))
             printf("ComputeNextStakeModifier: selected round %d stop=%s height=%d bit=%d\n", nRound,
                    DateTimeStrFormat(nSelectionIntervalStop).c_str(), pindex->nHeight,
                    pindex->GetStakeEntropyBit());
     }
 
     // Print selection map for visualization of the selected blocks
-    if (fDebug) {
+    if (LogAcceptCategory(LOG_STAKE)) {
         string strSelectionMap = "";
         // '-' indicates proof-of-work blocks not selected
         strSelectionMap.insert(0, pindexPrev->nHeight - nHeightFirstCandidate + 1, '-');
@@ -192,10 +189,8 @@ bool ComputeNextStakeModifier(const ITxDB& txdb, const CBlockIndex* pindexPrev,
         printf("ComputeNextStakeModifier: selection height [%d, %d] map %s\n", nHeightFirstCandidate,
                pindexPrev->nHeight, strSelectionMap.c_str());
     }
-    if (fDebug) {
-        printf("ComputeNextStakeModifier: new modifier=0x%016" PRIx64 " time=%s\n", nStakeModifierNew,
-               DateTimeStrFormat(pindexPrev->GetBlockTime()).c_str());
-    }
+    LogPrint(LOG_STAKE, "ComputeNextStakeModifier: new modifier=0x%016" PRIx64 " time=%s\n",
+             nStakeModifierNew, DateTimeStrFormat(pindexPrev->GetBlockTime()).c_str());
 
     nStakeModifier          = nStakeModifierNew;
     fGeneratedStakeModifier = true;
@@ -208,11 +203,10 @@ static bool GetKernelStakeModifier(const ITxDB& txdb, uint256 hashBlockFrom, uin
                                    int& nStakeModifierHeight, int64_t& nStakeModifierTime,
                                    bool fPrintProofOfStake)
 {
-    nStakeModifier = 0;
-    const auto bi = mapBlockIndex.get(hashBlockFrom).value_or(nullptr);
-    if (!bi)
+    nStakeModifier                = 0;
+    const CBlockIndex* pindexFrom = LookupBlockIndex(hashBlockFrom);
+    if (!pindexFrom)
         return error("GetKernelStakeModifier() : block not indexed");
-    const CBlockIndex* pindexFrom                        = bi.get();
     nStakeModifierHeight                                 = pindexFrom->nHeight;
     nStakeModifierTime                                   = pindexFrom->GetBlockTime();
     static const int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
@@ -220,7 +214,8 @@ static bool GetKernelStakeModifier(const ITxDB& txdb, uint256 hashBlockFrom, uin
     const CBlockIndex*   pindex                          = pindexFrom;
     // loop to find the stake modifier later by a selection interval
     while (nStakeModifierTime < pindexFrom->GetBlockTime() + nStakeModifierSelectionInterval) {
-        if (!pindex->pnext) { // reached best block; may happen if node is behind on block chain
+        const CBlockIndex* pindexNext = chainActive.Next(pindex);
+        if (!pindexNext) { // reached best block; may happen if node is behind on block chain
             if (fPrintProofOfStake ||
                 (pindex->GetBlockTime() + nSMA - nStakeModifierSelectionInterval > GetAdjustedTime()))
                 return error(
@@ -230,7 +225,7 @@ static bool GetKernelStakeModifier(const ITxDB& txdb, uint256 hashBlockFrom, uin
             else
                 return false;
         }
-        pindex = pindex->pnext.get();
+        pindex = pindexNext;
         if (pindex->GeneratedStakeModifier()) {
             nStakeModifierHeight = pindex->nHeight;
             nStakeModifierTime   = pindex->GetBlockTime();
@@ -300,8 +295,8 @@ bool CheckStakeKernelHash(const ITxDB& txdb, unsigned int nBits, const CBlock& b
 
     ss << nTimeBlockFrom << nTxPrevOffset << txPrev.nTime << prevout.n << nTimeTx;
     hashProofOfStake = Hash(ss.begin(), ss.end());
-    if (fDebug && fPrintProofOfStake) {
-        const auto bi = mapBlockIndex.get(hashBlockFrom).value_or(nullptr);
+    if (LogAcceptCategory(LOG_STAKE) && fPrintProofOfStake) {
+        const CBlockIndex* bi = LookupBlockIndex(hashBlockFrom);
         printf("CheckStakeKernelHash() : using modifier 0x%016" PRIx64
                " at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                nStakeModifier, nStakeModifierHeight, DateTimeStrFormat(nStakeModifierTime).c_str(),
@@ -319,8 +314,8 @@ bool CheckStakeKernelHash(const ITxDB& txdb, unsigned int nBits, const CBlock& b
         return false;
     }
 
-    if (fDebug && !fPrintProofOfStake) {
-        const auto bi = mapBlockIndex.get(hashBlockFrom).value_or(nullptr);
+    if (LogAcceptCategory(LOG_STAKE) && !fPrintProofOfStake) {
+        const CBlockIndex* bi = LookupBlockIndex(hashBlockFrom);
         printf("CheckStakeKernelHash() : using modifier 0x%016" PRIx64
                " at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
                nStakeModifier, nStakeModifierHeight, DateTimeStrFormat(nStakeModifierTime).c_str(),
@@ -365,11 +360,11 @@ bool CheckProofOfStake(const CTransaction& tx, unsigned int nBits, uint256& hash
     // Read block header
     CBlock block;
     if (!block.ReadFromDisk(txindex.pos.nBlockPos, false))
-        return fDebug ? error("CheckProofOfStake() : read block failed")
-                      : false; // unable to read block of previous transaction
+        return LogAcceptCategory(LOG_STAKE) ? error("CheckProofOfStake() : read block failed")
+                                            : false; // unable to read block of previous transaction
 
     if (!CheckStakeKernelHash(txdb, nBits, block, txindex.pos.nTxPos, txPrev, txin.prevout, tx.nTime,
-                              hashProofOfStake, targetProofOfStake, fDebug))
+                              hashProofOfStake, targetProofOfStake, LogAcceptCategory(LOG_STAKE)))
         return tx.DoS(
             1,
             error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s",
@@ -5,6 +5,7 @@
 
 #include "keystore.h"
 #include "script.h"
+#include "util.h"
 
 bool CKeyStore::GetPubKey(const CKeyID &address, CPubKey &vchPubKeyOut) const
 {
@@ -84,6 +85,7 @@ bool CCryptoKeyStore::Lock()
     {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        mapDecryptedKeys.clear();
     }
 
     NotifyStatusChanged(this);
@@ -162,10 +164,24 @@ bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
         if (!IsCrypted())
             return CBasicKeyStore::GetKey(address, keyOut);
 
+        const bool fUseCache = nDecryptedKeyLifetime > 0 && !IsLocked() && CanCacheDecryptedKeys();
+        if (fUseCache)
+            ExpireDecryptedKeys(GetTime());
+        else
+            mapDecryptedKeys.clear();
+
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
         if (mi != mapCryptedKeys.end())
         {
             const CPubKey &vchPubKey = (*mi).second.first;
+            DecryptedKeyMap::const_iterator it = mapDecryptedKeys.find(address);
+            if (it != mapDecryptedKeys.end())
+            {
+                keyOut.SetPubKey(vchPubKey);
+                keyOut.SetSecret(it->second.vchSecret);
+                return true;
+            }
+
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
             CSecret vchSecret;
             if (!DecryptSecret(vMasterKey, vchCryptedSecret, vchPubKey.GetHash(), vchSecret))
@@ -174,12 +190,53 @@ bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
                 return false;
             keyOut.SetPubKey(vchPubKey);
             keyOut.SetSecret(vchSecret);
+            if (fUseCache)
+            {
+                CDecryptedKey& decrypted = mapDecryptedKeys[address];
+                decrypted.vchSecret = vchSecret;
+                decrypted.nDecryptedTime = GetTime();
+            }
             return true;
         }
     }
     return false;
 }
 
+void CCryptoKeyStore::SetDecryptedKeyLifetime(int64_t nSeconds)
+{
+    LOCK(cs_KeyStore);
+    nDecryptedKeyLifetime = std::max<int64_t>(nSeconds, 0);
+    if (nDecryptedKeyLifetime == 0)
+        mapDecryptedKeys.clear();
+}
+
+void CCryptoKeyStore::ExpireDecryptedKeys() const
+{
+    LOCK(cs_KeyStore);
+    // keys may only be kept while caching is allowed, e.g. not after the store was fully unlocked
+    if (!CanCacheDecryptedKeys())
+        mapDecryptedKeys.clear();
+    ExpireDecryptedKeys(GetTime());
+}
+
+void CCryptoKeyStore::DropDecryptedKeys()
+{
+    LOCK(cs_KeyStore);
+    mapDecryptedKeys.clear();
+}
+
+void CCryptoKeyStore::ExpireDecryptedKeys(int64_t nNow) const
+{
+    DecryptedKeyMap::iterator it = mapDecryptedKeys.begin();
+    while (it != mapDecryptedKeys.end())
+    {
+        if (nNow - it->second.nDecryptedTime >= nDecryptedKeyLifetime)
+            mapDecryptedKeys.erase(it++);
+        else
+            ++it;
+    }
+}
+
 bool CCryptoKeyStore::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
 {
     {
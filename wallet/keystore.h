@@ -113,16 +113,38 @@ private:
     // if fUseCrypto is false, vMasterKey must be empty
     bool fUseCrypto;
 
+    struct CDecryptedKey
+    {
+        CSecret vchSecret;
+        int64_t nDecryptedTime;
+    };
+    typedef std::map<CKeyID, CDecryptedKey> DecryptedKeyMap;
+
+    // Secrets decrypted by GetKey(), so that signing with the same keys over and over (as staking
+    // does) doesn't decrypt them every time; the CKey is still rebuilt from the secret, so only the
+    // decryption is saved. The secrets live in locked memory that's wiped when freed. They're dropped
+    // on Lock(), when the store is fully unlocked, and nDecryptedKeyLifetime seconds after decryption.
+    mutable DecryptedKeyMap mapDecryptedKeys;
+    int64_t nDecryptedKeyLifetime;
+
+    void ExpireDecryptedKeys(int64_t nNow) const;
+
 protected:
     bool SetCrypted();
 
+    // whether keys decrypted by GetKey() may be kept, given the way the store is unlocked
+    virtual bool CanCacheDecryptedKeys() const
+    {
+        return true;
+    }
+
     // will encrypt previously unencrypted keys
     bool EncryptKeys(CKeyingMaterial& vMasterKeyIn);
 
     bool Unlock(const CKeyingMaterial& vMasterKeyIn);
 
 public:
-    CCryptoKeyStore() : fUseCrypto(false)
+    CCryptoKeyStore() : fUseCrypto(false), nDecryptedKeyLifetime(0)
     {
     }
 
@@ -145,6 +167,18 @@ public:
 
     bool Lock();
 
+    // Keep the keys decrypted by GetKey() for nSeconds; 0 (the default) turns the cache off
+    void SetDecryptedKeyLifetime(int64_t nSeconds);
+    // Drop the decrypted keys that are past their lifetime
+    void ExpireDecryptedKeys() const;
+    // Drop all the decrypted keys, e.g. once they may not be kept anymore
+    void DropDecryptedKeys();
+    std::size_t GetDecryptedKeyCount() const
+    {
+        LOCK(cs_KeyStore);
+        return mapDecryptedKeys.size();
+    }
+
     virtual bool AddCryptedKey(const CPubKey &vchPubKey, const std::vector<unsigned char> &vchCryptedSecret);
     bool AddKey(const CKey& key);
     bool HaveKey(const CKeyID &address) const
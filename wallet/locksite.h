@@ -0,0 +1,28 @@
+#ifndef LOCKSITE_H
+#define LOCKSITE_H
+
+#include "metrics.h"
+
+/**
+ * A LOCK() or LOCK2() in the code, with what the lock contention profiler measured there (see
+ * CLockProfiler in sync.h). Sites are created the first time they're sampled, and live as long as the
+ * process.
+ */
+class CLockSite
+{
+public:
+    const char* const pszName;
+    const char* const pszFile;
+    const int         nLine;
+
+    // sampled by the profiler; acquisitions is an estimate, as each sample counts for the interval
+    CMetricCounter   acquisitions;
+    CMetricCounter   sampled;
+    CMetricCounter   contended;
+    CMetricHistogram waits;
+    CMetricHistogram holds;
+
+    CLockSite(const char* pszNameIn, const char* pszFileIn, int nLineIn);
+};
+
+#endif // LOCKSITE_H
@@ -0,0 +1,227 @@
+#include "logging.h"
+
+#include "util.h"
+
+#include <boost/algorithm/string/join.hpp>
+
+boost::atomic<uint32_t> nLogCategories{LOG_NONE};
+
+static const std::vector<std::pair<std::string, uint32_t>> logCategoryNames = {
+    {"net", LOG_NET},
+    {"db", LOG_DB},
+    {"validation", LOG_VALIDATION},
+    {"mempool", LOG_MEMPOOL},
+    {"wallet", LOG_WALLET},
+    {"stake", LOG_STAKE},
+    {"import", LOG_IMPORT},
+    {"all", LOG_ALL},
+    {"1", LOG_ALL},
+};
+
+bool GetLogCategory(const std::string& name, uint32_t& category)
+{
+    for (const std::pair<std::string, uint32_t>& entry : logCategoryNames) {
+        if (entry.first == name) {
+            category = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string LogCategoryNames()
+{
+    std::vector<std::string> names;
+    for (const std::pair<std::string, uint32_t>& entry : logCategoryNames) {
+        if (entry.second != LOG_ALL) {
+            names.push_back(entry.first);
+        }
+    }
+    return boost::algorithm::join(names, ", ");
+}
+
+CLogRateLimiter::CLogRateLimiter(uint32_t maxPerWindow) : nMaxPerWindow(maxPerWindow) {}
+
+void CLogRateLimiter::SetLimit(uint32_t maxPerWindow) { nMaxPerWindow = maxPerWindow; }
+
+bool CLogRateLimiter::Allow(const char* pszFormat, int64_t nTime, uint32_t& nSuppressed)
+{
+    nSuppressed         = 0;
+    const uint32_t nMax = nMaxPerWindow.load(boost::memory_order_relaxed);
+    if (nMax == 0) {
+        return true;
+    }
+
+    const int64_t             nWindow = nTime / WINDOW_SECONDS;
+    boost::mutex::scoped_lock lock(mutex);
+    Budget&                   budget = budgets[pszFormat];
+    if (budget.nWindow != nWindow) {
+        budget.nWindow     = nWindow;
+        budget.nCount      = 0;
+        nSuppressed        = budget.nSuppressed;
+        budget.nSuppressed = 0;
+    }
+    if (budget.nCount < nMax) {
+        budget.nCount++;
+        return true;
+    }
+    budget.nSuppressed++;
+    return false;
+}
+
+static std::size_t RoundUpToPowerOfTwo(std::size_t n)
+{
+    std::size_t result = 2;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
+CAsyncLogWriter::CAsyncLogWriter(std::size_t capacity)
+    : mask(RoundUpToPowerOfTwo(capacity) - 1), cells(new Cell[mask + 1])
+{
+    for (std::size_t i = 0; i <= mask; i++) {
+        cells[i].nSequence.store(i, boost::memory_order_relaxed);
+    }
+}
+
+CAsyncLogWriter::~CAsyncLogWriter() { Stop(); }
+
+void CAsyncLogWriter::Start(Sink sinkIn, bool fTimestampsIn)
+{
+    if (fRunning) {
+        return;
+    }
+    sink        = std::move(sinkIn);
+    fTimestamps = fTimestampsIn;
+    fStopping   = false;
+    thread.reset(new boost::thread(std::bind(&CAsyncLogWriter::ThreadWrite, this)));
+    fRunning = true;
+}
+
+void CAsyncLogWriter::Stop()
+{
+    if (!fRunning.exchange(false)) {
+        return;
+    }
+    // the producers that saw the writer running finish queuing their messages before it goes away
+    while (nPushing > 0) {
+        boost::this_thread::yield();
+    }
+    fStopping = true;
+    condWake.notify_one();
+    thread->join();
+    thread.reset();
+}
+
+// a bounded multi-producer queue (D. Vyukov's): every cell holds the position it's ready for; producers
+// claim a position with a CAS, fill the cell and publish it by bumping its sequence
+bool CAsyncLogWriter::TryPush(int64_t nTime, std::string& str)
+{
+    std::size_t pos = nEnqueuePos.load(boost::memory_order_relaxed);
+    Cell*       cell;
+    while (true) {
+        cell                   = &cells[pos & mask];
+        const std::size_t seq  = cell->nSequence.load(boost::memory_order_acquire);
+        const intptr_t    diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (nEnqueuePos.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = nEnqueuePos.load(boost::memory_order_relaxed);
+        }
+    }
+    cell->nTime = nTime;
+    cell->str.swap(str);
+    cell->nSequence.store(pos + 1, boost::memory_order_release);
+
+    // the writer wakes up regularly anyway; wake it early when half of the buffer has been filled
+    if ((pos & (mask >> 1)) == 0) {
+        condWake.notify_one();
+    }
+    return true;
+}
+
+bool CAsyncLogWriter::Push(int64_t nTime, std::string& str)
+{
+    nPushing++;
+    if (!fRunning) {
+        nPushing--;
+        return false;
+    }
+    while (!TryPush(nTime, str)) {
+        condWake.notify_one();
+        boost::this_thread::yield();
+    }
+    nPushing--;
+    return true;
+}
+
+bool CAsyncLogWriter::WriteQueued()
+{
+    batch.clear();
+    const std::size_t nStartPos = nDequeuePos;
+    std::string       str;
+    // the batch is written once it's big enough, so that the writer keeps up with busy producers
+    while (batch.size() < MAX_BATCH_SIZE) {
+        Cell& cell = cells[nDequeuePos & mask];
+        if (cell.nSequence.load(boost::memory_order_acquire) != nDequeuePos + 1) {
+            break;
+        }
+        const int64_t nTime = cell.nTime;
+        // the cell keeps the buffer of the previous message, for a producer to reuse
+        str.swap(cell.str);
+        cell.nSequence.store(nDequeuePos + mask + 1, boost::memory_order_release);
+        nDequeuePos++;
+
+        if (fTimestamps && fStartedNewLine) {
+            if (nTime != nLastTime) {
+                nLastTime   = nTime;
+                strLastTime = DateTimeStrFormat("%x %H:%M:%S", nTime) + " ";
+            }
+            batch += strLastTime;
+        }
+        if (!str.empty()) {
+            fStartedNewLine = (str.back() == '\n');
+        }
+        batch += str;
+        str.clear();
+    }
+    if (nDequeuePos == nStartPos) {
+        return false;
+    }
+    if (!batch.empty()) {
+        sink(batch);
+    }
+    nWrittenPos.store(nDequeuePos);
+    return true;
+}
+
+void CAsyncLogWriter::ThreadWrite()
+{
+    RenameThread("neblio-log");
+    while (true) {
+        // producers are done once stopping is set, so everything is queued when it's seen
+        const bool fStop = fStopping;
+        while (WriteQueued()) {
+        }
+        if (fStop) {
+            break;
+        }
+        boost::unique_lock<boost::mutex> lock(mutexWake);
+        condWake.wait_for(lock, boost::chrono::milliseconds(100));
+    }
+}
+
+void CAsyncLogWriter::Flush()
+{
+    const std::size_t target = nEnqueuePos;
+    while (fRunning && nWrittenPos < target) {
+        condWake.notify_one();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+}
@@ -0,0 +1,151 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/** the categories of debug messages, enabled with -debug=<category> */
+enum LogCategory : uint32_t
+{
+    LOG_NONE       = 0,
+    LOG_NET        = (1 << 0),
+    LOG_DB         = (1 << 1),
+    LOG_VALIDATION = (1 << 2),
+    LOG_MEMPOOL    = (1 << 3),
+    LOG_WALLET     = (1 << 4),
+    LOG_STAKE      = (1 << 5),
+    LOG_IMPORT     = (1 << 6),
+    LOG_ALL        = 0xFFFFFFFF
+};
+
+extern boost::atomic<uint32_t> nLogCategories;
+
+inline bool LogAcceptCategory(uint32_t category)
+{
+    return (nLogCategories.load(boost::memory_order_relaxed) & category) != 0;
+}
+
+/** the category named by an argument of -debug; "1" and "all" name all of them */
+bool GetLogCategory(const std::string& name, uint32_t& category);
+
+/** the names of the categories, comma separated */
+std::string LogCategoryNames();
+
+/**
+ * printf() for debug messages of a category. The category is checked first, so the message isn't
+ * formatted, and its arguments aren't even evaluated, when the category isn't enabled.
+ */
+#define LogPrint(category, ...) \
+    do { \
+        if (LogAcceptCategory(category)) { \
+            OutputDebugStringF(__VA_ARGS__); \
+        } \
+    } while (0)
+
+/**
+ * Limits how many messages with the same format, that is from the same place in the code, are logged
+ * per minute. Formats are told apart by their address, and every one has its own budget.
+ */
+class CLogRateLimiter
+{
+    struct Budget
+    {
+        int64_t  nWindow     = 0;
+        uint32_t nCount      = 0;
+        uint32_t nSuppressed = 0;
+    };
+
+    boost::atomic<uint32_t>                 nMaxPerWindow;
+    boost::mutex                            mutex;
+    std::unordered_map<const void*, Budget> budgets;
+
+public:
+    static constexpr int64_t WINDOW_SECONDS = 60;
+
+    explicit CLogRateLimiter(uint32_t maxPerWindow = 0);
+
+    /** at most maxPerWindow messages with the same format per minute; 0 disables the limit */
+    void SetLimit(uint32_t maxPerWindow);
+
+    /**
+     * Whether a message with pszFormat may be logged at nTime. When the message is the first of its
+     * format in a new minute, nSuppressed is set to the number of messages suppressed in the previous
+     * one, for the caller to report; otherwise it's set to 0.
+     */
+    bool Allow(const char* pszFormat, int64_t nTime, uint32_t& nSuppressed);
+};
+
+/**
+ * Takes writing the debug log off the threads that log. Messages are queued in a bounded ring buffer
+ * that producers claim slots of without locking; a background thread takes them in order, prepends
+ * their timestamps and hands them to a sink in batches, so that the file is written once per batch
+ * rather than once per message.
+ *
+ * When the buffer is full, producers wait for the writer to make room rather than dropping messages.
+ * Messages queued before Stop() returns are all written; Push() returns false once the writer is
+ * stopped, for the caller to write the message itself.
+ */
+class CAsyncLogWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+private:
+    struct Cell
+    {
+        boost::atomic<std::size_t> nSequence{0};
+        int64_t                    nTime = 0;
+        std::string                str;
+    };
+
+    static constexpr std::size_t MAX_BATCH_SIZE = 1 << 20;
+
+    const std::size_t       mask;
+    std::unique_ptr<Cell[]> cells;
+
+    boost::atomic<std::size_t> nEnqueuePos{0};
+    std::size_t                nDequeuePos = 0; // only used by the writer thread
+    boost::atomic<std::size_t> nWrittenPos{0};
+
+    boost::atomic<bool>     fRunning{false};
+    boost::atomic<bool>     fStopping{false};
+    boost::atomic<unsigned> nPushing{0};
+
+    Sink                           sink;
+    bool                           fTimestamps     = true;
+    bool                           fStartedNewLine = true;
+    int64_t                        nLastTime       = -1;
+    std::string                    strLastTime;
+    std::string                    batch;
+    boost::mutex                   mutexWake;
+    boost::condition_variable      condWake;
+    std::unique_ptr<boost::thread> thread;
+
+    bool TryPush(int64_t nTime, std::string& str);
+    bool WriteQueued();
+    void ThreadWrite();
+
+public:
+    /** capacity is rounded up to a power of two */
+    explicit CAsyncLogWriter(std::size_t capacity = 4096);
+    ~CAsyncLogWriter();
+
+    CAsyncLogWriter(const CAsyncLogWriter&) = delete;
+    CAsyncLogWriter& operator=(const CAsyncLogWriter&) = delete;
+
+    void Start(Sink sinkIn, bool fTimestampsIn);
+    void Stop();
+    bool IsRunning() const { return fRunning; }
+
+    /** queues str, logged at nTime, taking its content; returns false if the writer isn't running */
+    bool Push(int64_t nTime, std::string& str);
+
+    /** waits until everything queued so far has been handed to the sink */
+    void Flush();
+};
+
+#endif // LOGGING_H
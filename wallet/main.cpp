@@ -6,6 +6,10 @@
 #include "main.h"
 #include "alert.h"
 #include "block.h"
+#include "blockarena.h"
+#include "blockencodings.h"
+#include "blockfilter.h"
+#include "blockfilterindex.h"
 #include "checkpoints.h"
 #include "db.h"
 #include "disktxpos.h"
@@ -13,6 +17,7 @@
 #include "kernel.h"
 #include "merkletx.h"
 #include "net.h"
+#include "nodemetrics.h"
 #include "ntp1/ntp1script.h"
 #include "ntp1/ntp1script_burn.h"
 #include "ntp1/ntp1script_issuance.h"
@@ -23,11 +28,13 @@
 #include "txindex.h"
 #include "txmempool.h"
 #include "ui_interface.h"
+#include "validationinterface.h"
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/regex.hpp>
+#include <algorithm>
 
 #include "NetworkForks.h"
 
@@ -116,30 +123,79 @@ void static EraseFromWallets(uint256 hash)
         pwallet->EraseFromWallet(hash);
 }
 
-// make sure all wallets know about the given transaction, in the given block
-void SyncWithWallets(const ITxDB& txdb, const CTransaction& tx, const CBlock* pblock)
+// The notifications below are queued in validationInterfaceQueue, so everything they use is copied
+// or captured when they're queued, including the height of the best block at that point
+
+static void SyncTransactionWithWallets(int nBestHeight, const CTransaction& tx, const CBlock* pblock)
 {
     // update NTP1 transactions
     if (pwalletMain && pwalletMain->walletNewTxUpdateFunctor) {
-        pwalletMain->walletNewTxUpdateFunctor->run(tx.GetHash(), txdb.GetBestChainHeight().value_or(0));
+        pwalletMain->walletNewTxUpdateFunctor->run(tx.GetHash(), nBestHeight);
     }
 
     for (const std::shared_ptr<CWallet>& pwallet : setpwalletRegistered)
         pwallet->SyncTransaction(tx, pblock);
 }
 
+// make sure all wallets know about the given transaction, in the given block
+void SyncWithWallets(const ITxDB& txdb, const CTransaction& tx, const CBlock* pblock)
+{
+    const int                       nBestHeight = txdb.GetBestChainHeight().value_or(0);
+    boost::shared_ptr<const CBlock> block;
+    if (pblock)
+        block = boost::make_shared<const CBlock>(*pblock);
+    validationInterfaceQueue.Push(
+        [nBestHeight, tx, block]() { SyncTransactionWithWallets(nBestHeight, tx, block.get()); });
+}
+
+// make sure all wallets know about all the transactions of the given block
+void SyncWithWallets(const ITxDB& txdb, const CBlock& block)
+{
+    const int                             nBestHeight = txdb.GetBestChainHeight().value_or(0);
+    const boost::shared_ptr<const CBlock> pblock      = boost::make_shared<const CBlock>(block);
+    validationInterfaceQueue.Push([nBestHeight, pblock]() {
+        for (const CTransaction& tx : pblock->vtx)
+            SyncTransactionWithWallets(nBestHeight, tx, pblock.get());
+    });
+}
+
+// make sure all wallets know about the transactions of the given blocks; the blocks are read from the
+// db in the queue thread
+void SyncWithWallets(const ITxDB& txdb, const std::vector<CBlockIndexSmartPtr>& vBlocks)
+{
+    const int nBestHeight = txdb.GetBestChainHeight().value_or(0);
+    validationInterfaceQueue.Push([nBestHeight, vBlocks]() {
+        const CTxDB txdbQueue;
+        for (const CBlockIndexSmartPtr& pindex : vBlocks) {
+            CBlock block;
+            if (!block.ReadFromDisk(pindex.get(), txdbQueue)) {
+                printf("SyncWithWallets() : ReadFromDisk failed for block %s + couldn't sync with "
+                       "wallet\n",
+                       pindex->GetBlockHash().ToString().c_str());
+                continue;
+            }
+            for (const CTransaction& tx : block.vtx)
+                SyncTransactionWithWallets(nBestHeight, tx, &block);
+        }
+    });
+}
+
 // notify wallets about a new best chain
 void SetBestChain(const CBlockLocator& loc)
 {
-    for (const std::shared_ptr<CWallet>& pwallet : setpwalletRegistered)
-        pwallet->SetBestChain(loc);
+    validationInterfaceQueue.Push([loc]() {
+        for (const std::shared_ptr<CWallet>& pwallet : setpwalletRegistered)
+            pwallet->SetBestChain(loc);
+    });
 }
 
 // notify wallets about an updated transaction
 void UpdatedTransaction(const uint256& hashTx)
 {
-    for (const std::shared_ptr<CWallet>& pwallet : setpwalletRegistered)
-        pwallet->UpdatedTransaction(hashTx);
+    validationInterfaceQueue.Push([hashTx]() {
+        for (const std::shared_ptr<CWallet>& pwallet : setpwalletRegistered)
+            pwallet->UpdatedTransaction(hashTx);
+    });
 }
 
 // dump all wallets
@@ -396,6 +452,9 @@ Result<void, TxValidationState> AcceptToMemoryPool(CTxMemPool& pool, const CTran
 {
     AssertLockHeld(cs_main);
 
+    static CMetricHistogram& acceptHistogram = Metrics().Histogram("neblio_mempool_accept_seconds");
+    const CMetricTimer       timer(acceptHistogram);
+
     /**
      * Using a pointer from the outside is important because a new instance of the database does not
      * discover the changes in the database until it's flushed. We want to have the option to use a
@@ -527,8 +586,8 @@ Result<void, TxValidationState> AcceptToMemoryPool(CTxMemPool& pool, const CTran
                     return Err(MakeInvalidTxState(TxValidationResult::TX_MEMPOOL_POLICY,
                                                   "fee-rejected-by-rate-limiter"));
 
-                if (fDebug)
-                    printf("Rate limit dFreeCount: %g => %g\n", dFreeCount, dFreeCount + nSize);
+                LogPrint(LOG_MEMPOOL, "Rate limit dFreeCount: %g => %g\n", dFreeCount,
+                         dFreeCount + nSize);
                 dFreeCount += nSize;
             }
         }
@@ -1445,7 +1504,7 @@ void PrintBlockTree()
         CBlock block;
         block.ReadFromDisk(pindex.get());
         printf("%d (%s) %s  %08x  %s  mint %7s  tx %" PRIszu "", pindex->nHeight,
-               pindex->blockKeyInDB.ToString().c_str(), block.GetHash().ToString().c_str(), block.nBits,
+               pindex->GetBlockHash().ToString().c_str(), block.GetHash().ToString().c_str(), block.nBits,
                DateTimeStrFormat("%x %H:%M:%S", block.GetBlockTime()).c_str(),
                FormatMoney(pindex->nMint).c_str(), block.vtx.size());
 
@@ -1476,55 +1535,62 @@ bool LoadExternalBlockFile(FILE* fileIn)
             CAutoFile    blkdat(fileIn, SER_DISK, CLIENT_VERSION);
             unsigned int nPos = 0;
             while (nPos != (unsigned int)-1 && blkdat.good() && !fRequestShutdown && !fShutdown) {
-                unsigned char pchData[65536];
-                do {
-                    fseek(blkdat, nPos, SEEK_SET);
-                    int nRead = fread(pchData, 1, sizeof(pchData), blkdat);
-                    if (nRead <= 8) {
-                        nPos = (unsigned int)-1;
-                        break;
-                    }
-                    void* nFind = memchr(pchData, Params().MessageStart()[0],
-                                         nRead + 1 - CMessageHeader::MESSAGE_START_SIZE);
-                    if (nFind) {
-                        if (memcmp(nFind, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) ==
-                            0) {
-                            nPos +=
-                                ((unsigned char*)nFind - pchData) + CMessageHeader::MESSAGE_START_SIZE;
+                // the blocks are processed in holds of cs_main of up to -ibdbatchms, and those of a
+                // hold are written in one batch; see CBlockWriteBatchScope
+                LOCK(cs_main);
+                CBlockWriteBatchScope blockWriteBatch;
+                const int64_t         nHoldStart = GetTimeMillis();
+                while (nPos != (unsigned int)-1 && blkdat.good() && !fRequestShutdown && !fShutdown) {
+                    unsigned char pchData[65536];
+                    do {
+                        fseek(blkdat, nPos, SEEK_SET);
+                        int nRead = fread(pchData, 1, sizeof(pchData), blkdat);
+                        if (nRead <= 8) {
+                            nPos = (unsigned int)-1;
                             break;
                         }
-                        nPos += ((unsigned char*)nFind - pchData) + 1;
-                    } else
-                        nPos += sizeof(pchData) - CMessageHeader::MESSAGE_START_SIZE + 1;
-                } while (!fRequestShutdown && !fShutdown);
-                if (nPos == (unsigned int)-1)
-                    break;
-                unsigned int nSizeLimit = MaxBlockSize(CTxDB());
-
-                fseek(blkdat, nPos, SEEK_SET);
-
-                unsigned int nSize;
-                blkdat >> nSize;
-
-                // this is just for debugging
-                // static const unsigned int fileStartFrom = 0;
-                // if (nPos < fileStartFrom) {
-                //     nPos += 4 + nSize;
-                //     printf("Skipping block at file pos: %u\n", nPos);
-                //     continue;
-                // }
-
-                if (nSize > 0 && nSize <= nSizeLimit) {
-                    CBlock block;
-                    blkdat >> block;
-                    printf("Reading block at file pos: %u\n", nPos);
+                        void* nFind = memchr(pchData, Params().MessageStart()[0],
+                                             nRead + 1 - CMessageHeader::MESSAGE_START_SIZE);
+                        if (nFind) {
+                            if (memcmp(nFind, Params().MessageStart(),
+                                       CMessageHeader::MESSAGE_START_SIZE) == 0) {
+                                nPos += ((unsigned char*)nFind - pchData) +
+                                        CMessageHeader::MESSAGE_START_SIZE;
+                                break;
+                            }
+                            nPos += ((unsigned char*)nFind - pchData) + 1;
+                        } else
+                            nPos += sizeof(pchData) - CMessageHeader::MESSAGE_START_SIZE + 1;
+                    } while (!fRequestShutdown && !fShutdown);
+                    if (nPos == (unsigned int)-1)
+                        break;
+                    unsigned int nSizeLimit = MaxBlockSize(CTxDB());
 
-                    LOCK(cs_main);
+                    fseek(blkdat, nPos, SEEK_SET);
 
-                    if (ProcessBlock(NULL, &block)) {
-                        nLoaded++;
-                        nPos += 4 + nSize;
+                    unsigned int nSize;
+                    blkdat >> nSize;
+
+                    // this is just for debugging
+                    // static const unsigned int fileStartFrom = 0;
+                    // if (nPos < fileStartFrom) {
+                    //     nPos += 4 + nSize;
+                    //     printf("Skipping block at file pos: %u\n", nPos);
+                    //     continue;
+                    // }
+
+                    if (nSize > 0 && nSize <= nSizeLimit) {
+                        CBlock block;
+                        blkdat >> block;
+                        LogPrint(LOG_IMPORT, "Reading block at file pos: %u\n", nPos);
+
+                        if (ProcessBlock(NULL, &block)) {
+                            nLoaded++;
+                            nPos += 4 + nSize;
+                        }
                     }
+                    if (GetTimeMillis() - nHoldStart >= GetArg("-ibdbatchms", 2000))
+                        break;
                 }
             }
         } catch (std::exception& e) {
@@ -1586,6 +1652,63 @@ void ThreadImport(void* data)
     vnThreadsRunning[THREAD_IMPORT]--;
 }
 
+bool RollBackToLastVerifiedBlock()
+{
+    CTxDB   txdb;
+    uint256 hashLastVerified;
+    if (!txdb.ReadLastVerifiedBlock(hashLastVerified))
+        return true;
+
+    LOCK(cs_main);
+
+    const CBlockIndexSmartPtr pindexFork = mapBlockIndex.get(hashLastVerified).value_or(nullptr);
+    if (pindexFork && pindexFork->IsInMainChain(txdb) &&
+        pindexFork->GetBlockHash() != txdb.GetBestBlockHash()) {
+        printf("RollBackToLastVerifiedBlock() : *** moving best chain pointer back to block %d\n",
+               pindexFork->nHeight);
+        CBlock block;
+        if (!block.ReadFromDisk(pindexFork.get(), txdb))
+            return error("RollBackToLastVerifiedBlock() : block.ReadFromDisk failed");
+        if (!block.SetBestChain(txdb, pindexFork))
+            return error("RollBackToLastVerifiedBlock() : SetBestChain failed");
+    }
+
+    // the blocks after it are verified again, as the best ones, by ThreadVerifyRecentBlocks()
+    if (!txdb.EraseLastVerifiedBlock())
+        return error("RollBackToLastVerifiedBlock() : failed to erase the last verified block");
+    return true;
+}
+
+void ThreadVerifyRecentBlocks(void* /*parg*/)
+{
+    RenameThread("neblio-verifyblk");
+
+    // vnThreadsRunning[THREAD_VERIFYBLOCKS] was incremented by the thread that started this one, so
+    // that a shutdown right after startup can't miss it and close the db under it
+
+    CTxDB txdb("r");
+    if (!txdb.VerifyRecentBlocks() && !fShutdown) {
+        // the best chain can't be moved back to the last good block while blocks are being connected
+        // to it, so the node is stopped, and the next start moves it back if that block was found
+        fShutdown         = true;
+        uint256 hashLastVerified;
+        string  strMessage =
+            txdb.ReadLastVerifiedBlock(hashLastVerified)
+                ? _("Error: Verification of the latest blocks failed; the best chain will be moved back "
+                    "to the last good block when neblio is restarted. See debug.log for details.")
+                : _("Error: Verification of the latest blocks failed, the block database "
+                    "may be corrupted. See debug.log for details.");
+        strMiscWarning    = strMessage;
+        printf("*** %s\n", strMessage.c_str());
+        uiInterface.ThreadSafeMessageBox(strMessage, "neblio",
+                                         CClientUIInterface::OK | CClientUIInterface::ICON_EXCLAMATION |
+                                             CClientUIInterface::MODAL);
+        StartShutdown();
+    }
+
+    vnThreadsRunning[THREAD_VERIFYBLOCKS]--;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // CAlert
@@ -1646,12 +1769,178 @@ bool static AlreadyHave(CTxDB& txdb, const CInv& inv, const BlockIndexMapType& b
     }
 
     case MSG_BLOCK:
-        return blockIndexMap.exists_unsafe(inv.hash) || mapOrphanBlocks.count(inv.hash);
+        return blockIndexMap.exists(inv.hash) || mapOrphanBlocks.count(inv.hash);
     }
     // Don't know what it is, just say we already got one
     return true;
 }
 
+// BIP157 limits on the number of blocks covered by a single request
+static const int MAX_GETCFILTERS_SIZE  = 1000;
+static const int MAX_GETCFHEADERS_SIZE = 2000;
+static const int CFCHECKPT_INTERVAL    = 1000;
+
+/**
+ * Resolves the blocks of a BIP157 request, from nStartHeight to stopHash in the main chain. Peers
+ * asking for filters that aren't served or for an invalid range are disconnected, as BIP157 requires;
+ * requests for blocks that left the main chain are just ignored.
+ */
+static bool GetBlockFilterRequestBlocks(CNode* pfrom, const CTxDB& txdb, uint8_t filterType,
+                                        uint32_t nStartHeight, const uint256& stopHash, int nMaxBlocks,
+                                        std::vector<const CBlockIndex*>& blocks)
+{
+    if (!fPeerBlockFilters || filterType != CBlockFilter::BASIC_FILTER_TYPE ||
+        !txdb.IsBlockFilterIndexComplete()) {
+        printf("Peer %s requested block filters that aren't served; disconnecting\n",
+               pfrom->addr.ToString().c_str());
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    const CBlockIndex* pindexStop = LookupBlockIndex(stopHash);
+    if (!pindexStop) {
+        printf("Peer %s requested block filters up to unknown block %s; disconnecting\n",
+               pfrom->addr.ToString().c_str(), stopHash.ToString().c_str());
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (nStartHeight > static_cast<uint32_t>(pindexStop->nHeight) ||
+        pindexStop->nHeight - static_cast<int>(nStartHeight) >= nMaxBlocks) {
+        printf("Peer %s requested block filters for an invalid range; disconnecting\n",
+               pfrom->addr.ToString().c_str());
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (!chainActive.Contains(pindexStop)) {
+        return false;
+    }
+
+    // following pprev keeps the range consistent even if the main chain changes meanwhile
+    blocks.clear();
+    for (const CBlockIndex* pindex = pindexStop;
+         pindex && pindex->nHeight >= static_cast<int>(nStartHeight); pindex = pindex->pprev.get()) {
+        blocks.push_back(pindex);
+    }
+    std::reverse(blocks.begin(), blocks.end());
+    return true;
+}
+
+// the message of the last block sent is kept, so that a new block requested by many peers is read,
+// serialized and checksummed once
+static LockedVar<std::pair<uint256, CSharedMessage>> lastBlockMessage;
+
+// returns a null message if the block can't be read from disk
+static CSharedMessage GetBlockMessage(const CBlockIndex* pindex, CBlockArena& blockArena)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    {
+        auto lock = lastBlockMessage.get_lock();
+        if (lastBlockMessage.get_unsafe().first == hash && lastBlockMessage.get_unsafe().second)
+            return lastBlockMessage.get_unsafe().second;
+    }
+
+    if (!blockArena.ReadFromDisk(pindex, CTxDB())) {
+        blockArena.Clear();
+        return CSharedMessage();
+    }
+    CSharedMessage msg = MakeSharedMessage("block", blockArena.GetBlock());
+    {
+        auto lock                     = lastBlockMessage.get_lock();
+        lastBlockMessage.get_unsafe() = std::make_pair(hash, msg);
+    }
+    return msg;
+}
+
+/** hands a block received from pfrom, in full or put together from a compact block, to ProcessBlock() */
+static void ProcessReceivedBlock(CNode* pfrom, CBlock& block)
+{
+    uint256 hashBlock = block.GetHash();
+
+    printf("received block %s\n", hashBlock.ToString().c_str());
+
+    CInv inv(MSG_BLOCK, hashBlock);
+    pfrom->AddInventoryKnown(inv);
+
+    if (ProcessBlock(pfrom, &block)) {
+        mapAlreadyAskedFor.erase(inv);
+    } else if (block.reject) {
+        pfrom->PushMessage("reject", std::string("block"), block.reject->chRejectCode,
+                           block.reject->strRejectReason, block.reject->hashBlock);
+    }
+
+    if (block.nDoS) {
+        pfrom->Misbehaving(block.nDoS);
+    }
+}
+
+/** handles the outcome of putting together a compact block from pfrom */
+static bool ProcessCompactBlockStatus(CNode* pfrom, ReadStatus status, const uint256& hashBlock)
+{
+    if (status == READ_STATUS_INVALID) {
+        pfrom->Misbehaving(100);
+        return error("invalid compact block %s from %s", hashBlock.ToString().c_str(),
+                     pfrom->addr.ToString().c_str());
+    }
+    if (status == READ_STATUS_FAILED) {
+        // the short ids collided; the block is downloaded in full instead
+        if (fDebugNet)
+            printf("failed to reconstruct compact block %s, asking for the full block\n",
+                   hashBlock.ToString().c_str());
+        pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hashBlock)));
+    }
+    return true;
+}
+
+/**
+ * The checks of a compact block that need only its header and prefilled transactions, so that a bogus
+ * one is rejected before the mempool is scanned for the rest of it. Sets nDoS if a check fails.
+ */
+static bool CheckCompactBlockHeader(const CBlockHeaderAndShortTxIDs& cmpctblock,
+                                    const CBlockIndex* pindexPrev, int& nDoS)
+{
+    const CBlock& header    = cmpctblock.header;
+    const uint256 hashBlock = header.GetHash();
+
+    // the coinstake of a proof-of-stake block is prefilled right after the coinbase
+    const CTransaction* pcoinstake = nullptr;
+    for (const CPrefilledTransaction& prefilled : cmpctblock.prefilledTxs)
+        if (prefilled.index == 1 && prefilled.tx.IsCoinStake())
+            pcoinstake = &prefilled.tx;
+    const bool fProofOfStake = (pcoinstake != nullptr);
+
+    if (header.GetBlockTime() > FutureDrift(GetAdjustedTime())) {
+        nDoS = 10;
+        return error("CheckCompactBlockHeader() : block timestamp too far in the future");
+    }
+    if (header.GetBlockTime() <= pindexPrev->GetPastTimeLimit() ||
+        FutureDrift(header.GetBlockTime()) < pindexPrev->GetBlockTime()) {
+        nDoS = 10;
+        return error("CheckCompactBlockHeader() : block's timestamp is too early");
+    }
+
+    if (header.nBits != GetNextTargetRequired(pindexPrev, fProofOfStake)) {
+        nDoS = 100;
+        return error("CheckCompactBlockHeader() : incorrect %s",
+                     fProofOfStake ? "proof-of-stake" : "proof-of-work");
+    }
+    if (!fProofOfStake && !CheckProofOfWork(header.GetPoWHash(), header.nBits)) {
+        nDoS = 50;
+        return error("CheckCompactBlockHeader() : proof of work failed");
+    }
+
+    // as in ProcessBlock(), a stake is only used twice when there's an orphan child block
+    if (fProofOfStake &&
+        setStakeSeen.count(std::make_pair(pcoinstake->vin[0].prevout, pcoinstake->nTime)) &&
+        !mapOrphanBlocksByPrev.count(hashBlock)) {
+        nDoS = 10;
+        return error("CheckCompactBlockHeader() : duplicate proof-of-stake (%s, %d) for block %s",
+                     pcoinstake->vin[0].prevout.ToString().c_str(), pcoinstake->nTime,
+                     hashBlock.ToString().c_str());
+    }
+
+    return true;
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
 {
     static map<CService, CPubKey> mapReuseKey;
@@ -1788,6 +2077,24 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
 
     else if (strCommand == "verack") {
         pfrom->SetRecvVersion(min(pfrom->nVersion, PROTOCOL_VERSION));
+
+        if (fCompactBlocks && pfrom->nVersion >= COMPACT_BLOCKS_VERSION) {
+            // new blocks are pushed to us as compact blocks by the peers we chose to connect to; the
+            // others announce them with an inv, and we ask for the compact block
+            pfrom->PushMessage("sendcmpct", !pfrom->fInbound, COMPACT_BLOCKS_ENCODING_VERSION);
+        }
+    }
+
+    else if (strCommand == "sendcmpct") {
+        bool     fAnnounce = false;
+        uint64_t nVersion  = 0;
+        vRecv >> fAnnounce >> nVersion;
+        // with -compactblocks=0, none are sent either
+        if (fCompactBlocks && pfrom->nVersion >= COMPACT_BLOCKS_VERSION &&
+            nVersion == COMPACT_BLOCKS_ENCODING_VERSION) {
+            pfrom->fSupportsCompactBlocks = true;
+            pfrom->fCompactBlockAnnounce  = fAnnounce;
+        }
     }
 
     else if (strCommand == "addr") {
@@ -1879,8 +2186,6 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
             pfrom->AddInventoryKnown(inv);
 
             {
-                auto lock = mapBlockIndex.get_shared_lock();
-
                 bool fAlreadyHave = AlreadyHave(txdb, inv, mapBlockIndex);
                 if (fDebug)
                     printf("  got inventory: %s  %s\n", inv.ToString().c_str(),
@@ -1896,8 +2201,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
                     // In case we are on a very long side-chain, it is possible that we already have
                     // the last block in an inv bundle sent in response to getblocks. Try to detect
                     // this situation and push another getblocks to continue.
-                    pfrom->PushGetBlocks(mapBlockIndex.get_unsafe(inv.hash).value_or(nullptr).get(),
-                                         uint256(0));
+                    pfrom->PushGetBlocks(LookupBlockIndex(inv.hash), uint256(0));
                     if (fDebug)
                         printf("force request: %s\n", inv.ToString().c_str());
                 }
@@ -1919,22 +2223,43 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
         if (fDebugNet || (vInv.size() != 1))
             printf("received getdata (%" PRIszu " invsz)\n", vInv.size());
 
+        // the blocks requested are serialized into the send buffer as soon as they're read, so one
+        // block's storage is enough for all of them
+        CBlockArena blockArena;
         for (const CInv& inv : vInv) {
             if (fShutdown)
                 return true;
             if (fDebugNet || (vInv.size() == 1))
                 printf("received getdata for: %s\n", inv.ToString().c_str());
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
                 // Send block from disk
                 auto mi = mapBlockIndex.get(inv.hash).value_or(nullptr);
                 if (mi) {
-                    CBlock block;
-                    block.ReadFromDisk(mi.get());
-                    if (inv.type == MSG_BLOCK)
-                        pfrom->PushMessage("block", block);
-                    else // MSG_FILTERED_BLOCK)
+                    // the transactions of older blocks are unlikely to be in the mempool of the peer
+                    const bool fCompact =
+                        inv.type == MSG_CMPCT_BLOCK &&
+                        mi->nHeight >= CTxDB().GetBestChainHeight().value_or(0) - MAX_CMPCTBLOCK_DEPTH;
+                    if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fCompact)) {
+                        CSharedMessage msg = GetBlockMessage(mi.get(), blockArena);
+                        if (!msg)
+                            continue;
+                        pfrom->PushSharedMessage(msg);
+                    } else if (fCompact) {
+                        if (!blockArena.ReadFromDisk(mi.get(), CTxDB())) {
+                            blockArena.Clear();
+                            continue;
+                        }
+                        pfrom->PushMessage("cmpctblock",
+                                           CBlockHeaderAndShortTxIDs(blockArena.GetBlock(),
+                                                                     GetRand(~uint64_t(0))));
+                    } else // MSG_FILTERED_BLOCK)
                     {
+                        if (!blockArena.ReadFromDisk(mi.get(), CTxDB())) {
+                            blockArena.Clear();
+                            continue;
+                        }
+                        const CBlock& block = blockArena.GetBlock();
                         LOCK(pfrom->cs_filter);
                         if (pfrom->pfilter) {
                             CMerkleBlock merkleBlock(block, *pfrom->pfilter);
@@ -1973,9 +2298,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
                 bool pushed = false;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
+                    map<CInv, CSharedMessage>::iterator mi = mapRelay.find(inv);
                     if (mi != mapRelay.end()) {
-                        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
+                        pfrom->PushSharedMessage((*mi).second);
                         pushed = true;
                     }
                 }
@@ -2136,25 +2461,118 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
     else if (strCommand == "block") {
         CBlock block;
         vRecv >> block;
-        uint256 hashBlock = block.GetHash();
+        ProcessReceivedBlock(pfrom, block);
+    }
 
-        printf("received block %s\n", hashBlock.ToString().c_str());
+    else if (strCommand == "cmpctblock") {
+        // compact blocks are only taken from the peers they were negotiated with, see "sendcmpct"
+        if (!fCompactBlocks || !pfrom->fSupportsCompactBlocks) {
+            pfrom->Misbehaving(10);
+            return error("unrequested compact block from %s", pfrom->addr.ToString().c_str());
+        }
 
-        CInv inv(MSG_BLOCK, hashBlock);
-        pfrom->AddInventoryKnown(inv);
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+        const uint256 hashBlock = cmpctblock.header.GetHash();
 
-        if (ProcessBlock(pfrom, &block)) {
-            mapAlreadyAskedFor.erase(inv);
-        } else if (block.reject) {
-            pfrom->PushMessage("reject", std::string("block"), block.reject->chRejectCode,
-                               block.reject->strRejectReason, block.reject->hashBlock);
+        if (fDebugNet)
+            printf("received compact block %s (%" PRIszu " transactions, %" PRIszu " prefilled)\n",
+                   hashBlock.ToString().c_str(), cmpctblock.BlockTxCount(),
+                   cmpctblock.prefilledTxs.size());
+
+        pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hashBlock));
+        if (mapBlockIndex.exists(hashBlock) || mapOrphanBlocks.count(hashBlock))
+            return true;
+
+        const CBlockIndexSmartPtr pindexPrev =
+            mapBlockIndex.get(cmpctblock.header.hashPrevBlock).value_or(nullptr);
+        if (!pindexPrev) {
+            // the block can't be connected yet; the full block goes through the orphan handling
+            pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hashBlock)));
+            return true;
+        }
+
+        int nDoS = 0;
+        if (!CheckCompactBlockHeader(cmpctblock, pindexPrev.get(), nDoS)) {
+            pfrom->Misbehaving(nDoS);
+            return error("invalid compact block header %s from %s", hashBlock.ToString().c_str(),
+                         pfrom->addr.ToString().c_str());
         }
 
-        if (block.nDoS) {
-            pfrom->Misbehaving(block.nDoS);
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock =
+            std::make_shared<PartiallyDownloadedBlock>();
+        const ReadStatus status = partialBlock->InitData(cmpctblock, mempool);
+        if (status != READ_STATUS_OK)
+            return ProcessCompactBlockStatus(pfrom, status, hashBlock);
+
+        BlockTransactionsRequest req;
+        req.blockhash = hashBlock;
+        req.indexes   = partialBlock->GetMissingIndexes();
+        if (req.indexes.empty()) {
+            // everything was in the mempool
+            CBlock block;
+            const ReadStatus fillStatus = partialBlock->FillBlock(block, std::vector<CTransaction>());
+            if (fillStatus != READ_STATUS_OK)
+                return ProcessCompactBlockStatus(pfrom, fillStatus, hashBlock);
+            ProcessReceivedBlock(pfrom, block);
+        } else {
+            pfrom->partialBlock      = partialBlock;
+            pfrom->nPartialBlockTime = GetTime();
+            pfrom->PushMessage("getblocktxn", req);
         }
     }
 
+    else if (strCommand == "getblocktxn") {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        // only compact blocks we sent are completed, and those are of blocks close to the tip
+        if (!pfrom->fSupportsCompactBlocks)
+            return true;
+        auto mi = mapBlockIndex.get(req.blockhash).value_or(nullptr);
+        if (!mi)
+            return true;
+        if (mi->nHeight < CTxDB().GetBestChainHeight().value_or(0) - MAX_BLOCKTXN_DEPTH) {
+            if (fDebugNet)
+                printf("ignoring getblocktxn for block %s from %s, which is too deep\n",
+                       req.blockhash.ToString().c_str(), pfrom->addr.ToString().c_str());
+            return true;
+        }
+        CBlockArena blockArena;
+        if (!blockArena.ReadFromDisk(mi.get(), CTxDB()))
+            return error("getblocktxn: failed to read block %s", req.blockhash.ToString().c_str());
+        const CBlock& block = blockArena.GetBlock();
+
+        BlockTransactions resp(req);
+        for (std::size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= block.vtx.size()) {
+                pfrom->Misbehaving(100);
+                return error("getblocktxn with out of range index %u from %s", req.indexes[i],
+                             pfrom->addr.ToString().c_str());
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+    else if (strCommand == "blocktxn") {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        // transactions we didn't ask for, or for a block that was received otherwise in the meantime,
+        // are ignored
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock = pfrom->partialBlock;
+        if (!partialBlock || partialBlock->GetBlockHash() != resp.blockhash)
+            return true;
+        pfrom->partialBlock.reset();
+
+        CBlock           block;
+        const ReadStatus status = partialBlock->FillBlock(block, resp.txn);
+        if (status != READ_STATUS_OK)
+            return ProcessCompactBlockStatus(pfrom, status, resp.blockhash);
+        ProcessReceivedBlock(pfrom, block);
+    }
+
     else if (strCommand == "getaddr") {
         // Don't return addresses older than nCutOff timestamp
         int64_t nCutOff = GetTime() - (nNodeLifespan * 24 * 60 * 60);
@@ -2269,6 +2687,89 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
         pfrom->fRelayTxes = true;
     }
 
+    else if (strCommand == "getcfilters") {
+        uint8_t  filterType;
+        uint32_t nStartHeight;
+        uint256  stopHash;
+        vRecv >> filterType >> nStartHeight >> stopHash;
+
+        const CTxDB                     txdb;
+        std::vector<const CBlockIndex*> blocks;
+        if (GetBlockFilterRequestBlocks(pfrom, txdb, filterType, nStartHeight, stopHash,
+                                        MAX_GETCFILTERS_SIZE, blocks)) {
+            for (const CBlockIndex* pindex : blocks) {
+                const uint256          hash = pindex->GetBlockHash();
+                CBlockFilterIndexEntry entry;
+                if (!txdb.ReadBlockFilter(hash, entry)) {
+                    printf("Error: the block filter of %s is missing\n", hash.ToString().c_str());
+                    break;
+                }
+                pfrom->PushMessage("cfilter", filterType, hash, entry.filter);
+            }
+        }
+    }
+
+    else if (strCommand == "getcfheaders") {
+        uint8_t  filterType;
+        uint32_t nStartHeight;
+        uint256  stopHash;
+        vRecv >> filterType >> nStartHeight >> stopHash;
+
+        const CTxDB                     txdb;
+        std::vector<const CBlockIndex*> blocks;
+        if (GetBlockFilterRequestBlocks(pfrom, txdb, filterType, nStartHeight, stopHash,
+                                        MAX_GETCFHEADERS_SIZE, blocks)) {
+            // the header before the range, from which the client rebuilds the others with the hashes
+            CBlockFilterIndexEntry entry;
+            uint256                prevHeader = 0;
+            bool                   fOk        = true;
+            if (blocks.front()->pprev) {
+                fOk        = txdb.ReadBlockFilter(blocks.front()->pprev->GetBlockHash(), entry);
+                prevHeader = entry.header;
+            }
+            std::vector<uint256> filterHashes;
+            for (const CBlockIndex* pindex : blocks) {
+                fOk = fOk && txdb.ReadBlockFilter(pindex->GetBlockHash(), entry);
+                if (!fOk) {
+                    break;
+                }
+                filterHashes.push_back(entry.filterHash);
+            }
+            if (fOk) {
+                pfrom->PushMessage("cfheaders", filterType, stopHash, prevHeader, filterHashes);
+            } else {
+                printf("Error: block filters up to %s are missing\n", stopHash.ToString().c_str());
+            }
+        }
+    }
+
+    else if (strCommand == "getcfcheckpt") {
+        uint8_t filterType;
+        uint256 stopHash;
+        vRecv >> filterType >> stopHash;
+
+        // only the stop block is resolved; the checkpoints below it are looked up by height
+        const CTxDB                     txdb;
+        const CBlockIndex*              pindexStop   = LookupBlockIndex(stopHash);
+        const uint32_t                  nStopHeight  = pindexStop ? pindexStop->nHeight : 0;
+        std::vector<const CBlockIndex*> stopBlock;
+        if (GetBlockFilterRequestBlocks(pfrom, txdb, filterType, nStopHeight, stopHash, 1, stopBlock)) {
+            std::vector<uint256> headers;
+            for (int h = CFCHECKPT_INTERVAL; h <= pindexStop->nHeight; h += CFCHECKPT_INTERVAL) {
+                const CBlockIndex*     pindex = chainActive[h];
+                CBlockFilterIndexEntry entry;
+                if (!pindex || !txdb.ReadBlockFilter(pindex->GetBlockHash(), entry)) {
+                    printf("Error: the block filter at height %d is missing\n", h);
+                    break;
+                }
+                headers.push_back(entry.header);
+            }
+            if (headers.size() == static_cast<std::size_t>(pindexStop->nHeight / CFCHECKPT_INTERVAL)) {
+                pfrom->PushMessage("cfcheckpt", filterType, stopHash, headers);
+            }
+        }
+    }
+
     else {
         // Ignore unknown commands for extensibility
     }
@@ -2282,8 +2783,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv)
     return true;
 }
 
-// requires LOCK(cs_vRecvMsg)
-bool ProcessMessages(CNode* pfrom)
+// requires LOCK(cs_vRecvMsg); stops at nStopMillis, if it isn't 0, and leaves the rest for the next pass
+static bool ProcessMessageQueue(CNode* pfrom, int64_t nStopMillis)
 {
     // if (fDebug)
     //    printf("ProcessMessages(%zu messages)\n", pfrom->vRecvMsg.size());
@@ -2304,6 +2805,9 @@ bool ProcessMessages(CNode* pfrom)
         if (pfrom->nSendSize >= SendBufferSize())
             break;
 
+        if (nStopMillis != 0 && it != pfrom->vRecvMsg.begin() && GetTimeMillis() >= nStopMillis)
+            break;
+
         // get next message
         CNetMessage& msg = *it;
 
@@ -2354,6 +2858,7 @@ bool ProcessMessages(CNode* pfrom)
         try {
             {
                 LOCK(cs_main);
+                const CMetricTimer timer(MessageProcessHistogram(strCommand));
                 fRet = ProcessMessage(pfrom, strCommand, vRecv);
             }
             if (fShutdown)
@@ -2390,6 +2895,20 @@ bool ProcessMessages(CNode* pfrom)
     return fOk;
 }
 
+// requires LOCK(cs_vRecvMsg)
+bool ProcessMessages(CNode* pfrom)
+{
+    if (!IsInitialBlockDownload())
+        return ProcessMessageQueue(pfrom, 0);
+
+    // during the initial block download, the messages of the peer are processed in one hold of cs_main
+    // of up to -ibdbatchms, so that the blocks they bring are written in one batch; see
+    // CBlockWriteBatchScope
+    LOCK(cs_main);
+    CBlockWriteBatchScope blockWriteBatch;
+    return ProcessMessageQueue(pfrom, GetTimeMillis() + GetArg("-ibdbatchms", 2000));
+}
+
 bool SendMessages(CNode* pto, bool fSendTrickle)
 {
     TRY_LOCK(cs_main, lockMain);
@@ -2408,6 +2927,14 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 pto->PushMessage("ping");
         }
 
+        // a compact block whose missing transactions didn't arrive in time is asked for in full
+        if (pto->partialBlock && GetTime() - pto->nPartialBlockTime > BLOCKTXN_TIMEOUT) {
+            const uint256 hashBlock = pto->partialBlock->GetBlockHash();
+            pto->partialBlock.reset();
+            if (!mapBlockIndex.exists(hashBlock) && !mapOrphanBlocks.count(hashBlock))
+                pto->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hashBlock)));
+        }
+
         // Resend wallet transactions that haven't gotten in a block yet
         ResendWalletTransactions();
 
@@ -2512,12 +3039,15 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         int64_t      nNow = GetTime() * 1000000;
         CTxDB        txdb("r");
         while (!pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow) {
-            const CInv& inv  = (*pto->mapAskFor.begin()).second;
-            auto        lock = mapBlockIndex.get_shared_lock();
+            const CInv& inv = (*pto->mapAskFor.begin()).second;
             if (!AlreadyHave(txdb, inv, mapBlockIndex)) {
                 if (fDebugNet)
                     printf("sending getdata: %s\n", inv.ToString().c_str());
                 vGetData.push_back(inv);
+                // new blocks are asked for as compact blocks; their transactions are mostly known
+                if (inv.type == MSG_BLOCK && fCompactBlocks && pto->fSupportsCompactBlocks &&
+                    !IsInitialBlockDownload())
+                    vGetData.back().type = MSG_CMPCT_BLOCK;
                 if (vGetData.size() >= 1000) {
                     pto->PushMessage("getdata", vGetData);
                     vGetData.clear();
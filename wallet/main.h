@@ -101,6 +101,8 @@ class CTxIndex;
 void         RegisterWallet(std::shared_ptr<CWallet> pwalletIn);
 void         UnregisterWallet(std::shared_ptr<CWallet> pwalletIn);
 void         SyncWithWallets(const ITxDB& txdb, const CTransaction& tx, const CBlock* pblock = NULL);
+void         SyncWithWallets(const ITxDB& txdb, const CBlock& block);
+void         SyncWithWallets(const ITxDB& txdb, const std::vector<CBlockIndexSmartPtr>& vBlocks);
 bool         ProcessBlock(CNode* pfrom, CBlock* pblock);
 bool         CheckDiskSpace(uintmax_t nAdditionalBytes = 0);
 bool         LoadBlockIndex(bool fAllowNew = true);
@@ -108,6 +110,9 @@ void         PrintBlockTree();
 bool         ProcessMessages(CNode* pfrom);
 bool         SendMessages(CNode* pto, bool fSendTrickle);
 void         ThreadImport(void* parg);
+/** Moves the best chain back to the block saved by a failed CTxDB::VerifyRecentBlocks(), if any */
+bool         RollBackToLastVerifiedBlock();
+void         ThreadVerifyRecentBlocks(void* parg);
 bool         CheckProofOfWork(const uint256& hash, unsigned int nBits, bool silent = false);
 unsigned int GetNextTargetRequired(const CBlockIndex* pindexLast, bool fProofOfStake);
 unsigned int ComputeMinWork(unsigned int nBase, int64_t nTime);
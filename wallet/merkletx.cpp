@@ -18,17 +18,15 @@ int CMerkleTx::GetDepthInMainChain(const CBlockIndex*& pindexRet) const
     int nResult = 0;
 
     // Find the block it claims to be in
-    const auto bi = mapBlockIndex.get(hashBlock).value_or(nullptr);
-    if (!bi) {
+    CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+    if (!pindex) {
         nResult = 0;
     } else {
-        CBlockIndex* pindex = bi.get();
-        if (!pindex || !pindex->IsInMainChain(CTxDB())) {
+        if (!chainActive.Contains(pindex)) {
             nResult = 0;
         } else {
             pindexRet = pindex;
-            nResult   = ((nIndex == -1) ? (-1) : 1) *
-                      (CTxDB().GetBestChainHeight().value_or(0) - pindex->nHeight + 1);
+            nResult   = ((nIndex == -1) ? (-1) : 1) * (chainActive.Height() - pindex->nHeight + 1);
         }
     }
 
@@ -89,10 +87,7 @@ int CMerkleTx::SetMerkleBranch(const CBlock* pblock)
     vMerkleBranch = pblock->GetMerkleBranch(nIndex);
 
     // Is the tx in a block that's in the main chain
-    const auto bi = mapBlockIndex.get(hashBlock).value_or(nullptr);
-    if (!bi)
-        return 0;
-    CBlockIndexSmartPtr pindex = bi;
+    const CBlockIndex* pindex = LookupBlockIndex(hashBlock);
     if (!pindex || !pindex->IsInMainChain(txdb))
         return 0;
 
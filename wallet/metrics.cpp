@@ -0,0 +1,228 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+constexpr unsigned CMetricHistogram::SUB_BUCKET_BITS;
+constexpr unsigned CMetricHistogram::SUB_BUCKETS;
+constexpr unsigned CMetricHistogram::MAX_VALUE_BITS;
+constexpr uint64_t CMetricHistogram::MAX_VALUE;
+constexpr unsigned CMetricHistogram::BUCKET_COUNT;
+
+CMetricHistogram::CMetricHistogram() { Reset(); }
+
+unsigned CMetricHistogram::BucketIndex(uint64_t value)
+{
+    value = std::min(value, MAX_VALUE);
+    if (value < SUB_BUCKETS) {
+        return static_cast<unsigned>(value);
+    }
+    unsigned exponent = 0;
+    for (uint64_t v = value; v > 1; v >>= 1) {
+        exponent++;
+    }
+    // the SUB_BUCKET_BITS bits below the leading one pick the sub-bucket
+    const unsigned sub = static_cast<unsigned>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t CMetricHistogram::BucketLowerBound(unsigned index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const unsigned exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const uint64_t sub      = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS);
+}
+
+void CMetricHistogram::Record(uint64_t nanos)
+{
+    buckets[BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t previousMax = max.load(std::memory_order_relaxed);
+    while (nanos > previousMax &&
+           !max.compare_exchange_weak(previousMax, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+CMetricHistogram::Snapshot CMetricHistogram::GetSnapshot() const
+{
+    Snapshot result;
+    result.buckets.resize(BUCKET_COUNT);
+    for (unsigned i = 0; i < BUCKET_COUNT; i++) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum.load(std::memory_order_relaxed);
+    result.max = max.load(std::memory_order_relaxed);
+    return result;
+}
+
+void CMetricHistogram::Reset()
+{
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CMetricHistogram::Snapshot::Percentile(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+    uint64_t       seen = 0;
+    for (unsigned i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // the upper end of the bucket, as the value is at most that, but no more than the max seen
+            const uint64_t upper = i + 1 < BUCKET_COUNT ? BucketLowerBound(i + 1) - 1 : MAX_VALUE;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+template <typename T>
+static T& GetOrCreate(std::map<std::string, std::map<std::string, std::unique_ptr<T>>>& families,
+                      const std::string& name, const std::string& labels)
+{
+    std::unique_ptr<T>& metric = families[name][labels];
+    if (!metric) {
+        metric.reset(new T);
+    }
+    return *metric;
+}
+
+CMetricCounter& CMetricsRegistry::Counter(const std::string& name, const std::string& labels)
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    return GetOrCreate(counters, name, labels);
+}
+
+CMetricGauge& CMetricsRegistry::Gauge(const std::string& name, const std::string& labels)
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    return GetOrCreate(gauges, name, labels);
+}
+
+CMetricHistogram& CMetricsRegistry::Histogram(const std::string& name, const std::string& labels)
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    return GetOrCreate(histograms, name, labels);
+}
+
+void CMetricsRegistry::ForEachCounter(
+    const std::function<void(const std::string&, const std::string&, uint64_t)>& f) const
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    for (const auto& family : counters) {
+        for (const auto& metric : family.second) {
+            f(family.first, metric.first, metric.second->Get());
+        }
+    }
+}
+
+void CMetricsRegistry::ForEachGauge(
+    const std::function<void(const std::string&, const std::string&, int64_t)>& f) const
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    for (const auto& family : gauges) {
+        for (const auto& metric : family.second) {
+            f(family.first, metric.first, metric.second->Get());
+        }
+    }
+}
+
+void CMetricsRegistry::ForEachHistogram(
+    const std::function<void(const std::string&, const std::string&, const CMetricHistogram::Snapshot&)>&
+        f) const
+{
+    boost::lock_guard<boost::mutex> lock(mtx);
+    for (const auto& family : histograms) {
+        for (const auto& metric : family.second) {
+            f(family.first, metric.first, metric.second->GetSnapshot());
+        }
+    }
+}
+
+static std::string WithLabels(const std::string& name, const std::string& labels,
+                              const std::string& extraLabel = "")
+{
+    std::string all = labels;
+    if (!extraLabel.empty()) {
+        all += (all.empty() ? "" : ",") + extraLabel;
+    }
+    return all.empty() ? name : name + "{" + all + "}";
+}
+
+static std::string NanosAsSeconds(uint64_t nanos)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9f", static_cast<double>(nanos) / 1e9);
+    return buf;
+}
+
+std::string CMetricsRegistry::FormatPrometheus() const
+{
+    std::string result;
+    std::string lastFamily;
+
+    ForEachCounter([&](const std::string& name, const std::string& labels, uint64_t value) {
+        if (name != lastFamily) {
+            result += "# TYPE " + name + " counter\n";
+            lastFamily = name;
+        }
+        result += WithLabels(name, labels) + " " + std::to_string(value) + "\n";
+    });
+    ForEachGauge([&](const std::string& name, const std::string& labels, int64_t value) {
+        if (name != lastFamily) {
+            result += "# TYPE " + name + " gauge\n";
+            lastFamily = name;
+        }
+        result += WithLabels(name, labels) + " " + std::to_string(value) + "\n";
+    });
+    ForEachHistogram([&](const std::string& name, const std::string& labels,
+                         const CMetricHistogram::Snapshot& snapshot) {
+        if (name != lastFamily) {
+            result += "# TYPE " + name + " summary\n";
+            lastFamily = name;
+        }
+        static const std::pair<const char*, double> quantiles[] = {
+            {"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}};
+        for (const auto& q : quantiles) {
+            result += WithLabels(name, labels, MetricLabel("quantile", q.first)) + " " +
+                      NanosAsSeconds(snapshot.Percentile(q.second)) + "\n";
+        }
+        result += WithLabels(name + "_sum", labels) + " " + NanosAsSeconds(snapshot.sum) + "\n";
+        result += WithLabels(name + "_count", labels) + " " + std::to_string(snapshot.count) + "\n";
+    });
+    return result;
+}
+
+CMetricsRegistry& Metrics()
+{
+    // never destroyed, as metrics may be recorded by threads that outlive static destruction
+    static CMetricsRegistry* registry = new CMetricsRegistry;
+    return *registry;
+}
+
+std::string MetricLabel(const std::string& name, const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return name + "=\"" + escaped + "\"";
+}
@@ -0,0 +1,151 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** a value that only goes up, such as the number of messages of a kind */
+class CMetricCounter
+{
+    std::atomic<uint64_t> value{0};
+
+public:
+    void     Inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+    void     Reset() { value.store(0, std::memory_order_relaxed); }
+};
+
+/** a value that goes up and down, such as the size of the mempool */
+class CMetricGauge
+{
+    std::atomic<int64_t> value{0};
+
+public:
+    void    Set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    void    Add(int64_t n) { value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * A histogram of durations, in nanoseconds, in the manner of HdrHistogram: every power of two is split
+ * into SUB_BUCKETS linear buckets, so any recorded value is known to within 1/SUB_BUCKETS of itself,
+ * from a nanosecond up to MAX_VALUE. Recording is a handful of relaxed atomic additions; there's no lock.
+ */
+class CMetricHistogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr unsigned SUB_BUCKETS     = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_VALUE_BITS  = 40; // about 18 minutes; longer values are clamped
+    static constexpr uint64_t MAX_VALUE       = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    static constexpr unsigned BUCKET_COUNT    = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot
+    {
+        uint64_t              count = 0;
+        uint64_t              sum   = 0;
+        uint64_t              max   = 0;
+        std::vector<uint64_t> buckets;
+
+        /** the value below which a fraction q of the recorded values are, 0 when nothing was recorded */
+        uint64_t Percentile(double q) const;
+    };
+
+private:
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+
+public:
+    CMetricHistogram();
+
+    CMetricHistogram(const CMetricHistogram&) = delete;
+    CMetricHistogram& operator=(const CMetricHistogram&) = delete;
+
+    static unsigned BucketIndex(uint64_t value);
+    static uint64_t BucketLowerBound(unsigned index);
+
+    void Record(uint64_t nanos);
+    void Record(std::chrono::steady_clock::duration elapsed)
+    {
+        const int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        Record(static_cast<uint64_t>(nanos > 0 ? nanos : 0));
+    }
+
+    /** not atomic as a whole: values recorded while it's taken may be in some fields and not others */
+    Snapshot GetSnapshot() const;
+
+    /** like GetSnapshot(), not atomic with the values recorded meanwhile */
+    void Reset();
+};
+
+/** records the time from its construction to its destruction in a histogram */
+class CMetricTimer
+{
+    CMetricHistogram&                           histogram;
+    const std::chrono::steady_clock::time_point start;
+
+public:
+    explicit CMetricTimer(CMetricHistogram& histogramIn)
+        : histogram(histogramIn), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    CMetricTimer(const CMetricTimer&) = delete;
+    CMetricTimer& operator=(const CMetricTimer&) = delete;
+
+    ~CMetricTimer() { histogram.Record(std::chrono::steady_clock::now() - start); }
+};
+
+/**
+ * The process-wide set of metrics, by name and labels. The labels are in the Prometheus format, e.g.
+ * command="inv", and tell apart the metrics of a family. Metrics are created on first use and live as
+ * long as the process, so the references returned can be kept, which is what hot paths should do
+ * rather than looking them up every time.
+ *
+ * The registry's mutex is a plain boost::mutex: LOCK() reports contention to the registry, so it can't
+ * take a lock that reports contention itself.
+ */
+class CMetricsRegistry
+{
+    template <typename T>
+    using Family = std::map<std::string, std::unique_ptr<T>>;
+
+    mutable boost::mutex                            mtx;
+    std::map<std::string, Family<CMetricCounter>>   counters;
+    std::map<std::string, Family<CMetricGauge>>     gauges;
+    std::map<std::string, Family<CMetricHistogram>> histograms;
+
+public:
+    CMetricCounter&   Counter(const std::string& name, const std::string& labels = "");
+    CMetricGauge&     Gauge(const std::string& name, const std::string& labels = "");
+    CMetricHistogram& Histogram(const std::string& name, const std::string& labels = "");
+
+    void ForEachCounter(
+        const std::function<void(const std::string&, const std::string&, uint64_t)>& f) const;
+    void ForEachGauge(
+        const std::function<void(const std::string&, const std::string&, int64_t)>& f) const;
+    void ForEachHistogram(const std::function<void(const std::string&, const std::string&,
+                                                   const CMetricHistogram::Snapshot&)>& f) const;
+
+    /**
+     * All the metrics in the Prometheus text exposition format. Histograms are written as summaries,
+     * in seconds, with the quantiles 0.5, 0.9 and 0.99.
+     */
+    std::string FormatPrometheus() const;
+};
+
+CMetricsRegistry& Metrics();
+
+/** a label in the Prometheus format, e.g. MetricLabel("command", "inv") is command="inv" */
+std::string MetricLabel(const std::string& name, const std::string& value);
+
+#endif // METRICS_H
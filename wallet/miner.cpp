@@ -10,6 +10,7 @@
 #include "main.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "validationinterface.h"
 #include "work.h"
 
 using namespace std;
@@ -396,10 +397,8 @@ std::unique_ptr<CBlock> CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int
             nBlockSigOps += nTxSigOps;
             nFees += nTxFees;
 
-            if (fDebug) {
-                printf("priority %.1f feeperkb %.1f txid %s\n", dPriority, dFeePerKb,
-                       tx.GetHash().ToString().c_str());
-            }
+            LogPrint(LOG_STAKE, "priority %.1f feeperkb %.1f txid %s\n", dPriority, dFeePerKb,
+                     tx.GetHash().ToString().c_str());
 
             // Add transactions that depend on this one to the priority queue
             uint256 hash = tx.GetHash();
@@ -420,8 +419,7 @@ std::unique_ptr<CBlock> CreateNewBlock(CWallet* pwallet, bool fProofOfStake, int
         nLastBlockTx   = nBlockTx;
         nLastBlockSize = nBlockSize;
 
-        if (fDebug)
-            printf("CreateNewBlock(): total size %" PRIu64 "\n", nBlockSize);
+        LogPrint(LOG_STAKE, "CreateNewBlock(): total size %" PRIu64 "\n", nBlockSize);
 
         if (!fProofOfStake)
             pblock->vtx[0].vout[0].nValue = GetProofOfWorkReward(nFees);
@@ -610,6 +608,7 @@ void StakeMiner(CWallet* pwallet)
             if (fShutdown)
                 return;
         }
+        pwallet->ExpireDecryptedKeys();
 
         if (Params().MiningRequiresPeers()) {
             while (is_vNodesEmpty_safe() || IsInitialBlockDownload()) {
@@ -646,6 +645,8 @@ void StakeMiner(CWallet* pwallet)
         if (pblock->SignBlock(txdb, *pwallet, nFees)) {
             SetThreadPriority(THREAD_PRIORITY_NORMAL);
             CheckStake(pblock.get(), *pwallet);
+            // the wallet has to see the outputs that its block spent before it stakes again
+            SyncWithValidationInterfaceQueue();
             SetThreadPriority(THREAD_PRIORITY_LOWEST);
             MilliSleep(500);
         } else {
@@ -65,7 +65,7 @@ LockedVar<CAddrMan>                         addrman;
 vector<CNode*>                      vNodes;
 CCriticalSection                    cs_vNodes;
 LockedVar<std::vector<std::string>> vAddedNodes;
-map<CInv, CDataStream>              mapRelay;
+map<CInv, CSharedMessage>           mapRelay;
 deque<pair<int64_t, CInv>>          vRelayExpiration;
 CCriticalSection                    cs_mapRelay;
 ThreadSafeHashMap<CInv, int64_t>    mapAlreadyAskedFor;
@@ -653,24 +653,69 @@ int CNetMessage::readData(const char* pch, unsigned int nBytes)
     return nCopy;
 }
 
+CSharedMessage FinalizeSharedMessage(CDataStream& ss)
+{
+    assert(ss.size() >= CMessageHeader::HEADER_SIZE);
+    unsigned int nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    memcpy((char*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+
+    // the checksum is computed once, whatever the number of peers the message is sent to
+    uint256      hash      = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    unsigned int nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+
+    std::shared_ptr<CSerializeData> data = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*data);
+    return data;
+}
+
+// sends as much of the queued messages as the socket takes; on POSIX systems, up to
+// MAX_SEND_IOVECS messages are handed to the kernel with a single sendmsg() call
+static const size_t MAX_SEND_IOVECS = 64;
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode* pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSharedMessage>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData& data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
+#ifdef WIN32
+        const CSerializeData& data = **it;
         int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset,
                           MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+        struct iovec iov[MAX_SEND_IOVECS];
+        size_t       nIov = 0;
+        for (std::deque<CSharedMessage>::iterator itMsg = it;
+             itMsg != pnode->vSendMsg.end() && nIov < MAX_SEND_IOVECS; ++itMsg, ++nIov) {
+            const size_t nOffset = (nIov == 0 ? pnode->nSendOffset : 0);
+            iov[nIov].iov_base   = const_cast<char*>((*itMsg)->data()) + nOffset;
+            iov[nIov].iov_len    = (*itMsg)->size() - nOffset;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = nIov;
+        ssize_t nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
-            pnode->nSendOffset += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // move past the messages sent completely
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                const size_t nRemaining = (*it)->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
+            }
+            if (pnode->nSendOffset > 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1586,6 +1631,7 @@ void ThreadMessageHandler2(void* /*parg*/)
 {
     printf("ThreadMessageHandler started\n");
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
+
     while (!fShutdown) {
         vector<CNode*> vNodesCopy;
         {
@@ -1900,7 +1946,12 @@ bool StopNode()
         printf("ThreadDumpAddresses still running\n");
     if (vnThreadsRunning[THREAD_STAKE_MINER] > 0)
         printf("ThreadStakeMiner still running\n");
-    while (vnThreadsRunning[THREAD_MESSAGEHANDLER] > 0 || vnThreadsRunning[THREAD_RPCHANDLER] > 0)
+    if (vnThreadsRunning[THREAD_VERIFYBLOCKS] > 0)
+        printf("ThreadVerifyRecentBlocks still running\n");
+    // the verification of the latest blocks reads the db, so it's waited for before it's closed; it
+    // checks fShutdown after every block
+    while (vnThreadsRunning[THREAD_MESSAGEHANDLER] > 0 || vnThreadsRunning[THREAD_RPCHANDLER] > 0 ||
+           vnThreadsRunning[THREAD_VERIFYBLOCKS] > 0)
         MilliSleep(20);
 
     MilliSleep(50);
@@ -1941,6 +1992,8 @@ void RelayTransaction(const CTransaction& tx)
 void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
 {
     CInv inv(MSG_TX, tx.GetHash());
+    // framed once here, and queued as is for every peer that asks for it
+    CSharedMessage msg = MakeSharedMessage(inv.GetCommand(), ss);
     {
         LOCK(cs_mapRelay);
         // Expire old relay messages
@@ -1950,7 +2003,7 @@ void RelayTransaction(const CTransaction& tx, const CDataStream& ss)
         }
 
         // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+        mapRelay.insert(std::make_pair(inv, msg));
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -10,6 +10,7 @@
 #include <boost/foreach.hpp>
 #include <chainparams.h>
 #include <deque>
+#include <memory>
 #include <openssl/rand.h>
 
 #ifndef WIN32
@@ -27,6 +28,24 @@
 class CRequestTracker;
 class CNode;
 class CBlockIndex;
+class PartiallyDownloadedBlock;
+
+/**
+ * A complete message, header and checksum included, serialized once and then queued unmodified on the
+ * send queues of any number of peers, like a transaction or block relayed to all of them.
+ */
+typedef std::shared_ptr<const CSerializeData> CSharedMessage;
+
+/** sets the size and checksum of the message in ss, header included, and takes its content */
+CSharedMessage FinalizeSharedMessage(CDataStream& ss);
+
+template <typename T>
+CSharedMessage MakeSharedMessage(const char* pszCommand, const T& payload)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(Params().MessageStart(), pszCommand, 0) << payload;
+    return FinalizeSharedMessage(ss);
+}
 
 inline unsigned int ReceiveFloodSize() { return 1000 * GetArg("-maxreceivebuffer", 5 * 1000); }
 inline unsigned int SendBufferSize() { return 1000 * GetArg("-maxsendbuffer", 1 * 1000); }
@@ -114,6 +133,7 @@ enum threadId
     THREAD_RPCHANDLER,
     THREAD_STAKE_MINER,
     THREAD_IMPORT,
+    THREAD_VERIFYBLOCKS,
 
     THREAD_MAX
 };
@@ -129,7 +149,7 @@ extern LockedVar<CAddrMan>                         addrman;
 extern std::vector<CNode*>                  vNodes;
 extern CCriticalSection                     cs_vNodes;
 extern LockedVar<std::vector<std::string>>  vAddedNodes;
-extern std::map<CInv, CDataStream>          mapRelay;
+extern std::map<CInv, CSharedMessage>       mapRelay;
 extern std::deque<std::pair<int64_t, CInv>> vRelayExpiration;
 extern CCriticalSection                     cs_mapRelay;
 extern ThreadSafeHashMap<CInv, int64_t>     mapAlreadyAskedFor;
@@ -199,7 +219,7 @@ public:
     CDataStream                ssSend;
     size_t                     nSendSize;   // total size of all vSendMsg entries
     size_t                     nSendOffset; // offset inside the first vSendMsg already sent
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSharedMessage> vSendMsg;
     CCriticalSection           cs_vSend;
 
     std::deque<CNetMessage> vRecvMsg;
@@ -226,6 +246,10 @@ public:
     // b) the peer may tell us in their version message that we should not relay tx invs
     //    until they have initialized their bloom filter.
     bool             fRelayTxes;
+    // the peer sent "sendcmpct": blocks may be asked from it as compact blocks, and when it set
+    // fCompactBlockAnnounce, new blocks are announced to it as compact blocks rather than with an inv
+    bool             fSupportsCompactBlocks;
+    bool             fCompactBlockAnnounce;
     CSemaphoreGrant  grantOutbound;
     CCriticalSection cs_filter;
     CBloomFilter*    pfilter;
@@ -259,6 +283,11 @@ public:
     CCriticalSection             cs_inventory;
     std::multimap<int64_t, CInv> mapAskFor;
 
+    // the compact block from this peer that's waiting for the "blocktxn" it was asked for, and when it
+    // was asked for; only used by the thread that processes messages
+    std::shared_ptr<PartiallyDownloadedBlock> partialBlock;
+    int64_t                                   nPartialBlockTime;
+
     CNode(int64_t nodeId, SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn = "",
           bool fInboundIn = false)
         : nodeid(nodeId), ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000)
@@ -291,6 +320,9 @@ public:
         nMisbehavior             = 0;
         hashCheckpointKnown      = 0;
         fRelayTxes               = false;
+        fSupportsCompactBlocks   = false;
+        fCompactBlockAnnounce    = false;
+        nPartialBlockTime        = 0;
         setInventoryKnown.max_size(SendBufferSize() / 1000);
         pfilter = NULL;
 
@@ -361,12 +393,11 @@ public:
             vAddrToSend.push_back(addr);
     }
 
-    void AddInventoryKnown(const CInv& inv)
+    /** returns false if the peer already knew inv */
+    bool AddInventoryKnown(const CInv& inv)
     {
-        {
-            LOCK(cs_inventory);
-            setInventoryKnown.insert(inv);
-        }
+        LOCK(cs_inventory);
+        return setInventoryKnown.insert(inv).second;
     }
 
     void PushInventory(const CInv& inv)
@@ -447,17 +478,33 @@ public:
             printf("(%d bytes)\n", nSize);
         }
 
-        std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-        ssSend.GetAndClear(*it);
-        nSendSize += (*it).size();
+        std::shared_ptr<CSerializeData> data = std::make_shared<CSerializeData>();
+        ssSend.GetAndClear(*data);
+        nSendSize += data->size();
+        vSendMsg.push_back(std::move(data));
 
         // If write queue empty, attempt "optimistic write"
-        if (it == vSendMsg.begin())
+        if (vSendMsg.size() == 1)
             SocketSendData(this);
 
         LEAVE_CRITICAL_SECTION(cs_vSend);
     }
 
+    /** queues a message made with MakeSharedMessage(), without copying it */
+    void PushSharedMessage(const CSharedMessage& msg)
+    {
+        LOCK(cs_vSend);
+        if (fDebug)
+            printf("sending shared message (%" PRIszu " bytes)\n", msg->size());
+
+        vSendMsg.push_back(msg);
+        nSendSize += msg->size();
+
+        // If write queue empty, attempt "optimistic write"
+        if (vSendMsg.size() == 1)
+            SocketSendData(this);
+    }
+
     void PushVersion();
 
     void PushMessage(const char* pszCommand)
@@ -0,0 +1,245 @@
+#include "nodemetrics.h"
+
+#include "main.h"
+#include "net.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "util.h"
+#include "validationtimes.h"
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include <unordered_map>
+
+CMetricHistogram& MessageProcessHistogram(const std::string& strCommand)
+{
+    static const char* const commands[] = {
+        "addr",        "alert",        "block",       "blocktxn",     "cmpctblock", "filteradd",
+        "filterclear", "filterload",   "getaddr",     "getblocks",    "getblocktxn", "getcfcheckpt",
+        "getcfheaders", "getcfilters", "getdata",     "getheaders",   "inv",        "mempool",
+        "ping",        "pong",         "reject",      "sendcmpct",    "tx",         "verack",
+        "version"};
+    // built once and only read afterwards, so it needs no lock
+    static const std::unordered_map<std::string, CMetricHistogram*> histograms = []() {
+        std::unordered_map<std::string, CMetricHistogram*> result;
+        for (const char* command : commands) {
+            result[command] =
+                &Metrics().Histogram("neblio_message_process_seconds", MetricLabel("command", command));
+        }
+        result[""] =
+            &Metrics().Histogram("neblio_message_process_seconds", MetricLabel("command", "other"));
+        return result;
+    }();
+
+    auto it = histograms.find(strCommand);
+    return *(it != histograms.end() ? it : histograms.find(""))->second;
+}
+
+void UpdateNodeMetrics()
+{
+    static CMetricGauge& height      = Metrics().Gauge("neblio_block_height");
+    static CMetricGauge& mempoolSize = Metrics().Gauge("neblio_mempool_transactions");
+    static CMetricGauge& peers       = Metrics().Gauge("neblio_peers");
+
+    height.Set(CTxDB().GetBestChainHeight().value_or(0));
+    mempoolSize.Set(mempool.size());
+    {
+        LOCK(cs_vNodes);
+        peers.Set(vNodes.size());
+    }
+
+    // the phase times are exported as counters, which only go up; ValidationTimes may be reset (by the
+    // replay benchmark), and then only what was added since is added to them
+    static std::atomic<int64_t> lastPhaseNanos[static_cast<unsigned>(ValidationPhase::Count)];
+    for (unsigned i = 0; i < static_cast<unsigned>(ValidationPhase::Count); i++) {
+        const ValidationPhase phase  = static_cast<ValidationPhase>(i);
+        const int64_t         nNanos = ValidationTimes::Get(phase).count();
+        const int64_t         nLast  = lastPhaseNanos[i].exchange(nNanos);
+        const int64_t         nAdded = nNanos >= nLast ? nNanos - nLast : nNanos;
+        Metrics()
+            .Counter("neblio_validation_phase_nanoseconds",
+                     MetricLabel("phase", ValidationTimes::PhaseName(phase)))
+            .Inc(static_cast<uint64_t>(nAdded));
+    }
+}
+
+namespace {
+
+class CMetricsHttpConnection : public boost::enable_shared_from_this<CMetricsHttpConnection>
+{
+    static constexpr long TIMEOUT_SECONDS = 10;
+    // the request line and headers; a scraper's are far smaller
+    static constexpr std::size_t MAX_REQUEST_SIZE = 8 * 1024;
+
+    boost::asio::ip::tcp::socket socket;
+    boost::asio::deadline_timer  timer;
+    boost::asio::streambuf       request;
+    std::string                  response;
+
+    void Send(const std::string& strStatus, const std::string& strBody)
+    {
+        response = "HTTP/1.1 " + strStatus +
+                   "\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: " +
+                   std::to_string(strBody.size()) +
+                   "\r\n"
+                   "Connection: close\r\n"
+                   "\r\n" +
+                   strBody;
+        boost::asio::async_write(socket, boost::asio::buffer(response),
+                                 boost::bind(&CMetricsHttpConnection::Close, shared_from_this()));
+    }
+
+    void Reply(const boost::system::error_code& error)
+    {
+        // the headers didn't end within MAX_REQUEST_SIZE
+        if (error == boost::asio::error::not_found) {
+            Send("431 Request Header Fields Too Large", "");
+            return;
+        }
+        if (error) {
+            Close();
+            return;
+        }
+        std::istream requestStream(&request);
+        std::string  strMethod, strPath;
+        requestStream >> strMethod >> strPath;
+
+        std::string strStatus = "200 OK";
+        std::string strBody;
+        if (strMethod != "GET") {
+            strStatus = "405 Method Not Allowed";
+        } else if (strPath != "/metrics") {
+            strStatus = "404 Not Found";
+        } else {
+            UpdateNodeMetrics();
+            strBody = Metrics().FormatPrometheus();
+        }
+        Send(strStatus, strBody);
+    }
+
+public:
+    explicit CMetricsHttpConnection(boost::asio::io_service& io)
+        : socket(io), timer(io), request(MAX_REQUEST_SIZE)
+    {
+    }
+
+    boost::asio::ip::tcp::socket& Socket() { return socket; }
+
+    void Start()
+    {
+        // a client that doesn't send its request in time doesn't hold the connection open
+        timer.expires_from_now(boost::posix_time::seconds(TIMEOUT_SECONDS));
+        timer.async_wait(boost::bind(&CMetricsHttpConnection::Close, shared_from_this()));
+        boost::asio::async_read_until(socket, request, "\r\n\r\n",
+                                      boost::bind(&CMetricsHttpConnection::Reply, shared_from_this(),
+                                                  boost::asio::placeholders::error));
+    }
+
+    void Close()
+    {
+        boost::system::error_code ignored;
+        timer.cancel(ignored);
+        socket.close(ignored);
+    }
+};
+
+class CMetricsHttpServer
+{
+    boost::asio::io_service        io;
+    boost::asio::ip::tcp::acceptor acceptor;
+    boost::thread                  thread;
+
+    void Accept()
+    {
+        boost::shared_ptr<CMetricsHttpConnection> conn = boost::make_shared<CMetricsHttpConnection>(io);
+        acceptor.async_accept(conn->Socket(), [this, conn](const boost::system::error_code& error) {
+            if (error == boost::asio::error::operation_aborted) {
+                return;
+            }
+            if (!error) {
+                conn->Start();
+            }
+            Accept();
+        });
+    }
+
+public:
+    CMetricsHttpServer() : acceptor(io) {}
+
+    bool Start(const boost::asio::ip::tcp::endpoint& endpoint, std::string& strError)
+    {
+        boost::system::error_code error;
+        acceptor.open(endpoint.protocol(), error);
+        if (!error)
+            acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+        if (!error)
+            acceptor.bind(endpoint, error);
+        if (!error)
+            acceptor.listen(boost::asio::socket_base::max_connections, error);
+        if (error) {
+            strError = strprintf("Unable to listen for metrics on %s:%u: %s",
+                                 endpoint.address().to_string().c_str(), endpoint.port(),
+                                 error.message().c_str());
+            return false;
+        }
+        Accept();
+        thread = boost::thread([this]() {
+            RenameThread("neblio-metrics");
+            io.run();
+        });
+        return true;
+    }
+
+    void Stop()
+    {
+        io.stop();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
+
+std::unique_ptr<CMetricsHttpServer> metricsServer;
+
+} // namespace
+
+bool StartMetricsServer(std::string& strError)
+{
+    const int64_t nPort = GetArg("-metricsport", 0);
+    if (nPort == 0) {
+        return true;
+    }
+    if (nPort < 0 || nPort > 65535) {
+        strError = strprintf("Invalid -metricsport: %" PRId64, nPort);
+        return false;
+    }
+
+    const std::string         strBind = GetArg("-metricsbind", "127.0.0.1");
+    boost::system::error_code error;
+    const boost::asio::ip::address address = boost::asio::ip::address::from_string(strBind, error);
+    if (error) {
+        strError = "Invalid -metricsbind address: " + strBind;
+        return false;
+    }
+
+    metricsServer.reset(new CMetricsHttpServer);
+    if (!metricsServer->Start(
+            boost::asio::ip::tcp::endpoint(address, static_cast<unsigned short>(nPort)), strError)) {
+        metricsServer.reset();
+        return false;
+    }
+    printf("Serving metrics on %s:%" PRId64 "\n", strBind.c_str(), nPort);
+    return true;
+}
+
+void StopMetricsServer()
+{
+    if (metricsServer) {
+        metricsServer->Stop();
+        metricsServer.reset();
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef NODEMETRICS_H
+#define NODEMETRICS_H
+
+#include "metrics.h"
+
+#include <string>
+
+/**
+ * The histogram of the time ProcessMessage() takes for messages of a command. Commands that the node
+ * doesn't handle share the command "other", so peers can't create metrics at will.
+ */
+CMetricHistogram& MessageProcessHistogram(const std::string& strCommand);
+
+/** refreshes the gauges that are read from the node's state when metrics are reported */
+void UpdateNodeMetrics();
+
+/**
+ * Serves the metrics in the Prometheus text format at http://<bind>:<port>/metrics, from a thread of
+ * its own, with -metricsport (and -metricsbind, 127.0.0.1 by default). There's no authentication, so
+ * it should only be reachable by the scraper.
+ */
+bool StartMetricsServer(std::string& strError);
+void StopMetricsServer();
+
+#endif // NODEMETRICS_H
@@ -0,0 +1,148 @@
+#ifndef NTP1CHECKEDINT_H
+#define NTP1CHECKEDINT_H
+
+#include "ntp1/ntp1script.h"
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+
+/**
+ * An NTP1 token amount for arithmetic in loops (token transfers, balance totals).
+ *
+ * Values are kept in a fixed-width, overflow-checked 128-bit integer that never allocates. If a result
+ * doesn't fit, the value switches to NTP1Int for good and the operation is redone there, so results
+ * are always exactly those of NTP1Int. Real token amounts are bounded by NTP1MaxAmount, so the switch
+ * only happens with crafted amounts.
+ */
+class NTP1CheckedInt
+{
+public:
+    using FixedInt = boost::multiprecision::checked_int128_t;
+
+private:
+    FixedInt fixed;
+    // only allocated once the value left the fixed-width range, which keeps copies cheap
+    std::unique_ptr<NTP1Int> big;
+
+    static bool FitsInFixed(const NTP1Int& value)
+    {
+        return value.is_zero() || boost::multiprecision::msb(boost::multiprecision::abs(value)) < 128;
+    }
+
+    static int Compare(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        if (!lhs.big && !rhs.big)
+            return lhs.fixed.compare(rhs.fixed);
+        return lhs.get().compare(rhs.get());
+    }
+
+    void Promote()
+    {
+        if (!big) {
+            big.reset(new NTP1Int(static_cast<NTP1Int>(fixed)));
+            fixed = 0;
+        }
+    }
+
+public:
+    NTP1CheckedInt() : fixed(0) {}
+    NTP1CheckedInt(int64_t value) : fixed(value) {}
+    NTP1CheckedInt(const NTP1Int& value) : fixed(0)
+    {
+        if (FitsInFixed(value))
+            fixed = static_cast<FixedInt>(value);
+        else
+            big.reset(new NTP1Int(value));
+    }
+    NTP1CheckedInt(const NTP1CheckedInt& other)
+        : fixed(other.fixed), big(other.big ? new NTP1Int(*other.big) : nullptr)
+    {
+    }
+    NTP1CheckedInt(NTP1CheckedInt&& other) = default;
+
+    NTP1CheckedInt& operator=(const NTP1CheckedInt& other)
+    {
+        if (this != &other) {
+            fixed = other.fixed;
+            big.reset(other.big ? new NTP1Int(*other.big) : nullptr);
+        }
+        return *this;
+    }
+    NTP1CheckedInt& operator=(NTP1CheckedInt&& other) = default;
+
+    /** whether the value is still in the fixed-width representation */
+    bool IsFixed() const { return !big; }
+
+    NTP1Int get() const { return big ? *big : static_cast<NTP1Int>(fixed); }
+
+    NTP1CheckedInt& operator+=(const NTP1CheckedInt& other)
+    {
+        if (!big && !other.big) {
+            try {
+                const FixedInt result = fixed + other.fixed;
+                fixed                 = result;
+                return *this;
+            } catch (const std::overflow_error&) {
+            }
+        }
+        Promote();
+        *big += other.get();
+        return *this;
+    }
+
+    NTP1CheckedInt& operator-=(const NTP1CheckedInt& other)
+    {
+        if (!big && !other.big) {
+            try {
+                const FixedInt result = fixed - other.fixed;
+                fixed                 = result;
+                return *this;
+            } catch (const std::overflow_error&) {
+            }
+        }
+        Promote();
+        *big -= other.get();
+        return *this;
+    }
+
+    bool operator!() const { return big ? big->is_zero() : fixed.is_zero(); }
+
+    friend NTP1CheckedInt operator+(NTP1CheckedInt lhs, const NTP1CheckedInt& rhs) { return lhs += rhs; }
+    friend NTP1CheckedInt operator-(NTP1CheckedInt lhs, const NTP1CheckedInt& rhs) { return lhs -= rhs; }
+
+    friend bool operator==(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) == 0;
+    }
+    friend bool operator!=(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) != 0;
+    }
+    friend bool operator<(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) < 0;
+    }
+    friend bool operator>(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) > 0;
+    }
+    friend bool operator<=(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) <= 0;
+    }
+    friend bool operator>=(const NTP1CheckedInt& lhs, const NTP1CheckedInt& rhs)
+    {
+        return Compare(lhs, rhs) >= 0;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const NTP1CheckedInt& value)
+    {
+        if (value.big)
+            return os << *value.big;
+        return os << value.fixed;
+    }
+};
+
+#endif // NTP1CHECKEDINT_H
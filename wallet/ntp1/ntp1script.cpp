@@ -145,9 +145,8 @@ NTP1Script::TxType NTP1Script::CalculateTxTypeNTP1v3(const std::string& op_code_
 
 uint64_t NTP1Script::CalculateAmountSize(uint8_t firstChar)
 {
-    std::bitset<8> bits(firstChar);
-    std::bitset<3> bits3(bits.to_string().substr(0, 3));
-    unsigned long  s = bits3.to_ulong();
+    // the 3 most significant bits
+    const unsigned s = firstChar >> 5;
     if (s < 6) {
         return s + 1;
     } else {
@@ -303,7 +302,7 @@ std::vector<NTP1Script::TransferInstruction> NTP1Script::ParseTransferInstructio
             break;
         }
 
-        const TransferInstruction transferInst = ParseTransferInstruction(toParse);
+        const TransferInstruction transferInst = ::ParseTransferInstruction(toParse);
         toParse.erase(toParse.begin(), toParse.begin() + transferInst.rawSize);
         totalRawSize += transferInst.rawSize;
 
@@ -339,7 +338,7 @@ NTP1Script::ParseNTP1v3TransferInstructionsFromLongEnoughString(
             throw std::runtime_error("Transfer instruction number " + ToString(i) + " has a size <= 1");
         }
 
-        const TransferInstruction transferInst = ParseTransferInstruction(toParse);
+        const TransferInstruction transferInst = ::ParseTransferInstruction(toParse);
         toParse.erase(toParse.begin(), toParse.begin() + transferInst.rawSize);
         totalRawSize += transferInst.rawSize;
 
@@ -349,7 +348,241 @@ NTP1Script::ParseNTP1v3TransferInstructionsFromLongEnoughString(
     return result;
 }
 
+NTP1Int NTP1Script::ParseAmount(StringViewT& ScriptBin)
+{
+    if (ScriptBin.size() < 1) {
+        throw std::runtime_error("Too short a string to parse an amount");
+    }
+    const std::size_t amountSize = CalculateAmountSize(static_cast<uint8_t>(ScriptBin[0]));
+    if (ScriptBin.size() < amountSize) {
+        throw std::runtime_error("Error parsing script: " + ToString(ScriptBin.size()) +
+                                 " bytes are left; the amount size is longer than what is available "
+                                 "in the script");
+    }
+    const NTP1Int result = NTP1AmountBinToNumber(ScriptBin.substr(0, amountSize));
+    ScriptBin.remove_prefix(amountSize);
+    return result;
+}
+
+StringViewT NTP1Script::ParseOpCode(StringViewT& ScriptBin)
+{
+    std::size_t size = 0;
+    while (size < ScriptBin.size()) {
+        // byte value 0xFF means that more OP_CODE bytes are required
+        if (static_cast<uint8_t>(ScriptBin[size++]) != 255) {
+            break;
+        }
+        if (size == ScriptBin.size()) {
+            throw std::runtime_error("OpCode's last byte 0xFF indicates that there's more, but "
+                                     "there's no more characters in the string.");
+        }
+    }
+    const StringViewT result = ScriptBin.substr(0, size);
+    ScriptBin.remove_prefix(size);
+    return result;
+}
+
+StringViewT NTP1Script::ParseMetadata(StringViewT& ScriptBin, StringViewT OpCodeBin)
+{
+    const std::size_t metadataSize = CalculateMetadataSize(OpCodeBin.to_string());
+    if (ScriptBin.size() < metadataSize) {
+        throw std::runtime_error("Error parsing script; the metadata size is longer than what is "
+                                 "available in the script");
+    }
+    const StringViewT result = ScriptBin.substr(0, metadataSize);
+    ScriptBin.remove_prefix(metadataSize);
+    return result;
+}
+
+StringViewT NTP1Script::ParseNTP1v3Metadata(StringViewT& ScriptBin)
+{
+    if (ScriptBin.size() == 0) {
+        return StringViewT();
+    }
+    if (ScriptBin.size() < 4) {
+        throw std::runtime_error(
+            "The data remaining cannot fit metadata start flag, which is 4 bytes: " +
+            boost::algorithm::hex(ScriptBin.to_string()));
+    }
+
+    uint32_t metadataSize;
+    memcpy(&metadataSize, ScriptBin.data(), 4);
+    FromBigEndianToThisEndianness(metadataSize);
+
+    const StringViewT result = ScriptBin.substr(4);
+    if (result.size() != metadataSize) {
+        throw std::runtime_error(
+            "The size of the metadata found is not equal to the available size of the data left");
+    }
+
+    // an empty metadata leaves its size in the script, which callers then reject as garbage
+    if (metadataSize > 0) {
+        ScriptBin.remove_prefix(4 + metadataSize);
+    }
+    return result;
+}
+
+std::string NTP1Script::ParseTokenSymbol(StringViewT& ScriptBin)
+{
+    if (ScriptBin.size() < 5) {
+        throw std::runtime_error(
+            "Error parsing script (starting at this point a symbol is expected); the token symbol "
+            "size is longer than what is available in the script");
+    }
+    std::string result;
+    result.reserve(5);
+    // drop 0x20 (space) chars
+    for (std::size_t i = 0; i < 5; i++) {
+        if (static_cast<uint8_t>(ScriptBin[i]) != 0x20) {
+            result.push_back(ScriptBin[i]);
+        }
+    }
+
+    auto it =
+        std::find_if(result.begin(), result.end(), [](char c) { return !IsTokenSymbolCharValid(c); });
+    if (it != result.end()) {
+        throw std::runtime_error("Invalid token symbol. Token symbols can only contain English letters "
+                                 "and numbers. The current name \"" +
+                                 result + "\", has an invalid character: \"" + std::string(1, *it) +
+                                 "\"");
+    }
+
+    if (result.size() == 0) {
+        throw std::runtime_error("Invalid token symbol; it cannot be empty.");
+    }
+    ScriptBin.remove_prefix(5);
+    return result;
+}
+
+NTP1Script::TransferInstruction NTP1Script::ParseTransferInstruction(StringViewT& ScriptBin)
+{
+    if (ScriptBin.size() <= 1) {
+        throw std::runtime_error("ParseTransferInstruction failed as input is too short");
+    }
+
+    // one byte of flags, and then N bytes for the amount
+    TransferInstruction transferInst;
+    const StringViewT   rawAmount =
+        ScriptBin.substr(1, CalculateAmountSize(static_cast<uint8_t>(ScriptBin[1])));
+    transferInst.firstRawByte = static_cast<unsigned char>(ScriptBin[0]);
+    transferInst.rawAmount.assign(rawAmount.data(), rawAmount.size());
+    transferInst.rawSize = 1 + rawAmount.size();
+
+    // the most significant bit is the skip flag, and the 5 least significant bits are the output index
+    transferInst.skipInput   = (transferInst.firstRawByte & 0x80) != 0;
+    transferInst.outputIndex = transferInst.firstRawByte & 0x1F;
+    transferInst.amount      = NTP1AmountBinToNumber(rawAmount);
+
+    ScriptBin.remove_prefix(transferInst.rawSize);
+    return transferInst;
+}
+
+std::vector<NTP1Script::TransferInstruction>
+NTP1Script::ParseTransferInstructions(StringViewT& ScriptBin)
+{
+    std::vector<TransferInstruction> result;
+    while (ScriptBin.size() > 1) {
+        result.push_back(ParseTransferInstruction(ScriptBin));
+    }
+    return result;
+}
+
+std::vector<NTP1Script::TransferInstruction>
+NTP1Script::ParseNTP1v3TransferInstructions(StringViewT& ScriptBin)
+{
+    if (ScriptBin.size() < 1) {
+        throw std::runtime_error("Transfer instructions do not contain the number of transfer "
+                                 "instructions in their first byte");
+    }
+
+    const int numOfTIs = static_cast<unsigned char>(ScriptBin[0]);
+    ScriptBin.remove_prefix(1);
+
+    if (numOfTIs <= 0) {
+        throw std::runtime_error("The number of transfer instructions cannot be zero.");
+    }
+
+    std::vector<TransferInstruction> result;
+    result.reserve(numOfTIs);
+    for (int i = 0; i < numOfTIs; i++) {
+        if (ScriptBin.size() <= 1) {
+            throw std::runtime_error("Transfer instruction number " + ToString(i) + " has a size <= 1");
+        }
+        result.push_back(ParseTransferInstruction(ScriptBin));
+    }
+    return result;
+}
+
 std::shared_ptr<NTP1Script> NTP1Script::ParseScript(const std::string& scriptHex)
+{
+    std::string scriptBin;
+    try {
+        scriptBin = boost::algorithm::unhex(scriptHex);
+    } catch (std::exception& ex) {
+        throw std::runtime_error("Unable to parse hex script: " + scriptHex + "; reason: " + ex.what());
+    }
+    return ParseScriptBin(scriptBin, scriptHex);
+}
+
+std::shared_ptr<NTP1Script> NTP1Script::ParseScriptBin(StringViewT        scriptBin,
+                                                       const std::string& scriptHex)
+{
+    try {
+        if (scriptBin.size() < 3) {
+            throw std::runtime_error("Too short script");
+        }
+        const StringViewT header = scriptBin.substr(0, 3);
+        if (header[0] != 'N' || header[1] != 'T') {
+            throw std::runtime_error("NTP1 script prefix is invalid for " + scriptHex);
+        }
+        const int protocolVersion = static_cast<uint8_t>(header[2]);
+        scriptBin.remove_prefix(3);
+
+        const StringViewT opCodeBin = ParseOpCode(scriptBin);
+        TxType            txType;
+        if (protocolVersion == 1) {
+            txType = CalculateTxType(opCodeBin.to_string());
+        } else if (protocolVersion == 3) {
+            txType = CalculateTxTypeNTP1v3(opCodeBin.to_string());
+        } else {
+            throw std::runtime_error("Unknown protocol version " + ToString(protocolVersion) +
+                                     " in script: " + scriptHex);
+        }
+
+        std::shared_ptr<NTP1Script> result_;
+
+        if (txType == TxType::TxType_Issuance) {
+            if (protocolVersion == 1) {
+                result_ = NTP1Script_Issuance::ParseNTP1v1IssuancePostHeaderBin(scriptBin, opCodeBin);
+            } else {
+                result_ = NTP1Script_Issuance::ParseNTP1v3IssuancePostHeaderBin(scriptBin);
+            }
+        } else if (txType == TxType::TxType_Transfer) {
+            if (protocolVersion == 1) {
+                result_ = NTP1Script_Transfer::ParseNTP1v1TransferPostHeaderBin(scriptBin, opCodeBin);
+            } else {
+                result_ = NTP1Script_Transfer::ParseNTP1v3TransferPostHeaderBin(scriptBin);
+            }
+        } else if (txType == TxType::TxType_Burn) {
+            if (protocolVersion == 1) {
+                result_ = NTP1Script_Burn::ParseNTP1v1BurnPostHeaderBin(scriptBin, opCodeBin);
+            } else {
+                result_ = NTP1Script_Burn::ParseNTP1v3BurnPostHeaderBin(scriptBin);
+            }
+        } else {
+            throw std::runtime_error("Unknown transaction type to parse in script: " + scriptHex);
+        }
+        result_->setCommonParams(header.to_string(), protocolVersion, opCodeBin.to_string(),
+                                 scriptHex);
+
+        return result_;
+
+    } catch (std::exception& ex) {
+        throw std::runtime_error("Unable to parse hex script: " + scriptHex + "; reason: " + ex.what());
+    }
+}
+
+std::shared_ptr<NTP1Script> NTP1Script::ParseScriptLegacy(const std::string& scriptHex)
 {
     try {
         std::string scriptBin = boost::algorithm::unhex(scriptHex);
@@ -423,15 +656,12 @@ std::shared_ptr<NTP1Script> NTP1Script::ParseScript(const std::string& scriptHex
 
 NTP1Script::IssuanceFlags NTP1Script::IssuanceFlags::ParseIssuanceFlag(uint8_t flags)
 {
-    IssuanceFlags  result;
-    std::bitset<8> bits(flags);
-    // first 3 bits
-    result.divisibility = static_cast<decltype(result.divisibility)>(
-        std::bitset<3>(bits.to_string().substr(0, 3)).to_ulong());
-    result.locked = bits.test(4); // 4th bit (3rd bit from the lsb, 7-(4-1)=3)
+    IssuanceFlags result;
+    // first 3 bits (most significant)
+    result.divisibility = static_cast<decltype(result.divisibility)>(flags >> 5);
+    result.locked       = (flags & 0x10) != 0; // 4th bit (3rd bit from the lsb, 7-(4-1)=3)
     // 5th + 6th bits
-    int aggrPolicy = static_cast<decltype(result.divisibility)>(
-        std::bitset<2>(bits.to_string().substr(4, 2)).to_ulong());
+    int aggrPolicy = (flags >> 2) & 0x03;
     switch (aggrPolicy) {
     case 0: // 00
         result.aggregationPolicy = AggregationPolicy::AggregationPolicy_Aggregatable;
@@ -730,6 +960,85 @@ NTP1Int NTP1Script::NTP1AmountHexToNumber(std::string hexVal)
                boost::multiprecision::pow(NTP1Int(10), boost::dynamic_bitset<>(exponent).to_ulong()));
 }
 
+NTP1Int NTP1Script::NTP1AmountBinToNumber(StringViewT bin)
+{
+    if (bin.size() < 1) {
+        throw std::runtime_error("An amount can't be empty.");
+    }
+    if (bin.size() > 7) {
+        throw std::out_of_range("Amount can't be bigger than 7 bytes.");
+    }
+
+    // sizes in bits; the header is the 2 or 3 most significant bits
+    const uint8_t first        = static_cast<uint8_t>(bin[0]);
+    int           headerSize   = 3;
+    int           mantissaSize = 0;
+    int           exponentSize = 0;
+    if ((first & 0xC0) == 0xC0) {
+        headerSize   = 2;
+        mantissaSize = 54;
+        exponentSize = 0;
+    } else {
+        switch (first >> 5) {
+        case 0:
+            mantissaSize = 5;
+            exponentSize = 0;
+            break;
+        case 1:
+            mantissaSize = 9;
+            exponentSize = 4;
+            break;
+        case 2:
+            mantissaSize = 17;
+            exponentSize = 4;
+            break;
+        case 3:
+            mantissaSize = 25;
+            exponentSize = 4;
+            break;
+        case 4:
+            mantissaSize = 34;
+            exponentSize = 3;
+            break;
+        default:
+            mantissaSize = 42;
+            exponentSize = 3;
+            break;
+        }
+    }
+
+    if (static_cast<std::size_t>(headerSize + mantissaSize + exponentSize) != bin.size() * 8) {
+        throw std::logic_error("The total bits don't make a byte. This should never happen.");
+    }
+
+    // at most 7 bytes, so the whole amount fits in 64 bits
+    uint64_t value = 0;
+    for (char c : bin) {
+        value = (value << 8) | static_cast<uint8_t>(c);
+    }
+
+    static const uint64_t PowersOf10[] = {UINT64_C(1),
+                                          UINT64_C(10),
+                                          UINT64_C(100),
+                                          UINT64_C(1000),
+                                          UINT64_C(10000),
+                                          UINT64_C(100000),
+                                          UINT64_C(1000000),
+                                          UINT64_C(10000000),
+                                          UINT64_C(100000000),
+                                          UINT64_C(1000000000),
+                                          UINT64_C(10000000000),
+                                          UINT64_C(100000000000),
+                                          UINT64_C(1000000000000),
+                                          UINT64_C(10000000000000),
+                                          UINT64_C(100000000000000),
+                                          UINT64_C(1000000000000000)};
+
+    const uint64_t exponent = value & ((UINT64_C(1) << exponentSize) - 1);
+    const uint64_t mantissa = (value >> exponentSize) & ((UINT64_C(1) << mantissaSize) - 1);
+    return NTP1Int(mantissa) * PowersOf10[exponent];
+}
+
 std::string
 NTP1Script::EncryptMetadataWithEphemeralKey(const StringViewT data, const CKey& publicKey,
                                             Crypto_HighLevel::EncryptionAlgorithm     encAlgo,
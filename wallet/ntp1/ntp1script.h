@@ -1,6 +1,7 @@
 #ifndef NTP1SCRIPT_H
 #define NTP1SCRIPT_H
 
+#include "CustomTypes.h"
 #include "boost/algorithm/string.hpp"
 #include "crypto_highlevel.h"
 #include "json_spirit.h"
@@ -193,15 +194,34 @@ public:
     ParseNTP1v3TransferInstructionsFromLongEnoughString(const std::string& BinInstructionsStartFromByte0,
                                                         int&               totalRawSize);
 
+    // the byte-span equivalents of the *FromLongEnoughString functions above; each of them removes what
+    // it parsed from the front of the span
+    static NTP1Int             ParseAmount(StringViewT& ScriptBin);
+    static StringViewT         ParseOpCode(StringViewT& ScriptBin);
+    static StringViewT         ParseMetadata(StringViewT& ScriptBin, StringViewT OpCodeBin);
+    static StringViewT         ParseNTP1v3Metadata(StringViewT& ScriptBin);
+    static std::string         ParseTokenSymbol(StringViewT& ScriptBin);
+    static TransferInstruction ParseTransferInstruction(StringViewT& ScriptBin);
+    static std::vector<TransferInstruction> ParseTransferInstructions(StringViewT& ScriptBin);
+    static std::vector<TransferInstruction> ParseNTP1v3TransferInstructions(StringViewT& ScriptBin);
+
     std::string getHeader() const;
     std::string getOpCodeBin() const;
     TxType      getTxType() const;
 
     static std::shared_ptr<NTP1Script> ParseScript(const std::string& scriptHex);
+    static std::shared_ptr<NTP1Script> ParseScriptBin(StringViewT        scriptBin,
+                                                      const std::string& scriptHex);
+    /**
+     * The original parser, which works on hex strings and copies of them. ParseScript() must produce
+     * the same results; this is kept to check exactly that
+     */
+    static std::shared_ptr<NTP1Script> ParseScriptLegacy(const std::string& scriptHex);
     std::string                        getParsedScriptHex() const;
     int                                getProtocolVersion() const;
 
     static NTP1Int     NTP1AmountHexToNumber(std::string hexVal);
+    static NTP1Int     NTP1AmountBinToNumber(StringViewT bin);
     static NTP1Int     GetTrailingZeros(const NTP1Int& num);
     static std::string NumberToHexNTP1Amount(const NTP1Int& num, bool caps = false);
 
@@ -95,6 +95,53 @@ std::shared_ptr<NTP1Script_Burn> NTP1Script_Burn::ParseNTP1v3BurnPostHeaderData(
     return result;
 }
 
+std::shared_ptr<NTP1Script_Burn> NTP1Script_Burn::ParseNTP1v1BurnPostHeaderBin(StringViewT ScriptBin,
+                                                                             StringViewT OpCodeBin)
+{
+    std::shared_ptr<NTP1Script_Burn> result = std::make_shared<NTP1Script_Burn>();
+
+    result->metadata             = ParseMetadata(ScriptBin, OpCodeBin).to_string();
+    result->transferInstructions = ParseTransferInstructions(ScriptBin);
+
+    // burn should have at least one transfer instruction output with index 31 as the burn address
+    // other addresses are transfer, not burn
+    auto it = std::find_if(result->transferInstructions.begin(), result->transferInstructions.end(),
+                           [](const TransferInstruction& t) { return t.outputIndex == 31; });
+
+    if (it == result->transferInstructions.end()) {
+        throw std::runtime_error("A burn transaction was created, but transfer instructions had invalid "
+                                 "outputs. At least one of the outputs should have the index 31, "
+                                 "indicating the amount to burn.");
+    }
+
+    return result;
+}
+
+std::shared_ptr<NTP1Script_Burn> NTP1Script_Burn::ParseNTP1v3BurnPostHeaderBin(StringViewT ScriptBin)
+{
+    std::shared_ptr<NTP1Script_Burn> result = std::make_shared<NTP1Script_Burn>();
+
+    result->transferInstructions = ParseNTP1v3TransferInstructions(ScriptBin);
+    result->metadata             = ParseNTP1v3Metadata(ScriptBin).to_string();
+
+    if (ScriptBin.size() != 0) {
+        throw std::runtime_error("Garbage data after the metadata (unaccounted for in size).");
+    }
+
+    // burn should have at least one transfer instruction output with index 31 as the burn address
+    // other addresses are transfer, not burn
+    auto it = std::find_if(result->transferInstructions.begin(), result->transferInstructions.end(),
+                           [](const TransferInstruction& t) { return t.outputIndex == 31; });
+
+    if (it == result->transferInstructions.end()) {
+        throw std::runtime_error("A burn transaction was created, but transfer instructions had invalid "
+                                 "outputs. At least one of the outputs should have the index 31, "
+                                 "indicating the amount to burn.");
+    }
+
+    return result;
+}
+
 std::string NTP1Script_Burn::calculateScriptBin() const
 {
     if (protocolVersion == 1) {
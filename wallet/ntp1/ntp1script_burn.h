@@ -23,6 +23,9 @@ public:
     static std::shared_ptr<NTP1Script_Burn> ParseNTP1v1BurnPostHeaderData(std::string ScriptBin,
                                                                     std::string OpCodeBin);
     static std::shared_ptr<NTP1Script_Burn> ParseNTP1v3BurnPostHeaderData(std::string ScriptBin);
+    static std::shared_ptr<NTP1Script_Burn> ParseNTP1v1BurnPostHeaderBin(StringViewT ScriptBin,
+                                                                       StringViewT OpCodeBin);
+    static std::shared_ptr<NTP1Script_Burn> ParseNTP1v3BurnPostHeaderBin(StringViewT ScriptBin);
     static std::string                      Create_OpCodeFromMetadata(const std::string& metadata);
     static std::shared_ptr<NTP1Script_Burn>
     CreateScript(const std::vector<NTP1Script::TransferInstruction>& transferInstructions,
@@ -178,6 +178,65 @@ NTP1Script_Issuance::ParseNTP1v3IssuancePostHeaderData(std::string ScriptBin)
     return result;
 }
 
+std::shared_ptr<NTP1Script_Issuance>
+NTP1Script_Issuance::ParseNTP1v1IssuancePostHeaderBin(StringViewT ScriptBin, StringViewT OpCodeBin)
+{
+    std::shared_ptr<NTP1Script_Issuance> result = std::make_shared<NTP1Script_Issuance>();
+
+    result->tokenSymbol          = ParseTokenSymbol(ScriptBin);
+    result->metadata             = ParseMetadata(ScriptBin, OpCodeBin).to_string();
+    result->amount               = ParseAmount(ScriptBin);
+    result->transferInstructions = ParseTransferInstructions(ScriptBin);
+
+    // check that no skip transfer instructions exist; as it's forbidden in issuance
+    for (const auto& inst : result->transferInstructions) {
+        if (inst.skipInput) {
+            throw std::runtime_error("An issuance script contained a skip transfer instruction");
+        }
+    }
+
+    // the expected remaining byte is the issuance flag, otherwise a problem is there
+    if (ScriptBin.size() != 1) {
+        throw std::runtime_error(
+            "Last expected byte is the issuance flag, but the remaining bytes are: " +
+            boost::algorithm::hex(ScriptBin.to_string()));
+    }
+
+    result->issuanceFlags = IssuanceFlags::ParseIssuanceFlag(ScriptBin[0]);
+    return result;
+}
+
+std::shared_ptr<NTP1Script_Issuance>
+NTP1Script_Issuance::ParseNTP1v3IssuancePostHeaderBin(StringViewT ScriptBin)
+{
+    std::shared_ptr<NTP1Script_Issuance> result = std::make_shared<NTP1Script_Issuance>();
+
+    result->tokenSymbol          = ParseTokenSymbol(ScriptBin);
+    result->amount               = ParseAmount(ScriptBin);
+    result->transferInstructions = ParseNTP1v3TransferInstructions(ScriptBin);
+
+    // check that no skip transfer instructions exist; as it's forbidden in issuance
+    for (const auto& inst : result->transferInstructions) {
+        if (inst.skipInput) {
+            throw std::runtime_error("An issuance script contained a skip transfer instruction");
+        }
+    }
+
+    if (ScriptBin.size() < 1) {
+        throw std::runtime_error("The data remaining cannot fit the issuance flags. It is empty.");
+    }
+    result->issuanceFlags = IssuanceFlags::ParseIssuanceFlag(ScriptBin[0]);
+    ScriptBin.remove_prefix(1);
+
+    result->metadata = ParseNTP1v3Metadata(ScriptBin).to_string();
+
+    if (ScriptBin.size() != 0) {
+        throw std::runtime_error("Garbage data after the metadata (unaccounted for in size).");
+    }
+
+    return result;
+}
+
 std::string NTP1Script_Issuance::getTokenID(std::string input0txid, unsigned int input0index) const
 {
     // txid should be lower case
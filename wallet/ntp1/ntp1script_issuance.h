@@ -36,6 +36,9 @@ public:
     static std::shared_ptr<NTP1Script_Issuance> ParseNTP1v1IssuancePostHeaderData(std::string ScriptBin,
                                                                                   std::string OpCodeBin);
     static std::shared_ptr<NTP1Script_Issuance> ParseNTP1v3IssuancePostHeaderData(std::string ScriptBin);
+    static std::shared_ptr<NTP1Script_Issuance> ParseNTP1v1IssuancePostHeaderBin(StringViewT ScriptBin,
+                                                                                 StringViewT OpCodeBin);
+    static std::shared_ptr<NTP1Script_Issuance> ParseNTP1v3IssuancePostHeaderBin(StringViewT ScriptBin);
     std::string getTokenID(std::string input0txid, unsigned int input0index) const;
 
     static std::shared_ptr<NTP1Script_Issuance>
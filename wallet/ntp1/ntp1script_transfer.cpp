@@ -78,6 +78,32 @@ NTP1Script_Transfer::ParseNTP1v3TransferPostHeaderData(std::string ScriptBin)
     return result;
 }
 
+std::shared_ptr<NTP1Script_Transfer>
+NTP1Script_Transfer::ParseNTP1v1TransferPostHeaderBin(StringViewT ScriptBin, StringViewT OpCodeBin)
+{
+    std::shared_ptr<NTP1Script_Transfer> result = std::make_shared<NTP1Script_Transfer>();
+
+    result->metadata             = ParseMetadata(ScriptBin, OpCodeBin).to_string();
+    result->transferInstructions = ParseTransferInstructions(ScriptBin);
+
+    return result;
+}
+
+std::shared_ptr<NTP1Script_Transfer>
+NTP1Script_Transfer::ParseNTP1v3TransferPostHeaderBin(StringViewT ScriptBin)
+{
+    std::shared_ptr<NTP1Script_Transfer> result = std::make_shared<NTP1Script_Transfer>();
+
+    result->transferInstructions = ParseNTP1v3TransferInstructions(ScriptBin);
+    result->metadata             = ParseNTP1v3Metadata(ScriptBin).to_string();
+
+    if (ScriptBin.size() != 0) {
+        throw std::runtime_error("Garbage data after the metadata (unaccounted for in size).");
+    }
+
+    return result;
+}
+
 std::string NTP1Script_Transfer::calculateScriptBin() const
 {
     if (protocolVersion == 1) {
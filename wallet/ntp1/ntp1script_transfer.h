@@ -23,6 +23,9 @@ public:
     static std::shared_ptr<NTP1Script_Transfer> ParseNTP1v1TransferPostHeaderData(std::string ScriptBin,
                                                                                   std::string OpCodeBin);
     static std::shared_ptr<NTP1Script_Transfer> ParseNTP1v3TransferPostHeaderData(std::string ScriptBin);
+    static std::shared_ptr<NTP1Script_Transfer> ParseNTP1v1TransferPostHeaderBin(StringViewT ScriptBin,
+                                                                                 StringViewT OpCodeBin);
+    static std::shared_ptr<NTP1Script_Transfer> ParseNTP1v3TransferPostHeaderBin(StringViewT ScriptBin);
     static std::string                          Create_OpCodeFromMetadata(const std::string& metadata);
     static std::shared_ptr<NTP1Script_Transfer>
     CreateScript(const std::vector<NTP1Script::TransferInstruction>& transferInstructions,
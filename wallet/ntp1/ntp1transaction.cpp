@@ -199,20 +199,22 @@ std::unordered_map<std::string, TokenMinimalData>
 NTP1Transaction::CalculateTotalInputTokens(const NTP1Transaction& ntp1tx)
 {
     std::unordered_map<std::string, TokenMinimalData> result;
+    std::unordered_map<std::string, NTP1CheckedInt>   totals;
     for (const NTP1TxIn& in : ntp1tx.vin) {
         for (const NTP1TokenTxData& token : in.tokens) {
             const std::string& tokenId = token.getTokenId();
             if (result.find(tokenId) == result.end()) {
                 TokenMinimalData tokenData;
-                tokenData.amount    = token.getAmount();
                 tokenData.tokenId   = token.getTokenId();
                 tokenData.tokenName = token.getTokenSymbol();
                 result[tokenId]     = tokenData;
-            } else {
-                result[tokenId].amount += token.getAmount();
             }
+            totals[tokenId] += token.getAmount();
         }
     }
+    for (const auto& total : totals) {
+        result[total.first].amount = total.second.get();
+    }
     return result;
 }
 
@@ -220,20 +222,22 @@ std::unordered_map<std::string, TokenMinimalData>
 NTP1Transaction::CalculateTotalOutputTokens(const NTP1Transaction& ntp1tx)
 {
     std::unordered_map<std::string, TokenMinimalData> result;
+    std::unordered_map<std::string, NTP1CheckedInt>   totals;
     for (const NTP1TxOut& in : ntp1tx.vout) {
         for (const NTP1TokenTxData& token : in.tokens) {
             const std::string& tokenId = token.getTokenId();
             if (result.find(tokenId) == result.end()) {
                 TokenMinimalData tokenData;
-                tokenData.amount    = token.getAmount();
                 tokenData.tokenId   = token.getTokenId();
                 tokenData.tokenName = token.getTokenSymbol();
                 result[tokenId]     = tokenData;
-            } else {
-                result[tokenId].amount += token.getAmount();
             }
+            totals[tokenId] += token.getAmount();
         }
     }
+    for (const auto& total : totals) {
+        result[total.first].amount = total.second.get();
+    }
     return result;
 }
 
@@ -639,7 +643,7 @@ void NTP1Transaction::readNTP1DataFromTx(
                                      FormatMoney(feeProvided));
         }
 
-        NTP1Int totalAmountLeft = scriptPtrD->getAmount();
+        NTP1CheckedInt totalAmountLeft = scriptPtrD->getAmount();
         if (tx.vin.size() < 1) {
             throw std::runtime_error("Number of inputs is zero for transaction: " +
                                      tx.GetHash().ToString());
@@ -654,7 +658,7 @@ void NTP1Transaction::readNTP1DataFromTx(
                                          ::ToString(tx.vout.size()) + " in transaction " +
                                          tx.GetHash().ToString());
             }
-            NTP1Int currentAmount = instruction.amount;
+            NTP1CheckedInt currentAmount = instruction.amount;
 
             // ensure the output is larger than input
             if (totalAmountLeft < currentAmount) {
@@ -664,7 +668,7 @@ void NTP1Transaction::readNTP1DataFromTx(
             }
 
             totalAmountLeft -= currentAmount;
-            ntp1tokenTxData.setAmount(currentAmount);
+            ntp1tokenTxData.setAmount(currentAmount.get());
             ntp1tokenTxData.setAggregationPolicy(scriptPtrD->getAggregationPolicyStr());
             ntp1tokenTxData.setDivisibility(scriptPtrD->getDivisibility());
             ntp1tokenTxData.setTokenSymbol(scriptPtrD->getTokenSymbol());
@@ -680,7 +684,7 @@ void NTP1Transaction::readNTP1DataFromTx(
             if (vout.size() > 0) {
                 NTP1TokenTxData ntp1tokenTxData;
 
-                ntp1tokenTxData.setAmount(totalAmountLeft);
+                ntp1tokenTxData.setAmount(totalAmountLeft.get());
                 totalAmountLeft = 0;
                 ntp1tokenTxData.setAggregationPolicy(scriptPtrD->getAggregationPolicyStr());
                 ntp1tokenTxData.setDivisibility(scriptPtrD->getDivisibility());
@@ -1,6 +1,7 @@
 #ifndef NTP1TRANSACTION_H
 #define NTP1TRANSACTION_H
 
+#include "ntp1/ntp1checkedint.h"
 #include "ntp1/ntp1script.h"
 #include "ntp1/ntp1script_burn.h"
 #include "ntp1/ntp1script_issuance.h"
@@ -224,7 +225,7 @@ void NTP1Transaction::__TransferTokens(
     EnsureInputTokensRelateToTx(tx, inputsTxs);
 
     // calculate total tokens in inputs
-    std::vector<std::vector<NTP1Int>>         totalTokensLeftInInputs(tx.vin.size());
+    std::vector<std::vector<NTP1CheckedInt>>  totalTokensLeftInInputs(tx.vin.size());
     std::vector<std::vector<NTP1TokenTxData>> tokensKindsInInputs(tx.vin.size());
     for (unsigned i = 0; i < tx.vin.size(); i++) {
         const auto& n    = tx.vin[i].prevout.n;
@@ -253,8 +254,9 @@ void NTP1Transaction::__TransferTokens(
     if (totalTokensLeftInInputs.size() == 0) {
         invalid = true;
     } else {
-        NTP1Int totalTokensInInput0 = std::accumulate(totalTokensLeftInInputs[0].begin(),
-                                                      totalTokensLeftInInputs[0].end(), NTP1Int(0));
+        NTP1CheckedInt totalTokensInInput0 =
+            std::accumulate(totalTokensLeftInInputs[0].begin(), totalTokensLeftInInputs[0].end(),
+                            NTP1CheckedInt(0));
 
         invalid = !totalTokensInInput0;
     }
@@ -286,17 +288,17 @@ void NTP1Transaction::__TransferTokens(
 
         // loop over the kinds of tokens in the input and distribute them over outputs
         // note: there's no way to switch from one token to the next unless its content depletes
-        NTP1Int currentOutputAmount = TIs[i].amount;
+        NTP1CheckedInt currentOutputAmount = TIs[i].amount;
 
         //  token index at which to start subtraction, helps in skipping empty tokens when
         // subtracting spent amount
         int startTokenIndex = 0;
 
         // if input is empty, just move to the next one since empty inputs don't break adjacency
-        bool    stopInstructions = false;
-        NTP1Int totalTokensInCurrentInput =
+        bool           stopInstructions = false;
+        NTP1CheckedInt totalTokensInCurrentInput =
             std::accumulate(totalTokensLeftInInputs[currentInputIndex].begin(),
-                            totalTokensLeftInInputs[currentInputIndex].end(), NTP1Int(0));
+                            totalTokensLeftInInputs[currentInputIndex].end(), NTP1CheckedInt(0));
         while (totalTokensLeftInInputs[currentInputIndex].size() == 0 ||
                totalTokensInCurrentInput == 0) {
             currentInputIndex++;
@@ -306,7 +308,7 @@ void NTP1Transaction::__TransferTokens(
             }
             totalTokensInCurrentInput =
                 std::accumulate(totalTokensLeftInInputs[currentInputIndex].begin(),
-                                totalTokensLeftInInputs[currentInputIndex].end(), NTP1Int(0));
+                                totalTokensLeftInInputs[currentInputIndex].end(), NTP1CheckedInt(0));
         }
 
         if (stopInstructions) {
@@ -316,9 +318,9 @@ void NTP1Transaction::__TransferTokens(
         for (int j = 0; j < (int)totalTokensLeftInInputs[currentInputIndex].size(); j++) {
 
             // calculate the total number of available tokens for spending
-            NTP1Int     totalAdjacentTokensOfOneKind = 0;
-            std::string currentTokenId;
-            bool        inputDone = false;
+            NTP1CheckedInt totalAdjacentTokensOfOneKind = 0;
+            std::string    currentTokenId;
+            bool           inputDone = false;
             for (int k = currentInputIndex; k < (int)totalTokensLeftInInputs.size(); k++) {
                 // an empty input in between doesn't break adjacency
                 //                if (totalTokensLeftInInputs[k].size() == 0) {
@@ -379,13 +381,15 @@ void NTP1Transaction::__TransferTokens(
                     "; and OP_RETURN script: " + scriptPtrD->getParsedScriptHex());
             }
 
-            const auto&   currentTokenObj = tokensKindsInInputs[currentInputIndex][startTokenIndex];
-            const NTP1Int amountToCredit  = std::min(totalAdjacentTokensOfOneKind, currentOutputAmount);
+            const auto&          currentTokenObj =
+                tokensKindsInInputs[currentInputIndex][startTokenIndex];
+            const NTP1CheckedInt amountToCredit =
+                std::min(totalAdjacentTokensOfOneKind, currentOutputAmount);
 
             if (!burnThisOutput) {
                 // create the token object that will be added to the output
                 NTP1TokenTxData ntp1tokenTxData;
-                ntp1tokenTxData.setAmount(amountToCredit);
+                ntp1tokenTxData.setAmount(amountToCredit.get());
                 ntp1tokenTxData.setTokenId(currentTokenObj.getTokenId());
                 ntp1tokenTxData.setAggregationPolicy(currentTokenObj.getAggregationPolicy());
                 ntp1tokenTxData.setDivisibility(currentTokenObj.getDivisibility());
@@ -405,7 +409,7 @@ void NTP1Transaction::__TransferTokens(
             }
 
             // reduce the available balance from the array that tracks all available inputs
-            NTP1Int amountLeftToSubtract = amountToCredit;
+            NTP1CheckedInt amountLeftToSubtract = amountToCredit;
             for (int k = currentInputIndex; k < (int)totalTokensLeftInInputs.size(); k++) {
                 // an empty input in between means inputs are not adjacent
                 for (int l = (k == currentInputIndex ? startTokenIndex : 0);
@@ -443,9 +447,9 @@ void NTP1Transaction::__TransferTokens(
                 currentInputIndex++;
             }
 
-            NTP1Int totalTokensLeftInCurrentInput =
+            NTP1CheckedInt totalTokensLeftInCurrentInput =
                 std::accumulate(totalTokensLeftInInputs[currentInputIndex].begin(),
-                                totalTokensLeftInInputs[currentInputIndex].end(), NTP1Int(0));
+                                totalTokensLeftInInputs[currentInputIndex].end(), NTP1CheckedInt(0));
             if (totalTokensLeftInCurrentInput == 0) {
                 // avoid incrementing twice
                 if (!TIs[i].skipInput) {
@@ -466,12 +470,12 @@ void NTP1Transaction::__TransferTokens(
                 continue;
             }
 
-            const auto& currentTokenObj = tokensKindsInInputs[i][j];
-            NTP1Int     amountToCredit  = totalTokensLeftInInputs[i][j];
+            const auto&    currentTokenObj = tokensKindsInInputs[i][j];
+            NTP1CheckedInt amountToCredit  = totalTokensLeftInInputs[i][j];
 
             // create the token object that will be added to the output
             NTP1TokenTxData ntp1tokenTxData;
-            ntp1tokenTxData.setAmount(amountToCredit);
+            ntp1tokenTxData.setAmount(amountToCredit.get());
             ntp1tokenTxData.setTokenId(currentTokenObj.getTokenId());
             ntp1tokenTxData.setAggregationPolicy(currentTokenObj.getAggregationPolicy());
             ntp1tokenTxData.setDivisibility(currentTokenObj.getDivisibility());
@@ -490,7 +494,8 @@ void NTP1Transaction::__TransferTokens(
             if (ntp1tokenTxData.getAggregationPolicy() ==
                 NTP1Script::IssuanceFlags::AggregationPolicy_Aggregatable_Str) {
                 // aggregate coins from next inputs
-                bool stopLooping = false;
+                NTP1CheckedInt aggregatedAmount = ntp1tokenTxData.getAmount();
+                bool           stopLooping      = false;
                 for (int k = i; k < (int)totalTokensLeftInInputs.size(); k++) {
                     for (int l = (k == i ? j : 0); l < (int)totalTokensLeftInInputs[k].size(); l++) {
                         if (k == i && l == j) {
@@ -503,7 +508,7 @@ void NTP1Transaction::__TransferTokens(
                         }
                         amountToCredit                = totalTokensLeftInInputs[k][l];
                         totalTokensLeftInInputs[k][l] = 0;
-                        ntp1tokenTxData.setAmount(ntp1tokenTxData.getAmount() + amountToCredit);
+                        aggregatedAmount += amountToCredit;
                     }
 
                     // stop the outer loop
@@ -511,6 +516,7 @@ void NTP1Transaction::__TransferTokens(
                         break;
                     }
                 }
+                ntp1tokenTxData.setAmount(aggregatedAmount.get());
             }
 
             // add the token to the last output
@@ -0,0 +1,155 @@
+#include "ntp1walletcache.h"
+
+#include "main.h"
+#include "ntp1/ntp1checkedint.h"
+#include "ntp1/ntp1transaction.h"
+#include "wallet.h"
+
+NTP1WalletCache::NTP1WalletCache(TxDecoder decoder) : decodeTx(std::move(decoder)) {}
+
+boost::optional<NTP1Transaction> NTP1WalletCache::DecodeTx(const CTransaction& tx)
+{
+    // NTP1 transactions strictly contain OP_RETURN in one of their vouts
+    if (!NTP1Transaction::IsTxNTP1(&tx))
+        return boost::none;
+
+    std::vector<std::pair<CTransaction, NTP1Transaction>> prevTxs =
+        NTP1Transaction::GetAllNTP1InputsOfTx(tx, true);
+    NTP1Transaction ntp1tx;
+    ntp1tx.readNTP1DataFromTx(tx, prevTxs);
+    return ntp1tx;
+}
+
+void NTP1WalletCache::TransactionChanged(const CWalletTx& wtx)
+{
+    const uint256 hash = wtx.GetHash();
+    if (!decodedTxs.count(hash))
+        pendingTxs.insert(hash);
+
+    // the outputs this transaction spends may be spendable again
+    for (const CTxIn& txin : wtx.vin) {
+        auto it = spentOutputs.find(txin.prevout);
+        if (it != spentOutputs.end()) {
+            unspentOutputs.insert(*it);
+            spentOutputs.erase(it);
+        }
+    }
+}
+
+void NTP1WalletCache::TransactionErased(const uint256& hash)
+{
+    pendingTxs.erase(hash);
+    decodedTxs.erase(hash);
+    for (TokenOutputsMap* outputs : {&unspentOutputs, &spentOutputs}) {
+        auto it = outputs->lower_bound(COutPoint(hash, 0));
+        while (it != outputs->end() && it->first.hash == hash) {
+            it = outputs->erase(it);
+        }
+    }
+}
+
+void NTP1WalletCache::ProcessPendingTxs(const CWallet& wallet)
+{
+    AssertLockHeld(wallet.cs_wallet);
+
+    if (!fInitialized) {
+        // transactions loaded from the wallet file don't go through AddToWallet()
+        for (const auto& item : wallet.mapWallet) {
+            if (!decodedTxs.count(item.first))
+                pendingTxs.insert(item.first);
+        }
+        fInitialized = true;
+    }
+
+    for (auto it = pendingTxs.begin(); it != pendingTxs.end();) {
+        const uint256& hash = *it;
+        const auto     wit  = wallet.mapWallet.find(hash);
+        if (wit == wallet.mapWallet.end()) {
+            it = pendingTxs.erase(it);
+            continue;
+        }
+        const CWalletTx& wtx = wit->second;
+
+        boost::optional<NTP1Transaction> decoded;
+        try {
+            decoded = decodeTx(wtx);
+        } catch (std::exception& ex) {
+            printf("NTP1WalletCache: Failed to decode wallet transaction %s, will retry. Error says: "
+                   "%s\n",
+                   hash.ToString().c_str(), ex.what());
+            ++it;
+            continue;
+        }
+        if (!decoded) {
+            decodedTxs.insert(hash);
+            it = pendingTxs.erase(it);
+            continue;
+        }
+
+        for (unsigned int i = 0; i < decoded->getTxOutCount(); i++) {
+            const NTP1TxOut& txout = decoded->getTxOut(i);
+            if (txout.tokenCount() == 0)
+                continue;
+            std::vector<NTP1TokenTxData> tokens;
+            tokens.reserve(txout.tokenCount());
+            for (unsigned int j = 0; j < txout.tokenCount(); j++) {
+                const NTP1TokenTxData& token   = txout.getToken(j);
+                tokenNames[token.getTokenId()] = token.getTokenSymbol();
+                tokens.push_back(token);
+            }
+            unspentOutputs[COutPoint(hash, i)] = std::move(tokens);
+        }
+
+        decodedTxs.insert(hash);
+        it = pendingTxs.erase(it);
+    }
+}
+
+std::map<std::string, NTP1Int> NTP1WalletCache::GetBalances(const CWallet& wallet, int nMinDepth)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(wallet.cs_wallet);
+
+    ProcessPendingTxs(wallet);
+
+    std::map<std::string, NTP1CheckedInt> totals;
+    for (auto it = unspentOutputs.begin(); it != unspentOutputs.end();) {
+        const COutPoint& output = it->first;
+        const auto       wit    = wallet.mapWallet.find(output.hash);
+        if (wit == wallet.mapWallet.end()) {
+            it = unspentOutputs.erase(it);
+            continue;
+        }
+        if (wallet.IsSpent(output.hash, output.n)) {
+            spentOutputs.insert(*it);
+            it = unspentOutputs.erase(it);
+            continue;
+        }
+
+        const CWalletTx& wtx    = wit->second;
+        int              nDepth = 0;
+        if (wallet.IsAvailableCoinTx(wtx, true, nDepth) && nDepth >= nMinDepth &&
+            output.n < wtx.vout.size() && wallet.IsAvailableCoinOutput(wtx, output.n)) {
+            for (const NTP1TokenTxData& token : it->second) {
+                totals[token.getTokenId()] += token.getAmount();
+            }
+        }
+        ++it;
+    }
+
+    std::map<std::string, NTP1Int> balances;
+    for (const auto& total : totals) {
+        balances.insert(balances.end(), std::make_pair(total.first, total.second.get()));
+    }
+    return balances;
+}
+
+std::string NTP1WalletCache::GetTokenName(const std::string& tokenId) const
+{
+    const auto it = tokenNames.find(tokenId);
+    if (it == tokenNames.end())
+        return std::string("<NameError>");
+    return it->second;
+}
+
+std::size_t NTP1WalletCache::GetPendingTxsCount() const { return pendingTxs.size(); }
@@ -0,0 +1,77 @@
+#ifndef NTP1WALLETCACHE_H
+#define NTP1WALLETCACHE_H
+
+#include "ntp1/ntp1tokentxdata.h"
+#include "ntp1/ntp1transaction.h"
+#include "outpoint.h"
+#include "uint256.h"
+
+#include <boost/optional.hpp>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class CWallet;
+class CWalletTx;
+
+/**
+ * The token-carrying outputs of a wallet, decoded once per wallet transaction and kept for the lifetime
+ * of the wallet, so that balance queries don't have to decode every available output of the wallet
+ * again.
+ *
+ * The wallet reports every transaction that is added or changes state (conflicts, abandonment), new
+ * transactions are decoded lazily on the next query. Outputs found spent are set aside and are only
+ * checked again when one of the transactions spending them changes state. Depth, maturity and mempool
+ * state change without wallet events, so those are still checked per query, but only for unspent
+ * token outputs.
+ *
+ * All methods have to be called with the wallet's cs_wallet held.
+ */
+class NTP1WalletCache
+{
+public:
+    /** Returns the decoded tokens of a wallet transaction, or boost::none if it isn't an NTP1
+     * transaction; throws if it can't be decoded now, in which case it's retried on the next query */
+    using TxDecoder = std::function<boost::optional<NTP1Transaction>(const CTransaction&)>;
+
+private:
+    using TokenOutputsMap = std::map<COutPoint, std::vector<NTP1TokenTxData>>;
+
+    // whether the transactions the wallet had when it was loaded were queued for decoding
+    bool fInitialized = false;
+    // wallet transactions that haven't been decoded yet, or failed to decode and will be retried
+    std::set<uint256> pendingTxs;
+    // wallet transactions that were decoded, whether they turned out to be NTP1 or not
+    std::set<uint256> decodedTxs;
+    // outputs with tokens that weren't spent the last time they were checked
+    TokenOutputsMap unspentOutputs;
+    // outputs with tokens that were found to be spent
+    TokenOutputsMap spentOutputs;
+    // token id vs token symbol
+    std::map<std::string, std::string> tokenNames;
+
+    TxDecoder decodeTx;
+
+    void ProcessPendingTxs(const CWallet& wallet);
+
+public:
+    explicit NTP1WalletCache(TxDecoder decoder = DecodeTx);
+
+    /** Decodes a transaction with its NTP1 inputs fetched from the blockchain */
+    static boost::optional<NTP1Transaction> DecodeTx(const CTransaction& tx);
+
+    void TransactionChanged(const CWalletTx& wtx);
+    void TransactionErased(const uint256& hash);
+
+    /** Balances of the available (as in CWallet::AvailableCoins()) token outputs with at least
+     * nMinDepth confirmations; requires cs_main as well */
+    std::map<std::string, NTP1Int> GetBalances(const CWallet& wallet, int nMinDepth);
+
+    std::string GetTokenName(const std::string& tokenId) const;
+
+    std::size_t GetPendingTxsCount() const;
+};
+
+#endif // NTP1WALLETCACHE_H
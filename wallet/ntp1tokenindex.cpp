@@ -0,0 +1,214 @@
+#include "ntp1tokenindex.h"
+
+#include "block.h"
+#include "globals.h"
+#include "ntp1/ntp1transaction.h"
+#include "optionalindex.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <memory>
+
+bool fNTP1TokenIndex = false;
+
+void AddNTP1TxOutToTokenIndexDelta(NTP1TokenIndexDelta& delta, const NTP1TxOut& output, bool fSpent)
+{
+    const std::string address = output.getAddress();
+    if (address.empty()) {
+        return;
+    }
+    for (unsigned long i = 0; i < output.tokenCount(); i++) {
+        const NTP1TokenTxData& token  = output.getToken(i);
+        NTP1Int&               change = delta[std::make_pair(address, token.getTokenId())];
+        if (fSpent) {
+            change -= token.getAmount();
+        } else {
+            change += token.getAmount();
+        }
+    }
+}
+
+/** reads an NTP1 transaction once per block; ntp1tx is nullptr if the transaction isn't NTP1 */
+static bool FetchNTP1TxForTokenIndex(const ITxDB& txdb, const uint256& hash,
+                                     std::map<uint256, std::unique_ptr<NTP1Transaction>>& cache,
+                                     const NTP1Transaction*&                                 ntp1tx)
+{
+    auto it = cache.find(hash);
+    if (it == cache.end()) {
+        std::unique_ptr<NTP1Transaction> fetched;
+        if (txdb.ContainsNTP1Tx(hash)) {
+            fetched.reset(new NTP1Transaction);
+            if (!txdb.ReadNTP1Tx(hash, *fetched)) {
+                return error("Failed to read NTP1 transaction %s for the NTP1 token index",
+                             hash.ToString().c_str());
+            }
+        }
+        it = cache.insert(std::make_pair(hash, std::move(fetched))).first;
+    }
+    ntp1tx = it->second.get();
+    return true;
+}
+
+bool GetNTP1TokenIndexDelta(const CBlock& block, const ITxDB& txdb, NTP1TokenIndexDelta& delta)
+{
+    std::map<uint256, std::unique_ptr<NTP1Transaction>> cache;
+
+    for (const CTransaction& tx : block.vtx) {
+        const NTP1Transaction* ntp1tx = nullptr;
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn& txin : tx.vin) {
+                if (!FetchNTP1TxForTokenIndex(txdb, txin.prevout.hash, cache, ntp1tx)) {
+                    return false;
+                }
+                if (!ntp1tx) {
+                    continue;
+                }
+                if (txin.prevout.n >= ntp1tx->getTxOutCount()) {
+                    return error("GetNTP1TokenIndexDelta(): prevout %s is out of range",
+                                 txin.prevout.ToString().c_str());
+                }
+                AddNTP1TxOutToTokenIndexDelta(delta, ntp1tx->getTxOut(txin.prevout.n), true);
+            }
+        }
+
+        if (!FetchNTP1TxForTokenIndex(txdb, tx.GetHash(), cache, ntp1tx)) {
+            return false;
+        }
+        if (ntp1tx) {
+            for (unsigned long i = 0; i < ntp1tx->getTxOutCount(); i++) {
+                AddNTP1TxOutToTokenIndexDelta(delta, ntp1tx->getTxOut(i), false);
+            }
+        }
+    }
+    return true;
+}
+
+bool ApplyNTP1TokenIndexDelta(CTxDB& txdb, const NTP1TokenIndexDelta& delta, bool fUndo)
+{
+    // token id vs the change of its supply and number of holders
+    std::map<std::string, std::pair<NTP1Int, int64_t>> statsChanges;
+
+    // the delta is sorted by address, so all the tokens of an address are updated together
+    auto it = delta.cbegin();
+    while (it != delta.cend()) {
+        const std::string              address = it->first.first;
+        std::map<std::string, NTP1Int> balances;
+        if (!txdb.ReadNTP1AddressBalances(address, balances)) {
+            return error("Failed to read NTP1 token balances of address %s", address.c_str());
+        }
+        const bool fExisted = !balances.empty();
+
+        for (; it != delta.cend() && it->first.first == address; ++it) {
+            const std::string& tokenId = it->first.second;
+            const NTP1Int      change  = (fUndo ? NTP1Int(-it->second) : it->second);
+            if (change.is_zero()) {
+                continue;
+            }
+
+            const NTP1Int oldBalance = balances[tokenId];
+            const NTP1Int newBalance = oldBalance + change;
+            if (newBalance < 0) {
+                return error("NTP1 token index is inconsistent: the balance of token %s at address %s "
+                             "would be %s",
+                             tokenId.c_str(), address.c_str(), ToString(newBalance).c_str());
+            }
+
+            std::pair<NTP1Int, int64_t>& stats = statsChanges[tokenId];
+            stats.first += change;
+            if (oldBalance.is_zero()) {
+                stats.second++;
+                if (!txdb.AddNTP1TokenHolder(tokenId, address)) {
+                    return error("Failed to add holder %s of NTP1 token %s", address.c_str(),
+                                 tokenId.c_str());
+                }
+            } else if (newBalance.is_zero()) {
+                stats.second--;
+                if (!txdb.EraseNTP1TokenHolder(tokenId, address)) {
+                    return error("Failed to remove holder %s of NTP1 token %s", address.c_str(),
+                                 tokenId.c_str());
+                }
+            }
+
+            if (newBalance.is_zero()) {
+                balances.erase(tokenId);
+            } else {
+                balances[tokenId] = newBalance;
+            }
+        }
+
+        if (!balances.empty()) {
+            if (!txdb.WriteNTP1AddressBalances(address, balances)) {
+                return error("Failed to write NTP1 token balances of address %s", address.c_str());
+            }
+        } else if (fExisted) {
+            if (!txdb.EraseNTP1AddressBalances(address)) {
+                return error("Failed to erase NTP1 token balances of address %s", address.c_str());
+            }
+        }
+    }
+
+    for (const auto& change : statsChanges) {
+        const std::string&  tokenId = change.first;
+        NTP1TokenIndexStats stats;
+        if (!txdb.ReadNTP1TokenIndexStats(tokenId, stats)) {
+            return error("Failed to read NTP1 token index stats of token %s", tokenId.c_str());
+        }
+        const bool fExisted = !stats.supply.is_zero();
+
+        stats.supply += change.second.first;
+        const int64_t holders = static_cast<int64_t>(stats.holders) + change.second.second;
+        if (stats.supply < 0 || holders < 0) {
+            return error("NTP1 token index is inconsistent: the supply of token %s would be %s with "
+                         "%" PRId64 " holders",
+                         tokenId.c_str(), ToString(stats.supply).c_str(), holders);
+        }
+        stats.holders = static_cast<uint64_t>(holders);
+
+        if (!stats.supply.is_zero()) {
+            if (!txdb.WriteNTP1TokenIndexStats(tokenId, stats)) {
+                return error("Failed to write NTP1 token index stats of token %s", tokenId.c_str());
+            }
+        } else if (fExisted) {
+            if (!txdb.EraseNTP1TokenIndexStats(tokenId)) {
+                return error("Failed to erase NTP1 token index stats of token %s", tokenId.c_str());
+            }
+        }
+    }
+    return true;
+}
+
+namespace {
+class CNTP1TokenIndex : public COptionalIndex
+{
+public:
+    CNTP1TokenIndex()
+        : COptionalIndex("NTP1 token index",
+                         {{"NTP1 token index", &fNTP1TokenIndex, &CTxDB::IsNTP1TokenIndexComplete,
+                           &CTxDB::WriteNTP1TokenIndexComplete, &CTxDB::ClearNTP1TokenIndex}})
+    {
+    }
+
+protected:
+    bool ApplyBlock(const CBlock& block, int /*nHeight*/, CTxDB& txdb, bool fUndo,
+                    unsigned int /*partsMask*/) const override
+    {
+        NTP1TokenIndexDelta delta;
+        return GetNTP1TokenIndexDelta(block, txdb, delta) &&
+               ApplyNTP1TokenIndexDelta(txdb, delta, fUndo);
+    }
+};
+
+const CNTP1TokenIndex ntp1TokenIndex;
+} // namespace
+
+bool ConnectBlockNTP1TokenIndex(const CBlock& block, int nHeight, CTxDB& txdb)
+{
+    return ntp1TokenIndex.UpdateWithBlock(block, nHeight, txdb, false);
+}
+
+bool DisconnectBlockNTP1TokenIndex(const CBlock& block, int nHeight, CTxDB& txdb)
+{
+    return ntp1TokenIndex.UpdateWithBlock(block, nHeight, txdb, true);
+}
+
+bool InitNTP1TokenIndex() { return ntp1TokenIndex.Init(); }
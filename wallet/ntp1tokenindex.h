@@ -0,0 +1,63 @@
+#ifndef NTP1TOKENINDEX_H
+#define NTP1TOKENINDEX_H
+
+#include "ntp1/ntp1script.h"
+#include "serialize.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+class CBlock;
+class CTxDB;
+class ITxDB;
+class NTP1TxOut;
+
+/**
+ * The optional (-ntp1index) chain-wide NTP1 token index. It keeps, in the txdb:
+ *   - per address: the balance of every token it holds
+ *   - per token:   the total supply in unspent outputs and the number of addresses holding it
+ *   - per token:   the list of addresses holding it
+ *
+ * It's maintained and built like the other optional indexes (see optionalindex.h). Balance changes are
+ * computed from the NTP1 data already in the db: tokens in the outputs a block spends are subtracted
+ * from their addresses and tokens in the NTP1 outputs it creates are added, so burns and tokens lost by
+ * spending them in non-NTP1 transactions reduce the supply. Tokens in outputs without an address
+ * (non-standard scripts) aren't indexed.
+ */
+
+class NTP1TokenIndexStats
+{
+public:
+    NTP1Int  supply  = 0;
+    uint64_t holders = 0;
+
+    // clang-format off
+    IMPLEMENT_SERIALIZE(
+                        READWRITE(supply);
+                        READWRITE(holders);
+                       )
+    // clang-format on
+};
+
+/** changes of balances, keyed by address and token id */
+using NTP1TokenIndexDelta = std::map<std::pair<std::string, std::string>, NTP1Int>;
+
+/** whether the index is maintained (-ntp1index); set on startup */
+extern bool fNTP1TokenIndex;
+
+/** Adds the tokens of an output to the delta, or subtracts them if fSpent */
+void AddNTP1TxOutToTokenIndexDelta(NTP1TokenIndexDelta& delta, const NTP1TxOut& output, bool fSpent);
+
+/** Collects the balance changes of a block; its NTP1 transactions must already be written to the db */
+bool GetNTP1TokenIndexDelta(const CBlock& block, const ITxDB& txdb, NTP1TokenIndexDelta& delta);
+
+/** Applies the changes to the index tables, or reverts them if fUndo */
+bool ApplyNTP1TokenIndexDelta(CTxDB& txdb, const NTP1TokenIndexDelta& delta, bool fUndo);
+
+/** The index as an optional index; see optionalindex.h */
+bool ConnectBlockNTP1TokenIndex(const CBlock& block, int nHeight, CTxDB& txdb);
+bool DisconnectBlockNTP1TokenIndex(const CBlock& block, int nHeight, CTxDB& txdb);
+bool InitNTP1TokenIndex();
+
+#endif // NTP1TOKENINDEX_H
@@ -0,0 +1,122 @@
+#include "optionalindex.h"
+
+#include "block.h"
+#include "blockarena.h"
+#include "globals.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "util.h"
+
+// number of blocks applied per db transaction when an index is built from the main chain
+static const int OPTIONAL_INDEX_BUILD_BATCH = 500;
+
+COptionalIndex::COptionalIndex(const std::string& nameIn, const std::vector<Part>& partsIn)
+    : name(nameIn), parts(partsIn)
+{
+}
+
+bool COptionalIndex::WriteComplete(CTxDB& txdb, unsigned int partsMask, bool fComplete) const
+{
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        if (HasPart(partsMask, i) && !(txdb.*parts[i].writeComplete)(fComplete)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool COptionalIndex::UpdateWithBlock(const CBlock& block, int nHeight, CTxDB& txdb, bool fUndo) const
+{
+    unsigned int partsMask = 0;
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        if (*parts[i].pfEnabled && (txdb.*parts[i].isComplete)()) {
+            partsMask |= 1u << i;
+        }
+    }
+    if (partsMask == 0) {
+        return true;
+    }
+
+    if (ApplyBlock(block, nHeight, txdb, fUndo, partsMask)) {
+        return true;
+    }
+
+    printf("Error: Failed to update the %s with block %s; it will be rebuilt on the next start\n",
+           name.c_str(), block.GetHash().ToString().c_str());
+    return WriteComplete(txdb, partsMask, false);
+}
+
+bool COptionalIndex::Init() const
+{
+    CTxDB txdb;
+
+    unsigned int partsMask = 0;
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        const Part& part = parts[i];
+        if (*part.pfEnabled) {
+            if (!(txdb.*part.isComplete)()) {
+                partsMask |= 1u << i;
+            }
+        } else if ((txdb.*part.isComplete)()) {
+            printf("The %s is disabled; removing it\n", part.name);
+            if (!(txdb.*part.clear)()) {
+                return error("Failed to remove the %s", part.name);
+            }
+        }
+    }
+    if (partsMask == 0) {
+        return true;
+    }
+
+    LOCK(cs_main);
+
+    const int64_t nStart  = GetTimeMillis();
+    const int     nHeight = chainActive.Height();
+    printf("Building the %s from %d blocks...\n", name.c_str(), nHeight + 1);
+    uiInterface.InitMessage(strprintf(_("Building %s..."), name.c_str()));
+
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        if (HasPart(partsMask, i) && !(txdb.*parts[i].clear)()) {
+            return error("Failed to clear the %s", parts[i].name);
+        }
+    }
+
+    CBlockArena blockArena;
+    for (int nBatchStart = 0; nBatchStart <= nHeight; nBatchStart += OPTIONAL_INDEX_BUILD_BATCH) {
+        if (fRequestShutdown) {
+            // whatever was built is discarded on the next start
+            return false;
+        }
+
+        const int nBatchEnd = std::min(nBatchStart + OPTIONAL_INDEX_BUILD_BATCH - 1, nHeight);
+        if (!txdb.TxnBegin()) {
+            return error("Failed to begin a db transaction to build the %s", name.c_str());
+        }
+        for (int h = nBatchStart; h <= nBatchEnd; h++) {
+            if (!blockArena.ReadFromDisk(chainActive[h], txdb)) {
+                txdb.TxnAbort();
+                return error("Failed to read block at height %d to build the %s", h, name.c_str());
+            }
+            const CBlock& block = blockArena.GetBlock();
+            if (!ApplyBlock(block, h, txdb, false, partsMask)) {
+                txdb.TxnAbort();
+                return error("Failed to add block %s to the %s", block.GetHash().ToString().c_str(),
+                             name.c_str());
+            }
+        }
+        if (nBatchEnd == nHeight && !WriteComplete(txdb, partsMask, true)) {
+            txdb.TxnAbort();
+            return error("Failed to mark the %s as complete", name.c_str());
+        }
+        txdb.TxnCommit();
+
+        uiInterface.InitMessage(
+            strprintf(_("Building %s... (%d/%d)"), name.c_str(), nBatchEnd, nHeight));
+    }
+    if (nHeight < 0 && !WriteComplete(txdb, partsMask, true)) {
+        return error("Failed to mark the %s as complete", name.c_str());
+    }
+
+    printf("Built the %s in %" PRId64 "ms\n", name.c_str(), GetTimeMillis() - nStart);
+    return true;
+}
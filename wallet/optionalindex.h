@@ -0,0 +1,62 @@
+#ifndef OPTIONALINDEX_H
+#define OPTIONALINDEX_H
+
+#include <string>
+#include <vector>
+
+class CBlock;
+class CTxDB;
+
+/**
+ * The optional indexes (the NTP1 token index, the address and spent indexes and the block filter index)
+ * are tables in the txdb that are updated with the main chain in ConnectBlock/DisconnectBlock, within
+ * the same db transaction. An index is only valid if it was maintained since the genesis block, which
+ * a flag in the txdb records, so on startup an enabled index without the flag is built from the main
+ * chain, and a disabled one is removed, as it would be stale if it were enabled again.
+ *
+ * The indexes aren't part of consensus, so a block isn't rejected when an index fails to be updated
+ * with it; the flag of the index is cleared instead, so that it isn't used anymore and is rebuilt on
+ * the next start.
+ *
+ * An index can have parts with their own option and flag that are built in the same pass, like the
+ * address and the spent index. Subclasses only implement how a block changes the index.
+ */
+class COptionalIndex
+{
+public:
+    struct Part
+    {
+        const char* name; // for messages, e.g. "spent index"
+        const bool* pfEnabled;
+        bool (CTxDB::*isComplete)() const;
+        bool (CTxDB::*writeComplete)(bool);
+        bool (CTxDB::*clear)();
+    };
+
+    COptionalIndex(const std::string& nameIn, const std::vector<Part>& partsIn);
+    virtual ~COptionalIndex() = default;
+
+    /** Called by ConnectBlock/DisconnectBlock; a no-op for the parts that are disabled or not built yet */
+    bool UpdateWithBlock(const CBlock& block, int nHeight, CTxDB& txdb, bool fUndo) const;
+
+    /**
+     * Builds the parts that are enabled but haven't been maintained so far from the main chain, and
+     * drops the disabled ones. Must be called after the block index is loaded.
+     */
+    bool Init() const;
+
+protected:
+    /** Applies a block of the main chain to the parts of the index in partsMask, or reverts it if fUndo */
+    virtual bool ApplyBlock(const CBlock& block, int nHeight, CTxDB& txdb, bool fUndo,
+                            unsigned int partsMask) const = 0;
+
+    static bool HasPart(unsigned int partsMask, unsigned int part) { return partsMask & (1u << part); }
+
+private:
+    const std::string       name; // e.g. "address/spent index"
+    const std::vector<Part> parts;
+
+    bool WriteComplete(CTxDB& txdb, unsigned int partsMask, bool fComplete) const;
+};
+
+#endif // OPTIONALINDEX_H
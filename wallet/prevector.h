@@ -0,0 +1,360 @@
+#ifndef PREVECTOR_H
+#define PREVECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A vector of trivially copyable elements that keeps up to N of them inline, in the object itself,
+ * and only allocates on the heap when it grows beyond that. It's meant for the many small containers
+ * that are allocated and copied all the time, like scripts, where one heap allocation per object is
+ * most of the cost of deserializing or copying the objects holding them.
+ *
+ * The interface is the subset of std::vector's used by the code base, with pointers as iterators.
+ * Elements are compared lexicographically, like std::vector's, so containers of prevectors are
+ * ordered the same way they were when they held vectors.
+ *
+ * The size is a Size, so a prevector holds at most 2^32 - N - 2 elements by default.
+ */
+template <unsigned int N, typename T, typename Size = uint32_t, typename Diff = int32_t>
+class prevector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "prevector only holds trivially copyable types");
+
+public:
+    typedef Size      size_type;
+    typedef Diff      difference_type;
+    typedef T         value_type;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T*        iterator;
+    typedef const T*  const_iterator;
+    typedef std::reverse_iterator<iterator>       reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+#pragma pack(push, 1)
+    union direct_or_indirect
+    {
+        char direct[sizeof(T) * N];
+        struct
+        {
+            char*     indirect;
+            size_type capacity;
+        } indirect_contents;
+    };
+#pragma pack(pop)
+    alignas(char*) direct_or_indirect _union = {};
+
+    // the size if the elements are inline (_size <= N), otherwise the size + N + 1
+    size_type _size = 0;
+
+    T*       direct_ptr(difference_type pos) { return reinterpret_cast<T*>(_union.direct) + pos; }
+    const T* direct_ptr(difference_type pos) const
+    {
+        return reinterpret_cast<const T*>(_union.direct) + pos;
+    }
+    T* indirect_ptr(difference_type pos)
+    {
+        return reinterpret_cast<T*>(_union.indirect_contents.indirect) + pos;
+    }
+    const T* indirect_ptr(difference_type pos) const
+    {
+        return reinterpret_cast<const T*>(_union.indirect_contents.indirect) + pos;
+    }
+    bool is_direct() const { return _size <= N; }
+
+    T*       item_ptr(difference_type pos) { return is_direct() ? direct_ptr(pos) : indirect_ptr(pos); }
+    const T* item_ptr(difference_type pos) const
+    {
+        return is_direct() ? direct_ptr(pos) : indirect_ptr(pos);
+    }
+
+    // the heap buffer comes from operator new, like std::vector's, so it's accounted for the same way
+    void change_capacity(size_type new_capacity)
+    {
+        if (new_capacity <= N) {
+            if (!is_direct()) {
+                char* indirect = _union.indirect_contents.indirect;
+                std::memcpy(_union.direct, indirect, size() * sizeof(T));
+                ::operator delete(indirect);
+                _size -= N + 1;
+            }
+            return;
+        }
+        char* new_indirect = static_cast<char*>(::operator new(sizeof(T) * new_capacity));
+        std::memcpy(new_indirect, item_ptr(0), size() * sizeof(T));
+        if (!is_direct()) {
+            ::operator delete(_union.indirect_contents.indirect);
+        } else {
+            _size += N + 1;
+        }
+        _union.indirect_contents.indirect = new_indirect;
+        _union.indirect_contents.capacity = new_capacity;
+    }
+
+    /** grows the capacity to at least new_size, with some headroom for the next insertions */
+    void grow_for(size_type new_size)
+    {
+        if (capacity() < new_size) {
+            change_capacity(new_size + (new_size >> 1));
+        }
+    }
+
+    template <typename InputIterator>
+    static void fill(T* dst, InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first, ++dst) {
+            new (static_cast<void*>(dst)) T(*first);
+        }
+    }
+
+    template <typename InputIterator>
+    using EnableIfIterator =
+        typename std::enable_if<!std::is_integral<InputIterator>::value, InputIterator>::type;
+
+public:
+    prevector() = default;
+
+    explicit prevector(size_type n) { resize(n); }
+
+    prevector(size_type n, const T& val)
+    {
+        change_capacity(n);
+        _size += n;
+        std::fill_n(item_ptr(0), n, val);
+    }
+
+    template <typename InputIterator, typename = EnableIfIterator<InputIterator>>
+    prevector(InputIterator first, InputIterator last)
+    {
+        const size_type n = static_cast<size_type>(std::distance(first, last));
+        change_capacity(n);
+        _size += n;
+        fill(item_ptr(0), first, last);
+    }
+
+    prevector(const prevector& other)
+    {
+        const size_type n = other.size();
+        change_capacity(n);
+        _size += n;
+        std::memcpy(item_ptr(0), other.item_ptr(0), n * sizeof(T));
+    }
+
+    prevector(prevector&& other) noexcept : _union(other._union), _size(other._size)
+    {
+        // the heap buffer, if any, now belongs to this one
+        other._size = 0;
+    }
+
+    ~prevector()
+    {
+        if (!is_direct()) {
+            ::operator delete(_union.indirect_contents.indirect);
+        }
+    }
+
+    prevector& operator=(const prevector& other)
+    {
+        if (&other != this) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    prevector& operator=(prevector&& other) noexcept
+    {
+        if (&other != this) {
+            if (!is_direct()) {
+                ::operator delete(_union.indirect_contents.indirect);
+            }
+            _union      = other._union;
+            _size       = other._size;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+    void assign(size_type n, const T& val)
+    {
+        clear();
+        if (capacity() < n) {
+            change_capacity(n);
+        }
+        _size += n;
+        std::fill_n(item_ptr(0), n, val);
+    }
+
+    template <typename InputIterator, typename = EnableIfIterator<InputIterator>>
+    void assign(InputIterator first, InputIterator last)
+    {
+        const size_type n = static_cast<size_type>(std::distance(first, last));
+        clear();
+        if (capacity() < n) {
+            change_capacity(n);
+        }
+        _size += n;
+        fill(item_ptr(0), first, last);
+    }
+
+    size_type size() const { return is_direct() ? _size : _size - N - 1; }
+    bool      empty() const { return size() == 0; }
+    size_type capacity() const { return is_direct() ? N : _union.indirect_contents.capacity; }
+
+    iterator               begin() { return item_ptr(0); }
+    const_iterator         begin() const { return item_ptr(0); }
+    iterator               end() { return item_ptr(size()); }
+    const_iterator         end() const { return item_ptr(size()); }
+    const_iterator         cbegin() const { return item_ptr(0); }
+    const_iterator         cend() const { return item_ptr(size()); }
+    reverse_iterator       rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator       rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    T&       operator[](size_type pos) { return *item_ptr(pos); }
+    const T& operator[](size_type pos) const { return *item_ptr(pos); }
+    T*       data() { return item_ptr(0); }
+    const T* data() const { return item_ptr(0); }
+    T&       front() { return *item_ptr(0); }
+    const T& front() const { return *item_ptr(0); }
+    T&       back() { return *item_ptr(size() - 1); }
+    const T& back() const { return *item_ptr(size() - 1); }
+
+    void resize(size_type new_size)
+    {
+        const size_type cur_size = size();
+        if (new_size < cur_size) {
+            _size -= cur_size - new_size;
+            return;
+        }
+        if (new_size > capacity()) {
+            change_capacity(new_size);
+        }
+        std::fill_n(item_ptr(cur_size), new_size - cur_size, T());
+        _size += new_size - cur_size;
+    }
+
+    /** like resize(), but the new elements are left uninitialized for the caller to overwrite */
+    void resize_uninitialized(size_type new_size)
+    {
+        const size_type cur_size = size();
+        if (new_size < cur_size) {
+            _size -= cur_size - new_size;
+            return;
+        }
+        if (new_size > capacity()) {
+            change_capacity(new_size);
+        }
+        _size += new_size - cur_size;
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity > capacity()) {
+            change_capacity(new_capacity);
+        }
+    }
+
+    void shrink_to_fit() { change_capacity(size()); }
+
+    void clear() { resize(0); }
+
+    iterator insert(iterator pos, const T& value)
+    {
+        const size_type p    = static_cast<size_type>(pos - begin());
+        const T         copy = value; // value may be an element of this prevector
+        grow_for(size() + 1);
+        T* ptr = item_ptr(p);
+        std::memmove(ptr + 1, ptr, (size() - p) * sizeof(T));
+        _size++;
+        *ptr = copy;
+        return ptr;
+    }
+
+    void insert(iterator pos, size_type count, const T& value)
+    {
+        const size_type p    = static_cast<size_type>(pos - begin());
+        const T         copy = value;
+        grow_for(size() + count);
+        T* ptr = item_ptr(p);
+        std::memmove(ptr + count, ptr, (size() - p) * sizeof(T));
+        _size += count;
+        std::fill_n(ptr, count, copy);
+    }
+
+    template <typename InputIterator, typename = EnableIfIterator<InputIterator>>
+    void insert(iterator pos, InputIterator first, InputIterator last)
+    {
+        const size_type p     = static_cast<size_type>(pos - begin());
+        const size_type count = static_cast<size_type>(std::distance(first, last));
+        grow_for(size() + count);
+        T* ptr = item_ptr(p);
+        std::memmove(ptr + count, ptr, (size() - p) * sizeof(T));
+        _size += count;
+        fill(ptr, first, last);
+    }
+
+    iterator erase(iterator first, iterator last)
+    {
+        T* const endp = end();
+        std::memmove(first, last, (endp - last) * sizeof(T));
+        _size -= static_cast<size_type>(last - first);
+        return first;
+    }
+
+    iterator erase(iterator pos) { return erase(pos, pos + 1); }
+
+    void push_back(const T& value)
+    {
+        const T copy = value;
+        grow_for(size() + 1);
+        *item_ptr(size()) = copy;
+        _size++;
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        const T value(std::forward<Args>(args)...);
+        push_back(value);
+    }
+
+    void pop_back() { _size--; }
+
+    void swap(prevector& other)
+    {
+        std::swap(_union, other._union);
+        std::swap(_size, other._size);
+    }
+
+    /** the heap memory used by the elements, for memory usage accounting */
+    std::size_t allocated_memory() const
+    {
+        return is_direct() ? 0 : sizeof(T) * _union.indirect_contents.capacity;
+    }
+
+    friend bool operator==(const prevector& a, const prevector& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const prevector& a, const prevector& b) { return !(a == b); }
+    friend bool operator<(const prevector& a, const prevector& b)
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator>(const prevector& a, const prevector& b) { return b < a; }
+    friend bool operator<=(const prevector& a, const prevector& b) { return !(b < a); }
+    friend bool operator>=(const prevector& a, const prevector& b) { return !(a < b); }
+};
+
+#endif // PREVECTOR_H
@@ -63,7 +63,9 @@ public:
 /** nServices flags */
 enum
 {
-    NODE_NETWORK = (1 << 0),
+    NODE_NETWORK         = (1 << 0),
+    // serves BIP157 compact block filters (-peerblockfilters)
+    NODE_COMPACT_FILTERS = (1 << 6),
 };
 
 /** A CService with information about it as peer */
@@ -133,6 +135,8 @@ enum
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // only asked for in a getdata, from peers that sent "sendcmpct"; answered with a "cmpctblock"
+    MSG_CMPCT_BLOCK,
 };
 
 /** Generate a new RPC authentication cookie and write it to disk */
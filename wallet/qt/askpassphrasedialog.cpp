@@ -155,6 +155,9 @@ void AskPassphraseDialog::accept()
         else
         {
             fWalletUnlockStakingOnly = ui->stakingCheckBox->isChecked();
+            // keys decrypted for staking may not be kept by a fully unlocked wallet
+            if (!fWalletUnlockStakingOnly)
+                model->dropDecryptedKeys();
             QDialog::accept(); // Success
         }
         break;
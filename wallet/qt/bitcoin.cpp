@@ -19,6 +19,7 @@
 #include <QMessageBox>
 #include <QSplashScreen>
 #include <QTextCodec>
+#include <QThread>
 #include <QTranslator>
 
 #if defined(BITCOIN_NEED_QT_PLUGINS) && !defined(_BITCOIN_QT_PLUGINS_INCLUDED)
@@ -82,8 +83,15 @@ static void ThreadSafeHandleURI(const std::string& strURI)
 static void InitMessage(const std::string& message)
 {
     if (splashref) {
-        splashref->showMessage(QString::fromStdString(message) + " [Click to hide]",
-                               Qt::AlignBottom | Qt::AlignHCenter, QColor(11, 223, 212));
+        const QString text = QString::fromStdString(message) + " [Click to hide]";
+        if (QThread::currentThread() != splashref->thread()) {
+            // e.g. the verification of the latest blocks, which runs in the background
+            QMetaObject::invokeMethod(splashref, "showMessage", Qt::QueuedConnection, Q_ARG(QString, text),
+                                      Q_ARG(int, Qt::AlignBottom | Qt::AlignHCenter),
+                                      Q_ARG(QColor, QColor(11, 223, 212)));
+            return;
+        }
+        splashref->showMessage(text, Qt::AlignBottom | Qt::AlignHCenter, QColor(11, 223, 212));
         QApplication::instance()->processEvents();
     }
 }
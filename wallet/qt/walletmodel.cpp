@@ -404,6 +404,8 @@ bool WalletModel::setWalletLocked(bool locked, const SecureString& passPhrase)
     }
 }
 
+void WalletModel::dropDecryptedKeys() { wallet->DropDecryptedKeys(); }
+
 bool WalletModel::changePassphrase(const SecureString& oldPass, const SecureString& newPass)
 {
     bool retval;
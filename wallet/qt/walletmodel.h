@@ -125,6 +125,8 @@ public:
     bool setWalletEncrypted(bool encrypted, const SecureString& passphrase);
     // Passphrase only needed when unlocking
     bool setWalletLocked(bool locked, const SecureString& passPhrase = SecureString());
+    // Drop the keys that the wallet keeps decrypted for staking
+    void dropDecryptedKeys();
     bool changePassphrase(const SecureString& oldPass, const SecureString& newPass);
     // Wallet backup
     bool backupWallet(const QString& filename);
@@ -0,0 +1,381 @@
+#include "quicksyncdownloader.h"
+
+#include "curltools.h"
+#include "util.h"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
+#include <thread>
+
+static const long QUICKSYNC_CONNECTION_TIMEOUT = 300;
+
+static const std::string PROGRESS_FILE_MAGIC = "quicksync-progress";
+
+QuickSyncDownloader::QuickSyncDownloader(const std::vector<std::string>& urlsIn, uint64_t fileSizeIn,
+                                         const std::string&              sha256In,
+                                         const boost::filesystem::path&  targetIn,
+                                         uint64_t                        chunkSizeIn,
+                                         const std::vector<std::string>& chunkSha256s)
+    : urls(urlsIn), fileSize(fileSizeIn), sha256(sha256In), chunkSize(chunkSizeIn), target(targetIn),
+      tempPath(targetIn.string() + ".temp"), progressPath(targetIn.string() + ".temp.progress"),
+      connections(QUICKSYNC_DEFAULT_CONNECTIONS), nHashed(0), fFailed(false),
+      fRangesUnsupported(false), nBytesDone(0)
+{
+    if (urls.empty()) {
+        throw std::runtime_error("No urls to download " + target.filename().string() + " from");
+    }
+    if (chunkSize == 0) {
+        throw std::runtime_error("Invalid chunk size for " + target.filename().string());
+    }
+
+    for (uint64_t offset = 0; offset < fileSize; offset += chunkSize) {
+        Chunk chunk;
+        chunk.offset = offset;
+        chunk.size   = std::min(chunkSize, fileSize - offset);
+        chunks.push_back(chunk);
+    }
+    if (!chunkSha256s.empty()) {
+        if (chunkSha256s.size() != chunks.size()) {
+            throw std::runtime_error("The manifest of " + target.filename().string() + " has " +
+                                     std::to_string(chunkSha256s.size()) + " chunk sums for " +
+                                     std::to_string(chunks.size()) + " chunks");
+        }
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            chunks[i].sha256 = chunkSha256s[i];
+        }
+    }
+
+    fetcher = [](const std::string& url, uint64_t offset, uint64_t size, const Sink& sink) {
+        cURLTools::GetFileRangeFromHTTPS(url, QUICKSYNC_CONNECTION_TIMEOUT, offset, size, sink);
+    };
+}
+
+void QuickSyncDownloader::SetConnections(unsigned connectionsIn)
+{
+    connections = std::max(1u, std::min(connectionsIn, QUICKSYNC_MAX_CONNECTIONS));
+}
+
+std::string QuickSyncDownloader::ProgressHeader() const
+{
+    return PROGRESS_FILE_MAGIC + " " + std::to_string(fileSize) + " " + std::to_string(chunkSize) + " " +
+           HexStr(sha256.begin(), sha256.end());
+}
+
+void QuickSyncDownloader::LoadProgress()
+{
+    namespace fs = boost::filesystem;
+
+    vDone.assign(chunks.size(), false);
+    vVerified.assign(chunks.size(), false);
+    vAttempts.assign(chunks.size(), 0);
+    vUrlSupportsRanges.assign(urls.size(), true);
+    pending.clear();
+    nHashed = 0;
+    hasher.reset();
+    fFailed            = false;
+    fRangesUnsupported = false;
+    strError.clear();
+    nBytesDone = 0;
+
+    boost::system::error_code ec;
+    if (fs::exists(target) && !fs::remove(target, ec)) {
+        throw std::runtime_error("File " + target.string() +
+                                 " already exists and could not be deleted: " + ec.message());
+    }
+
+    // the chunks recorded are only trusted if the partial download is of the same file
+    bool fResumed = false;
+    if (fs::exists(tempPath) && fs::exists(progressPath) && fs::file_size(tempPath, ec) == fileSize) {
+        fs::ifstream progressIn(progressPath);
+        std::string  line;
+        if (std::getline(progressIn, line) && line == ProgressHeader()) {
+            fResumed = true;
+            // a record cut short by a crash doesn't parse, and its chunk is downloaded again
+            while (std::getline(progressIn, line)) {
+                char*                    end   = nullptr;
+                const unsigned long long index = std::strtoull(line.c_str(), &end, 10);
+                if (line.empty() || *end != '\0' || index >= chunks.size() || vDone[index]) {
+                    continue;
+                }
+                vDone[index] = true;
+                nBytesDone += chunks[index].size;
+            }
+        }
+    }
+
+    if (fResumed) {
+        printf("Resuming the download of %s with %" PRIu64 " of %" PRIu64 " bytes done\n",
+               target.filename().string().c_str(), nBytesDone.load(), fileSize);
+        progressFile.open(progressPath, std::ios::out | std::ios::app);
+    } else {
+        fs::remove(progressPath, ec);
+        fs::remove(tempPath, ec);
+        {
+            fs::ofstream temp(tempPath, std::ios::out | std::ios::binary);
+            if (!temp.good()) {
+                throw std::runtime_error("Failed to create " + tempPath.string());
+            }
+        }
+        fs::resize_file(tempPath, fileSize);
+        progressFile.open(progressPath, std::ios::out | std::ios::trunc);
+        progressFile << ProgressHeader() << std::endl;
+    }
+    if (!progressFile.good()) {
+        throw std::runtime_error("Failed to open " + progressPath.string());
+    }
+
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        if (!vDone[i]) {
+            pending.push_back(i);
+        }
+    }
+}
+
+void QuickSyncDownloader::Fail(const std::string& error, bool fUnsupported)
+{
+    // called with mutex held; the first error is the one reported
+    if (!fFailed) {
+        strError           = error;
+        fRangesUnsupported = fUnsupported;
+        fFailed            = true;
+    }
+    cond.notify_all();
+}
+
+void QuickSyncDownloader::ThreadDownload(unsigned worker)
+{
+    boost::filesystem::fstream file(tempPath, std::ios::in | std::ios::out | std::ios::binary);
+
+    // the workers start on different mirrors, and move to the next one when a chunk fails
+    std::size_t urlIndex = worker % urls.size();
+    while (true) {
+        std::size_t i;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return IsFinished() || !pending.empty(); });
+            if (fFailed || pending.empty()) {
+                return;
+            }
+            if (!file.good()) {
+                Fail("Failed to open " + tempPath.string());
+                return;
+            }
+            i = pending.front();
+            pending.pop_front();
+            while (!vUrlSupportsRanges[urlIndex]) {
+                urlIndex = (urlIndex + 1) % urls.size();
+            }
+        }
+
+        const Chunk&      chunk = chunks[i];
+        const std::string url   = urls[urlIndex];
+        Sha256Calculator  chunkHasher;
+        uint64_t          received = 0;
+        try {
+            file.seekp(chunk.offset);
+            fetcher(url, chunk.offset, chunk.size, [&](const char* data, std::size_t size) {
+                if (fFailed) {
+                    return false;
+                }
+                file.write(data, size);
+                if (!file.good()) {
+                    return false;
+                }
+                chunkHasher.push_data(data, size);
+                received += size;
+                nBytesDone += size;
+                return true;
+            });
+            file.flush();
+            if (!file.good()) {
+                throw std::runtime_error("Failed to write to " + tempPath.string());
+            }
+            if (received != chunk.size) {
+                throw std::runtime_error("Got " + std::to_string(received) + " bytes for a chunk of " +
+                                         std::to_string(chunk.size));
+            }
+            if (!chunk.sha256.empty() && chunkHasher.getHashAndReset() != chunk.sha256) {
+                throw std::runtime_error("The chunk at " + std::to_string(chunk.offset) +
+                                         " doesn't match its sha256");
+            }
+        } catch (const std::exception& ex) {
+            nBytesDone -= received;
+            file.clear();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (fFailed) {
+                return;
+            }
+            pending.push_front(i);
+            if (dynamic_cast<const RangeNotSupportedError*>(&ex)) {
+                vUrlSupportsRanges[urlIndex] = false;
+                if (std::find(vUrlSupportsRanges.begin(), vUrlSupportsRanges.end(), true) ==
+                    vUrlSupportsRanges.end()) {
+                    Fail(ex.what(), true);
+                    return;
+                }
+                continue;
+            }
+            printf("QuickSync: failed to download a chunk of %s from %s: %s\n",
+                   target.filename().string().c_str(), url.c_str(), ex.what());
+            if (++vAttempts[i] >= QUICKSYNC_MAX_CHUNK_ATTEMPTS) {
+                Fail("Failed to download the chunk at " + std::to_string(chunk.offset) + " of " +
+                     target.filename().string() + " " + std::to_string(vAttempts[i]) +
+                     " times. The last error is: " + ex.what());
+                return;
+            }
+            urlIndex = (urlIndex + 1) % urls.size();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        vDone[i]     = true;
+        vVerified[i] = true;
+        progressFile << i << std::endl;
+        cond.notify_all();
+    }
+}
+
+void QuickSyncDownloader::ThreadHash()
+{
+    static const std::size_t READ_SIZE = 1 << 20;
+
+    boost::filesystem::ifstream file(tempPath, std::ios::in | std::ios::binary);
+    std::vector<char>           buffer(READ_SIZE);
+    while (true) {
+        std::size_t i;
+        bool        fVerify;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return IsFinished() || vDone[nHashed]; });
+            if (IsFinished()) {
+                return;
+            }
+            i       = nHashed;
+            fVerify = !chunks[i].sha256.empty() && !vVerified[i];
+        }
+
+        // the chunk was just written, so it's read back from the page cache
+        const Chunk&     chunk = chunks[i];
+        Sha256Calculator next  = hasher;
+        Sha256Calculator chunkHasher;
+        file.clear();
+        file.seekg(chunk.offset);
+        for (uint64_t left = chunk.size; left > 0 && file.good();) {
+            const std::size_t size = static_cast<std::size_t>(std::min<uint64_t>(left, READ_SIZE));
+            file.read(buffer.data(), size);
+            next.push_data(buffer.data(), static_cast<std::size_t>(file.gcount()));
+            if (fVerify) {
+                chunkHasher.push_data(buffer.data(), static_cast<std::size_t>(file.gcount()));
+            }
+            left -= static_cast<uint64_t>(file.gcount());
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!file.good()) {
+            Fail("Failed to read " + tempPath.string());
+            return;
+        }
+        if (fVerify && chunkHasher.getHashAndReset() != chunk.sha256) {
+            // a chunk of an earlier attempt that didn't make it to the disk intact
+            printf("QuickSync: the chunk at %" PRIu64 " of %s is corrupt, downloading it again\n",
+                   chunk.offset, target.filename().string().c_str());
+            vDone[i] = false;
+            nBytesDone -= chunk.size;
+            pending.push_front(i);
+            cond.notify_all();
+            continue;
+        }
+        hasher = next;
+        nHashed++;
+        cond.notify_all();
+    }
+}
+
+void QuickSyncDownloader::Run(const ProgressCallback& progress)
+{
+    LoadProgress();
+
+    // there's no use for more connections than chunks
+    const std::size_t workers =
+        std::min<std::size_t>(connections, std::max<std::size_t>(chunks.size(), 1));
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < workers; i++) {
+        threads.emplace_back(&QuickSyncDownloader::ThreadDownload, this, static_cast<unsigned>(i));
+    }
+    threads.emplace_back(&QuickSyncDownloader::ThreadHash, this);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!IsFinished()) {
+            cond.wait_for(lock, std::chrono::milliseconds(250));
+            if (progress) {
+                lock.unlock();
+                progress(nBytesDone, fileSize);
+                lock.lock();
+            }
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    progressFile.close();
+
+    if (fFailed) {
+        if (fRangesUnsupported) {
+            throw RangeNotSupportedError(strError);
+        }
+        throw std::runtime_error(strError);
+    }
+
+    if (hasher.getHashAndReset() != sha256) {
+        // the chunks can't be told apart without a manifest, so the download starts over
+        Discard();
+        throw std::runtime_error("The calculated checksum for the downloaded file: " +
+                                 tempPath.string() + "; does not match the expected one.");
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tempPath, target, ec);
+    if (ec) {
+        throw std::runtime_error("Error when trying to rename the temporary file " + tempPath.string() +
+                                 " to " + target.string() + ". Error: " + ec.message());
+    }
+    boost::filesystem::remove(progressPath, ec);
+}
+
+void QuickSyncDownloader::Discard()
+{
+    if (progressFile.is_open()) {
+        progressFile.close();
+    }
+    boost::system::error_code ec;
+    boost::filesystem::remove(progressPath, ec);
+    boost::filesystem::remove(tempPath, ec);
+}
+
+bool QuickSyncDownloader::IsPartialDownload(const boost::filesystem::path& path)
+{
+    const std::string name = path.filename().string();
+    return boost::algorithm::ends_with(name, ".temp") ||
+           boost::algorithm::ends_with(name, ".temp.progress");
+}
+
+void QuickSyncDownloader::RemovePartialDownloads(const boost::filesystem::path& dir)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_directory(dir, ec)) {
+        return;
+    }
+    std::vector<boost::filesystem::path> partials;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (IsPartialDownload(it->path())) {
+            partials.push_back(it->path());
+        }
+    }
+    for (const boost::filesystem::path& path : partials) {
+        printf("QuickSync: removing the partial download %s\n", path.string().c_str());
+        boost::filesystem::remove(path, ec);
+    }
+}
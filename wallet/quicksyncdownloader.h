@@ -0,0 +1,126 @@
+#ifndef QUICKSYNCDOWNLOADER_H
+#define QUICKSYNCDOWNLOADER_H
+
+#include "hash.h"
+
+#include <atomic>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** the size of the ranges a QuickSync file is downloaded in, when its manifest doesn't give one */
+static const uint64_t QUICKSYNC_DEFAULT_CHUNK_SIZE = 32 * 1024 * 1024;
+
+/** the number of ranges of a QuickSync file downloaded at once, set with -quicksyncconnections */
+static const unsigned QUICKSYNC_DEFAULT_CONNECTIONS = 4;
+static const unsigned QUICKSYNC_MAX_CONNECTIONS     = 16;
+
+/** a chunk that failed this many times fails the download, which resumes on the next attempt */
+static const unsigned QUICKSYNC_MAX_CHUNK_ATTEMPTS = 5;
+
+/**
+ * Downloads a file of known size and sha256 from a set of mirrors, in chunks fetched concurrently with
+ * HTTP range requests that are spread over the mirrors.
+ *
+ * The chunks are written in place to <target>.temp, and every chunk that's done is recorded in
+ * <target>.temp.progress, so that a download that was interrupted resumes with the chunks it didn't
+ * finish, as long as it's for the same file. When the manifest has the sha256 of every chunk, chunks are
+ * verified as they arrive, and one that doesn't match is downloaded again from another mirror. The whole
+ * file is hashed during the download, a chunk at a time as soon as the chunks before it are done, rather
+ * than read again once it's complete.
+ *
+ * A server that doesn't support range requests isn't used; if none does, Run() throws
+ * RangeNotSupportedError, for the caller to download the file in one piece instead.
+ */
+class QuickSyncDownloader
+{
+public:
+    typedef std::function<bool(const char*, std::size_t)> Sink;
+    /** downloads the size bytes at offset of a url and hands them to the sink; throws on failure */
+    typedef std::function<void(const std::string& url, uint64_t offset, uint64_t size, const Sink& sink)>
+        RangeFetcher;
+    typedef std::function<void(uint64_t bytesDone, uint64_t bytesTotal)> ProgressCallback;
+
+private:
+    struct Chunk
+    {
+        uint64_t    offset;
+        uint64_t    size;
+        std::string sha256; // binary, empty if the manifest has no sums
+    };
+
+    const std::vector<std::string> urls;
+    const uint64_t                 fileSize;
+    const std::string              sha256;
+    const uint64_t                 chunkSize;
+    const boost::filesystem::path  target;
+    const boost::filesystem::path  tempPath;
+    const boost::filesystem::path  progressPath;
+    std::vector<Chunk>             chunks;
+    RangeFetcher                   fetcher;
+    unsigned                       connections;
+
+    std::mutex                  mutex;
+    std::condition_variable     cond;
+    std::deque<std::size_t>     pending;
+    std::vector<bool>           vDone;
+    std::vector<bool>           vVerified; // checked against the manifest since it was written
+    std::vector<unsigned>       vAttempts;
+    std::vector<bool>           vUrlSupportsRanges;
+    std::size_t                 nHashed;
+    Sha256Calculator            hasher; // the sha256 of the chunks before nHashed
+    boost::filesystem::ofstream progressFile;
+    std::atomic<bool>           fFailed;
+    bool                        fRangesUnsupported;
+    std::string                 strError;
+    std::atomic<uint64_t>       nBytesDone;
+
+    std::string ProgressHeader() const;
+    void        LoadProgress();
+    void        Fail(const std::string& error, bool fUnsupported = false);
+    bool        IsFinished() const { return fFailed || nHashed == chunks.size(); }
+    void        ThreadDownload(unsigned worker);
+    void        ThreadHash();
+
+public:
+    /**
+     * sha256 and the sums of the chunks are binary. The file is split in chunks of chunkSize bytes,
+     * the last of which may be shorter; chunkSha256s is either empty, or has the sum of each of them.
+     */
+    QuickSyncDownloader(const std::vector<std::string>& urlsIn, uint64_t fileSizeIn,
+                        const std::string& sha256In, const boost::filesystem::path& targetIn,
+                        uint64_t                        chunkSizeIn   = QUICKSYNC_DEFAULT_CHUNK_SIZE,
+                        const std::vector<std::string>& chunkSha256s = std::vector<std::string>());
+
+    QuickSyncDownloader(const QuickSyncDownloader&) = delete;
+    QuickSyncDownloader& operator=(const QuickSyncDownloader&) = delete;
+
+    /** replaces the cURL range requests, for tests */
+    void SetFetcher(const RangeFetcher& fetcherIn) { fetcher = fetcherIn; }
+    void SetConnections(unsigned connectionsIn);
+
+    std::size_t GetChunkCount() const { return chunks.size(); }
+
+    /**
+     * Downloads what's left of the file, verifies it and moves it to the target; progress is called
+     * a few times a second from the calling thread. On failure, what was downloaded is kept for the
+     * next call to resume with, unless the file doesn't match its sha256.
+     */
+    void Run(const ProgressCallback& progress = ProgressCallback());
+
+    /** removes the partial download */
+    void Discard();
+
+    /** whether path is the partial download of a QuickSync file, to be kept between attempts */
+    static bool IsPartialDownload(const boost::filesystem::path& path);
+
+    /** removes the partial downloads left in dir, once they won't be resumed anymore */
+    static void RemovePartialDownloads(const boost::filesystem::path& dir);
+};
+
+#endif // QUICKSYNCDOWNLOADER_H
@@ -3,15 +3,20 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "addressindex.h"
 #include "amount.h"
 #include "bitcoinrpc.h"
+#include "blockfilterindex.h"
 #include "main.h"
 #include "merkletx.h"
+#include "ntp1tokenindex.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "validationinterface.h"
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <limits>
 #include <thread>
 
 using namespace json_spirit;
@@ -222,11 +227,15 @@ Value getblockhash(const Array& params, bool fHelp)
         throw runtime_error("getblockhash <index>\n"
                             "Returns hash of block in best-block-chain at <index>.");
 
+    LOCK(cs_main);
+
     int nHeight = params[0].get_int();
     if (nHeight < 0 || nHeight > CTxDB().GetBestChainHeight().value_or(0))
         throw runtime_error("Block number out of range.");
 
     CBlockIndexSmartPtr pblockindex = CBlock::FindBlockByHeight(nHeight);
+    if (!pblockindex)
+        throw runtime_error("Block number out of range.");
     return pblockindex->phashBlock.GetHex();
 }
 
@@ -291,13 +300,16 @@ Value getblock(const Array& params, bool fHelp)
     if (params.size() > 2)
         fShowTxns = params[2].get_bool();
 
-    const auto bi = mapBlockIndex.get(hash);
-    if (!bi.is_initialized())
+    // the blocks in the block index are only all readable with cs_main; see CBlockWriteBatchScope
+    LOCK(cs_main);
+
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock       block;
-    CBlockIndex* pblockindex = bi->get();
-    block.ReadFromDisk(pblockindex, true);
+    CBlock block;
+    if (!block.ReadFromDisk(pblockindex, true))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Can't read block from disk");
 
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
@@ -322,22 +334,19 @@ Value getblockbynumber(const Array& params, bool fHelp)
                             "try to retireve NTP1 data from the database. This won't work if the "
                             "transaction is not in the blockchain.");
 
+    LOCK(cs_main);
+
     int nHeight = params[0].get_int();
     if (nHeight < 0 || nHeight > CTxDB().GetBestChainHeight().value_or(0))
         throw runtime_error("Block number out of range.");
 
     CBlock              block;
-    CBlockIndexSmartPtr pblockindex = CTxDB().GetBestBlockIndex();
-    while (pblockindex->nHeight > nHeight)
-        pblockindex = pblockindex->pprev;
-
-    const uint256 hash = pblockindex->phashBlock;
-
-    pblockindex = mapBlockIndex.get(hash).value_or(nullptr);
+    CBlockIndexSmartPtr pblockindex = CBlock::FindBlockByHeight(nHeight);
     if(!pblockindex) {
         throw runtime_error("Failed to get block after finding its hash.");
     }
-    block.ReadFromDisk(pblockindex.get(), true);
+    if (!block.ReadFromDisk(pblockindex.get(), true))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Can't read block from disk");
 
     bool fIgnoreNTP1 = false;
     if (params.size() > 2)
@@ -466,13 +475,13 @@ Value waitforblockheight(const Array& params, bool fHelp)
 Value syncwithvalidationinterfacequeue(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() > 0) {
-        throw std::runtime_error("syncwithvalidationinterfacequeue (unimplemented)\n"
+        throw std::runtime_error("syncwithvalidationinterfacequeue\n"
                                  "\nWaits for the validation interface queue to catch up on everything "
                                  "that was there when we entered this function.\n"
                                  "\nExamples:\n"
                                  "syncwithvalidationinterfacequeue");
     }
-    //    SyncWithValidationInterfaceQueue();
+    SyncWithValidationInterfaceQueue();
     return Value();
 }
 
@@ -499,6 +508,14 @@ Value getblockchaininfo(const Array& params, bool fHelp)
             "hexadecimal\n"
             "  \"size_on_disk\": xxxxxx,       (numeric) the estimated size of the block and undo files "
             "on disk\n"
+            "  \"dbmap\": {                    (object) the memory map of the database\n"
+            "     \"size\": xxxxxx,            (numeric) the size of the map, in bytes\n"
+            "     \"used\": xxxxxx,            (numeric) the part of the map in use, in bytes\n"
+            "     \"resizes\": xx,             (numeric) how many times the map was resized\n"
+            "     \"resize_stall_ms\": xx,     (numeric) how long resizes stopped all database "
+            "transactions, in total\n"
+            "     \"max_resize_stall_ms\": xx, (numeric) the longest that a resize stopped them\n"
+            "  },\n"
             "  \"softforks\": [                (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",           (string) name of softfork\n"
@@ -532,6 +549,14 @@ Value getblockchaininfo(const Array& params, bool fHelp)
     obj.push_back(Pair("initialblockdownload", IsInitialBlockDownload()));
     obj.push_back(Pair("chainwork", bestBlockIndex->nChainTrust.GetHex()));
     obj.push_back(Pair("size_on_disk", (int64_t)CTxDB::GetCurrentDiskUsage()));
+    const LMDBMapStats mapStats = CTxDB::GetMapStats();
+    Object             dbMap;
+    dbMap.push_back(Pair("size", (int64_t)mapStats.mapSize));
+    dbMap.push_back(Pair("used", (int64_t)mapStats.usedSize));
+    dbMap.push_back(Pair("resizes", (int64_t)mapStats.resizes));
+    dbMap.push_back(Pair("resize_stall_ms", mapStats.totalStallMillis));
+    dbMap.push_back(Pair("max_resize_stall_ms", mapStats.maxStallMillis));
+    obj.push_back(Pair("dbmap", dbMap));
     obj.push_back(Pair("warnings", GetWarnings("statusbar")));
     return obj;
 }
@@ -616,13 +641,11 @@ Value getblockheader(const Array& params, bool fHelp)
         fVerbose = params[1].get_bool();
     }
 
-    const auto bi = mapBlockIndex.get(hash).value_or(nullptr);
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
 
-    if (!bi)
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlockIndex* pblockindex = bi.get();
-
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << pblockindex->GetBlockHeader();
@@ -753,3 +776,363 @@ Value gettxout(const Array& params, bool fHelp)
 
     return ret;
 }
+
+static void EnsureNTP1TokenIndexIsAvailable(const CTxDB& txdb)
+{
+    if (!fNTP1TokenIndex || !txdb.IsNTP1TokenIndexComplete()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The NTP1 token index is not available; restart with "
+                                           "-ntp1index to build it");
+    }
+}
+
+/** accepts a token id or the symbol of a token issued in the main chain */
+static std::string NTP1TokenIdFromRPCParam(const CTxDB& txdb, const std::string& tokenIdOrName)
+{
+    NTP1TokenIndexStats stats;
+    if (!txdb.ReadNTP1TokenIndexStats(tokenIdOrName, stats)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the NTP1 token index");
+    }
+    if (!stats.supply.is_zero()) {
+        return tokenIdOrName;
+    }
+    try {
+        return GetTokenIDFromTokenName(tokenIdOrName);
+    } catch (std::exception&) {
+        // a token id that isn't in the index (anymore) has no supply and no holders
+        return tokenIdOrName;
+    }
+}
+
+Value getntp1addressbalances(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "getntp1addressbalances \"address\"\n"
+            "Returns the NTP1 token balances of any address in the main chain. Requires -ntp1index.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"tokenid\": \"amount\",   (string) the balance of each token held by the address\n"
+            "  ...\n"
+            "}\n");
+
+    const CBitcoinAddress address(params[0].get_str());
+    if (!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid neblio address");
+
+    // like the address index, the token index is updated with the blocks, which are only all readable
+    // with cs_main; see CBlockWriteBatchScope
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureNTP1TokenIndexIsAvailable(txdb);
+
+    std::map<std::string, NTP1Int> balances;
+    if (!txdb.ReadNTP1AddressBalances(address.ToString(), balances))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the NTP1 token index");
+
+    Object result;
+    for (const auto& balance : balances) {
+        result.push_back(Pair(balance.first, ToString(balance.second)));
+    }
+    return result;
+}
+
+Value getntp1tokeninfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "getntp1tokeninfo <tokenId/name>\n"
+            "Returns the supply and the number of holders of an NTP1 token in the main chain. Requires "
+            "-ntp1index.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"tokenid\": \"xxxx\",    (string) the token id\n"
+            "  \"supply\": \"xxxx\",     (string) the amount of the token in unspent outputs\n"
+            "  \"holders\": n          (numeric) the number of addresses holding the token\n"
+            "}\n");
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureNTP1TokenIndexIsAvailable(txdb);
+
+    const std::string   tokenId = NTP1TokenIdFromRPCParam(txdb, params[0].get_str());
+    NTP1TokenIndexStats stats;
+    if (!txdb.ReadNTP1TokenIndexStats(tokenId, stats))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the NTP1 token index");
+
+    Object result;
+    result.push_back(Pair("tokenid", tokenId));
+    result.push_back(Pair("supply", ToString(stats.supply)));
+    result.push_back(Pair("holders", static_cast<uint64_t>(stats.holders)));
+    return result;
+}
+
+Value getntp1tokenholders(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "getntp1tokenholders <tokenId/name>\n"
+            "Returns the addresses holding an NTP1 token in the main chain with their balances. "
+            "Requires -ntp1index.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"address\": \"amount\",   (string) the balance of each address holding the token\n"
+            "  ...\n"
+            "}\n");
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureNTP1TokenIndexIsAvailable(txdb);
+
+    const std::string        tokenId = NTP1TokenIdFromRPCParam(txdb, params[0].get_str());
+    std::vector<std::string> holders;
+    if (!txdb.ReadNTP1TokenHolders(tokenId, holders))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the NTP1 token index");
+
+    Object result;
+    for (const std::string& holder : holders) {
+        std::map<std::string, NTP1Int> balances;
+        if (!txdb.ReadNTP1AddressBalances(holder, balances))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the NTP1 token index");
+        const auto it = balances.find(tokenId);
+        result.push_back(Pair(holder, ToString(it != balances.end() ? it->second : NTP1Int(0))));
+    }
+    return result;
+}
+
+static void EnsureAddressIndexIsAvailable(const CTxDB& txdb)
+{
+    if (!fAddressIndex || !txdb.IsAddressIndexComplete()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The address index is not available; restart with "
+                                           "-addressindex to build it");
+    }
+}
+
+static std::string AddressIndexKeyFromRPCParam(const Value& param)
+{
+    const CBitcoinAddress address(param.get_str());
+    if (!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid neblio address");
+    return address.ToString();
+}
+
+Value getaddresstxids(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw std::runtime_error(
+            "getaddresstxids \"address\" ( start end )\n"
+            "Returns the ids of the transactions of any address in the main chain, ordered by height. "
+            "Requires -addressindex.\n"
+            "\nArguments:\n"
+            "1. \"address\"  (string, required) The address\n"
+            "2. start      (numeric, optional) The lowest block height to include\n"
+            "3. end        (numeric, optional) The highest block height to include\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"txid\"      (string) the id of a transaction that sends to or spends from the address\n"
+            "  ,...\n"
+            "]\n");
+
+    const std::string address = AddressIndexKeyFromRPCParam(params[0]);
+    const int64_t     nStart  = params.size() > 1 ? params[1].get_int64() : 0;
+    const int64_t     nEnd    = params.size() > 2 ? params[2].get_int64() : INT64_MAX;
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureAddressIndexIsAvailable(txdb);
+
+    Array result;
+    if (nStart > nEnd || nEnd < 0 || nStart > std::numeric_limits<int>::max())
+        return result;
+
+    // only the entries in the range are read from the db, already sorted by height
+    std::vector<CAddressIndexEntry> entries;
+    if (!txdb.ReadAddressIndex(address, static_cast<int>(std::max<int64_t>(nStart, 0)),
+                               static_cast<int>(std::min<int64_t>(nEnd, std::numeric_limits<int>::max())),
+                               entries))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+
+    // a transaction may send to and spend from the address more than once; the entries of a
+    // transaction are next to each other, as they're sorted by txid within a height
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        if (i > 0 && entries[i].txid == entries[i - 1].txid)
+            continue;
+        result.push_back(entries[i].txid.GetHex());
+    }
+    return result;
+}
+
+Value getaddressutxos(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "getaddressutxos \"address\"\n"
+            "Returns the unspent outputs of any address in the main chain, ordered by height. Requires "
+            "-addressindex.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"txid\",          (string) the transaction id\n"
+            "    \"vout\" : n,               (numeric) the output index\n"
+            "    \"scriptPubKey\" : \"hex\",   (string) the script of the output\n"
+            "    \"amount\" : x.xxx,         (numeric) the value of the output in " +
+            CURRENCY_UNIT +
+            "\n"
+            "    \"height\" : n              (numeric) the height of the block containing the output\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n");
+
+    const std::string address = AddressIndexKeyFromRPCParam(params[0]);
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureAddressIndexIsAvailable(txdb);
+
+    std::vector<CAddressUnspentEntry> outputs;
+    if (!txdb.ReadAddressUnspentOutputs(address, outputs))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    std::stable_sort(outputs.begin(), outputs.end(),
+                     [](const CAddressUnspentEntry& a, const CAddressUnspentEntry& b) {
+                         return a.nHeight < b.nHeight;
+                     });
+
+    Array result;
+    for (const CAddressUnspentEntry& output : outputs) {
+        Object entry;
+        entry.push_back(Pair("txid", output.outpoint.hash.GetHex()));
+        entry.push_back(Pair("vout", static_cast<int64_t>(output.outpoint.n)));
+        entry.push_back(Pair("scriptPubKey",
+                             HexStr(output.scriptPubKey.begin(), output.scriptPubKey.end())));
+        entry.push_back(Pair("amount", ValueFromAmount(output.nValue)));
+        entry.push_back(Pair("height", output.nHeight));
+        result.push_back(entry);
+    }
+    return result;
+}
+
+Value getaddressbalance(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance \"address\"\n"
+            "Returns the balance of any address in the main chain. Requires -addressindex.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\" : x.xxx,    (numeric) the value of the unspent outputs of the address\n"
+            "  \"received\" : x.xxx    (numeric) the value of all the outputs the address received\n"
+            "}\n");
+
+    const std::string address = AddressIndexKeyFromRPCParam(params[0]);
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    EnsureAddressIndexIsAvailable(txdb);
+
+    std::vector<CAddressIndexEntry> entries;
+    if (!txdb.ReadAddressIndex(address, entries))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+
+    CAmount nBalance  = 0;
+    CAmount nReceived = 0;
+    for (const CAddressIndexEntry& entry : entries) {
+        nBalance += entry.nAmount;
+        if (!entry.fSpend) {
+            nReceived += entry.nAmount;
+        }
+    }
+
+    Object result;
+    result.push_back(Pair("balance", ValueFromAmount(nBalance)));
+    result.push_back(Pair("received", ValueFromAmount(nReceived)));
+    return result;
+}
+
+Value getspentinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw std::runtime_error(
+            "getspentinfo \"txid\" n\n"
+            "Returns the input that spent an output in the main chain. Requires -spentindex.\n"
+            "\nArguments:\n"
+            "1. \"txid\"  (string, required) The transaction id\n"
+            "2. n       (numeric, required) The output index\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\" : \"txid\",      (string) the id of the spending transaction\n"
+            "  \"index\" : n,          (numeric) the index of the spending input\n"
+            "  \"height\" : n,         (numeric) the height of the block containing the spending input\n"
+            "  \"amount\" : x.xxx,     (numeric) the value of the spent output in " +
+            CURRENCY_UNIT +
+            "\n"
+            "  \"address\" : \"addr\"    (string) the address of the spent output, if it has one\n"
+            "}\n");
+
+    const COutPoint outpoint(uint256(params[0].get_str()), static_cast<uint32_t>(params[1].get_int()));
+
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    if (!fSpentIndex || !txdb.IsSpentIndexComplete()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The spent index is not available; restart with "
+                                           "-spentindex to build it");
+    }
+
+    CSpentIndexValue value;
+    if (!txdb.ReadSpentIndex(outpoint, value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    Object result;
+    result.push_back(Pair("txid", value.txid.GetHex()));
+    result.push_back(Pair("index", static_cast<int64_t>(value.nInputIndex)));
+    result.push_back(Pair("height", value.nHeight));
+    result.push_back(Pair("amount", ValueFromAmount(value.nValue)));
+    if (!value.address.empty()) {
+        result.push_back(Pair("address", value.address));
+    }
+    return result;
+}
+
+Value getblockfilter(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "Returns the BIP158 filter of a block. Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"   (string, required) The hash of the block\n"
+            "2. \"filtertype\"  (string, optional, default=\"basic\") The type of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the encoded filter\n"
+            "  \"header\" : \"hex\"   (string) the filter header, committing to all the previous filters\n"
+            "}\n");
+
+    const uint256 hash(params[0].get_str());
+    if (params.size() > 1 && params[1].get_str() != "basic") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown filter type");
+    }
+
+    // the filters of the blocks of the chain are only all readable with cs_main; see CBlockWriteBatchScope
+    LOCK(cs_main);
+
+    CTxDB txdb;
+    if (!fBlockFilterIndex || !txdb.IsBlockFilterIndexComplete()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The block filter index is not available; restart with "
+                                           "-blockfilterindex to build it");
+    }
+
+    CBlockFilterIndexEntry entry;
+    if (!txdb.ReadBlockFilter(hash, entry))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block filter not found");
+
+    Object result;
+    result.push_back(Pair("filter", HexStr(entry.filter)));
+    result.push_back(Pair("header", entry.header.GetHex()));
+    return result;
+}
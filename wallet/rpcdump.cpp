@@ -151,11 +151,12 @@ Value importprivkey(const Array& params, bool fHelp)
 
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-
-        pwalletMain->ScanForWalletTransactions(boost::atomic_load(&pindexGenesisBlock).get(), true);
-        pwalletMain->ReacceptWalletTransactions();
     }
 
+    // the rescan takes the locks it needs itself, so that the node isn't blocked while blocks are read
+    pwalletMain->ScanForWalletTransactions(boost::atomic_load(&pindexGenesisBlock).get(), true);
+    pwalletMain->ReacceptWalletTransactions();
+
     return Value::null;
 }
 
@@ -11,6 +11,7 @@
 #include "script.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "validationinterface.h"
 #include "work.h"
 #include <random>
 
@@ -529,7 +530,15 @@ Value submitblock(const Array& params, bool fHelp)
         throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Block decode failed");
     }
 
-    bool fAccepted = ProcessBlock(NULL, &block);
+    bool fAccepted;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        fAccepted = ProcessBlock(NULL, &block);
+    }
+
+    // the wallet knows about the block by the time the call returns
+    SyncWithValidationInterfaceQueue();
+
     if (!fAccepted)
         return "rejected";
 
@@ -576,6 +585,8 @@ Value generateBlocks(int nGenerate, uint64_t nMaxTries, CWallet* const pwallet,
             return *destinationAddress;
         }
 
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
         CPubKey newKey;
         if (!pwalletMain->GetKeyFromPool(newKey))
             throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT,
@@ -588,41 +599,45 @@ Value generateBlocks(int nGenerate, uint64_t nMaxTries, CWallet* const pwallet,
     }();
 
     while (nHeight < nHeightEnd) {
-        std::unique_ptr<CBlock> pblock = CreateNewBlock(pwallet, false, 0, destination);
-        if (!pblock)
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
         {
-            LOCK(cs_main);
+            LOCK2(cs_main, pwalletMain->cs_wallet);
+
+            std::unique_ptr<CBlock> pblock = CreateNewBlock(pwallet, false, 0, destination);
+            if (!pblock)
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
             IncrementExtraNonce(pblock.get(), CTxDB().GetBestBlockIndex().get(), nExtraNonce);
-        }
 
-        boost::optional<unsigned int> nonce = MineBlock(*pblock, nMaxTries);
-        if (nonce) {
-            pblock->nNonce = *nonce;
-        } else {
-            // failed to mine
-            break;
-        }
+            boost::optional<unsigned int> nonce = MineBlock(*pblock, nMaxTries);
+            if (nonce) {
+                pblock->nNonce = *nonce;
+            } else {
+                // failed to mine
+                break;
+            }
 
-        if (pblock->nNonce == nInnerLoopCount) {
-            continue;
+            if (pblock->nNonce == nInnerLoopCount) {
+                continue;
+            }
+
+            // peercoin: sign block
+            // rfc6: we sign proof of work blocks only before 0.8 fork
+            //        if (!pblock->SignBlock(*pwallet, 0))
+            //            throw JSONRPCError(-100, "Unable to sign block, wallet locked?");
+
+            if (!ProcessBlock(nullptr, pblock.get()))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
+            ++nHeight;
+            blockHashes.push_back(pblock->GetHash().GetHex());
+
+            // mark script as important because it was used at least for one coinbase output if the
+            // script came from the wallet
+            //        if (keepScript) {
+            //            coinbaseScript->KeepScript();
+            //        }
         }
 
-        // peercoin: sign block
-        // rfc6: we sign proof of work blocks only before 0.8 fork
-        //        if (!pblock->SignBlock(*pwallet, 0))
-        //            throw JSONRPCError(-100, "Unable to sign block, wallet locked?");
-
-        if (!ProcessBlock(nullptr, pblock.get()))
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
-        ++nHeight;
-        blockHashes.push_back(pblock->GetHash().GetHex());
-
-        // mark script as important because it was used at least for one coinbase output if the script
-        // came from the wallet
-        //        if (keepScript) {
-        //            coinbaseScript->KeepScript();
-        //        }
+        // the wallet has to know about the new block before the next one is built on top of it
+        SyncWithValidationInterfaceQueue();
     }
     return Value(blockHashes);
 }
@@ -661,24 +676,32 @@ Value generatePOSBlocks(
     };
 
     while (nHeight < nHeightEnd) {
-        const std::unique_ptr<CBlock> pblock = BlockMaker();
+        {
+            LOCK2(cs_main, pwalletMain->cs_wallet);
 
-        if (!pblock) {
-            // staking failed
-            break;
-        }
+            const std::unique_ptr<CBlock> pblock = BlockMaker();
 
-        ++nHeight;
-        if (submitBlock) {
-            blockHashesOrSerializedData.push_back(pblock->GetHash().GetHex());
-        } else {
-            // if block is not submitted, return the serialized format
-            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-            ss << *pblock;
-            std::string blockRaw = ss.str();
-            blockHashesOrSerializedData.push_back(HexStr(std::make_move_iterator(blockRaw.begin()),
-                                                         std::make_move_iterator(blockRaw.end())));
+            if (!pblock) {
+                // staking failed
+                break;
+            }
+
+            ++nHeight;
+            if (submitBlock) {
+                blockHashesOrSerializedData.push_back(pblock->GetHash().GetHex());
+            } else {
+                // if block is not submitted, return the serialized format
+                CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                ss << *pblock;
+                std::string blockRaw = ss.str();
+                blockHashesOrSerializedData.push_back(
+                    HexStr(std::make_move_iterator(blockRaw.begin()),
+                           std::make_move_iterator(blockRaw.end())));
+            }
         }
+
+        // the staker must not pick an output that the previous block already spent
+        SyncWithValidationInterfaceQueue();
     }
     return Value(blockHashesOrSerializedData);
 }
@@ -5,6 +5,8 @@
 #include "alert.h"
 #include "bitcoinrpc.h"
 #include "db.h"
+#include "locksite.h"
+#include "nodemetrics.h"
 #include "net.h"
 #include "wallet.h"
 #include "walletdb.h"
@@ -142,6 +144,171 @@ Value getpeerinfo(const Array& params, bool fHelp)
     return ret;
 }
 
+static std::string MetricKey(const std::string& name, const std::string& labels)
+{
+    return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+static double NanosAsMillis(uint64_t nanos) { return static_cast<double>(nanos) / 1e6; }
+
+Value getmetrics(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getmetrics ( \"format\" )\n"
+            "Returns the node's counters, gauges and latency histograms.\n"
+            "\nArguments:\n"
+            "1. \"format\"  (string, optional, default=\"json\") \"json\", or \"prometheus\" for the text that\n"
+            "              -metricsport serves\n"
+            "\nResult (json):\n"
+            "{\n"
+            "  \"counters\" : { \"name{labels}\" : n, ... },\n"
+            "  \"gauges\" : { \"name{labels}\" : n, ... },\n"
+            "  \"histograms\" : {\n"
+            "    \"name{labels}\" : { \"count\", \"sum_ms\", \"p50_ms\", \"p90_ms\", \"p99_ms\", \"max_ms\" },\n"
+            "    ...\n"
+            "  }\n"
+            "}\n");
+
+    const std::string strFormat = params.size() > 0 ? params[0].get_str() : "json";
+    if (strFormat != "json" && strFormat != "prometheus")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown format: " + strFormat);
+
+    UpdateNodeMetrics();
+    if (strFormat == "prometheus")
+        return Metrics().FormatPrometheus();
+
+    Object counters, gauges, histograms;
+    Metrics().ForEachCounter([&](const std::string& name, const std::string& labels, uint64_t value) {
+        counters.push_back(Pair(MetricKey(name, labels), value));
+    });
+    Metrics().ForEachGauge([&](const std::string& name, const std::string& labels, int64_t value) {
+        gauges.push_back(Pair(MetricKey(name, labels), value));
+    });
+    Metrics().ForEachHistogram([&](const std::string& name, const std::string& labels,
+                                   const CMetricHistogram::Snapshot& snapshot) {
+        Object histogram;
+        histogram.push_back(Pair("count", snapshot.count));
+        histogram.push_back(Pair("sum_ms", NanosAsMillis(snapshot.sum)));
+        histogram.push_back(Pair("p50_ms", NanosAsMillis(snapshot.Percentile(0.5))));
+        histogram.push_back(Pair("p90_ms", NanosAsMillis(snapshot.Percentile(0.9))));
+        histogram.push_back(Pair("p99_ms", NanosAsMillis(snapshot.Percentile(0.99))));
+        histogram.push_back(Pair("max_ms", NanosAsMillis(snapshot.max)));
+        histograms.push_back(Pair(MetricKey(name, labels), histogram));
+    });
+
+    Object result;
+    result.push_back(Pair("counters", counters));
+    result.push_back(Pair("gauges", gauges));
+    result.push_back(Pair("histograms", histograms));
+    return result;
+}
+
+Value setlockprofiling(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "setlockprofiling <sampleinterval>\n"
+            "Enables the lock contention profiler, reported by getlockcontention, timing one in every\n"
+            "<sampleinterval> lock acquisitions of each thread; 1 times all of them, 0 disables it.");
+
+    const int64_t nInterval = params[0].get_int64();
+    if (nInterval < 0 || nInterval > std::numeric_limits<uint32_t>::max())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid sample interval");
+    CLockProfiler::SetSampleInterval(static_cast<uint32_t>(nInterval));
+    return Value::null;
+}
+
+static Object LockTimesToJSON(const CMetricHistogram::Snapshot& snapshot, double dScale)
+{
+    Object result;
+    result.push_back(Pair("total_ms", NanosAsMillis(snapshot.sum) * dScale));
+    result.push_back(Pair("p50_ms", NanosAsMillis(snapshot.Percentile(0.5))));
+    result.push_back(Pair("p99_ms", NanosAsMillis(snapshot.Percentile(0.99))));
+    result.push_back(Pair("max_ms", NanosAsMillis(snapshot.max)));
+    return result;
+}
+
+Value getlockcontention(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getlockcontention ( count reset )\n"
+            "Returns what the lock contention profiler (setlockprofiling) measured at the sites in the\n"
+            "code where locks are taken, those that waited the longest in total first.\n"
+            "\nArguments:\n"
+            "1. count  (numeric, optional, default=20) The number of sites to return, 0 for all\n"
+            "2. reset  (boolean, optional, default=false) Clear the measurements after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"sampleinterval\" : n,   (numeric) one in this many acquisitions is timed, 0 when disabled\n"
+            "  \"sites\" : [\n"
+            "    {\n"
+            "      \"lock\" : \"name\",       (string) the locked expression, e.g. cs_main\n"
+            "      \"site\" : \"file:line\",  (string) where it's taken\n"
+            "      \"acquisitions\" : n,    (numeric) estimated from the samples\n"
+            "      \"sampled\" : n,         (numeric) the acquisitions timed\n"
+            "      \"contended\" : n,       (numeric) the sampled acquisitions that had to wait\n"
+            "      \"wait\" : { \"total_ms\", \"p50_ms\", \"p99_ms\", \"max_ms\" },  total is estimated\n"
+            "      \"hold\" : { \"total_ms\", \"p50_ms\", \"p99_ms\", \"max_ms\" }\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n");
+
+    const int64_t nCount = params.size() > 0 ? params[0].get_int64() : 20;
+    const bool    fReset = params.size() > 1 && params[1].get_bool();
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+
+    struct SiteTimes
+    {
+        std::string                lock;
+        std::string                site;
+        uint64_t                   acquisitions;
+        uint64_t                   sampled;
+        uint64_t                   contended;
+        CMetricHistogram::Snapshot waits;
+        CMetricHistogram::Snapshot holds;
+
+        // the samples are scaled up to estimate the totals of all the acquisitions
+        double Scale() const { return sampled > 0 ? static_cast<double>(acquisitions) / sampled : 0; }
+    };
+    std::vector<SiteTimes> vSites;
+    CLockProfiler::ForEachSite([&](const CLockSite& site) {
+        if (site.sampled.Get() == 0)
+            return;
+        vSites.push_back({site.pszName, strprintf("%s:%d", site.pszFile, site.nLine),
+                          site.acquisitions.Get(), site.sampled.Get(), site.contended.Get(),
+                          site.waits.GetSnapshot(), site.holds.GetSnapshot()});
+    });
+    if (fReset)
+        CLockProfiler::Reset();
+
+    std::sort(vSites.begin(), vSites.end(), [](const SiteTimes& a, const SiteTimes& b) {
+        return a.waits.sum * a.Scale() > b.waits.sum * b.Scale();
+    });
+    if (nCount > 0 && vSites.size() > static_cast<uint64_t>(nCount))
+        vSites.resize(nCount);
+
+    Array sites;
+    for (const SiteTimes& times : vSites) {
+        Object site;
+        site.push_back(Pair("lock", times.lock));
+        site.push_back(Pair("site", times.site));
+        site.push_back(Pair("acquisitions", times.acquisitions));
+        site.push_back(Pair("sampled", times.sampled));
+        site.push_back(Pair("contended", times.contended));
+        site.push_back(Pair("wait", LockTimesToJSON(times.waits, times.Scale())));
+        site.push_back(Pair("hold", LockTimesToJSON(times.holds, times.Scale())));
+        sites.push_back(site);
+    }
+
+    Object result;
+    result.push_back(Pair("sampleinterval", static_cast<uint64_t>(CLockProfiler::GetSampleInterval())));
+    result.push_back(Pair("sites", sites));
+    return result;
+}
+
 // ppcoin: send alert.
 // There is a known deadlock situation with ThreadMessageHandler
 // ThreadMessageHandler: holds cs_vSend and acquiring cs_main in SendMessages()
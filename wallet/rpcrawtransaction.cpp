@@ -14,6 +14,7 @@
 #include "net.h"
 #include "ntp1/ntp1transaction.h"
 #include "txdb.h"
+#include "validationinterface.h"
 #include "wallet.h"
 
 using namespace std;
@@ -999,27 +1000,12 @@ Value signrawtransaction(const Array& params, bool fHelp)
     return result;
 }
 
-Value sendrawtransaction(const Array& params, bool fHelp)
+// accepts a transaction to the mempool (unless it's there already) and relays it
+static void SubmitRawTransaction(const CTransaction& tx)
 {
-    if (fHelp || params.size() < 1 || params.size() > 1)
-        throw runtime_error(
-            "sendrawtransaction <hex string>\n"
-            "Submits raw transaction (serialized, hex-encoded) to local node and network.");
+    LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    RPCTypeCheck(params, list_of(str_type));
-
-    // parse hex string from parameter
-    vector<unsigned char> txData(ParseHex(params[0].get_str()));
-    CDataStream           ssData(txData, SER_NETWORK, PROTOCOL_VERSION);
-    CTransaction          tx;
-
-    // deserialize binary data stream
-    try {
-        ssData >> tx;
-    } catch (std::exception& e) {
-        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "TX decode failed");
-    }
-    uint256 hashTx = tx.GetHash();
+    const uint256 hashTx = tx.GetHash();
 
     // See if the transaction is already in a block
     // or in the memory pool:
@@ -1049,6 +1035,33 @@ Value sendrawtransaction(const Array& params, bool fHelp)
         SyncWithWallets(CTxDB(), tx, nullptr);
     }
     RelayTransaction(tx);
+}
+
+Value sendrawtransaction(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 1)
+        throw runtime_error(
+            "sendrawtransaction <hex string>\n"
+            "Submits raw transaction (serialized, hex-encoded) to local node and network.");
+
+    RPCTypeCheck(params, list_of(str_type));
+
+    // parse hex string from parameter
+    vector<unsigned char> txData(ParseHex(params[0].get_str()));
+    CDataStream           ssData(txData, SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction          tx;
+
+    // deserialize binary data stream
+    try {
+        ssData >> tx;
+    } catch (std::exception& e) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "TX decode failed");
+    }
+
+    SubmitRawTransaction(tx);
+
+    // the wallet knows about the transaction by the time the call returns
+    SyncWithValidationInterfaceQueue();
 
-    return hashTx.GetHex();
+    return tx.GetHash().GetHex();
 }
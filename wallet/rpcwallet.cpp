@@ -1306,29 +1306,25 @@ Value getntp1balances(const Array& params, bool fHelp)
     if (fHelp || params.size() > 1)
         throw runtime_error("getntp1balances [minconf=1]\n");
 
-    boost::shared_ptr<NTP1Wallet> ntp1wallet = boost::make_shared<NTP1Wallet>();
-
     int nMinDepth = 0;
     if (params.size() > 0)
         nMinDepth = params[0].get_int();
 
-    ntp1wallet->setRetrieveFullMetadata(false);
-    ntp1wallet->setMinMaxConfirmations(nMinDepth);
-    ntp1wallet->update();
+    LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    int tokenCount = ntp1wallet->getNumberOfTokens();
+    const std::map<std::string, NTP1Int> balances =
+        pwalletMain->ntp1WalletCache.GetBalances(*pwalletMain, nMinDepth);
 
     json_spirit::Object root;
 
-    for (int i = 0; i < tokenCount; i++) {
-        std::string tokenId   = ntp1wallet->getTokenID(i);
-        std::string tokenName = ntp1wallet->getTokenName(tokenId);
-        NTP1Int     balance   = ntp1wallet->getTokenBalance(tokenId);
+    for (const auto& tokenBalance : balances) {
+        const std::string& tokenId   = tokenBalance.first;
+        std::string        tokenName = pwalletMain->ntp1WalletCache.GetTokenName(tokenId);
 
         json_spirit::Object tokenJsonData;
         tokenJsonData.push_back(json_spirit::Pair("Name", tokenName));
         tokenJsonData.push_back(json_spirit::Pair("TokenId", tokenId));
-        tokenJsonData.push_back(json_spirit::Pair("Balance", ToString(balance)));
+        tokenJsonData.push_back(json_spirit::Pair("Balance", ToString(tokenBalance.second)));
 
         root.push_back(json_spirit::Pair(tokenId, tokenJsonData));
     }
@@ -1341,8 +1337,6 @@ Value getntp1balance(const Array& params, bool fHelp)
     if (fHelp || params.size() > 2)
         throw runtime_error("getntp1balance <tokenId/name> [minconf=1]\n");
 
-    boost::shared_ptr<NTP1Wallet> ntp1wallet = boost::make_shared<NTP1Wallet>();
-
     int    nMinDepth = 0;
     string requestedToken;
     string requestedTokenLowerCase;
@@ -1354,25 +1348,22 @@ Value getntp1balance(const Array& params, bool fHelp)
     std::transform(requestedToken.cbegin(), requestedToken.cend(),
                    std::back_inserter(requestedTokenLowerCase), ::tolower);
 
-    ntp1wallet->setRetrieveFullMetadata(false);
-    ntp1wallet->setMinMaxConfirmations(nMinDepth);
-    ntp1wallet->update();
+    LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    int tokenCount = ntp1wallet->getNumberOfTokens();
+    const std::map<std::string, NTP1Int> balances =
+        pwalletMain->ntp1WalletCache.GetBalances(*pwalletMain, nMinDepth);
 
     json_spirit::Object root;
 
-    for (int i = 0; i < tokenCount; i++) {
-        std::string tokenId   = ntp1wallet->getTokenID(i);
-        std::string tokenName = ntp1wallet->getTokenName(tokenId);
+    for (const auto& tokenBalance : balances) {
+        const std::string& tokenId   = tokenBalance.first;
+        std::string        tokenName = pwalletMain->ntp1WalletCache.GetTokenName(tokenId);
         std::transform(tokenName.begin(), tokenName.end(), tokenName.begin(), ::tolower);
         if (tokenId != requestedToken && tokenName != requestedTokenLowerCase) {
             continue;
         }
 
-        NTP1Int balance = ntp1wallet->getTokenBalance(tokenId);
-
-        return json_spirit::Value(ToString(balance));
+        return json_spirit::Value(ToString(tokenBalance.second));
     }
 
     return json_spirit::Value(root);
@@ -2128,10 +2119,7 @@ Value listsinceblock(const Array& params, bool fHelp)
     } else {
         int target_height = CTxDB().GetBestChainHeight().value_or(0) + 1 - target_confirms;
 
-        CBlockIndex* block;
-        for (block = txdb.GetBestBlockIndex().get(); block && block->nHeight > target_height;
-             block = boost::atomic_load(&block->pprev).get()) {
-        }
+        const CBlockIndex* block = chainActive[target_height];
 
         lastblock = block ? block->GetBlockHash() : 0;
     }
@@ -2425,6 +2413,9 @@ Value walletpassphrase(const Array& params, bool fHelp)
         fWalletUnlockStakingOnly = params[2].get_bool();
     else
         fWalletUnlockStakingOnly = false;
+    // keys decrypted for staking may not be kept by a fully unlocked wallet
+    if (!fWalletUnlockStakingOnly)
+        pwalletMain->DropDecryptedKeys();
 
     return Value::null;
 }
@@ -1869,7 +1869,7 @@ SignatureState SignSignature(const CKeyStore& keystore, const CScript& fromPubKe
         bool fSolved = Solver(txdb, keystore, subscript, hash2, nHashType, txin.scriptSig, subType) &&
                        subType != TX_SCRIPTHASH;
         // Append serialized subscript whether or not it is completely signed:
-        txin.scriptSig << static_cast<valtype>(subscript);
+        txin.scriptSig << valtype(subscript.begin(), subscript.end());
         if (!fSolved)
             return SignatureState::Failed;
     }
@@ -2080,9 +2080,9 @@ bool CScript::IsPayToScriptHash() const
 {
     // Extra-fast test for pay-to-script-hash CScripts:
     return (this->size() == 23 &&
-            this->at(0) == OP_HASH160 &&
-            this->at(1) == 0x14 &&
-            this->at(22) == OP_EQUAL);
+            (*this)[0] == OP_HASH160 &&
+            (*this)[1] == 0x14 &&
+            (*this)[22] == OP_EQUAL);
 }
 // clang-format off
 
@@ -2091,12 +2091,12 @@ bool CScript::IsPayToColdStaking() const
 {
     // Extra-fast test for pay-to-cold-staking CScripts:
     return (this->size() == 51 &&
-            this->at(2) == OP_ROT &&
-            this->at(4) == OP_CHECKCOLDSTAKEVERIFY &&
-            this->at(5) == 0x14 &&
-            this->at(27) == 0x14 &&
-            this->at(49) == OP_EQUALVERIFY &&
-            this->at(50) == OP_CHECKSIG);
+            (*this)[2] == OP_ROT &&
+            (*this)[4] == OP_CHECKCOLDSTAKEVERIFY &&
+            (*this)[5] == 0x14 &&
+            (*this)[27] == 0x14 &&
+            (*this)[49] == OP_EQUALVERIFY &&
+            (*this)[50] == OP_CHECKSIG);
 }
 // clang-format on
 
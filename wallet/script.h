@@ -272,7 +272,7 @@ inline std::string StackString(const std::vector<std::vector<unsigned char>>& vS
 ////////////////////////////////
 
 /** Serialized script, used inside transaction inputs and outputs */
-class CScript : public std::vector<unsigned char>
+class CScript : public CScriptBase
 {
 protected:
     CScript& push_int64(int64_t n)
@@ -299,14 +299,12 @@ protected:
 
 public:
     CScript() {}
-    CScript(const CScript& b) : std::vector<unsigned char>(b.begin(), b.end()) {}
-    CScript(const_iterator pbegin, const_iterator pend) : std::vector<unsigned char>(pbegin, pend) {}
-#ifndef _MSC_VER
-    CScript(const unsigned char* pbegin, const unsigned char* pend)
-        : std::vector<unsigned char>(pbegin, pend)
+    CScript(const_iterator pbegin, const_iterator pend) : CScriptBase(pbegin, pend) {}
+    CScript(std::vector<unsigned char>::const_iterator pbegin,
+            std::vector<unsigned char>::const_iterator pend)
+        : CScriptBase(pbegin, pend)
     {
     }
-#endif
 
     CScript& operator+=(const CScript& b)
     {
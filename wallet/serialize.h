@@ -21,12 +21,16 @@
 
 #include "allocators.h"
 #include "ntp1/ntp1script.h"
+#include "prevector.h"
 #include "version.h"
 
 class CAutoFile;
 class CDataStream;
 class CScript;
 
+// the container CScript is built on; most scripts fit in it without a heap allocation
+typedef prevector<28, unsigned char> CScriptBase;
+
 static const unsigned int MAX_SIZE = 0x02000000;
 
 // Used to bypass the rule against non-const reference to temporary
@@ -53,6 +57,9 @@ enum
     // modifiers
     SER_SKIPSIG         = (1 << 16),
     SER_BLOCKHEADERONLY = (1 << 17),
+    // when unserializing, vectors of objects are read into the elements they already hold, which
+    // keeps the buffers those own (see CBlockArena)
+    SER_REUSE_STORAGE   = (1 << 18),
 };
 
 #define IMPLEMENT_SERIALIZE(statements)    \
@@ -408,6 +415,11 @@ template<typename Stream, typename T, typename A> void Unserialize_impl(Stream&
 template<typename Stream, typename T, typename A> void Unserialize_impl(Stream& is, std::vector<T, A>& v, int nType, int nVersion, const boost::false_type&);
 template<typename Stream, typename T, typename A> inline void Unserialize(Stream& is, std::vector<T, A>& v, int nType, int nVersion);
 
+// prevector
+template<unsigned int N, typename T> unsigned int GetSerializeSize(const prevector<N, T>& v, int nType, int nVersion);
+template<typename Stream, unsigned int N, typename T> void Serialize(Stream& os, const prevector<N, T>& v, int nType, int nVersion);
+template<typename Stream, unsigned int N, typename T> void Unserialize(Stream& is, prevector<N, T>& v, int nType, int nVersion);
+
 // others derived from vector
 extern inline unsigned int GetSerializeSize(const CScript& v, int nType, int nVersion);
 template<typename Stream> void Serialize(Stream& os, const CScript& v, int nType, int nVersion);
@@ -595,16 +607,23 @@ void Unserialize_impl(Stream& is, std::vector<T, A>& v, int /*nType*/, int /*nVe
 template<typename Stream, typename T, typename A>
 void Unserialize_impl(Stream& is, std::vector<T, A>& v, int nType, int nVersion, const boost::false_type&)
 {
-    v.clear();
+    if (!(nType & SER_REUSE_STORAGE))
+        v.clear();
     unsigned int nSize = ReadCompactSize(is);
+    if (v.size() > nSize)
+        v.resize(nSize);
     unsigned int i = 0;
-    unsigned int nMid = 0;
-    while (nMid < nSize)
+    // the elements already there are overwritten in place
+    unsigned int nMid = v.size();
+    while (i < nSize)
     {
-        nMid += 5000000 / sizeof(T);
-        if (nMid > nSize)
-            nMid = nSize;
-        v.resize(nMid);
+        if (i == nMid)
+        {
+            nMid += 5000000 / sizeof(T);
+            if (nMid > nSize)
+                nMid = nSize;
+            v.resize(nMid);
+        }
         for (; i < nMid; i++)
             Unserialize(is, v[i], nType, nVersion);
     }
@@ -618,24 +637,63 @@ inline void Unserialize(Stream& is, std::vector<T, A>& v, int nType, int nVersio
 
 
 
+//
+// prevector, serialized like a vector; it only holds trivially copyable types, so only fundamental
+// ones are supported
+//
+template<unsigned int N, typename T>
+unsigned int GetSerializeSize(const prevector<N, T>& v, int /*nType*/, int /*nVersion*/)
+{
+    static_assert(boost::is_fundamental<T>::value, "prevectors of fundamental types only");
+    return (GetSizeOfCompactSize(v.size()) + v.size() * sizeof(T));
+}
+
+template<typename Stream, unsigned int N, typename T>
+void Serialize(Stream& os, const prevector<N, T>& v, int /*nType*/, int /*nVersion*/)
+{
+    static_assert(boost::is_fundamental<T>::value, "prevectors of fundamental types only");
+    WriteCompactSize(os, v.size());
+    if (!v.empty())
+        os.write((char*)v.data(), v.size() * sizeof(T));
+}
+
+template<typename Stream, unsigned int N, typename T>
+void Unserialize(Stream& is, prevector<N, T>& v, int /*nType*/, int /*nVersion*/)
+{
+    static_assert(boost::is_fundamental<T>::value, "prevectors of fundamental types only");
+    // Limit size per read so bogus size value won't cause out of memory
+    v.clear();
+    unsigned int nSize = ReadCompactSize(is);
+    unsigned int i = 0;
+    while (i < nSize)
+    {
+        unsigned int blk = std::min(nSize - i, (unsigned int)(1 + 4999999 / sizeof(T)));
+        v.resize_uninitialized(i + blk);
+        is.read((char*)&v[i], blk * sizeof(T));
+        i += blk;
+    }
+}
+
+
+
 //
 // others derived from vector
 //
 inline unsigned int GetSerializeSize(const CScript& v, int nType, int nVersion)
 {
-    return GetSerializeSize((const std::vector<unsigned char>&)v, nType, nVersion);
+    return GetSerializeSize((const CScriptBase&)v, nType, nVersion);
 }
 
 template<typename Stream>
 void Serialize(Stream& os, const CScript& v, int nType, int nVersion)
 {
-    Serialize(os, (const std::vector<unsigned char>&)v, nType, nVersion);
+    Serialize(os, (const CScriptBase&)v, nType, nVersion);
 }
 
 template<typename Stream>
 void Unserialize(Stream& is, CScript& v, int nType, int nVersion)
 {
-    Unserialize(is, (std::vector<unsigned char>&)v, nType, nVersion);
+    Unserialize(is, (CScriptBase&)v, nType, nVersion);
 }
 
 
@@ -73,8 +73,7 @@ TestAndCreateStakeKernel(const CTxDB& txdb, const StakeMaker::KeyGetterFunctorTy
         }
 
         // Found a kernel
-        if (fDebug)
-            printf("FindStakeKernel : kernel found\n");
+        LogPrint(LOG_STAKE, "FindStakeKernel : kernel found\n");
 
         const CScript& kernelScriptPubKey = pcoin.first->vout[pcoin.second].scriptPubKey;
 
@@ -82,8 +81,7 @@ TestAndCreateStakeKernel(const CTxDB& txdb, const StakeMaker::KeyGetterFunctorTy
             StakeMaker::CalculateScriptPubKeyForStakeOutput(txdb, keyGetter, kernelScriptPubKey);
 
         if (!spkKernel) {
-            if (fDebug)
-                printf("FindStakeKernel : failed to get scriptPubKey for kernel");
+            LogPrint(LOG_STAKE, "FindStakeKernel : failed to get scriptPubKey for kernel\n");
             continue;
         }
 
@@ -362,12 +360,10 @@ StakeMaker::CalculateScriptPubKeyForStakeOutput(const ITxDB& txdb, const KeyGett
     std::vector<valtype> vSolutions;
     txnouttype           whichType;
     if (!Solver(txdb, scriptPubKeyKernel, whichType, vSolutions)) {
-        if (fDebug)
-            printf("CalculateScriptPubKeyForStakeOutput : failed to parse kernel\n");
+        LogPrint(LOG_STAKE, "CalculateScriptPubKeyForStakeOutput : failed to parse kernel\n");
         return boost::none;
     }
-    if (fDebug)
-        printf("CalculateScriptPubKeyForStakeOutput : parsed kernel type=%d\n", whichType);
+    LogPrint(LOG_STAKE, "CalculateScriptPubKeyForStakeOutput : parsed kernel type=%d\n", whichType);
 
     switch (whichType) {
     case TX_PUBKEYHASH: // pay to address type
@@ -375,9 +371,9 @@ StakeMaker::CalculateScriptPubKeyForStakeOutput(const ITxDB& txdb, const KeyGett
         // convert to pay to public key type
         const boost::optional<CKey> key = keyGetter(uint160(vSolutions[0]));
         if (!key) {
-            if (fDebug)
-                printf("CalculateScriptPubKeyForStakeOutput : failed to get key for kernel type=%d\n",
-                       whichType);
+            LogPrint(LOG_STAKE,
+                     "CalculateScriptPubKeyForStakeOutput : failed to get key for kernel type=%d\n",
+                     whichType);
             return boost::none; // unable to find corresponding public key
         }
         return CScript() << key->GetPubKey() << OP_CHECKSIG;
@@ -387,16 +383,16 @@ StakeMaker::CalculateScriptPubKeyForStakeOutput(const ITxDB& txdb, const KeyGett
         const valtype&              vchPubKey = vSolutions[0];
         const boost::optional<CKey> key       = keyGetter(Hash160(vchPubKey));
         if (!key) {
-            if (fDebug)
-                printf("CalculateScriptPubKeyForStakeOutput : failed to get key for kernel type=%d\n",
-                       whichType);
+            LogPrint(LOG_STAKE,
+                     "CalculateScriptPubKeyForStakeOutput : failed to get key for kernel type=%d\n",
+                     whichType);
             return boost::none; // unable to find corresponding public key
         }
 
         if (key->GetPubKey() != vchPubKey) {
-            if (fDebug)
-                printf("CalculateScriptPubKeyForStakeOutput : invalid key for kernel P2PK type=%d\n",
-                       whichType);
+            LogPrint(LOG_STAKE,
+                     "CalculateScriptPubKeyForStakeOutput : invalid key for kernel P2PK type=%d\n",
+                     whichType);
             return boost::none; // keys mismatch
         }
         return scriptPubKeyKernel;
@@ -418,10 +414,9 @@ StakeMaker::CalculateScriptPubKeyForStakeOutput(const ITxDB& txdb, const KeyGett
         break;
     }
 
-    if (fDebug)
-        printf(
-            "CalculateScriptPubKeyForStakeOutput : Unsupported scriptPubKey type for staking type=%d\n",
-            whichType);
+    LogPrint(LOG_STAKE,
+             "CalculateScriptPubKeyForStakeOutput : Unsupported scriptPubKey type for staking type=%d\n",
+             whichType);
     return boost::none;
 }
 
@@ -4,9 +4,130 @@
 
 #include "sync.h"
 
+#include "locksite.h"
+#include "metrics.h"
 #include "util.h"
 
 #include <boost/foreach.hpp>
+#include <map>
+#include <tuple>
+
+namespace {
+// the mutexes that have a lock-wait metric; only a few, so RecordLockWait() just scans them
+struct LockWaitMetric
+{
+    std::atomic<const void*>       pMutex{nullptr};
+    std::atomic<CMetricHistogram*> pWaits{nullptr};
+};
+
+const int      MAX_LOCK_WAIT_METRICS = 8;
+LockWaitMetric lockWaitMetrics[MAX_LOCK_WAIT_METRICS];
+boost::mutex   lockWaitMetricsMutex; // serializes SetLockWaitMetricName()
+} // namespace
+
+void SetLockWaitMetricName(const void* pMutex, const char* pszName)
+{
+    CMetricHistogram* pWaits =
+        pszName ? &Metrics().Histogram("neblio_lock_wait_seconds", MetricLabel("lock", pszName)) : nullptr;
+
+    boost::lock_guard<boost::mutex> lock(lockWaitMetricsMutex);
+    LockWaitMetric*                 pFree = nullptr;
+    for (LockWaitMetric& metric : lockWaitMetrics) {
+        const void* p = metric.pMutex.load(std::memory_order_relaxed);
+        if (p == pMutex) {
+            metric.pWaits.store(pWaits, std::memory_order_release);
+            return;
+        }
+        if (p == nullptr && pFree == nullptr) {
+            pFree = &metric;
+        }
+    }
+    if (pWaits == nullptr) {
+        return;
+    }
+    if (pFree == nullptr) {
+        printf("SetLockWaitMetricName(): no room left for the lock-wait metric of %s\n", pszName);
+        return;
+    }
+    pFree->pWaits.store(pWaits, std::memory_order_relaxed);
+    pFree->pMutex.store(pMutex, std::memory_order_release);
+}
+
+void RecordLockWait(const void* pMutex, std::chrono::steady_clock::duration wait)
+{
+    for (const LockWaitMetric& metric : lockWaitMetrics) {
+        if (metric.pMutex.load(std::memory_order_acquire) == pMutex) {
+            CMetricHistogram* pWaits = metric.pWaits.load(std::memory_order_acquire);
+            if (pWaits) {
+                pWaits->Record(wait);
+            }
+            return;
+        }
+    }
+}
+
+CLockSite::CLockSite(const char* pszNameIn, const char* pszFileIn, int nLineIn)
+    : pszName(pszNameIn), pszFile(pszFileIn), nLine(nLineIn)
+{
+}
+
+std::atomic<uint32_t> CLockProfiler::nSampleInterval{0};
+
+// plain boost::mutex, as sites are created from within LOCK()
+static boost::mutex lockSitesMutex;
+
+static std::map<std::tuple<std::string, int, std::string>, std::unique_ptr<CLockSite>>& LockSites()
+{
+    // never destroyed, as locks may be taken by threads that outlive static destruction
+    static auto* sites = new std::map<std::tuple<std::string, int, std::string>, std::unique_ptr<CLockSite>>;
+    return *sites;
+}
+
+CLockSite& CLockProfiler::Site(const char* pszName, const char* pszFile, int nLine)
+{
+    boost::lock_guard<boost::mutex> lock(lockSitesMutex);
+    std::unique_ptr<CLockSite>&     site = LockSites()[std::make_tuple(pszFile, nLine, pszName)];
+    if (!site) {
+        site.reset(new CLockSite(pszName, pszFile, nLine));
+    }
+    return *site;
+}
+
+void CLockProfiler::RecordSample(CLockSite& site, uint32_t nInterval, bool fContended,
+                                 std::chrono::steady_clock::duration wait)
+{
+    site.acquisitions.Inc(nInterval);
+    site.sampled.Inc();
+    site.waits.Record(wait);
+    if (fContended) {
+        site.contended.Inc();
+    }
+}
+
+void CLockProfiler::RecordHold(CLockSite& site, std::chrono::steady_clock::duration hold)
+{
+    site.holds.Record(hold);
+}
+
+void CLockProfiler::ForEachSite(const std::function<void(const CLockSite&)>& f)
+{
+    boost::lock_guard<boost::mutex> lock(lockSitesMutex);
+    for (const auto& site : LockSites()) {
+        f(*site.second);
+    }
+}
+
+void CLockProfiler::Reset()
+{
+    boost::lock_guard<boost::mutex> lock(lockSitesMutex);
+    for (const auto& site : LockSites()) {
+        site.second->acquisitions.Reset();
+        site.second->sampled.Reset();
+        site.second->contended.Reset();
+        site.second->waits.Reset();
+        site.second->holds.Reset();
+    }
+}
 
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
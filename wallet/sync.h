@@ -8,12 +8,15 @@
 
 #include "threadsafety.h"
 
+#include <atomic>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/atomic.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/optional.hpp>
+#include <chrono>
+#include <functional>
 
 
 ////////////////////////////////////////////////
@@ -229,10 +232,204 @@ auto _trylock4_internal(M1&& m1, M2&& m2, M3&& m3, M4&& m4) -> __Lock4ReturnType
     }
 }
 
-#define LOCK(cs) boost::lock_guard<decltype(cs)> __lockguard__(cs)
-#define LOCKN(cs, name) boost::lock_guard<decltype(cs)> name(cs)
-#define LOCK2(cs1, cs2) auto __lockguard2__ = _lock2_internal(cs1, cs2)
-#define LOCK2N(cs1, cs2, name) auto name = _lock2_internal(cs1, cs2)
+class CLockSite; // locksite.h
+
+/**
+ * Names the lock-wait metric of the mutex at pMutex, so that how long contended LOCK()s of it waited is
+ * recorded in neblio_lock_wait_seconds{lock="<pszName>"}; nullptr stops recording them. Only the
+ * busiest locks get a name, the waits for all the others aren't recorded.
+ */
+void SetLockWaitMetricName(const void* pMutex, const char* pszName);
+
+/** records how long a LOCK() waited for the mutex at pMutex, if the mutex has a lock-wait metric */
+void RecordLockWait(const void* pMutex, std::chrono::steady_clock::duration wait);
+
+/**
+ * Profiles lock contention per site. When it's enabled, one in every SampleInterval acquisitions by a
+ * thread is timed: how long it waited for the lock, and how long it held it. It's disabled by default
+ * (-lockprofile, setlockprofiling), and then all a LOCK() adds is reading the interval.
+ */
+class CLockProfiler
+{
+    static std::atomic<uint32_t> nSampleInterval;
+
+public:
+    /** 0 disables the profiler, 1 times every acquisition */
+    static void     SetSampleInterval(uint32_t n) { nSampleInterval.store(n, std::memory_order_relaxed); }
+    static uint32_t GetSampleInterval() { return nSampleInterval.load(std::memory_order_relaxed); }
+
+    /** whether to time this acquisition; nIntervalOut is then the number of acquisitions it stands for */
+    static bool ShouldSample(uint32_t& nIntervalOut)
+    {
+        const uint32_t n = GetSampleInterval();
+        if (n == 0) {
+            return false;
+        }
+        static thread_local uint32_t nSinceSample = 0;
+        if (++nSinceSample < n) {
+            return false;
+        }
+        nSinceSample = 0;
+        nIntervalOut = n;
+        return true;
+    }
+
+    /** the site at pszFile:nLine; a template's instantiations share theirs */
+    static CLockSite& Site(const char* pszName, const char* pszFile, int nLine);
+
+    /** records an acquisition sampled at site, which stands for nInterval of them */
+    static void RecordSample(CLockSite& site, uint32_t nInterval, bool fContended,
+                             std::chrono::steady_clock::duration wait);
+    static void RecordHold(CLockSite& site, std::chrono::steady_clock::duration hold);
+
+    static void ForEachSite(const std::function<void(const CLockSite&)>& f);
+
+    /** clears what was measured at every site */
+    static void Reset();
+};
+
+/** the measuring shared by the lock guards of LOCK() and LOCK2() */
+class CLockSiteTimer
+{
+    CLockSite*                            site = nullptr; // set when sampled
+    std::chrono::steady_clock::time_point acquired;
+
+public:
+    /**
+     * Acquires the lock with tryLock(), or else lock(). The wait of a sampled acquisition is recorded
+     * at the site; lock() records the waits of the contended mutexes in their lock-wait metrics.
+     */
+    template <typename GetSite, typename TryLock, typename Lock>
+    void Acquire(GetSite getSite, TryLock tryLock, Lock lock)
+    {
+        uint32_t nInterval = 0;
+        if (CLockProfiler::ShouldSample(nInterval)) {
+            site = &getSite();
+            const std::chrono::steady_clock::time_point start      = std::chrono::steady_clock::now();
+            const bool                                  fContended = !tryLock();
+            if (fContended) {
+                lock();
+            }
+            acquired = std::chrono::steady_clock::now();
+            CLockProfiler::RecordSample(*site, nInterval, fContended, acquired - start);
+        } else if (!tryLock()) {
+            lock();
+        }
+    }
+
+    /** releases the lock with unlock(), and records how long it was held if it was sampled */
+    template <typename Unlock>
+    void Release(Unlock unlock)
+    {
+        if (!site) {
+            unlock();
+            return;
+        }
+        const std::chrono::steady_clock::time_point released = std::chrono::steady_clock::now();
+        unlock();
+        CLockProfiler::RecordHold(*site, released - acquired);
+    }
+};
+
+/** locks lock, of the mutex at pMutex, recording how long it waited if it had to */
+template <typename Lock>
+void LockMeasuringWait(Lock& lock, const void* pMutex)
+{
+    if (lock.try_lock()) {
+        return;
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    lock.lock();
+    RecordLockWait(pMutex, std::chrono::steady_clock::now() - start);
+}
+
+/**
+ * What LOCK() expands to: a lock_guard that measures its lock, see CLockSiteTimer. getSite is only
+ * called when the lock is sampled, so an uncontended lock costs a try_lock() and, while the profiler is
+ * enabled, a thread-local counter.
+ */
+template <typename Mutex>
+class CMeasuredLockGuard
+{
+    Mutex&         mutex;
+    CLockSiteTimer timer;
+
+public:
+    template <typename GetSite>
+    CMeasuredLockGuard(Mutex& mutexIn, GetSite getSite) : mutex(mutexIn)
+    {
+        timer.Acquire(getSite, [this]() { return mutex.try_lock(); },
+                      [this]() { LockMeasuringWait(mutex, &mutex); });
+    }
+
+    ~CMeasuredLockGuard()
+    {
+        timer.Release([this]() { mutex.unlock(); });
+    }
+
+    CMeasuredLockGuard(const CMeasuredLockGuard&) = delete;
+    CMeasuredLockGuard& operator=(const CMeasuredLockGuard&) = delete;
+};
+
+/**
+ * What LOCK2() expands to: both mutexes are taken without deadlocking the way boost::lock() does,
+ * blocking on one of them at a time and trying the other, so that every wait is recorded for the mutex
+ * that was waited for. The site measures the pair as one.
+ */
+template <typename Mutex1, typename Mutex2>
+class CMeasuredLock2Guard
+{
+    boost::unique_lock<Mutex1> lock1;
+    boost::unique_lock<Mutex2> lock2;
+    CLockSiteTimer             timer;
+
+public:
+    template <typename GetSite>
+    CMeasuredLock2Guard(Mutex1& mutex1, Mutex2& mutex2, GetSite getSite)
+        : lock1(mutex1, boost::defer_lock), lock2(mutex2, boost::defer_lock)
+    {
+        timer.Acquire(getSite, [this]() { return boost::try_lock(lock1, lock2) == -1; },
+                      [this]() {
+                          while (true) {
+                              LockMeasuringWait(lock1, lock1.mutex());
+                              if (lock2.try_lock()) {
+                                  return;
+                              }
+                              lock1.unlock();
+                              LockMeasuringWait(lock2, lock2.mutex());
+                              if (lock1.try_lock()) {
+                                  return;
+                              }
+                              lock2.unlock();
+                          }
+                      });
+    }
+
+    ~CMeasuredLock2Guard()
+    {
+        timer.Release([this]() {
+            lock2.unlock();
+            lock1.unlock();
+        });
+    }
+
+    CMeasuredLock2Guard(const CMeasuredLock2Guard&) = delete;
+    CMeasuredLock2Guard& operator=(const CMeasuredLock2Guard&) = delete;
+};
+
+// looks the site up once per LOCK() in the code, the first time it's sampled
+#define LOCK_SITE(name)                                                                                \
+    []() -> CLockSite& {                                                                               \
+        static CLockSite& __locksite__ = CLockProfiler::Site(name, __FILE__, __LINE__);                \
+        return __locksite__;                                                                           \
+    }
+
+#define LOCK(cs) CMeasuredLockGuard<decltype(cs)> __lockguard__(cs, LOCK_SITE(#cs))
+#define LOCKN(cs, name) CMeasuredLockGuard<decltype(cs)> name(cs, LOCK_SITE(#cs))
+#define LOCK2(cs1, cs2)                                                                                \
+    CMeasuredLock2Guard<decltype(cs1), decltype(cs2)> __lockguard2__(cs1, cs2, LOCK_SITE(#cs1 ", " #cs2))
+#define LOCK2N(cs1, cs2, name)                                                                         \
+    CMeasuredLock2Guard<decltype(cs1), decltype(cs2)> name(cs1, cs2, LOCK_SITE(#cs1 ", " #cs2))
 #define TRY_LOCK(cs, name) auto name = _trylock_internal(cs)
 #define TRY_LOCK2(cs1, cs2, name) auto name = _trylock2_internal(cs1, cs2)
 #define TRY_LOCK4(cs1, cs2, cs3, cs4, name) auto name = _trylock4_internal(cs1, cs2, cs3, cs4)
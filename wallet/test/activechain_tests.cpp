@@ -0,0 +1,72 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "activechain.h"
+#include "blockindex.h"
+
+#include <boost/make_shared.hpp>
+#include <vector>
+
+static std::vector<CBlockIndexSmartPtr> MakeBranch(const CBlockIndexSmartPtr& pfork, int length)
+{
+    std::vector<CBlockIndexSmartPtr> result;
+    CBlockIndexSmartPtr              pprev = pfork;
+    for (int i = 0; i < length; i++) {
+        CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>();
+        pindex->pprev              = pprev;
+        pindex->nHeight            = pprev ? pprev->nHeight + 1 : 0;
+        result.push_back(pindex);
+        pprev = pindex;
+    }
+    return result;
+}
+
+TEST(activechain_tests, empty)
+{
+    ActiveChain chain;
+    EXPECT_EQ(chain.Height(), -1);
+    EXPECT_EQ(chain.Tip(), nullptr);
+    EXPECT_EQ(chain.Genesis(), nullptr);
+    EXPECT_EQ(chain[0], nullptr);
+    EXPECT_FALSE(chain.Contains(nullptr));
+}
+
+TEST(activechain_tests, set_tip_and_reorganize)
+{
+    const std::vector<CBlockIndexSmartPtr> mainBranch = MakeBranch(nullptr, 100);
+
+    ActiveChain chain;
+    chain.SetTip(mainBranch.back().get());
+    EXPECT_EQ(chain.Height(), 99);
+    EXPECT_EQ(chain.Genesis(), mainBranch.front().get());
+    EXPECT_EQ(chain.Tip(), mainBranch.back().get());
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(chain[i], mainBranch[i].get());
+        EXPECT_TRUE(chain.Contains(mainBranch[i].get()));
+    }
+    EXPECT_EQ(chain[-1], nullptr);
+    EXPECT_EQ(chain[100], nullptr);
+    EXPECT_EQ(chain.Next(mainBranch[10].get()), mainBranch[11].get());
+    EXPECT_EQ(chain.Next(mainBranch.back().get()), nullptr);
+
+    // a side branch forking at height 49 that's longer than the main one
+    const std::vector<CBlockIndexSmartPtr> sideBranch = MakeBranch(mainBranch[49], 70);
+    EXPECT_FALSE(chain.Contains(sideBranch.front().get()));
+    EXPECT_EQ(chain.Next(sideBranch.front().get()), nullptr);
+
+    chain.SetTip(sideBranch.back().get());
+    EXPECT_EQ(chain.Height(), 119);
+    EXPECT_EQ(chain[49], mainBranch[49].get());
+    EXPECT_EQ(chain[50], sideBranch[0].get());
+    EXPECT_EQ(chain.Next(mainBranch[49].get()), sideBranch[0].get());
+    EXPECT_FALSE(chain.Contains(mainBranch[50].get()));
+    EXPECT_FALSE(chain.Contains(mainBranch.back().get()));
+
+    // going back to a shorter chain drops the heights above the new tip
+    chain.SetTip(mainBranch[20].get());
+    EXPECT_EQ(chain.Height(), 20);
+    EXPECT_EQ(chain.Tip(), mainBranch[20].get());
+    EXPECT_FALSE(chain.Contains(sideBranch.front().get()));
+
+    chain.SetTip(nullptr);
+    EXPECT_EQ(chain.Height(), -1);
+}
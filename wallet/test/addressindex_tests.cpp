@@ -0,0 +1,173 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "addressindex.h"
+#include "base58.h"
+#include "block.h"
+#include "txdb-lmdb.h"
+
+#include <limits>
+
+static const CKeyID KeyA(uint160(1));
+static const CKeyID KeyB(uint160(2));
+
+static CAmount GetBalance(const CTxDB& txdb, const std::string& address)
+{
+    std::vector<CAddressUnspentEntry> outputs;
+    EXPECT_TRUE(txdb.ReadAddressUnspentOutputs(address, outputs));
+    CAmount total = 0;
+    for (const CAddressUnspentEntry& output : outputs) {
+        total += output.nValue;
+    }
+    return total;
+}
+
+static std::size_t GetHistorySize(const CTxDB& txdb, const std::string& address)
+{
+    std::vector<CAddressIndexEntry> entries;
+    EXPECT_TRUE(txdb.ReadAddressIndex(address, entries));
+    return entries.size();
+}
+
+// a block whose coinbase pays KeyA, and a transaction spending it to KeyB with change
+static CBlock MakeBlockWithInternalSpend()
+{
+    CTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.push_back(CTxOut(1000, GetScriptForDestination(KeyA)));
+
+    CTransaction pay;
+    pay.vin.resize(1);
+    pay.vin[0].prevout = COutPoint(coinbase.GetHash(), 0);
+    pay.vout.push_back(CTxOut(600, GetScriptForDestination(KeyB)));
+    pay.vout.push_back(CTxOut(390, GetScriptForDestination(KeyA)));
+    pay.vout.push_back(CTxOut(10, CScript() << OP_RETURN));
+
+    CBlock block;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(pay);
+    return block;
+}
+
+TEST(addressindex_tests, connect_and_disconnect)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB txdb;
+
+    const std::string AddressA = CBitcoinAddress(KeyA).ToString();
+    const std::string AddressB = CBitcoinAddress(KeyB).ToString();
+
+    // transactions spending each other in the same block don't need the db to be resolved
+    const CBlock       block   = MakeBlockWithInternalSpend();
+    const uint256      payTxid = block.vtx[1].GetHash();
+    const COutPoint    coinbaseOut(block.vtx[0].GetHash(), 0);
+    CAddressIndexDelta delta;
+    ASSERT_TRUE(GetAddressIndexDelta(block, 10, txdb, delta));
+
+    // the coinbase and the two outputs of pay with an address; OP_RETURN has none
+    EXPECT_EQ(delta.createdOutputs.size(), 3u);
+    EXPECT_EQ(delta.spentOutputs.size(), 1u);
+    EXPECT_EQ(delta.entries.size(), 4u);
+    ASSERT_EQ(delta.spends.size(), 1u);
+    EXPECT_EQ(delta.spends[0].first, coinbaseOut);
+    EXPECT_EQ(delta.spends[0].second.txid, payTxid);
+    EXPECT_EQ(delta.spends[0].second.address, AddressA);
+
+    ASSERT_TRUE(ApplyAddressIndexDelta(txdb, delta, false, true, true));
+    EXPECT_EQ(GetBalance(txdb, AddressA), 390);
+    EXPECT_EQ(GetBalance(txdb, AddressB), 600);
+    EXPECT_EQ(GetHistorySize(txdb, AddressA), 3u);
+    EXPECT_EQ(GetHistorySize(txdb, AddressB), 1u);
+
+    CSpentIndexValue spent;
+    ASSERT_TRUE(txdb.ReadSpentIndex(coinbaseOut, spent));
+    EXPECT_EQ(spent.txid, payTxid);
+    EXPECT_EQ(spent.nInputIndex, 0u);
+    EXPECT_EQ(spent.nHeight, 10);
+    EXPECT_EQ(spent.nValue, 1000);
+    EXPECT_FALSE(txdb.ReadSpentIndex(COutPoint(payTxid, 0), spent));
+
+    // spending an output that isn't in the index means the index is broken
+    CAddressIndexDelta unknownSpend;
+    const CAddressUnspentEntry unknownOutput(COutPoint(uint256(1), 0), 5, 3,
+                                             GetScriptForDestination(KeyB));
+    unknownSpend.spentOutputs.push_back(std::make_pair(AddressB, unknownOutput));
+    txdb.TxnBegin();
+    EXPECT_FALSE(ApplyAddressIndexDelta(txdb, unknownSpend, false, true, false));
+    txdb.TxnAbort();
+
+    // disconnecting the block restores the previous state
+    ASSERT_TRUE(ApplyAddressIndexDelta(txdb, delta, true, true, true));
+    EXPECT_EQ(GetBalance(txdb, AddressA), 0);
+    EXPECT_EQ(GetBalance(txdb, AddressB), 0);
+    EXPECT_EQ(GetHistorySize(txdb, AddressA), 0u);
+    EXPECT_EQ(GetHistorySize(txdb, AddressB), 0u);
+    EXPECT_FALSE(txdb.ReadSpentIndex(coinbaseOut, spent));
+
+    // the completeness flags are cleared together with the tables
+    ASSERT_TRUE(ApplyAddressIndexDelta(txdb, delta, false, true, true));
+    ASSERT_TRUE(txdb.WriteAddressIndexComplete(true));
+    ASSERT_TRUE(txdb.WriteSpentIndexComplete(true));
+    ASSERT_TRUE(txdb.ClearAddressIndex());
+    EXPECT_FALSE(txdb.IsAddressIndexComplete());
+    EXPECT_TRUE(txdb.IsSpentIndexComplete());
+    EXPECT_EQ(GetHistorySize(txdb, AddressA), 0u);
+    EXPECT_EQ(GetBalance(txdb, AddressB), 0);
+    ASSERT_TRUE(txdb.ClearSpentIndex());
+    EXPECT_FALSE(txdb.IsSpentIndexComplete());
+    EXPECT_FALSE(txdb.ReadSpentIndex(coinbaseOut, spent));
+
+    txdb.Close();
+}
+
+TEST(addressindex_tests, read_height_range)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB txdb;
+
+    const std::string AddressA = CBitcoinAddress(KeyA).ToString();
+    const std::string AddressB = CBitcoinAddress(KeyB).ToString();
+
+    // written out of order, with heights whose little-endian bytes would sort differently
+    const std::vector<int> heights = {300, 1, 256, 0, 70000, 255, 2};
+    for (int nHeight : heights) {
+        ASSERT_TRUE(txdb.AddAddressIndexEntry(
+            AddressA, CAddressIndexEntry(uint256(1000 - nHeight), 0, nHeight, 5, false)));
+    }
+    ASSERT_TRUE(txdb.AddAddressIndexEntry(AddressB, CAddressIndexEntry(uint256(7), 0, 256, 5, false)));
+
+    auto readHeights = [&](int nStart, int nEnd) {
+        std::vector<CAddressIndexEntry> entries;
+        EXPECT_TRUE(txdb.ReadAddressIndex(AddressA, nStart, nEnd, entries));
+        std::vector<int> result;
+        for (const CAddressIndexEntry& entry : entries) {
+            result.push_back(entry.nHeight);
+        }
+        return result;
+    };
+
+    EXPECT_EQ(readHeights(0, std::numeric_limits<int>::max()),
+              std::vector<int>({0, 1, 2, 255, 256, 300, 70000}));
+    EXPECT_EQ(readHeights(2, 300), std::vector<int>({2, 255, 256, 300}));
+    EXPECT_EQ(readHeights(256, 256), std::vector<int>({256}));
+    EXPECT_EQ(readHeights(3, 254), std::vector<int>());
+    EXPECT_EQ(readHeights(70001, 80000), std::vector<int>());
+
+    // an address without entries, and the entries of the other address aren't included
+    std::vector<CAddressIndexEntry> entries;
+    EXPECT_TRUE(txdb.ReadAddressIndex(CBitcoinAddress(CKeyID(uint160(3))).ToString(), 0, 1000, entries));
+    EXPECT_TRUE(entries.empty());
+    EXPECT_TRUE(txdb.ReadAddressIndex(AddressB, 0, 1000, entries));
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0], CAddressIndexEntry(uint256(7), 0, 256, 5, false));
+
+    txdb.Close();
+}
@@ -0,0 +1,97 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "block.h"
+#include "blockarena.h"
+#include "serialize.h"
+#include "version.h"
+
+// a block of txCount transactions with inCount inputs and outputs each; the scripts are as big as
+// scriptSize, so that they may or may not fit inline
+static CBlock MakeBlock(int txCount, unsigned inCount, unsigned scriptSize, unsigned char seed)
+{
+    CBlock block;
+    block.nTime = 1600000000 + seed;
+    for (int i = 0; i < txCount; i++) {
+        CTransaction tx;
+        tx.nTime = block.nTime;
+        for (unsigned j = 0; j < inCount; j++) {
+            CTxIn txin;
+            txin.prevout   = COutPoint(uint256(static_cast<uint64_t>(seed * 1000 + i)), j);
+            txin.scriptSig = CScript() << std::vector<unsigned char>(scriptSize, seed + j);
+            tx.vin.push_back(txin);
+            tx.vout.push_back(
+                CTxOut(i + j, CScript() << std::vector<unsigned char>(scriptSize / 2 + j, seed)));
+        }
+        block.vtx.push_back(tx);
+    }
+    block.vchBlockSig.assign(scriptSize, seed);
+    return block;
+}
+
+static CDataStream Serialized(const CBlock& block)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    return ss;
+}
+
+// whatever the arena held before, a block read in it is the block that was serialized
+TEST(blockarena_tests, read_matches_fresh_block)
+{
+    const std::vector<CBlock> blocks{MakeBlock(50, 2, 100, 1), MakeBlock(10, 1, 10, 2),
+                                     MakeBlock(80, 3, 20, 3), MakeBlock(0, 0, 0, 4),
+                                     MakeBlock(50, 2, 100, 5), MakeBlock(50, 4, 120, 6)};
+
+    CBlockArena arena;
+    for (const CBlock& block : blocks) {
+        CDataStream   ss   = Serialized(block);
+        const CBlock& read = arena.Read(ss);
+        EXPECT_TRUE(ss.empty());
+        EXPECT_EQ(read.GetHash(), block.GetHash());
+        ASSERT_EQ(read.vtx.size(), block.vtx.size());
+        for (unsigned i = 0; i < block.vtx.size(); i++) {
+            EXPECT_TRUE(read.vtx[i] == block.vtx[i]);
+        }
+        EXPECT_EQ(read.vchBlockSig, block.vchBlockSig);
+        EXPECT_EQ(Serialized(read).str(), Serialized(block).str());
+    }
+}
+
+TEST(blockarena_tests, storage_is_reused)
+{
+    const CBlock block = MakeBlock(20, 2, 100, 1);
+    const CBlock other = MakeBlock(20, 2, 100, 2);
+
+    CBlockArena arena;
+    CDataStream ss = Serialized(block);
+    arena.Read(ss);
+    const CTransaction*  txs       = arena.GetBlock().vtx.data();
+    const unsigned char* scriptSig = arena.GetBlock().vtx[5].vin[1].scriptSig.data();
+
+    ss                 = Serialized(other);
+    const CBlock& read = arena.Read(ss);
+    EXPECT_EQ(read.GetHash(), other.GetHash());
+    EXPECT_EQ(read.vtx.data(), txs);
+    EXPECT_EQ(read.vtx[5].vin[1].scriptSig.data(), scriptSig);
+
+    arena.Clear();
+    EXPECT_TRUE(arena.GetBlock().vtx.empty());
+    EXPECT_EQ(arena.GetBlock().vtx.capacity(), 0u);
+}
+
+// what isn't serialized doesn't carry over from one block to the next
+TEST(blockarena_tests, non_serialized_state_is_reset)
+{
+    CBlockArena arena;
+    CDataStream ss = Serialized(MakeBlock(3, 1, 10, 1));
+    arena.Read(ss);
+    arena.GetBlock().DoS(10, false);
+    arena.GetBlock().vtx[0].DoS(10, false);
+    arena.GetBlock().reject = CBlock::CBlockReject(REJECT_INVALID, "bad-block");
+
+    ss                 = Serialized(MakeBlock(3, 1, 10, 2));
+    const CBlock& read = arena.Read(ss);
+    EXPECT_EQ(read.nDoS, 0);
+    EXPECT_EQ(read.vtx[0].nDoS, 0);
+    EXPECT_FALSE(read.reject);
+}
@@ -0,0 +1,145 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "block.h"
+#include "blockencodings.h"
+#include "txmempool.h"
+
+static CBlock BuildBlock(int txCount)
+{
+    CBlock block;
+    block.nBits = 0x207fffff;
+    block.nTime = 1500000000;
+    block.vtx.resize(txCount);
+    block.vtx[0].vin.resize(1);
+    block.vtx[0].vin[0].prevout.SetNull();
+    block.vtx[0].vin[0].scriptSig = CScript() << 1;
+    block.vtx[0].vout.push_back(CTxOut(50, CScript() << OP_TRUE));
+    for (int i = 1; i < txCount; i++) {
+        block.vtx[i].vin.resize(1);
+        block.vtx[i].vin[0].prevout = COutPoint(block.vtx[i - 1].GetHash(), 0);
+        block.vtx[i].vout.push_back(CTxOut(50 - i, CScript() << OP_TRUE));
+    }
+    block.hashMerkleRoot = block.GetMerkleRoot();
+    return block;
+}
+
+static CBlockHeaderAndShortTxIDs RoundTrip(const CBlockHeaderAndShortTxIDs& cmpctblock)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << cmpctblock;
+    CBlockHeaderAndShortTxIDs result;
+    ss >> result;
+    EXPECT_TRUE(ss.empty());
+    return result;
+}
+
+TEST(blockencodings_tests, serialization)
+{
+    const CBlock                    block = BuildBlock(5);
+    const CBlockHeaderAndShortTxIDs cmpctblock(block, 42);
+    ASSERT_EQ(cmpctblock.prefilledTxs.size(), 1u);
+    EXPECT_EQ(cmpctblock.prefilledTxs[0].index, 0u);
+    EXPECT_EQ(cmpctblock.shortTxIDs.size(), 4u);
+    EXPECT_EQ(cmpctblock.BlockTxCount(), block.vtx.size());
+
+    const CBlockHeaderAndShortTxIDs read = RoundTrip(cmpctblock);
+    EXPECT_EQ(read.header.GetHash(), block.GetHash());
+    EXPECT_EQ(read.nonce, 42u);
+    EXPECT_EQ(read.shortTxIDs, cmpctblock.shortTxIDs);
+    for (std::size_t i = 1; i < block.vtx.size(); i++) {
+        // the ids are 6 bytes, and the receiver derives them the same way
+        EXPECT_EQ(read.shortTxIDs[i - 1], cmpctblock.GetShortID(block.vtx[i].GetHash()));
+        EXPECT_EQ(read.GetShortID(block.vtx[i].GetHash()) >> 48, 0u);
+    }
+
+    // another nonce gives other ids for the same block
+    const CBlockHeaderAndShortTxIDs other(block, 43);
+    EXPECT_NE(other.shortTxIDs, cmpctblock.shortTxIDs);
+
+    BlockTransactionsRequest req;
+    req.blockhash = block.GetHash();
+    req.indexes   = {0, 1, 5, 6, 1000};
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << req;
+    // the indexes are sent as the differences between them, in a byte each here
+    EXPECT_EQ(ss.size(), 32u + 1 + 4 + 3);
+    BlockTransactionsRequest readReq;
+    ss >> readReq;
+    EXPECT_EQ(readReq.blockhash, req.blockhash);
+    EXPECT_EQ(readReq.indexes, req.indexes);
+}
+
+TEST(blockencodings_tests, reconstruct_from_mempool)
+{
+    const CBlock                    block      = BuildBlock(6);
+    const CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block, 7));
+
+    CTxMemPool pool;
+    for (int i : {1, 3, 5}) {
+        pool.mapTx[block.vtx[i].GetHash()] = block.vtx[i];
+    }
+    CTransaction unrelated;
+    unrelated.vout.push_back(CTxOut(1, CScript() << OP_FALSE));
+    pool.mapTx[unrelated.GetHash()] = unrelated;
+
+    PartiallyDownloadedBlock partialBlock;
+    ASSERT_EQ(partialBlock.InitData(cmpctblock, pool), READ_STATUS_OK);
+    EXPECT_EQ(partialBlock.GetBlockHash(), block.GetHash());
+    EXPECT_TRUE(partialBlock.IsTxAvailable(0));
+    EXPECT_EQ(partialBlock.GetMissingIndexes(), std::vector<uint32_t>({2, 4}));
+
+    CBlock filled;
+    ASSERT_EQ(partialBlock.FillBlock(filled, {block.vtx[2], block.vtx[4]}), READ_STATUS_OK);
+    EXPECT_EQ(filled.GetHash(), block.GetHash());
+    ASSERT_EQ(filled.vtx.size(), block.vtx.size());
+    for (std::size_t i = 0; i < block.vtx.size(); i++) {
+        EXPECT_EQ(filled.vtx[i].GetHash(), block.vtx[i].GetHash());
+    }
+
+    // everything found in the mempool needs no round trip
+    pool.mapTx[block.vtx[2].GetHash()] = block.vtx[2];
+    pool.mapTx[block.vtx[4].GetHash()] = block.vtx[4];
+    PartiallyDownloadedBlock complete;
+    ASSERT_EQ(complete.InitData(cmpctblock, pool), READ_STATUS_OK);
+    EXPECT_TRUE(complete.GetMissingIndexes().empty());
+    ASSERT_EQ(complete.FillBlock(filled, {}), READ_STATUS_OK);
+    EXPECT_EQ(filled.GetMerkleRoot(), block.hashMerkleRoot);
+}
+
+TEST(blockencodings_tests, bad_transactions)
+{
+    const CBlock                    block = BuildBlock(4);
+    const CBlockHeaderAndShortTxIDs cmpctblock(block, 1);
+    CTxMemPool                      pool;
+
+    // too few or too many transactions for what's missing is the peer's fault
+    PartiallyDownloadedBlock partialBlock;
+    ASSERT_EQ(partialBlock.InitData(cmpctblock, pool), READ_STATUS_OK);
+    CBlock filled;
+    EXPECT_EQ(partialBlock.FillBlock(filled, {block.vtx[1], block.vtx[2]}), READ_STATUS_INVALID);
+    ASSERT_EQ(partialBlock.InitData(cmpctblock, pool), READ_STATUS_OK);
+    EXPECT_EQ(partialBlock.FillBlock(filled, {block.vtx[1], block.vtx[2], block.vtx[3], block.vtx[3]}),
+              READ_STATUS_INVALID);
+
+    // transactions that don't make up the block make it fall back to the full block
+    ASSERT_EQ(partialBlock.InitData(cmpctblock, pool), READ_STATUS_OK);
+    EXPECT_EQ(partialBlock.FillBlock(filled, {block.vtx[1], block.vtx[3], block.vtx[2]}),
+              READ_STATUS_FAILED);
+
+    // prefilled transactions out of order or out of range, and blocks without transactions, are invalid
+    CBlockHeaderAndShortTxIDs bad = cmpctblock;
+    bad.prefilledTxs.push_back(CPrefilledTransaction(0, block.vtx[0]));
+    EXPECT_EQ(partialBlock.InitData(bad, pool), READ_STATUS_INVALID);
+    bad = cmpctblock;
+    bad.prefilledTxs[0].index = 4;
+    EXPECT_EQ(partialBlock.InitData(bad, pool), READ_STATUS_INVALID);
+    bad = cmpctblock;
+    bad.prefilledTxs.clear();
+    bad.shortTxIDs.clear();
+    EXPECT_EQ(partialBlock.InitData(bad, pool), READ_STATUS_INVALID);
+
+    // colliding short ids in the block can't be told apart
+    bad = cmpctblock;
+    bad.shortTxIDs[1] = bad.shortTxIDs[0];
+    EXPECT_EQ(partialBlock.InitData(bad, pool), READ_STATUS_FAILED);
+}
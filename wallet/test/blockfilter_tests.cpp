@@ -0,0 +1,104 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "block.h"
+#include "blockfilter.h"
+#include "util.h"
+
+// the first test vector of BIP158: the basic filter of the genesis block of bitcoin's testnet3
+TEST(blockfilter_tests, bip158_vector)
+{
+    const uint256 blockHash("000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943");
+    const std::vector<unsigned char> script =
+        ParseHex("4104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f"
+                 "35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac");
+
+    const CBlockFilter filter(blockHash, std::vector<CBlockFilter::Element>{script});
+    EXPECT_EQ(HexStr(filter.GetEncoded()), "019dfca8");
+    EXPECT_EQ(filter.GetElementCount(), 1u);
+    EXPECT_EQ(filter.ComputeHeader(0).GetHex(),
+              "21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750");
+    EXPECT_TRUE(filter.Match(script));
+}
+
+TEST(blockfilter_tests, match_and_roundtrip)
+{
+    const std::string seed      = "block";
+    const uint256     blockHash = Hash(seed.begin(), seed.end());
+
+    std::vector<CBlockFilter::Element> included;
+    std::vector<CBlockFilter::Element> excluded;
+    for (int i = 0; i < 100; i++) {
+        included.push_back(CBlockFilter::Element(20, static_cast<unsigned char>(i)));
+        excluded.push_back(CBlockFilter::Element(21, static_cast<unsigned char>(i)));
+    }
+    // duplicates and empty elements aren't part of the set
+    std::vector<CBlockFilter::Element> elements = included;
+    elements.push_back(included[0]);
+    elements.push_back(CBlockFilter::Element());
+
+    const CBlockFilter filter(blockHash, elements);
+    EXPECT_EQ(filter.GetElementCount(), included.size());
+    for (const CBlockFilter::Element& element : included) {
+        EXPECT_TRUE(filter.Match(element));
+    }
+    for (const CBlockFilter::Element& element : excluded) {
+        EXPECT_FALSE(filter.Match(element));
+    }
+    EXPECT_FALSE(filter.MatchAny(excluded));
+    excluded.push_back(included[50]);
+    EXPECT_TRUE(filter.MatchAny(excluded));
+
+    // a filter read back from its encoding is the same filter
+    const CBlockFilter decoded(blockHash, filter.GetEncoded());
+    EXPECT_EQ(decoded.GetElementCount(), filter.GetElementCount());
+    EXPECT_EQ(decoded.GetHash(), filter.GetHash());
+    for (const CBlockFilter::Element& element : included) {
+        EXPECT_TRUE(decoded.Match(element));
+    }
+
+    // an empty filter matches nothing
+    const CBlockFilter empty(blockHash, std::vector<CBlockFilter::Element>());
+    EXPECT_EQ(HexStr(empty.GetEncoded()), "00");
+    EXPECT_FALSE(empty.MatchAny(included));
+}
+
+TEST(blockfilter_tests, basic_elements)
+{
+    CBlock block;
+    block.vtx.resize(1);
+    block.vtx[0].vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+    block.vtx[0].vout.push_back(CTxOut(0, CScript() << OP_RETURN << OP_TRUE));
+    block.vtx[0].vout.push_back(CTxOut(0, CScript()));
+
+    const CScript spent = CScript() << OP_DUP << OP_DROP;
+
+    const std::vector<CBlockFilter::Element> elements =
+        GetBasicBlockFilterElements(block, std::vector<CScript>{spent});
+    ASSERT_EQ(elements.size(), 2u);
+    EXPECT_EQ(elements[0], CBlockFilter::Element({OP_TRUE}));
+    EXPECT_EQ(elements[1], CBlockFilter::Element(spent.begin(), spent.end()));
+}
+
+// as in BIP158, a spent output with an empty script isn't an element either
+TEST(blockfilter_tests, basic_elements_empty_prev_script)
+{
+    CBlock block;
+    block.vtx.resize(1);
+    block.vtx[0].vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+
+    const CScript spent = CScript() << OP_DUP << OP_DROP;
+
+    const std::vector<CBlockFilter::Element> elements =
+        GetBasicBlockFilterElements(block, std::vector<CScript>{CScript(), spent, CScript()});
+    ASSERT_EQ(elements.size(), 2u);
+    EXPECT_EQ(elements[0], CBlockFilter::Element({OP_TRUE}));
+    EXPECT_EQ(elements[1], CBlockFilter::Element(spent.begin(), spent.end()));
+
+    const uint256      blockHash = block.GetHash();
+    const CBlockFilter filter(blockHash, elements);
+    const CBlockFilter withoutEmpty(blockHash,
+                                    GetBasicBlockFilterElements(block, std::vector<CScript>{spent}));
+    EXPECT_EQ(filter.GetElementCount(), 2u);
+    EXPECT_EQ(HexStr(filter.GetEncoded()), HexStr(withoutEmpty.GetEncoded()));
+    EXPECT_FALSE(filter.Match(CBlockFilter::Element()));
+}
@@ -0,0 +1,145 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "environment.h"
+
+#include "blockindex.h"
+#include "blockindexsnapshot.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <fstream>
+
+static uint256 MakeHash(uint64_t n)
+{
+    uint256 result = n + 1;
+    result <<= 128;
+    return result + n;
+}
+
+/** a main chain of `length` blocks starting at the genesis block, plus a short side branch */
+static BlockIndexMapType::MapType MakeBlockIndex(int length, uint256& hashBest)
+{
+    BlockIndexMapType::MapType result;
+    CBlockIndexSmartPtr        pprev;
+    for (int i = 0; i < length; i++) {
+        CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>();
+        pindex->phashBlock         = (i == 0 ? Params().GenesisBlockHash() : MakeHash(i));
+        pindex->pprev              = pprev;
+        pindex->nHeight            = i;
+        pindex->nChainTrust        = MakeHash(1000000 + i);
+        pindex->nMint              = i * 1000;
+        pindex->nMoneySupply       = i * 2000;
+        pindex->nStakeModifier     = 0x1234567812345678 + i;
+        pindex->nFlags             = (i % 2 ? CBlockIndex::BLOCK_PROOF_OF_STAKE : 0);
+        pindex->nTime              = 1500000000 + i;
+        pindex->nBits              = 0x1d00ffff;
+        pindex->nNonce             = i * 7;
+        if (pprev)
+            pprev->pnext = pindex;
+        result[pindex->GetBlockHash()] = pindex;
+        pprev                          = pindex;
+    }
+    hashBest = pprev->GetBlockHash();
+
+    CBlockIndexSmartPtr pfork = result.at(MakeHash(length / 2));
+    for (int i = 0; i < 3; i++) {
+        CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>();
+        pindex->phashBlock         = MakeHash(5000000 + i);
+        pindex->pprev              = pfork;
+        pindex->nHeight            = pfork->nHeight + 1;
+        result[pindex->GetBlockHash()] = pindex;
+        pfork                          = pindex;
+    }
+    return result;
+}
+
+static StakeSeenSetType MakeStakeSeen()
+{
+    StakeSeenSetType result;
+    for (unsigned i = 0; i < 20; i++) {
+        result.insert(std::make_pair(COutPoint(MakeHash(7000000 + i), i), 1500000000 + i));
+    }
+    return result;
+}
+
+class blockindexsnapshot_tests : public ::testing::Test
+{
+protected:
+    boost::filesystem::path path = "blockindexsnapshot_test.dat";
+
+    void TearDown() override { boost::filesystem::remove(path); }
+};
+
+TEST_F(blockindexsnapshot_tests, round_trip)
+{
+    uint256                          hashBest;
+    const BlockIndexMapType::MapType blockIndex = MakeBlockIndex(200, hashBest);
+    const StakeSeenSetType           stakeSeen  = MakeStakeSeen();
+
+    ASSERT_TRUE(WriteBlockIndexSnapshot(path, blockIndex, stakeSeen, hashBest));
+
+    BlockIndexMapType::MapType loaded;
+    StakeSeenSetType           loadedStakeSeen;
+    ASSERT_TRUE(ReadBlockIndexSnapshot(path, hashBest, blockIndex.size(), loaded, loadedStakeSeen));
+
+    EXPECT_TRUE(loadedStakeSeen == stakeSeen);
+    ASSERT_EQ(loaded.size(), blockIndex.size());
+    for (const auto& item : blockIndex) {
+        const CBlockIndex* expected = item.second.get();
+        ASSERT_EQ(loaded.count(item.first), 1u);
+        const CBlockIndex* actual = loaded.at(item.first).get();
+        EXPECT_EQ(actual->GetBlockHash(), expected->GetBlockHash());
+        EXPECT_EQ(actual->pprev ? actual->pprev->GetBlockHash() : uint256(0),
+                  expected->pprev ? expected->pprev->GetBlockHash() : uint256(0));
+        EXPECT_EQ(actual->pnext ? actual->pnext->GetBlockHash() : uint256(0),
+                  expected->pnext ? expected->pnext->GetBlockHash() : uint256(0));
+        EXPECT_EQ(actual->nChainTrust, expected->nChainTrust);
+        EXPECT_EQ(actual->nHeight, expected->nHeight);
+        EXPECT_EQ(actual->nMint, expected->nMint);
+        EXPECT_EQ(actual->nMoneySupply, expected->nMoneySupply);
+        EXPECT_EQ(actual->nStakeModifier, expected->nStakeModifier);
+        EXPECT_EQ(actual->nFlags, expected->nFlags);
+        EXPECT_EQ(actual->nTime, expected->nTime);
+        EXPECT_EQ(actual->nBits, expected->nBits);
+        EXPECT_EQ(actual->nNonce, expected->nNonce);
+    }
+}
+
+TEST_F(blockindexsnapshot_tests, stale_or_corrupt)
+{
+    uint256                          hashBest;
+    const BlockIndexMapType::MapType blockIndex = MakeBlockIndex(50, hashBest);
+    const StakeSeenSetType           stakeSeen  = MakeStakeSeen();
+
+    BlockIndexMapType::MapType loaded;
+    StakeSeenSetType           loadedStakeSeen;
+
+    // missing file
+    EXPECT_FALSE(ReadBlockIndexSnapshot(path, hashBest, blockIndex.size(), loaded, loadedStakeSeen));
+
+    ASSERT_TRUE(WriteBlockIndexSnapshot(path, blockIndex, stakeSeen, hashBest));
+
+    // the db moved on since the snapshot was written
+    EXPECT_FALSE(ReadBlockIndexSnapshot(path, MakeHash(1), blockIndex.size(), loaded, loadedStakeSeen));
+    EXPECT_FALSE(ReadBlockIndexSnapshot(path, hashBest, blockIndex.size() + 1, loaded, loadedStakeSeen));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_TRUE(loadedStakeSeen.empty());
+
+    // flip a byte in the middle of the block records
+    {
+        std::fstream f(path.string(), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(200);
+        char c = 0;
+        f.read(&c, 1);
+        c ^= 0x55;
+        f.seekp(200);
+        f.write(&c, 1);
+    }
+    EXPECT_FALSE(ReadBlockIndexSnapshot(path, hashBest, blockIndex.size(), loaded, loadedStakeSeen));
+    EXPECT_TRUE(loaded.empty());
+
+    // truncated
+    ASSERT_TRUE(WriteBlockIndexSnapshot(path, blockIndex, stakeSeen, hashBest));
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 10);
+    EXPECT_FALSE(ReadBlockIndexSnapshot(path, hashBest, blockIndex.size(), loaded, loadedStakeSeen));
+}
@@ -0,0 +1,72 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "block.h"
+#include "chainparams.h"
+#include "main.h"
+#include "txdb-lmdb.h"
+
+#include <chrono>
+#include <future>
+
+TEST(blockwritebatch_tests, batch_is_committed_before_main_lock_is_released)
+{
+    SelectParams(NetworkType::Regtest);
+
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB db;
+
+    auto existsInOtherThread = [](const std::string& key) {
+        return std::async(std::launch::async, [key]() { return CTxDB().test1_ExistsStrKeyVal(key); })
+            .get();
+    };
+    auto existsWithMainInOtherThread = [](const std::string& key) {
+        return std::async(std::launch::async, [key]() {
+            LOCK(cs_main);
+            return CTxDB().test1_ExistsStrKeyVal(key);
+        });
+    };
+
+    std::future<bool> key2WithMain;
+    {
+        LOCK(cs_main);
+        // there's no chain, so the initial block download is in progress
+        CBlockWriteBatchScope batchScope;
+        bool                  fBatched = false;
+        ASSERT_TRUE(PrepareBlockWriteBatch(1000, fBatched));
+        ASSERT_TRUE(fBatched);
+        ASSERT_TRUE(CTxDB::IsSharedTxnOpen());
+        EXPECT_TRUE(db.test1_WriteStrKeyVal("key1", "val1"));
+
+        // other threads read as of the last commit
+        EXPECT_FALSE(existsInOtherThread("key1"));
+
+        // a flush commits the batch, and the next block begins a new one
+        FlushBlockWriteBatch(true);
+        EXPECT_FALSE(CTxDB::IsSharedTxnOpen());
+        EXPECT_TRUE(existsInOtherThread("key1"));
+        ASSERT_TRUE(PrepareBlockWriteBatch(1000, fBatched));
+        ASSERT_TRUE(fBatched);
+        EXPECT_TRUE(db.test1_WriteStrKeyVal("key2", "val2"));
+        EXPECT_FALSE(existsInOtherThread("key2"));
+
+        // a thread that takes cs_main waits for it, and then finds the batch committed
+        key2WithMain = existsWithMainInOtherThread("key2");
+        EXPECT_EQ(key2WithMain.wait_for(std::chrono::milliseconds(200)), std::future_status::timeout);
+    }
+    EXPECT_FALSE(CTxDB::IsSharedTxnOpen());
+    ASSERT_EQ(key2WithMain.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_TRUE(key2WithMain.get());
+    EXPECT_TRUE(existsInOtherThread("key2"));
+
+    // without a scope, nothing is batched
+    bool fBatched = true;
+    EXPECT_TRUE(PrepareBlockWriteBatch(1000, fBatched));
+    EXPECT_FALSE(fBatched);
+    EXPECT_FALSE(CTxDB::IsSharedTxnOpen());
+
+    db.Close();
+}
@@ -5,6 +5,7 @@
 #include "ntp1/ntp1tools.h"
 #include <boost/algorithm/string.hpp>
 #include <fstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -28,6 +29,12 @@ std::string RandomString(const int len)
 #define CUSTOM_LMDB_DB_SIZE (1 << 14)
 #include "../txdb-lmdb.h"
 
+#include "block.h"
+#include "chainparams.h"
+#include "diskblockindex.h"
+#include "main.h"
+#include <boost/make_shared.hpp>
+
 TEST(lmdb_tests, basic)
 {
     std::cout << "LMDB DB size: " << DB_DEFAULT_MAPSIZE << std::endl;
@@ -84,6 +91,223 @@ TEST(lmdb_tests, basic_in_1_tx)
     db.Close();
 }
 
+TEST(lmdb_tests, shared_tx)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB db;
+
+    auto existsInOtherThread = [](const std::string& key) {
+        bool result = false;
+        std::thread([&]() { result = CTxDB().test1_ExistsStrKeyVal(key); }).join();
+        return result;
+    };
+
+    ASSERT_TRUE(CTxDB::SharedTxnBegin());
+    EXPECT_TRUE(CTxDB::IsSharedTxnOpen());
+
+    // every instance of this thread writes through the shared transaction
+    EXPECT_TRUE(CTxDB().test1_WriteStrKeyVal("key1", "val1"));
+    EXPECT_TRUE(db.test1_ExistsStrKeyVal("key1"));
+    EXPECT_GT(CTxDB::GetSharedTxnDirtyBytes(), 0u);
+
+    // a transaction nested in it is committed into it, or aborted alone
+    {
+        CTxDB nested;
+        nested.TxnBegin();
+        EXPECT_TRUE(nested.test1_WriteStrKeyVal("key2", "val2"));
+        EXPECT_TRUE(db.test1_ExistsStrKeyVal("key2"));
+        nested.TxnCommit();
+        nested.TxnBegin();
+        EXPECT_TRUE(nested.test1_WriteStrKeyVal("key3", "val3"));
+        nested.TxnAbort();
+    }
+    EXPECT_TRUE(db.test1_ExistsStrKeyVal("key2"));
+    EXPECT_FALSE(db.test1_ExistsStrKeyVal("key3"));
+
+    // other threads see nothing before it's committed
+    EXPECT_FALSE(existsInOtherThread("key1"));
+    EXPECT_FALSE(existsInOtherThread("key2"));
+
+    ASSERT_TRUE(CTxDB::SharedTxnCommit());
+    EXPECT_FALSE(CTxDB::IsSharedTxnOpen());
+    EXPECT_EQ(CTxDB::GetSharedTxnDirtyBytes(), 0u);
+    EXPECT_TRUE(existsInOtherThread("key1"));
+    EXPECT_TRUE(existsInOtherThread("key2"));
+    EXPECT_FALSE(existsInOtherThread("key3"));
+
+    db.Close();
+}
+
+TEST(lmdb_tests, read_snapshot)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB db;
+
+    auto writeInOtherThread = [](const std::string& key, const std::string& val) {
+        bool result = false;
+        std::thread([&]() { result = CTxDB().test1_WriteStrKeyVal(key, val); }).join();
+        return result;
+    };
+
+    EXPECT_TRUE(db.test1_WriteStrKeyVal("key1", "val1"));
+
+    ASSERT_TRUE(CTxDB::ReadSnapshotBegin());
+    // it isn't a shared transaction that blocks could be written in
+    EXPECT_FALSE(CTxDB::IsSharedTxnOpen());
+
+    // every instance of this thread reads the db as of when the snapshot began
+    EXPECT_TRUE(writeInOtherThread("key1", "val1-new"));
+    EXPECT_TRUE(writeInOtherThread("key2", "val2"));
+    std::string val;
+    EXPECT_TRUE(CTxDB().test1_ReadStrKeyVal("key1", val));
+    EXPECT_EQ(val, "val1");
+    EXPECT_FALSE(db.test1_ExistsStrKeyVal("key2"));
+
+    CTxDB::ReadSnapshotEnd();
+    EXPECT_TRUE(db.test1_ReadStrKeyVal("key1", val));
+    EXPECT_EQ(val, "val1-new");
+    EXPECT_TRUE(db.test1_ExistsStrKeyVal("key2"));
+
+    db.Close();
+}
+
+/** a coinbase-only proof-of-work block on top of prev that CheckBlock() accepts */
+static CBlock MakeNextBlock(const CBlock& prev, int nHeight)
+{
+    CBlock block;
+    block.hashPrevBlock = prev.GetHash();
+    block.nTime         = prev.nTime + 60;
+    block.nBits         = Params().PoWLimit().GetCompact();
+    block.vtx.resize(1);
+    block.vtx[0].nTime = block.nTime;
+    block.vtx[0].vin.resize(1);
+    block.vtx[0].vin[0].prevout.SetNull();
+    block.vtx[0].vin[0].scriptSig = CScript() << nHeight << OP_0;
+    block.vtx[0].vout.push_back(CTxOut(0, CScript() << OP_TRUE));
+    block.hashMerkleRoot = block.GetMerkleRoot();
+    while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, true))
+        block.nNonce++;
+    return block;
+}
+
+/** writes the block and makes it the best one, as connecting it would */
+static CBlockIndexSmartPtr AddToTestChain(CTxDB& txdb, const CBlock& block,
+                                          const CBlockIndexSmartPtr& pprev)
+{
+    EXPECT_TRUE(txdb.WriteBlock(block.GetHash(), block));
+    CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>(block);
+    pindex->phashBlock         = block.GetHash();
+    pindex->pprev              = pprev;
+    pindex->nHeight            = pprev ? pprev->nHeight + 1 : 0;
+    pindex->nChainTrust        = (pprev ? pprev->nChainTrust : 0) + pindex->GetBlockTrust();
+    mapBlockIndex.set(block.GetHash(), pindex);
+    if (pprev) {
+        pprev->pnext = pindex;
+        EXPECT_TRUE(txdb.WriteBlockIndex(CDiskBlockIndex(pprev.get(), COutPoint(), 0)));
+    }
+    EXPECT_TRUE(txdb.WriteBlockIndex(CDiskBlockIndex(pindex.get(), COutPoint(), 0)));
+    EXPECT_TRUE(txdb.WriteHashBestChain(block.GetHash()));
+    chainActive.SetTip(pindex.get());
+    return pindex;
+}
+
+TEST(lmdb_tests, verify_recent_blocks_rolls_back_bad_block)
+{
+    SelectParams(NetworkType::Regtest);
+
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB db;
+
+    std::vector<CBlock> blocks{Params().GenesisBlock()};
+    CBlockIndexSmartPtr pindex = AddToTestChain(db, blocks.back(), nullptr);
+    pindexGenesisBlock         = pindex;
+    for (int i = 1; i <= 10; i++) {
+        blocks.push_back(MakeNextBlock(blocks.back(), i));
+        pindex = AddToTestChain(db, blocks.back(), pindex);
+    }
+
+    uint256 hashLastVerified;
+    EXPECT_TRUE(db.VerifyRecentBlocks());
+    EXPECT_FALSE(db.ReadLastVerifiedBlock(hashLastVerified));
+
+    // the transactions of block 8 are corrupted, its header isn't
+    CBlock corrupted                = blocks[8];
+    corrupted.vtx[0].vout[0].nValue = 1;
+    ASSERT_EQ(corrupted.GetHash(), blocks[8].GetHash());
+    ASSERT_TRUE(db.WriteBlock(corrupted.GetHash(), corrupted));
+
+    // the verification fails and saves the block before it, without touching the chain
+    EXPECT_FALSE(db.VerifyRecentBlocks());
+    ASSERT_TRUE(db.ReadLastVerifiedBlock(hashLastVerified));
+    EXPECT_EQ(hashLastVerified, blocks[7].GetHash());
+    EXPECT_EQ(db.GetBestBlockHash(), blocks[10].GetHash());
+
+    // the next start moves the best chain back to it, and the verification passes again
+    EXPECT_TRUE(RollBackToLastVerifiedBlock());
+    EXPECT_EQ(db.GetBestBlockHash(), blocks[7].GetHash());
+    EXPECT_EQ(chainActive.Tip()->GetBlockHash(), blocks[7].GetHash());
+    EXPECT_FALSE(db.ReadLastVerifiedBlock(hashLastVerified));
+    EXPECT_TRUE(db.VerifyRecentBlocks());
+
+    // the start after that has nothing to move back
+    EXPECT_TRUE(RollBackToLastVerifiedBlock());
+    EXPECT_EQ(db.GetBestBlockHash(), blocks[7].GetHash());
+
+    mapBlockIndex.clear();
+    chainActive.clear();
+    pindexGenesisBlock = nullptr;
+
+    db.Close();
+}
+
+TEST(lmdb_tests, map_growth)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB db;
+
+#ifdef LMDB_RESERVE_MAP
+    // the map is reserved up front, far bigger than the database
+    EXPECT_FALSE(CTxDB::need_resize());
+#endif
+
+    // the map grows by a fraction of its size, and the stop of all transactions is accounted for
+    CMetricHistogram&  stalls       = Metrics().Histogram("neblio_db_map_resize_stall_seconds");
+    const uint64_t     stallsBefore = stalls.GetSnapshot().count;
+    const LMDBMapStats before       = CTxDB::GetMapStats();
+    db.do_resize();
+    const LMDBMapStats after = CTxDB::GetMapStats();
+    EXPECT_GE(after.mapSize, before.mapSize + before.mapSize / MAP_SIZE_GROWTH_DIVISOR);
+    EXPECT_EQ(after.resizes, before.resizes + 1);
+    EXPECT_GE(after.totalStallMillis, after.maxStallMillis);
+    // and exported as a metric
+    EXPECT_EQ(stalls.GetSnapshot().count, stallsBefore + 1);
+
+    std::string k1 = "key1";
+    std::string v1 = "val1";
+    EXPECT_TRUE(db.test1_WriteStrKeyVal(k1, v1));
+    std::string out;
+    EXPECT_TRUE(db.test1_ReadStrKeyVal(k1, out));
+    EXPECT_EQ(out, v1);
+
+    db.Close();
+}
+
 TEST(lmdb_tests, many_inputs)
 {
     CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
@@ -0,0 +1,132 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "keystore.h"
+#include "script.h"
+#include "util.h"
+
+class TestCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    bool fCanCache = true;
+
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+
+protected:
+    bool CanCacheDecryptedKeys() const override { return fCanCache; }
+};
+
+class keystore_tests : public ::testing::Test
+{
+protected:
+    TestCryptoKeyStore keystore;
+    CKeyingMaterial    masterKey;
+    CKey               key;
+    CKeyID             keyID;
+
+    void SetUp() override
+    {
+        masterKey.assign(32, 0x42);
+        key.MakeNewKey(true);
+        keyID = key.GetPubKey().GetID();
+        ASSERT_TRUE(keystore.AddKey(key));
+        ASSERT_TRUE(keystore.EncryptKeys(masterKey));
+        ASSERT_TRUE(keystore.Unlock(masterKey));
+    }
+
+    void TearDown() override { SetMockTime(0); }
+
+    void ExpectKey()
+    {
+        CKey keyOut;
+        ASSERT_TRUE(keystore.GetKey(keyID, keyOut));
+        EXPECT_TRUE(keyOut.GetPubKey() == key.GetPubKey());
+        bool fCompressed = false;
+        EXPECT_TRUE(keyOut.GetSecret(fCompressed) == key.GetSecret(fCompressed));
+    }
+};
+
+TEST_F(keystore_tests, decrypted_keys_not_cached_by_default)
+{
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+}
+
+TEST_F(keystore_tests, decrypted_key_cache_lifetime)
+{
+    SetMockTime(1000000);
+    keystore.SetDecryptedKeyLifetime(60);
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+    // served from the cache
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+
+    SetMockTime(1000059);
+    keystore.ExpireDecryptedKeys();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+    SetMockTime(1000060);
+    keystore.ExpireDecryptedKeys();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+
+    // decrypted again once expired
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+
+    keystore.SetDecryptedKeyLifetime(0);
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+}
+
+TEST_F(keystore_tests, decrypted_key_cache_wiped_on_lock)
+{
+    keystore.SetDecryptedKeyLifetime(60);
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+
+    ASSERT_TRUE(keystore.Lock());
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+    CKey keyOut;
+    EXPECT_FALSE(keystore.GetKey(keyID, keyOut));
+
+    ASSERT_TRUE(keystore.Unlock(masterKey));
+    ExpectKey();
+}
+
+TEST_F(keystore_tests, decrypted_key_cache_only_when_allowed)
+{
+    keystore.SetDecryptedKeyLifetime(60);
+    keystore.fCanCache = false;
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+
+    keystore.fCanCache = true;
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+
+    // what was cached is dropped once caching isn't allowed anymore
+    keystore.fCanCache = false;
+    keystore.ExpireDecryptedKeys();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+
+    // or by the next lookup
+    keystore.fCanCache = true;
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+    keystore.fCanCache = false;
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+}
+
+TEST_F(keystore_tests, decrypted_keys_dropped)
+{
+    keystore.SetDecryptedKeyLifetime(60);
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+
+    keystore.DropDecryptedKeys();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 0u);
+    ExpectKey();
+    EXPECT_EQ(keystore.GetDecryptedKeyCount(), 1u);
+}
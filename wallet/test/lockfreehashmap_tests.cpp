@@ -0,0 +1,225 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "LockFreeHashMap.h"
+#include "uint256.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <map>
+#include <random>
+
+static uint256 MakeKey(uint64_t n)
+{
+    std::mt19937_64 gen(n);
+    uint256         result;
+    for (unsigned i = 0; i < result.size() / sizeof(uint64_t); i++) {
+        uint64_t v = gen();
+        memcpy(result.begin() + i * sizeof(uint64_t), &v, sizeof(v));
+    }
+    return result;
+}
+
+TEST(lockfreehashmap_tests, behaves_like_map)
+{
+    LockFreeHashMap<uint256, int> m;
+    std::map<uint256, int>        ref;
+
+    EXPECT_TRUE(m.empty());
+
+    std::mt19937 gen(1);
+    for (int i = 0; i < 20000; i++) {
+        const uint256 key = MakeKey(gen() % 5000);
+        switch (gen() % 3) {
+        case 0:
+        case 1:
+            m.set(key, i);
+            ref[key] = i;
+            break;
+        case 2:
+            EXPECT_EQ(m.erase(key), ref.erase(key));
+            break;
+        }
+        EXPECT_EQ(m.size(), ref.size());
+    }
+
+    for (const auto& p : ref) {
+        ASSERT_TRUE(m.exists(p.first));
+        EXPECT_EQ(*m.get(p.first), p.second);
+        int visited = -1;
+        EXPECT_TRUE(m.visit(p.first, [&visited](int v) { visited = v; }));
+        EXPECT_EQ(visited, p.second);
+    }
+    EXPECT_TRUE(m.getInternalMap() == ref);
+
+    LockFreeHashMap<uint256, int> copy(m);
+    EXPECT_TRUE(copy.getInternalMap() == ref);
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.get(ref.begin()->first));
+    EXPECT_FALSE(m.visit(ref.begin()->first, [](int) { FAIL(); }));
+}
+
+TEST(lockfreehashmap_tests, copies_stay_valid)
+{
+    LockFreeHashMap<uint256, boost::shared_ptr<int>> m;
+
+    const uint256 key = MakeKey(0);
+    m.set(key, boost::make_shared<int>(5));
+    const boost::shared_ptr<int> p = m.get(key).value_or(nullptr);
+    ASSERT_NE(p, nullptr);
+
+    // grow the table many times and replace the key; the copy has to remain usable
+    for (int i = 1; i < 100000; i++) {
+        m.set(MakeKey(i), boost::make_shared<int>(i));
+    }
+    m.set(key, boost::make_shared<int>(6));
+    m.erase(key);
+
+    EXPECT_EQ(*p, 5);
+    EXPECT_FALSE(m.exists(key));
+    EXPECT_EQ(m.size(), 99999u);
+}
+
+TEST(lockfreehashmap_tests, replaced_and_erased_entries_are_freed)
+{
+    LockFreeHashMap<uint256, boost::shared_ptr<int>> m;
+
+    // the values that the map still holds, live or not freed yet
+    const boost::shared_ptr<int> value = boost::make_shared<int>(1);
+
+    const uint256 key = MakeKey(0);
+    for (int i = 0; i < 100000; i++) {
+        m.set(key, value);
+        EXPECT_LE(m.garbageSize(), 1024u + 1);
+    }
+    EXPECT_LE(value.use_count(), 1024 + 2);
+    EXPECT_EQ(m.size(), 1u);
+
+    for (int i = 0; i < 100000; i++) {
+        m.set(MakeKey(i % 10), value);
+        m.erase(MakeKey(i % 10));
+    }
+    EXPECT_LE(m.garbageSize(), 1024u + 1);
+    EXPECT_LE(value.use_count(), 1024 + 2);
+
+    m.clear();
+    EXPECT_EQ(m.garbageSize(), 0u);
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(lockfreehashmap_tests, concurrent_readers_single_writer)
+{
+    LockFreeHashMap<uint256, int> m;
+
+    static const int N = 50000;
+
+    std::atomic<int>  written{0};
+    std::atomic<bool> failed{false};
+
+    boost::thread writer([&]() {
+        for (int i = 0; i < N; i++) {
+            m.set(MakeKey(i), i);
+            written.store(i + 1, std::memory_order_release);
+        }
+    });
+
+    std::vector<boost::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            while (written.load(std::memory_order_acquire) < N) {
+                int upTo = written.load(std::memory_order_acquire);
+                if (upTo == 0) {
+                    continue;
+                }
+                int                      i = gen() % upTo;
+                const boost::optional<int> v = m.get(MakeKey(i));
+                if (!v || *v != i) {
+                    failed = true;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& r : readers) {
+        r.join();
+    }
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(m.size(), static_cast<std::size_t>(N));
+}
+
+TEST(lockfreehashmap_tests, concurrent_readers_while_replacing)
+{
+    LockFreeHashMap<uint256, boost::shared_ptr<int>> m;
+
+    static const int KEYS = 16;
+    for (int i = 0; i < KEYS; i++) {
+        m.set(MakeKey(i), boost::make_shared<int>(i));
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+
+    // the replaced values are freed while the readers run; a value read must still be the key's
+    std::vector<boost::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            while (!done.load(std::memory_order_acquire)) {
+                const int i = gen() % KEYS;
+                m.visit(MakeKey(i), [&](const boost::shared_ptr<int>& v) {
+                    if (!v || *v % KEYS != i) {
+                        failed = true;
+                    }
+                });
+            }
+        });
+    }
+
+    for (int n = 0; n < 200000; n++) {
+        const int i = n % KEYS;
+        m.set(MakeKey(i), boost::make_shared<int>(i + KEYS * n));
+    }
+    done = true;
+    for (auto& r : readers) {
+        r.join();
+    }
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(m.size(), static_cast<std::size_t>(KEYS));
+    EXPECT_LE(m.garbageSize(), 1024u + 1);
+}
+
+TEST(lockfreehashmap_tests, visit_may_write_to_another_map)
+{
+    LockFreeHashMap<int, int> a;
+    LockFreeHashMap<int, int> b;
+    a.set(0, 0);
+
+    // the writes to b free its garbage while this thread is in a lookup in a
+    for (int n = 0; n < 10000; n++) {
+        EXPECT_TRUE(a.visit(0, [&](int) {
+            b.set(n % 16, n);
+            EXPECT_TRUE(b.exists(n % 16));
+        }));
+    }
+    EXPECT_EQ(b.size(), 16u);
+    EXPECT_LE(b.garbageSize(), 1024u + 1);
+}
+
+TEST(lockfreehashmap_tests, readers_in_short_lived_threads)
+{
+    LockFreeHashMap<int, int> m;
+
+    // every thread takes a reader slot, and gives it back when it exits
+    for (int n = 0; n < 200; n++) {
+        boost::thread reader([&m]() { EXPECT_FALSE(m.exists(1)); });
+        reader.join();
+        for (int i = 0; i < 20; i++) {
+            m.set(0, n * 20 + i);
+        }
+    }
+    EXPECT_EQ(m.get(0).value_or(-1), 199 * 20 + 19);
+}
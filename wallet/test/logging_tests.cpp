@@ -0,0 +1,130 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "logging.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+TEST(logging_tests, categories)
+{
+    uint32_t category = LOG_NONE;
+    EXPECT_TRUE(GetLogCategory("net", category));
+    EXPECT_EQ(category, LOG_NET);
+    EXPECT_TRUE(GetLogCategory("stake", category));
+    EXPECT_EQ(category, LOG_STAKE);
+    EXPECT_TRUE(GetLogCategory("1", category));
+    EXPECT_EQ(category, LOG_ALL);
+    EXPECT_FALSE(GetLogCategory("nosuchcategory", category));
+
+    const uint32_t previous = nLogCategories;
+    nLogCategories          = LOG_NET | LOG_DB;
+    EXPECT_TRUE(LogAcceptCategory(LOG_NET));
+    EXPECT_TRUE(LogAcceptCategory(LOG_DB));
+    EXPECT_FALSE(LogAcceptCategory(LOG_VALIDATION));
+
+    // the arguments of a message of a disabled category aren't evaluated
+    int evaluated = 0;
+    LogPrint(LOG_VALIDATION, "%d\n", ++evaluated);
+    EXPECT_EQ(evaluated, 0);
+    nLogCategories = previous;
+}
+
+TEST(logging_tests, rate_limit)
+{
+    static const char* const format      = "repeated message %d\n";
+    static const char* const otherFormat = "other message %d\n";
+
+    CLogRateLimiter limiter(3);
+    uint32_t        nSuppressed = 0;
+    const int64_t   nTime       = 1000 * CLogRateLimiter::WINDOW_SECONDS;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(limiter.Allow(format, nTime + i, nSuppressed));
+        EXPECT_EQ(nSuppressed, 0u);
+    }
+    EXPECT_FALSE(limiter.Allow(format, nTime + 3, nSuppressed));
+    EXPECT_FALSE(limiter.Allow(format, nTime + 4, nSuppressed));
+    EXPECT_TRUE(limiter.Allow(otherFormat, nTime + 4, nSuppressed));
+
+    // the first message of the next minute is let through and reports what was suppressed
+    EXPECT_TRUE(limiter.Allow(format, nTime + CLogRateLimiter::WINDOW_SECONDS, nSuppressed));
+    EXPECT_EQ(nSuppressed, 2u);
+
+    limiter.SetLimit(0);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(limiter.Allow(format, nTime + CLogRateLimiter::WINDOW_SECONDS, nSuppressed));
+    }
+}
+
+// formats never share a budget, however many there are
+TEST(logging_tests, rate_limit_per_format)
+{
+    static const std::size_t formatCount = 5000;
+    const std::vector<char>  formats(formatCount, '\n');
+
+    CLogRateLimiter limiter(1);
+    uint32_t        nSuppressed = 0;
+    for (std::size_t i = 0; i < formatCount; i++) {
+        EXPECT_TRUE(limiter.Allow(&formats[i], 0, nSuppressed));
+    }
+    for (std::size_t i = 0; i < formatCount; i++) {
+        EXPECT_FALSE(limiter.Allow(&formats[i], 0, nSuppressed));
+    }
+}
+
+// messages from many threads are all written, each in the order its thread queued them, and lines
+// are timestamped once
+TEST(logging_tests, async_writer)
+{
+    static const int threadCount       = 4;
+    static const int messagesPerThread = 5000;
+
+    std::string     written;
+    CAsyncLogWriter writer(64);
+    writer.Start([&](const std::string& batch) { written += batch; }, true);
+
+    boost::thread_group threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.create_thread([&writer, t]() {
+            for (int i = 0; i < messagesPerThread; i++) {
+                std::string str = strprintf("%d %d\n", t, i);
+                EXPECT_TRUE(writer.Push(0, str));
+            }
+        });
+    }
+    threads.join_all();
+    writer.Flush();
+
+    std::string partial = "partial ";
+    EXPECT_TRUE(writer.Push(0, partial));
+    std::string end = "end\n";
+    EXPECT_TRUE(writer.Push(0, end));
+    writer.Stop();
+
+    std::string last = "after stop\n";
+    EXPECT_FALSE(writer.Push(0, last));
+
+    const std::string timestamp = DateTimeStrFormat("%x %H:%M:%S", 0) + " ";
+    std::vector<int>  nextIndex(threadCount, 0);
+    std::size_t       pos       = 0;
+    int               lineCount = 0;
+    while (pos < written.size()) {
+        const std::size_t eol = written.find('\n', pos);
+        ASSERT_NE(eol, std::string::npos);
+        const std::string line = written.substr(pos, eol - pos);
+        pos                    = eol + 1;
+        ASSERT_EQ(line.compare(0, timestamp.size(), timestamp), 0);
+        const std::string message = line.substr(timestamp.size());
+        if (message == "partial end") {
+            continue;
+        }
+        int t = -1, i = -1;
+        ASSERT_EQ(sscanf(message.c_str(), "%d %d", &t, &i), 2);
+        ASSERT_GE(t, 0);
+        ASSERT_LT(t, threadCount);
+        EXPECT_EQ(i, nextIndex[t]);
+        nextIndex[t] = i + 1;
+        lineCount++;
+    }
+    EXPECT_EQ(lineCount, threadCount * messagesPerThread);
+    EXPECT_EQ(written.substr(written.size() - timestamp.size() - 12), timestamp + "partial end\n");
+}
@@ -0,0 +1,120 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "metrics.h"
+#include "sync.h"
+
+#include <boost/thread.hpp>
+
+TEST(metrics_tests, histogram_buckets)
+{
+    // every value is in the bucket whose bounds surround it
+    for (uint64_t value : {uint64_t(0), uint64_t(1), uint64_t(15), uint64_t(16), uint64_t(17),
+                           uint64_t(1000), uint64_t(123456789), CMetricHistogram::MAX_VALUE}) {
+        const unsigned index = CMetricHistogram::BucketIndex(value);
+        ASSERT_LT(index, CMetricHistogram::BUCKET_COUNT);
+        EXPECT_LE(CMetricHistogram::BucketLowerBound(index), value);
+        if (index + 1 < CMetricHistogram::BUCKET_COUNT) {
+            EXPECT_GT(CMetricHistogram::BucketLowerBound(index + 1), value);
+        }
+    }
+    // the buckets are contiguous and no wider than 1/SUB_BUCKETS of their values
+    for (unsigned i = CMetricHistogram::SUB_BUCKETS; i + 1 < CMetricHistogram::BUCKET_COUNT; i++) {
+        const uint64_t lower = CMetricHistogram::BucketLowerBound(i);
+        const uint64_t upper = CMetricHistogram::BucketLowerBound(i + 1);
+        EXPECT_EQ(CMetricHistogram::BucketIndex(lower), i);
+        EXPECT_EQ(CMetricHistogram::BucketIndex(upper - 1), i);
+        EXPECT_LE((upper - lower) * CMetricHistogram::SUB_BUCKETS, lower);
+    }
+    // longer values are clamped to the last bucket
+    EXPECT_EQ(CMetricHistogram::BucketIndex(UINT64_MAX), CMetricHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(metrics_tests, histogram_percentiles)
+{
+    CMetricHistogram histogram;
+    EXPECT_EQ(histogram.GetSnapshot().Percentile(0.5), 0u);
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        histogram.Record(i * 1000);
+    }
+    const CMetricHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 1000u * 1001u / 2u * 1000u);
+    EXPECT_EQ(snapshot.max, 1000000u);
+
+    // within the precision of the buckets
+    EXPECT_NEAR(static_cast<double>(snapshot.Percentile(0.5)), 500000.0, 500000.0 / 16);
+    EXPECT_NEAR(static_cast<double>(snapshot.Percentile(0.99)), 990000.0, 990000.0 / 16);
+    EXPECT_EQ(snapshot.Percentile(1.0), 1000000u);
+}
+
+TEST(metrics_tests, registry)
+{
+    CMetricsRegistry registry;
+    CMetricCounter&  counter = registry.Counter("test_total", MetricLabel("kind", "a"));
+    EXPECT_EQ(&counter, &registry.Counter("test_total", MetricLabel("kind", "a")));
+    EXPECT_NE(&counter, &registry.Counter("test_total", MetricLabel("kind", "b")));
+    counter.Inc();
+    counter.Inc(2);
+    registry.Gauge("test_gauge").Set(-5);
+    registry.Histogram("test_seconds").Record(uint64_t(1500000000));
+
+    EXPECT_EQ(MetricLabel("kind", "a\"b\\"), "kind=\"a\\\"b\\\\\"");
+
+    const std::string text = registry.FormatPrometheus();
+    EXPECT_NE(text.find("# TYPE test_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("test_total{kind=\"a\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_total{kind=\"b\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_gauge gauge\ntest_gauge -5\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_seconds summary\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_sum 1.500000000\n"), std::string::npos);
+    EXPECT_NE(text.find("test_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(metrics_tests, lock_wait)
+{
+    static CCriticalSection cs_metrics_test;
+    static CCriticalSection cs_unnamed;
+
+    SetLockWaitMetricName(&cs_metrics_test, "metrics_test");
+    CMetricHistogram& histogram =
+        Metrics().Histogram("neblio_lock_wait_seconds", MetricLabel("lock", "metrics_test"));
+    const uint64_t before = histogram.GetSnapshot().count;
+
+    // an uncontended lock doesn't record anything
+    {
+        LOCK(cs_metrics_test);
+    }
+    EXPECT_EQ(histogram.GetSnapshot().count, before);
+
+    // a lock that waits for another thread records how long it waited
+    boost::thread holder;
+    {
+        LOCK(cs_metrics_test);
+        holder = boost::thread([]() { LOCK(cs_metrics_test); });
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+    }
+    holder.join();
+    const CMetricHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    EXPECT_EQ(snapshot.count, before + 1);
+    EXPECT_GE(snapshot.max, 10000000u);
+
+    // locks without a name have no metric, nor does one whose name was taken back
+    SetLockWaitMetricName(&cs_metrics_test, nullptr);
+    for (CCriticalSection* cs : {&cs_unnamed, &cs_metrics_test}) {
+        {
+            LOCK(*cs);
+            holder = boost::thread([cs]() { LOCK(*cs); });
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+        }
+        holder.join();
+    }
+    EXPECT_EQ(histogram.GetSnapshot().count, before + 1);
+    Metrics().ForEachHistogram([](const std::string& name, const std::string& labels,
+                                  const CMetricHistogram::Snapshot&) {
+        if (name == "neblio_lock_wait_seconds") {
+            EXPECT_EQ(labels.find("cs_unnamed"), std::string::npos);
+            EXPECT_EQ(labels.find("*cs"), std::string::npos);
+        }
+    });
+}
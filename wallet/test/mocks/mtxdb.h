@@ -35,6 +35,8 @@ struct mTxDB : public ITxDB
     MOCK_METHOD(bool, ReadBlock, (const uint256& hash, CBlock& blk, bool fReadTransactions),
                 (const, override));
     MOCK_METHOD(bool, WriteBlock, (const uint256& hash, const CBlock& blk), (override));
+    MOCK_METHOD(bool, ReadBlockIndex, (const uint256& hash, CDiskBlockIndex& blockindex),
+                (const, override));
     MOCK_METHOD(bool, WriteBlockIndex, (const CDiskBlockIndex& blockindex), (override));
     MOCK_METHOD(bool, ReadHashBestChain, (uint256 & hashBestChain), (const, override));
     MOCK_METHOD(bool, WriteHashBestChain, (const uint256& hashBestChain), (override));
@@ -0,0 +1,121 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "net.h"
+#include "transaction.h"
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::string ReadFromSocket(SOCKET hSocket, std::size_t size)
+{
+    std::string result(size, 0);
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t nBytes = recv(hSocket, &result[done], size - done, 0);
+        if (nBytes <= 0) {
+            break;
+        }
+        done += nBytes;
+    }
+    result.resize(done);
+    return result;
+}
+
+static std::string ToString(const CSerializeData& data) { return std::string(data.begin(), data.end()); }
+
+TEST(net_tests, shared_message_framing)
+{
+    CTransaction tx;
+    tx.vout.push_back(CTxOut(5, CScript() << OP_TRUE));
+    const CSharedMessage msg = MakeSharedMessage("tx", tx);
+
+    CDataStream    ss(msg->begin(), msg->end(), SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(Params().MessageStart());
+    ss >> hdr;
+    EXPECT_TRUE(hdr.IsValid(Params().MessageStart()));
+    EXPECT_EQ(hdr.GetCommand(), "tx");
+    EXPECT_EQ(hdr.nMessageSize, ss.size());
+    const uint256 hash      = Hash(ss.begin(), ss.end());
+    unsigned int  nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    EXPECT_EQ(hdr.nChecksum, nChecksum);
+
+    CTransaction txRead;
+    ss >> txRead;
+    EXPECT_TRUE(txRead == tx);
+
+    // a serialized payload is framed as is
+    CDataStream payload(SER_NETWORK, PROTOCOL_VERSION);
+    payload << tx;
+    EXPECT_EQ(ToString(*MakeSharedMessage("tx", payload)), ToString(*msg));
+}
+
+// the same buffer is queued for every peer, and goes out after what was queued before it
+TEST(net_tests, shared_message_sent_to_many_peers)
+{
+    static const int peerCount = 3;
+
+    const CSharedMessage msg = MakeSharedMessage("block", std::vector<unsigned char>(1000, 7));
+    for (int i = 0; i < peerCount; i++) {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        CNode node(i, fds[0], CAddress(), "peer", true);
+        node.PushMessage("ping", static_cast<uint64_t>(i));
+        node.PushSharedMessage(msg);
+        EXPECT_TRUE(node.vSendMsg.empty());
+        EXPECT_EQ(node.nSendSize, 0u);
+
+        CDataStream ping(SER_NETWORK, PROTOCOL_VERSION);
+        ping << static_cast<uint64_t>(i);
+        EXPECT_EQ(ReadFromSocket(fds[1], CMessageHeader::HEADER_SIZE + ping.size()),
+                  ToString(*MakeSharedMessage("ping", ping)));
+        EXPECT_EQ(ReadFromSocket(fds[1], msg->size()), ToString(*msg));
+        close(fds[1]);
+    }
+    EXPECT_EQ(msg.use_count(), 1);
+}
+
+// messages that don't fit in the socket buffer stay queued, and are sent where they were left off
+TEST(net_tests, partially_sent_messages)
+{
+    static const int messageCount = 200;
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int nBufSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &nBufSize, sizeof(nBufSize));
+
+    std::vector<CSharedMessage> messages;
+    std::string                 expected;
+    for (int i = 0; i < messageCount; i++) {
+        const std::vector<unsigned char> payload(997 + i, static_cast<unsigned char>(i));
+        messages.push_back(MakeSharedMessage("block", payload));
+        expected += ToString(*messages.back());
+    }
+
+    CNode node(0, fds[0], CAddress(), "peer", true);
+    for (const CSharedMessage& msg : messages) {
+        node.PushSharedMessage(msg);
+    }
+    EXPECT_FALSE(node.vSendMsg.empty());
+
+    std::string received;
+    while (received.size() < expected.size()) {
+        {
+            LOCK(node.cs_vSend);
+            SocketSendData(&node);
+        }
+        char          buffer[3000];
+        const ssize_t nBytes = recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (nBytes > 0) {
+            received.append(buffer, nBytes);
+        }
+    }
+    EXPECT_TRUE(received == expected);
+    EXPECT_TRUE(node.vSendMsg.empty());
+    EXPECT_EQ(node.nSendSize, 0u);
+    EXPECT_EQ(node.nSendOffset, 0u);
+    close(fds[1]);
+}
+#endif
@@ -7,6 +7,7 @@
 #include "curltools.h"
 #include "mocks/mtxdb.h"
 #include "ntp1/ntp1apicalls.h"
+#include "ntp1/ntp1checkedint.h"
 #include "ntp1/ntp1script.h"
 #include "ntp1/ntp1script_burn.h"
 #include "ntp1/ntp1script_issuance.h"
@@ -450,6 +451,84 @@ TEST(ntp1_tests, amount_to_int)
     EXPECT_EQ(NTP1Script::NumberToHexNTP1Amount(1412849080), "80435eb161");
 }
 
+TEST(ntp1_tests, checked_int_matches_ntp1int_random)
+{
+    auto seed = std::random_device{}();
+
+    std::cout << "Using seed for random amount generator: " << seed << std::endl;
+    std::mt19937 gen{seed};
+
+    std::uniform_int_distribution<int64_t> amount_dist{0, std::numeric_limits<int64_t>::max()};
+    std::uniform_int_distribution<int>     op_dist{0, 2};
+
+    NTP1Int        expected = 0;
+    NTP1CheckedInt actual   = 0;
+    for (int i = 0; i < 100000; i++) {
+        const NTP1Int amount = amount_dist(gen);
+        switch (op_dist(gen)) {
+        case 0:
+            expected += amount;
+            actual += amount;
+            break;
+        case 1:
+            expected -= amount;
+            actual -= amount;
+            break;
+        default:
+            // double up until the fixed-width range is left well behind, then start over from zero
+            if (expected.is_zero() || boost::multiprecision::msb(abs(expected)) < 140) {
+                expected += expected;
+                actual += actual;
+            } else {
+                expected -= expected;
+                actual -= actual;
+            }
+            break;
+        }
+        ASSERT_EQ(actual.get(), expected) << "at step " << i;
+        ASSERT_EQ(actual < NTP1CheckedInt(amount), expected < amount);
+        ASSERT_TRUE(actual == NTP1CheckedInt(expected));
+    }
+}
+
+TEST(ntp1_tests, checked_int_overflow)
+{
+    const NTP1Int maxFixed = NTP1Int(NTP1CheckedInt::FixedInt(
+        std::numeric_limits<NTP1CheckedInt::FixedInt>::max()));
+
+    NTP1CheckedInt value = maxFixed;
+    EXPECT_TRUE(value.IsFixed());
+    value += 1;
+    EXPECT_FALSE(value.IsFixed());
+    EXPECT_EQ(value.get(), NTP1Int(maxFixed + 1));
+    EXPECT_GT(value, NTP1CheckedInt(maxFixed));
+    value -= 1;
+    EXPECT_EQ(value.get(), maxFixed);
+    EXPECT_EQ(value, NTP1CheckedInt(maxFixed));
+
+    NTP1CheckedInt negative = NTP1Int(-maxFixed);
+    EXPECT_TRUE(negative.IsFixed());
+    negative -= 2;
+    EXPECT_FALSE(negative.IsFixed());
+    EXPECT_EQ(negative.get(), NTP1Int(-maxFixed - 2));
+    EXPECT_LT(negative, NTP1CheckedInt(0));
+
+    // values that don't fit are kept as they are
+    const NTP1Int  huge = NTP1Int(maxFixed * maxFixed);
+    NTP1CheckedInt fromHuge(huge);
+    EXPECT_FALSE(fromHuge.IsFixed());
+    EXPECT_EQ(fromHuge.get(), huge);
+    EXPECT_EQ(::ToString(fromHuge), ::ToString(huge));
+    EXPECT_FALSE(!fromHuge);
+    EXPECT_TRUE(!NTP1CheckedInt(0));
+
+    // summing NTP1MaxAmount many times over stays fixed-width
+    std::vector<NTP1CheckedInt> amounts(1000, NTP1MaxAmount);
+    NTP1CheckedInt total = std::accumulate(amounts.begin(), amounts.end(), NTP1CheckedInt(0));
+    EXPECT_TRUE(total.IsFixed());
+    EXPECT_EQ(total.get(), NTP1Int(NTP1MaxAmount * 1000));
+}
+
 TEST(ntp1_tests, script_transfer)
 {
     // transfer some tokens
@@ -2685,6 +2764,132 @@ TEST(ntp1_tests, ntp1v3_burn_test)
               boost::algorithm::unhex(std::string("02")));
 }
 
+static void ExpectSameTransferInstructions(const std::vector<NTP1Script::TransferInstruction>& a,
+                                           const std::vector<NTP1Script::TransferInstruction>& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for (unsigned i = 0; i < a.size(); i++) {
+        EXPECT_EQ(a[i].firstRawByte, b[i].firstRawByte);
+        EXPECT_EQ(a[i].skipInput, b[i].skipInput);
+        EXPECT_EQ(a[i].outputIndex, b[i].outputIndex);
+        EXPECT_EQ(a[i].rawAmount, b[i].rawAmount);
+        EXPECT_EQ(a[i].amount, b[i].amount);
+        EXPECT_EQ(a[i].rawSize, b[i].rawSize);
+    }
+}
+
+static void ExpectSameScript(const std::shared_ptr<NTP1Script>& a, const std::shared_ptr<NTP1Script>& b)
+{
+    EXPECT_EQ(a->getTxType(), b->getTxType());
+    EXPECT_EQ(a->getHeader(), b->getHeader());
+    EXPECT_EQ(a->getOpCodeBin(), b->getOpCodeBin());
+    EXPECT_EQ(a->getProtocolVersion(), b->getProtocolVersion());
+    EXPECT_EQ(a->getParsedScriptHex(), b->getParsedScriptHex());
+    EXPECT_EQ(a->getRawMetadata(), b->getRawMetadata());
+
+    if (auto issuanceA = std::dynamic_pointer_cast<NTP1Script_Issuance>(a)) {
+        auto issuanceB = std::dynamic_pointer_cast<NTP1Script_Issuance>(b);
+        ASSERT_NE(issuanceB, nullptr);
+        EXPECT_EQ(issuanceA->getTokenSymbol(), issuanceB->getTokenSymbol());
+        EXPECT_EQ(issuanceA->getAmount(), issuanceB->getAmount());
+        EXPECT_EQ(issuanceA->getDivisibility(), issuanceB->getDivisibility());
+        EXPECT_EQ(issuanceA->isLocked(), issuanceB->isLocked());
+        EXPECT_EQ(issuanceA->getAggregationPolicy(), issuanceB->getAggregationPolicy());
+        ExpectSameTransferInstructions(issuanceA->getTransferInstructions(),
+                                       issuanceB->getTransferInstructions());
+    } else if (auto transferA = std::dynamic_pointer_cast<NTP1Script_Transfer>(a)) {
+        auto transferB = std::dynamic_pointer_cast<NTP1Script_Transfer>(b);
+        ASSERT_NE(transferB, nullptr);
+        ExpectSameTransferInstructions(transferA->getTransferInstructions(),
+                                       transferB->getTransferInstructions());
+    } else if (auto burnA = std::dynamic_pointer_cast<NTP1Script_Burn>(a)) {
+        auto burnB = std::dynamic_pointer_cast<NTP1Script_Burn>(b);
+        ASSERT_NE(burnB, nullptr);
+        ExpectSameTransferInstructions(burnA->getTransferInstructions(),
+                                       burnB->getTransferInstructions());
+    } else {
+        FAIL() << "Unknown script type";
+    }
+}
+
+TEST(ntp1_tests, script_parser_matches_legacy_parser_fuzz)
+{
+    const std::vector<std::string> seeds{
+        // v1 issuance, transfer, burn
+        "4e5401014e4942424cab10c04e20e0aec73d58c8fbf2a9c26a6dc3ed666c7b80fef2"
+        "15620c817703b1e5d8b1870211ce7cdf50718b4789245fb80f58992019002019f0",
+        "4e5401150069892a92", "4e5401150020120169895242", "4e5401251f2013",
+        // v3 issuance, transfer, burn
+        "4e540301524f4d4150010100010000000003abcdef", "4e54031001032051",
+        "4e540310050320510420410520e20638b10719", "4e540310020022a00160f42160",
+        "4e5403200200081f02"};
+
+    for (const std::string& seed : seeds) {
+        ASSERT_NO_THROW(NTP1Script::ParseScriptLegacy(seed)) << seed;
+        ExpectSameScript(NTP1Script::ParseScript(seed), NTP1Script::ParseScriptLegacy(seed));
+    }
+
+    auto seed = std::random_device{}();
+
+    std::cout << "Using seed for random script mutations: " << seed << std::endl;
+    std::mt19937 gen{seed};
+
+    auto randomByte = [&gen]() { return static_cast<char>(gen() % 256); };
+
+    unsigned parsedCount = 0;
+    for (int i = 0; i < 50000; i++) {
+        std::string script = boost::algorithm::unhex(seeds[gen() % seeds.size()]);
+        const int   mutationsCount = 1 + gen() % 3;
+        for (int j = 0; j < mutationsCount; j++) {
+            const std::size_t pos = gen() % (script.size() + 1);
+            switch (gen() % 5) {
+            case 0: // change a byte (but mostly keep the header so that the parsers get further)
+                if (pos >= 3 || gen() % 8 == 0) {
+                    script[std::min(pos, script.size() - 1)] = randomByte();
+                }
+                break;
+            case 1: // flip a bit
+                script[std::min(pos, script.size() - 1)] ^= static_cast<char>(1 << (gen() % 8));
+                break;
+            case 2: // truncate
+                script.resize(std::max<std::size_t>(pos, 3));
+                break;
+            case 3: // insert a byte
+                script.insert(script.begin() + pos, randomByte());
+                break;
+            default: // append some bytes
+                for (unsigned k = gen() % 8; k > 0; k--) {
+                    script.push_back(randomByte());
+                }
+                break;
+            }
+        }
+
+        const std::string           scriptHex = boost::algorithm::hex(script);
+        std::shared_ptr<NTP1Script> parsed;
+        std::shared_ptr<NTP1Script> parsedLegacy;
+        bool                        failed       = false;
+        bool                        failedLegacy = false;
+        try {
+            parsed = NTP1Script::ParseScript(scriptHex);
+        } catch (std::exception&) {
+            failed = true;
+        }
+        try {
+            parsedLegacy = NTP1Script::ParseScriptLegacy(scriptHex);
+        } catch (std::exception&) {
+            failedLegacy = true;
+        }
+        ASSERT_EQ(failed, failedLegacy) << "Parsers disagree on script: " << scriptHex;
+        if (!failed) {
+            parsedCount++;
+            ExpectSameScript(parsed, parsedLegacy);
+        }
+    }
+    // make sure that the mutations don't only produce garbage
+    EXPECT_GT(parsedCount, 1000u);
+}
+
 TEST(ntp1_tests, amend_tx_with_op_return)
 {
     SwitchNetworkTypeTemporarily state_holder(NetworkType::Testnet);
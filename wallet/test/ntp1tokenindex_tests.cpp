@@ -0,0 +1,137 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "ntp1/ntp1txout.h"
+#include "ntp1tokenindex.h"
+#include "txdb-lmdb.h"
+
+#include <algorithm>
+
+static const std::string TokenA   = "La4aGUPuNKZyC393pS2Nb4RJdkh8TzqVRqq7ia";
+static const std::string TokenB   = "La6ojcmYEq5ig6jFPRkVXRJrskMpYqAJ2P5cc3";
+static const std::string AddressA = "NRVhBXHw9JRiPGSHLuy4w9s4vhsJAxjF5A";
+static const std::string AddressB = "NS6tkj4qB2k7rzxXWZMd1CjCXvCc2ua4bt";
+
+static NTP1TxOut MakeTokenOutput(const std::string& address, const std::string& tokenId, int64_t amount)
+{
+    NTP1TokenTxData token;
+    token.setTokenId(tokenId);
+    token.setAmount(amount);
+
+    NTP1TxOut output;
+    output.__manualSet(10000, "", "", {token}, address);
+    return output;
+}
+
+static NTP1Int GetBalance(const CTxDB& txdb, const std::string& address, const std::string& tokenId)
+{
+    std::map<std::string, NTP1Int> balances;
+    EXPECT_TRUE(txdb.ReadNTP1AddressBalances(address, balances));
+    const auto it = balances.find(tokenId);
+    return it != balances.end() ? it->second : NTP1Int(0);
+}
+
+static std::vector<std::string> GetHolders(const CTxDB& txdb, const std::string& tokenId)
+{
+    std::vector<std::string> holders;
+    EXPECT_TRUE(txdb.ReadNTP1TokenHolders(tokenId, holders));
+    std::sort(holders.begin(), holders.end());
+    return holders;
+}
+
+TEST(ntp1tokenindex_tests, delta_from_outputs)
+{
+    NTP1TokenIndexDelta delta;
+    AddNTP1TxOutToTokenIndexDelta(delta, MakeTokenOutput(AddressA, TokenA, 1000), true);
+    AddNTP1TxOutToTokenIndexDelta(delta, MakeTokenOutput(AddressB, TokenA, 600), false);
+    AddNTP1TxOutToTokenIndexDelta(delta, MakeTokenOutput(AddressA, TokenA, 400), false);
+    // tokens in outputs without an address aren't indexed
+    AddNTP1TxOutToTokenIndexDelta(delta, MakeTokenOutput("", TokenA, 50), false);
+
+    ASSERT_EQ(delta.size(), 2u);
+    EXPECT_EQ(delta.at(std::make_pair(AddressA, TokenA)), NTP1Int(-600));
+    EXPECT_EQ(delta.at(std::make_pair(AddressB, TokenA)), NTP1Int(600));
+}
+
+TEST(ntp1tokenindex_tests, apply_and_undo)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB txdb;
+
+    // issuance of TokenA to AddressA, and of TokenB to AddressB
+    NTP1TokenIndexDelta issuance;
+    AddNTP1TxOutToTokenIndexDelta(issuance, MakeTokenOutput(AddressA, TokenA, 1000), false);
+    AddNTP1TxOutToTokenIndexDelta(issuance, MakeTokenOutput(AddressB, TokenB, 5), false);
+
+    // AddressA sends 600 of TokenA to AddressB and gets 400 back as change
+    NTP1TokenIndexDelta transfer;
+    AddNTP1TxOutToTokenIndexDelta(transfer, MakeTokenOutput(AddressA, TokenA, 1000), true);
+    AddNTP1TxOutToTokenIndexDelta(transfer, MakeTokenOutput(AddressB, TokenA, 600), false);
+    AddNTP1TxOutToTokenIndexDelta(transfer, MakeTokenOutput(AddressA, TokenA, 400), false);
+
+    // AddressB burns all of TokenB
+    NTP1TokenIndexDelta burn;
+    AddNTP1TxOutToTokenIndexDelta(burn, MakeTokenOutput(AddressB, TokenB, 5), true);
+
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, issuance, false));
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, transfer, false));
+
+    NTP1TokenIndexStats stats;
+    EXPECT_EQ(GetBalance(txdb, AddressA, TokenA), NTP1Int(400));
+    EXPECT_EQ(GetBalance(txdb, AddressB, TokenA), NTP1Int(600));
+    EXPECT_EQ(GetBalance(txdb, AddressB, TokenB), NTP1Int(5));
+    ASSERT_TRUE(txdb.ReadNTP1TokenIndexStats(TokenA, stats));
+    EXPECT_EQ(stats.supply, NTP1Int(1000));
+    EXPECT_EQ(stats.holders, 2u);
+    EXPECT_EQ(GetHolders(txdb, TokenA), std::vector<std::string>({AddressA, AddressB}));
+
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, burn, false));
+    ASSERT_TRUE(txdb.ReadNTP1TokenIndexStats(TokenB, stats));
+    EXPECT_EQ(stats.supply, NTP1Int(0));
+    EXPECT_EQ(stats.holders, 0u);
+    EXPECT_TRUE(GetHolders(txdb, TokenB).empty());
+
+    // spending more than an address has means the index is broken
+    NTP1TokenIndexDelta overspend;
+    AddNTP1TxOutToTokenIndexDelta(overspend, MakeTokenOutput(AddressA, TokenA, 401), true);
+    txdb.TxnBegin();
+    EXPECT_FALSE(ApplyNTP1TokenIndexDelta(txdb, overspend, false));
+    txdb.TxnAbort();
+
+    // disconnecting the blocks in reverse order restores every state
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, burn, true));
+    EXPECT_EQ(GetBalance(txdb, AddressB, TokenB), NTP1Int(5));
+    EXPECT_EQ(GetHolders(txdb, TokenB), std::vector<std::string>({AddressB}));
+
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, transfer, true));
+    EXPECT_EQ(GetBalance(txdb, AddressA, TokenA), NTP1Int(1000));
+    EXPECT_EQ(GetBalance(txdb, AddressB, TokenA), NTP1Int(0));
+    ASSERT_TRUE(txdb.ReadNTP1TokenIndexStats(TokenA, stats));
+    EXPECT_EQ(stats.supply, NTP1Int(1000));
+    EXPECT_EQ(stats.holders, 1u);
+    EXPECT_EQ(GetHolders(txdb, TokenA), std::vector<std::string>({AddressA}));
+
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, issuance, true));
+    std::map<std::string, NTP1Int> balances;
+    ASSERT_TRUE(txdb.ReadNTP1AddressBalances(AddressA, balances));
+    EXPECT_TRUE(balances.empty());
+    ASSERT_TRUE(txdb.ReadNTP1AddressBalances(AddressB, balances));
+    EXPECT_TRUE(balances.empty());
+    ASSERT_TRUE(txdb.ReadNTP1TokenIndexStats(TokenA, stats));
+    EXPECT_EQ(stats.supply, NTP1Int(0));
+    EXPECT_TRUE(GetHolders(txdb, TokenA).empty());
+
+    // the completeness flag is cleared together with the tables
+    ASSERT_TRUE(txdb.WriteNTP1TokenIndexComplete(true));
+    EXPECT_TRUE(txdb.IsNTP1TokenIndexComplete());
+    ASSERT_TRUE(ApplyNTP1TokenIndexDelta(txdb, issuance, false));
+    ASSERT_TRUE(txdb.ClearNTP1TokenIndex());
+    EXPECT_FALSE(txdb.IsNTP1TokenIndexComplete());
+    EXPECT_EQ(GetBalance(txdb, AddressA, TokenA), NTP1Int(0));
+    EXPECT_TRUE(GetHolders(txdb, TokenA).empty());
+
+    txdb.Close();
+}
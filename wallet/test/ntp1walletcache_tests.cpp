@@ -0,0 +1,277 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "blockindex.h"
+#include "main.h"
+#include "ntp1/ntp1walletcache.h"
+#include "wallet.h"
+
+#include <boost/make_shared.hpp>
+#include <stdexcept>
+
+class ntp1walletcache_tests : public ::testing::Test
+{
+protected:
+    CWallet                                 wallet;
+    CKey                                    key;
+    std::vector<CBlockIndexSmartPtr>        blocks;
+    std::map<uint256, std::vector<NTP1Int>> tokensOfTx; // the TOK amount of every output, by tx
+    std::set<uint256>                       failingTxs;
+    int                                     nDecodeCalls = 0;
+
+    void SetUp() override
+    {
+        key.MakeNewKey(true);
+        LOCK(wallet.cs_wallet);
+        ASSERT_TRUE(wallet.AddKey(key));
+        wallet.ntp1WalletCache = NTP1WalletCache(
+            [this](const CTransaction& tx) -> boost::optional<NTP1Transaction> {
+                return Decode(tx);
+            });
+    }
+
+    void TearDown() override
+    {
+        chainActive.SetTip(nullptr);
+        for (const CBlockIndexSmartPtr& pindex : blocks)
+            mapBlockIndex.erase(pindex->GetBlockHash());
+    }
+
+    boost::optional<NTP1Transaction> Decode(const CTransaction& tx)
+    {
+        nDecodeCalls++;
+        const uint256 hash = tx.GetHash();
+        if (failingTxs.count(hash))
+            throw std::runtime_error("inputs not available");
+        const auto it = tokensOfTx.find(hash);
+        if (it == tokensOfTx.end())
+            return boost::none;
+        std::vector<NTP1TxOut> vout;
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            NTP1TxOut txout(tx.vout[i].nValue, "");
+            if (i < it->second.size() && it->second[i] > 0) {
+                NTP1TokenTxData token;
+                token.setTokenId("La000000000000000000000000000000000000");
+                token.setTokenSymbol("TOK");
+                token.setAmount(it->second[i]);
+                txout.__addToken(token);
+            }
+            vout.push_back(txout);
+        }
+        NTP1Transaction ntp1tx;
+        ntp1tx.__manualSet(tx.nVersion, hash, std::vector<unsigned char>(), std::vector<NTP1TxIn>(),
+                           vout, tx.nLockTime, tx.nTime, NTP1TxType_TRANSFER);
+        return ntp1tx;
+    }
+
+    // appends a block to the active chain and returns its hash
+    uint256 ConnectBlock()
+    {
+        CBlockIndexSmartPtr pindex = boost::make_shared<CBlockIndex>();
+        pindex->pprev              = blocks.empty() ? nullptr : blocks.back();
+        pindex->nHeight            = static_cast<int>(blocks.size());
+        pindex->phashBlock         = uint256(1000 + blocks.size());
+        mapBlockIndex.set(pindex->GetBlockHash(), pindex);
+        blocks.push_back(pindex);
+        chainActive.SetTip(pindex.get());
+        return pindex->GetBlockHash();
+    }
+
+    void DisconnectBlock()
+    {
+        mapBlockIndex.erase(blocks.back()->GetBlockHash());
+        blocks.pop_back();
+        chainActive.SetTip(blocks.empty() ? nullptr : blocks.back().get());
+    }
+
+    // a transaction that spends prevout and pays the given TOK amounts to its outputs; to this wallet
+    // if the amount is positive, elsewhere if it's negative
+    CWalletTx MakeTx(const COutPoint& prevout, const std::vector<NTP1Int>& tokens,
+                     const uint256& hashBlock)
+    {
+        CKey other;
+        other.MakeNewKey(true);
+
+        CTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(tokens.size());
+        for (unsigned int i = 0; i < tokens.size(); i++) {
+            tx.vout[i].nValue = 10 * CENT;
+            tx.vout[i].scriptPubKey =
+                GetScriptForDestination((tokens[i] > 0 ? key : other).GetPubKey().GetID());
+        }
+        std::vector<NTP1Int>& decoded = tokensOfTx[tx.GetHash()];
+        for (const NTP1Int& amount : tokens)
+            decoded.push_back(boost::multiprecision::abs(amount));
+
+        CWalletTx wtx(&wallet, tx);
+        wtx.hashBlock = hashBlock;
+        wtx.nIndex    = hashBlock == 0 ? -1 : 1;
+        return wtx;
+    }
+
+    NTP1Int Balance(int nMinDepth = 1)
+    {
+        LOCK2(cs_main, wallet.cs_wallet);
+        std::map<std::string, NTP1Int> balances = wallet.ntp1WalletCache.GetBalances(wallet, nMinDepth);
+        EXPECT_LE(balances.size(), 1u);
+        return balances.empty() ? 0 : balances.begin()->second;
+    }
+
+    void AddToWallet(const CWalletTx& wtx)
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddToWallet(wtx, true, nullptr);
+    }
+
+    // what the wallet does when a transaction is (re)confirmed, or abandoned if hashBlock is 0
+    void ChangeInWallet(const uint256& hash, const uint256& hashBlock)
+    {
+        LOCK(wallet.cs_wallet);
+        CWalletTx& wtx = wallet.mapWallet.at(hash);
+        if (hashBlock == 0)
+            wtx.setAbandoned();
+        else
+            wtx.hashBlock = hashBlock;
+        wtx.MarkDirty();
+        wallet.ntp1WalletCache.TransactionChanged(wtx);
+    }
+};
+
+TEST_F(ntp1walletcache_tests, apply_and_undo_blocks)
+{
+    ConnectBlock();
+    const uint256   block1  = ConnectBlock();
+    const CWalletTx receive = MakeTx(COutPoint(uint256(1), 0), {100}, block1);
+    AddToWallet(receive);
+    EXPECT_EQ(Balance(), 100u);
+
+    // spend 40 TOK elsewhere and keep 60 as change
+    const uint256   block2 = ConnectBlock();
+    const CWalletTx spend  = MakeTx(COutPoint(receive.GetHash(), 0), {-40, 60}, block2);
+    AddToWallet(spend);
+    EXPECT_EQ(Balance(), 60u);
+    EXPECT_EQ(Balance(2), 0u);
+
+    // the spend isn't in the chain or the mempool anymore, but it still spends the output
+    DisconnectBlock();
+    EXPECT_EQ(Balance(), 0u);
+    EXPECT_EQ(Balance(0), 0u);
+
+    // once it's abandoned, the output it spent is available again
+    ChangeInWallet(spend.GetHash(), 0);
+    EXPECT_EQ(Balance(), 100u);
+
+    // and spent again when it's in a block again
+    const uint256 block2b = ConnectBlock();
+    ChangeInWallet(spend.GetHash(), block2b);
+    EXPECT_EQ(Balance(), 60u);
+
+    DisconnectBlock();
+    DisconnectBlock();
+    EXPECT_EQ(Balance(), 0u);
+
+    // every transaction was decoded once
+    EXPECT_EQ(nDecodeCalls, 2);
+}
+
+TEST_F(ntp1walletcache_tests, pending_txs)
+{
+    ConnectBlock();
+    const uint256 block1 = ConnectBlock();
+
+    const CWalletTx notNTP1 = MakeTx(COutPoint(uint256(1), 0), {1}, block1);
+    tokensOfTx.erase(notNTP1.GetHash());
+    const CWalletTx received = MakeTx(COutPoint(uint256(2), 0), {5}, block1);
+    const CWalletTx failing  = MakeTx(COutPoint(uint256(3), 0), {7}, block1);
+    failingTxs.insert(failing.GetHash());
+
+    AddToWallet(notNTP1);
+    AddToWallet(received);
+    AddToWallet(failing);
+    EXPECT_EQ(nDecodeCalls, 0);
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_EQ(wallet.ntp1WalletCache.GetPendingTxsCount(), 3u);
+    }
+
+    // transactions are decoded on the next query; the one that fails stays pending
+    EXPECT_EQ(Balance(), 5u);
+    EXPECT_EQ(nDecodeCalls, 3);
+    {
+        LOCK(wallet.cs_wallet);
+        EXPECT_EQ(wallet.ntp1WalletCache.GetPendingTxsCount(), 1u);
+        EXPECT_EQ(wallet.ntp1WalletCache.GetTokenName("La000000000000000000000000000000000000"), "TOK");
+        EXPECT_EQ(wallet.ntp1WalletCache.GetTokenName("unknown"), "<NameError>");
+    }
+
+    // and is retried until it succeeds
+    EXPECT_EQ(Balance(), 5u);
+    EXPECT_EQ(nDecodeCalls, 4);
+    failingTxs.clear();
+    EXPECT_EQ(Balance(), 12u);
+    EXPECT_EQ(nDecodeCalls, 5);
+
+    // a transaction that changes state isn't decoded again
+    ChangeInWallet(received.GetHash(), block1);
+    EXPECT_EQ(Balance(), 12u);
+    EXPECT_EQ(nDecodeCalls, 5);
+
+    // an erased transaction drops its outputs
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.mapWallet.erase(received.GetHash());
+        wallet.ntp1WalletCache.TransactionErased(received.GetHash());
+        EXPECT_EQ(wallet.ntp1WalletCache.GetPendingTxsCount(), 0u);
+    }
+    EXPECT_EQ(Balance(), 7u);
+}
+
+TEST_F(ntp1walletcache_tests, wallet_reload)
+{
+    ConnectBlock();
+    const uint256   block1  = ConnectBlock();
+    const CWalletTx receive = MakeTx(COutPoint(uint256(1), 0), {100, 3}, block1);
+    AddToWallet(receive);
+    const uint256   block2 = ConnectBlock();
+    const CWalletTx spend  = MakeTx(COutPoint(receive.GetHash(), 0), {-40, 60}, block2);
+    AddToWallet(spend);
+    EXPECT_EQ(Balance(), 63u);
+
+    // write the transactions the way CWalletDB does, and load them in a new wallet the way
+    // CWalletDB::LoadWallet() does
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    {
+        LOCK(wallet.cs_wallet);
+        for (const auto& item : wallet.mapWallet)
+            ss << item.first << item.second;
+    }
+
+    CWallet reloaded;
+    int     nReloadedDecodeCalls = 0;
+    reloaded.ntp1WalletCache     = NTP1WalletCache(
+        [&](const CTransaction& tx) -> boost::optional<NTP1Transaction> {
+            nReloadedDecodeCalls++;
+            return Decode(tx);
+        });
+    {
+        LOCK2(cs_main, reloaded.cs_wallet);
+        ASSERT_TRUE(reloaded.AddKey(key));
+        while (!ss.empty()) {
+            uint256 hash;
+            ss >> hash;
+            CWalletTx& wtx = reloaded.mapWallet[hash];
+            ss >> wtx;
+            wtx.BindWallet(&reloaded);
+            reloaded.AddToWallet(wtx, true, nullptr);
+        }
+        EXPECT_EQ(reloaded.mapWallet.size(), 2u);
+
+        const std::map<std::string, NTP1Int> balances = reloaded.ntp1WalletCache.GetBalances(reloaded, 1);
+        ASSERT_EQ(balances.size(), 1u);
+        EXPECT_EQ(balances.begin()->second, 63u);
+        EXPECT_EQ(reloaded.ntp1WalletCache.GetTokenName(balances.begin()->first), "TOK");
+        EXPECT_EQ(reloaded.ntp1WalletCache.GetPendingTxsCount(), 0u);
+    }
+    EXPECT_EQ(nReloadedDecodeCalls, 2);
+}
@@ -0,0 +1,79 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "block.h"
+#include "optionalindex.h"
+#include "txdb-lmdb.h"
+
+static bool fTestIndex = false;
+
+// an index stored like the NTP1 token index, whose updates can be made to fail
+class CTestIndex : public COptionalIndex
+{
+public:
+    mutable int nApplied = 0;
+    bool        fFail    = false;
+
+    CTestIndex()
+        : COptionalIndex("test index",
+                         {{"test index", &fTestIndex, &CTxDB::IsNTP1TokenIndexComplete,
+                           &CTxDB::WriteNTP1TokenIndexComplete, &CTxDB::ClearNTP1TokenIndex}})
+    {
+    }
+
+protected:
+    bool ApplyBlock(const CBlock& /*block*/, int /*nHeight*/, CTxDB& /*txdb*/, bool /*fUndo*/,
+                    unsigned int partsMask) const override
+    {
+        EXPECT_EQ(partsMask, 1u);
+        nApplied++;
+        return !fFail;
+    }
+};
+
+TEST(optionalindex_tests, update_and_init)
+{
+    CTxDB::DB_DIR = "test-txdb"; // avoid writing to the main database
+
+    CTxDB::__deleteDb(); // clean up
+
+    CTxDB::QuickSyncHigherControl_Enabled = false;
+    CTxDB txdb;
+
+    CTestIndex   index;
+    const CBlock block;
+
+    // an index that's disabled or not built isn't updated
+    fTestIndex = false;
+    ASSERT_TRUE(txdb.WriteNTP1TokenIndexComplete(true));
+    EXPECT_TRUE(index.UpdateWithBlock(block, 1, txdb, false));
+    fTestIndex = true;
+    ASSERT_TRUE(txdb.WriteNTP1TokenIndexComplete(false));
+    EXPECT_TRUE(index.UpdateWithBlock(block, 1, txdb, false));
+    EXPECT_EQ(index.nApplied, 0);
+
+    ASSERT_TRUE(txdb.WriteNTP1TokenIndexComplete(true));
+    EXPECT_TRUE(index.UpdateWithBlock(block, 1, txdb, false));
+    EXPECT_TRUE(index.UpdateWithBlock(block, 1, txdb, true));
+    EXPECT_EQ(index.nApplied, 2);
+    EXPECT_TRUE(txdb.IsNTP1TokenIndexComplete());
+
+    // a failed update doesn't fail the block, but the index isn't used anymore
+    index.fFail = true;
+    EXPECT_TRUE(index.UpdateWithBlock(block, 1, txdb, false));
+    EXPECT_EQ(index.nApplied, 3);
+    EXPECT_FALSE(txdb.IsNTP1TokenIndexComplete());
+    EXPECT_TRUE(index.UpdateWithBlock(block, 2, txdb, false));
+    EXPECT_EQ(index.nApplied, 3);
+    txdb.Close();
+
+    // and it's rebuilt on the next start; there are no blocks in the main chain here
+    index.fFail = false;
+    ASSERT_TRUE(index.Init());
+    EXPECT_TRUE(CTxDB().IsNTP1TokenIndexComplete());
+    EXPECT_EQ(index.nApplied, 3);
+
+    // a disabled index is dropped
+    fTestIndex = false;
+    ASSERT_TRUE(index.Init());
+    EXPECT_FALSE(CTxDB().IsNTP1TokenIndexComplete());
+}
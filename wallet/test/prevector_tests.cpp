@@ -0,0 +1,164 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "prevector.h"
+#include "script.h"
+#include "serialize.h"
+#include "version.h"
+
+#include <random>
+
+typedef prevector<8, int> TestVector;
+
+static void ExpectEqual(const TestVector& pre, const std::vector<int>& real)
+{
+    ASSERT_EQ(pre.size(), real.size());
+    EXPECT_EQ(pre.empty(), real.empty());
+    for (std::size_t i = 0; i < real.size(); i++) {
+        EXPECT_EQ(pre[i], real[i]);
+    }
+    EXPECT_TRUE(std::equal(pre.begin(), pre.end(), real.begin()));
+    EXPECT_TRUE(std::equal(pre.rbegin(), pre.rend(), real.rbegin()));
+    EXPECT_GE(pre.capacity(), pre.size());
+
+    const TestVector copy(pre);
+    EXPECT_TRUE(copy == pre);
+    TestVector moved(std::move(TestVector(pre)));
+    EXPECT_TRUE(moved == pre);
+    TestVector assigned;
+    assigned = pre;
+    EXPECT_TRUE(assigned == pre);
+}
+
+// random operations applied to a prevector and a vector alike, going back and forth across the
+// inline capacity
+TEST(prevector_tests, matches_vector)
+{
+    std::mt19937 rng(42);
+    for (int run = 0; run < 50; run++) {
+        TestVector       pre;
+        std::vector<int> real;
+        for (int step = 0; step < 500; step++) {
+            const int value = static_cast<int>(rng() % 1000);
+            switch (rng() % 11) {
+            case 0:
+                pre.push_back(value);
+                real.push_back(value);
+                break;
+            case 1: {
+                const std::size_t pos = rng() % (real.size() + 1);
+                pre.insert(pre.begin() + pos, value);
+                real.insert(real.begin() + pos, value);
+                break;
+            }
+            case 2: {
+                const std::size_t pos   = rng() % (real.size() + 1);
+                const std::size_t count = rng() % 10;
+                pre.insert(pre.begin() + pos, count, value);
+                real.insert(real.begin() + pos, count, value);
+                break;
+            }
+            case 3: {
+                const std::size_t      pos = rng() % (real.size() + 1);
+                const std::vector<int> values(rng() % 20, value);
+                pre.insert(pre.begin() + pos, values.begin(), values.end());
+                real.insert(real.begin() + pos, values.begin(), values.end());
+                break;
+            }
+            case 4:
+                if (!real.empty()) {
+                    const std::size_t pos = rng() % real.size();
+                    pre.erase(pre.begin() + pos);
+                    real.erase(real.begin() + pos);
+                }
+                break;
+            case 5: {
+                const std::size_t first = rng() % (real.size() + 1);
+                const std::size_t last  = first + rng() % (real.size() - first + 1);
+                pre.erase(pre.begin() + first, pre.begin() + last);
+                real.erase(real.begin() + first, real.begin() + last);
+                break;
+            }
+            case 6: {
+                const std::size_t size = rng() % 30;
+                pre.resize(size);
+                real.resize(size);
+                break;
+            }
+            case 7:
+                if (!real.empty()) {
+                    pre.pop_back();
+                    real.pop_back();
+                }
+                break;
+            case 8:
+                pre.reserve(rng() % 40);
+                break;
+            case 9:
+                pre.shrink_to_fit();
+                break;
+            case 10: {
+                // an element of the container itself may be inserted
+                if (!real.empty()) {
+                    const std::size_t src = rng() % real.size();
+                    pre.insert(pre.begin(), pre[src]);
+                    real.insert(real.begin(), real[src]);
+                }
+                break;
+            }
+            }
+            ExpectEqual(pre, real);
+        }
+    }
+}
+
+TEST(prevector_tests, inline_storage)
+{
+    TestVector pre;
+    for (int i = 0; i < 8; i++) {
+        pre.push_back(i);
+    }
+    EXPECT_EQ(pre.allocated_memory(), 0u);
+    pre.push_back(8);
+    EXPECT_GT(pre.allocated_memory(), 0u);
+    pre.resize(4);
+    pre.shrink_to_fit();
+    EXPECT_EQ(pre.allocated_memory(), 0u);
+    EXPECT_EQ(pre.size(), 4u);
+    EXPECT_EQ(pre[3], 3);
+}
+
+TEST(prevector_tests, ordering_matches_vector)
+{
+    const std::vector<std::vector<int>> values{{}, {1}, {1, 2}, {2}, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+    for (const std::vector<int>& a : values) {
+        for (const std::vector<int>& b : values) {
+            const TestVector preA(a.begin(), a.end());
+            const TestVector preB(b.begin(), b.end());
+            EXPECT_EQ(preA < preB, a < b);
+            EXPECT_EQ(preA == preB, a == b);
+        }
+    }
+}
+
+// scripts are serialized exactly as they were when CScript was a vector
+TEST(prevector_tests, script_serialization)
+{
+    for (std::size_t size : {0, 1, 27, 28, 29, 252, 253, 10000}) {
+        std::vector<unsigned char> bytes(size);
+        for (std::size_t i = 0; i < size; i++) {
+            bytes[i] = static_cast<unsigned char>(i * 7);
+        }
+        const CScript script(bytes.begin(), bytes.end());
+
+        CDataStream ssScript(SER_NETWORK, PROTOCOL_VERSION);
+        ssScript << script;
+        CDataStream ssVector(SER_NETWORK, PROTOCOL_VERSION);
+        ssVector << bytes;
+        EXPECT_EQ(ssScript.str(), ssVector.str());
+        EXPECT_EQ(::GetSerializeSize(script, SER_NETWORK, PROTOCOL_VERSION), ssVector.size());
+
+        CScript read;
+        ssScript >> read;
+        EXPECT_TRUE(read == script);
+    }
+}
@@ -0,0 +1,271 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "curltools.h"
+#include "quicksyncdownloader.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <thread>
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <cinttypes>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * A stand-in for a QuickSync mirror: serves one file over HTTP on localhost, with range requests, and
+ * misbehaves in the ways it's told to.
+ */
+class LocalHTTPServer
+{
+    const std::string        content;
+    int                      listenSocket;
+    uint16_t                 port;
+    std::thread              acceptThread;
+    std::mutex               mutex;
+    std::vector<std::thread> connectionThreads;
+
+    void Serve(int hSocket)
+    {
+        std::string request;
+        char        buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            const ssize_t nBytes = recv(hSocket, buffer, sizeof(buffer), 0);
+            if (nBytes <= 0) {
+                close(hSocket);
+                return;
+            }
+            request.append(buffer, nBytes);
+        }
+
+        uint64_t          begin  = 0;
+        uint64_t          end    = content.size() - 1;
+        const std::size_t range  = request.find("Range: bytes=");
+        const bool        fRange = range != std::string::npos && !fIgnoreRanges;
+        if (fRange) {
+            sscanf(request.c_str() + range, "Range: bytes=%" SCNu64 "-%" SCNu64, &begin, &end);
+        }
+
+        std::string response;
+        const int   nRequest = nRequests++;
+        if (nRequest >= nFailFrom) {
+            response =
+                "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        } else {
+            std::string body     = content.substr(begin, end - begin + 1);
+            uint64_t    expected = begin;
+            if (fRange && corruptOffset.compare_exchange_strong(expected, UINT64_MAX)) {
+                body[body.size() / 2] ^= 1;
+            }
+            response = std::string(fRange ? "HTTP/1.1 206 Partial Content" : "HTTP/1.1 200 OK") +
+                       "\r\nContent-Length: " + std::to_string(body.size()) +
+                       "\r\nConnection: close\r\n\r\n" + body;
+        }
+        for (std::size_t sent = 0; sent < response.size();) {
+            const ssize_t nBytes = send(hSocket, response.data() + sent, response.size() - sent, 0);
+            if (nBytes <= 0) {
+                break;
+            }
+            sent += nBytes;
+        }
+        close(hSocket);
+    }
+
+public:
+    std::atomic<int>      nRequests{0};
+    std::atomic<int>      nFailFrom{INT32_MAX};      // requests from this one on fail
+    std::atomic<bool>     fIgnoreRanges{false};      // answer every request with the whole file
+    std::atomic<uint64_t> corruptOffset{UINT64_MAX}; // the range at this offset is corrupted once
+
+    explicit LocalHTTPServer(const std::string& contentIn) : content(contentIn)
+    {
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+        socklen_t len        = sizeof(addr);
+        if (bind(listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listenSocket, 16) != 0 ||
+            getsockname(listenSocket, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            throw std::runtime_error("Failed to start the local HTTP server");
+        }
+        port         = ntohs(addr.sin_port);
+        acceptThread = std::thread([this]() {
+            while (true) {
+                const int hSocket = accept(listenSocket, nullptr, nullptr);
+                if (hSocket < 0) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                connectionThreads.emplace_back(&LocalHTTPServer::Serve, this, hSocket);
+            }
+        });
+    }
+
+    ~LocalHTTPServer()
+    {
+        shutdown(listenSocket, SHUT_RDWR);
+        close(listenSocket);
+        acceptThread.join();
+        for (std::thread& thread : connectionThreads) {
+            thread.join();
+        }
+    }
+
+    std::string GetURL() const { return "http://127.0.0.1:" + std::to_string(port) + "/data.mdb"; }
+};
+
+class QuickSyncDownloaderTest : public ::testing::Test
+{
+protected:
+    static const uint64_t CHUNK_SIZE = 64 * 1024;
+
+    const boost::filesystem::path dir    = "quicksync_test_dir";
+    const boost::filesystem::path target = dir / "data.mdb";
+    std::string                   content;
+    std::string                   sha256;
+    std::vector<std::string>      chunkSums;
+
+    void SetUp() override
+    {
+        boost::filesystem::remove_all(dir);
+        boost::filesystem::create_directories(dir);
+
+        // more than 16 chunks, the last of which is short
+        content.resize(16 * CHUNK_SIZE + 123);
+        for (std::size_t i = 0; i < content.size(); i++) {
+            content[i] = static_cast<char>((i * 7919) >> 3);
+        }
+        Sha256Calculator hasher;
+        hasher.push_data(content);
+        sha256 = hasher.getHashAndReset();
+        for (uint64_t offset = 0; offset < content.size(); offset += CHUNK_SIZE) {
+            hasher.push_data(content.substr(offset, CHUNK_SIZE));
+            chunkSums.push_back(hasher.getHashAndReset());
+        }
+    }
+
+    void TearDown() override { boost::filesystem::remove_all(dir); }
+
+    std::string ReadTarget() const
+    {
+        boost::filesystem::ifstream f(target, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(QuickSyncDownloaderTest, parallel_ranges)
+{
+    LocalHTTPServer server(content);
+
+    QuickSyncDownloader downloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE,
+                                   chunkSums);
+    ASSERT_EQ(downloader.GetChunkCount(), 17u);
+    downloader.SetConnections(4);
+    uint64_t lastProgress = 0;
+    downloader.Run([&lastProgress](uint64_t done, uint64_t total) {
+        EXPECT_LE(done, total);
+        lastProgress = done;
+    });
+
+    EXPECT_EQ(server.nRequests, 17);
+    EXPECT_TRUE(ReadTarget() == content);
+    EXPECT_FALSE(boost::filesystem::exists(target.string() + ".temp"));
+    EXPECT_FALSE(boost::filesystem::exists(target.string() + ".temp.progress"));
+}
+
+// an interrupted download resumes with the chunks it didn't finish
+TEST_F(QuickSyncDownloaderTest, resume)
+{
+    {
+        LocalHTTPServer server(content);
+        server.nFailFrom = 5;
+
+        QuickSyncDownloader downloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE,
+                                       chunkSums);
+        downloader.SetConnections(1);
+        EXPECT_THROW(downloader.Run(), std::runtime_error);
+        EXPECT_EQ(server.nRequests, 5 + static_cast<int>(QUICKSYNC_MAX_CHUNK_ATTEMPTS));
+        EXPECT_FALSE(boost::filesystem::exists(target));
+        EXPECT_TRUE(boost::filesystem::exists(target.string() + ".temp"));
+    }
+
+    // a chunk that was recorded, but is corrupt on disk, is downloaded again
+    {
+        boost::filesystem::fstream temp(target.string() + ".temp",
+                                        std::ios::in | std::ios::out | std::ios::binary);
+        temp.seekp(CHUNK_SIZE + 10);
+        temp.put(~content[CHUNK_SIZE + 10]);
+    }
+
+    LocalHTTPServer     server(content);
+    QuickSyncDownloader downloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE,
+                                   chunkSums);
+    downloader.SetConnections(3);
+    downloader.Run();
+    EXPECT_EQ(server.nRequests, 17 - 5 + 1);
+    EXPECT_TRUE(ReadTarget() == content);
+}
+
+// chunks that fail, or don't match the manifest, are downloaded again, from the other mirror
+TEST_F(QuickSyncDownloaderTest, failed_chunks_retried)
+{
+    LocalHTTPServer broken(content);
+    broken.nFailFrom = 0;
+    LocalHTTPServer server(content);
+    server.corruptOffset = 3 * CHUNK_SIZE;
+
+    QuickSyncDownloader downloader({broken.GetURL(), server.GetURL()}, content.size(), sha256, target,
+                                   CHUNK_SIZE, chunkSums);
+    downloader.SetConnections(2);
+    downloader.Run();
+    EXPECT_EQ(server.nRequests, 17 + 1);
+    EXPECT_GT(broken.nRequests, 0);
+    EXPECT_TRUE(ReadTarget() == content);
+}
+
+TEST_F(QuickSyncDownloaderTest, bad_checksum_and_no_ranges)
+{
+    LocalHTTPServer server(content);
+
+    // without a manifest, a corrupt chunk is only found when the whole file is checked
+    server.corruptOffset = 2 * CHUNK_SIZE;
+    {
+        QuickSyncDownloader downloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE);
+        EXPECT_THROW(downloader.Run(), std::runtime_error);
+        EXPECT_FALSE(boost::filesystem::exists(target));
+        EXPECT_FALSE(boost::filesystem::exists(target.string() + ".temp"));
+    }
+
+    server.fIgnoreRanges = true;
+    {
+        QuickSyncDownloader downloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE);
+        EXPECT_THROW(downloader.Run(), RangeNotSupportedError);
+    }
+
+    EXPECT_THROW(QuickSyncDownloader({server.GetURL()}, content.size(), sha256, target, CHUNK_SIZE,
+                                     {chunkSums[0]}),
+                 std::runtime_error);
+}
+TEST_F(QuickSyncDownloaderTest, remove_partial_downloads)
+{
+    const boost::filesystem::path other = dir / "lock.mdb";
+    for (const boost::filesystem::path& path :
+         {boost::filesystem::path(target.string() + ".temp"),
+          boost::filesystem::path(target.string() + ".temp.progress"), other}) {
+        boost::filesystem::ofstream(path) << "x";
+    }
+
+    QuickSyncDownloader::RemovePartialDownloads(dir);
+    EXPECT_FALSE(boost::filesystem::exists(target.string() + ".temp"));
+    EXPECT_FALSE(boost::filesystem::exists(target.string() + ".temp.progress"));
+    EXPECT_TRUE(boost::filesystem::exists(other));
+
+    // a missing directory is nothing to clean up
+    EXPECT_NO_THROW(QuickSyncDownloader::RemovePartialDownloads(dir / "missing"));
+}
+#endif
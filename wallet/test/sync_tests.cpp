@@ -0,0 +1,111 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "locksite.h"
+#include "metrics.h"
+#include "sync.h"
+
+#include <boost/thread.hpp>
+
+static const CLockSite* FindLockSite(const std::string& name)
+{
+    const CLockSite* result = nullptr;
+    CLockProfiler::ForEachSite([&](const CLockSite& site) {
+        if (site.pszName == name) {
+            result = &site;
+        }
+    });
+    return result;
+}
+
+static CCriticalSection cs_profiled;
+
+// a single site, however many times it's called
+static void LockProfiled(int nHoldMillis = 0)
+{
+    LOCK(cs_profiled);
+    if (nHoldMillis > 0) {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(nHoldMillis));
+    }
+}
+
+TEST(sync_tests, lock_profiler_sampling)
+{
+    CLockProfiler::SetSampleInterval(0);
+    for (int i = 0; i < 10; i++) {
+        LockProfiled();
+    }
+    // an uncontended lock isn't a site until it's sampled
+    EXPECT_EQ(FindLockSite("cs_profiled"), nullptr);
+
+    CLockProfiler::SetSampleInterval(1);
+    for (int i = 0; i < 10; i++) {
+        LockProfiled(1);
+    }
+    const CLockSite* site = FindLockSite("cs_profiled");
+    ASSERT_NE(site, nullptr);
+    EXPECT_EQ(site->sampled.Get(), 10u);
+    EXPECT_EQ(site->acquisitions.Get(), 10u);
+    EXPECT_EQ(site->contended.Get(), 0u);
+    EXPECT_EQ(site->waits.GetSnapshot().count, 10u);
+    EXPECT_EQ(site->holds.GetSnapshot().count, 10u);
+    EXPECT_GE(site->holds.GetSnapshot().sum, 10u * 1000000u);
+    EXPECT_NE(std::string(site->pszFile).find("sync_tests.cpp"), std::string::npos);
+
+    // with an interval of 4, one in 4 acquisitions is timed and counts for 4
+    CLockProfiler::Reset();
+    EXPECT_EQ(site->sampled.Get(), 0u);
+    EXPECT_EQ(site->holds.GetSnapshot().count, 0u);
+    CLockProfiler::SetSampleInterval(4);
+    for (int i = 0; i < 40; i++) {
+        LockProfiled();
+    }
+    EXPECT_EQ(site->sampled.Get(), 10u);
+    EXPECT_EQ(site->acquisitions.Get(), 40u);
+
+    CLockProfiler::SetSampleInterval(0);
+    CLockProfiler::Reset();
+}
+
+TEST(sync_tests, lock_profiler_contention)
+{
+    static CCriticalSection cs_first;
+    static CCriticalSection cs_second;
+
+    SetLockWaitMetricName(&cs_first, "first");
+    SetLockWaitMetricName(&cs_second, "second");
+    CMetricHistogram& firstHistogram =
+        Metrics().Histogram("neblio_lock_wait_seconds", MetricLabel("lock", "first"));
+    CMetricHistogram& secondHistogram =
+        Metrics().Histogram("neblio_lock_wait_seconds", MetricLabel("lock", "second"));
+    const uint64_t firstWaits  = firstHistogram.GetSnapshot().count;
+    const uint64_t secondWaits = secondHistogram.GetSnapshot().count;
+
+    CLockProfiler::SetSampleInterval(1);
+    boost::thread waiter;
+    {
+        LOCK(cs_second);
+        waiter = boost::thread([]() { LOCK2(cs_first, cs_second); });
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+    }
+    waiter.join();
+    CLockProfiler::SetSampleInterval(0);
+
+    // LOCK2() is a site of its own, named after both locks
+    const CLockSite* site = FindLockSite("cs_first, cs_second");
+    ASSERT_NE(site, nullptr);
+    EXPECT_EQ(site->sampled.Get(), 1u);
+    EXPECT_EQ(site->contended.Get(), 1u);
+    EXPECT_GE(site->waits.GetSnapshot().max, 10000000u);
+
+    // the wait is recorded in the metric of the lock that was waited for, not for the pair
+    EXPECT_EQ(firstHistogram.GetSnapshot().count, firstWaits);
+    EXPECT_EQ(secondHistogram.GetSnapshot().count, secondWaits + 1);
+
+    // both locks were released
+    TRY_LOCK2(cs_first, cs_second, lockBoth);
+    EXPECT_TRUE(static_cast<bool>(lockBoth));
+
+    SetLockWaitMetricName(&cs_first, nullptr);
+    SetLockWaitMetricName(&cs_second, nullptr);
+    CLockProfiler::Reset();
+}
@@ -37,11 +37,18 @@ SOURCES += \
 
 SOURCES += \
     accounting_tests.cpp  \
+    activechain_tests.cpp \
+    addressindex_tests.cpp \
     allocator_tests.cpp   \
     base32_tests.cpp      \
     base58_tests.cpp      \
     base64_tests.cpp      \
     bignum_tests.cpp      \
+    blockarena_tests.cpp  \
+    blockencodings_tests.cpp \
+    blockfilter_tests.cpp \
+    blockindexsnapshot_tests.cpp \
+    blockwritebatch_tests.cpp \
     bloom_tests.cpp       \
     canonical_tests.cpp   \
     checkpoints_tests.cpp \
@@ -52,24 +59,38 @@ SOURCES += \
     getarg_tests.cpp      \
     hash_tests.cpp        \
     key_tests.cpp         \
+    keystore_tests.cpp    \
+    lockfreehashmap_tests.cpp \
+    logging_tests.cpp     \
     merkle_tests.cpp      \
+    metrics_tests.cpp     \
     miner_tests.cpp       \
     mruset_tests.cpp      \
+    net_tests.cpp         \
     netbase_tests.cpp     \
     ntp1_selection_tests.cpp \
     ntp1_tests.cpp        \
+    ntp1tokenindex_tests.cpp \
+    ntp1walletcache_tests.cpp \
+    optionalindex_tests.cpp \
     pmt_tests.cpp         \
     pos_tests.cpp         \
+    prevector_tests.cpp   \
+    quicksyncdownloader_tests.cpp \
     rpc_tests.cpp         \
     result_tests.cpp      \
     script_tests.cpp      \
     serialize_tests.cpp   \
     sigopcount_tests.cpp  \
+    sync_tests.cpp        \
     transaction_tests.cpp \
     uint160_tests.cpp     \
     uint256_tests.cpp     \
     util_tests.cpp        \
+    validationinterface_tests.cpp \
+    validationtimes_tests.cpp \
     wallet_tests.cpp      \
+    walletrescan_tests.cpp \
     environment.cpp
 
 DEFINES += BITCOIN_QT_TEST
@@ -0,0 +1,78 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "validationinterface.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST(validationinterface_tests, runs_inline_when_not_started)
+{
+    ValidationInterfaceQueue queue;
+    int                      calls = 0;
+    queue.Push([&calls]() { calls++; });
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(queue.Size(), 0u);
+    queue.Sync();
+}
+
+TEST(validationinterface_tests, order_and_sync)
+{
+    ValidationInterfaceQueue queue;
+    queue.Start();
+    EXPECT_TRUE(queue.IsRunning());
+
+    std::vector<int>  processed;
+    std::atomic<bool> fRelease(false);
+    // hold the queue thread until everything is queued, so that Sync() really has to wait
+    queue.Push([&fRelease]() {
+        while (!fRelease)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    for (int i = 0; i < 1000; i++) {
+        queue.Push([&processed, i]() { processed.push_back(i); });
+    }
+    EXPECT_GE(queue.Size(), 1000u);
+    fRelease = true;
+
+    queue.Sync();
+    ASSERT_EQ(processed.size(), 1000u);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(processed[i], i);
+    }
+    EXPECT_EQ(queue.Size(), 0u);
+
+    // callbacks that throw don't stop the queue
+    queue.Push([]() { throw std::runtime_error("test"); });
+    queue.Push([&processed]() { processed.push_back(-1); });
+    queue.Sync();
+    EXPECT_EQ(processed.back(), -1);
+
+    // a callback waiting for its own queue doesn't deadlock
+    queue.Push([&queue]() { queue.Sync(); });
+    queue.Sync();
+
+    queue.Stop();
+    EXPECT_FALSE(queue.IsRunning());
+}
+
+TEST(validationinterface_tests, stop_processes_remaining)
+{
+    ValidationInterfaceQueue queue;
+    queue.Start();
+
+    std::atomic<int> calls(0);
+    for (int i = 0; i < 100; i++) {
+        queue.Push([&calls]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            calls++;
+        });
+    }
+    queue.Stop();
+    EXPECT_EQ(calls, 100);
+
+    // after stopping, callbacks are executed in the calling thread again
+    queue.Push([&calls]() { calls++; });
+    EXPECT_EQ(calls, 101);
+}
@@ -0,0 +1,54 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "validationtimes.h"
+
+#include <thread>
+
+static void SleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// a phase timed within another one only counts for the inner phase, so the phases add up to at most
+// the time that passed
+TEST(validationtimes_tests, nested_timers_are_exclusive)
+{
+    ValidationTimes::Reset();
+    const auto start = std::chrono::steady_clock::now();
+    {
+        const ValidationPhaseTimer ntp1Timer(ValidationPhase::NTP1);
+        SleepMs(20);
+        {
+            const ValidationPhaseTimer fetchTimer(ValidationPhase::FetchInputs);
+            SleepMs(50);
+            {
+                const ValidationPhaseTimer commitTimer(ValidationPhase::DbCommit);
+                SleepMs(20);
+            }
+        }
+        SleepMs(20);
+    }
+    const std::chrono::nanoseconds total = std::chrono::steady_clock::now() - start;
+
+    const std::chrono::nanoseconds ntp1   = ValidationTimes::Get(ValidationPhase::NTP1);
+    const std::chrono::nanoseconds fetch  = ValidationTimes::Get(ValidationPhase::FetchInputs);
+    const std::chrono::nanoseconds commit = ValidationTimes::Get(ValidationPhase::DbCommit);
+    EXPECT_GE(ntp1, std::chrono::milliseconds(40));
+    EXPECT_LT(ntp1, std::chrono::milliseconds(40) + std::chrono::milliseconds(50));
+    EXPECT_GE(fetch, std::chrono::milliseconds(50));
+    EXPECT_LT(fetch, std::chrono::milliseconds(50) + std::chrono::milliseconds(20));
+    EXPECT_GE(commit, std::chrono::milliseconds(20));
+    EXPECT_LE(ntp1 + fetch + commit, total);
+    EXPECT_EQ(ValidationTimes::Get(ValidationPhase::ScriptChecks).count(), 0);
+
+    // timers on other threads don't pause the ones of this thread
+    ValidationTimes::Reset();
+    {
+        const ValidationPhaseTimer checkTimer(ValidationPhase::CheckBlock);
+        std::thread                other([]() {
+            const ValidationPhaseTimer scriptTimer(ValidationPhase::ScriptChecks);
+            SleepMs(20);
+        });
+        other.join();
+    }
+    EXPECT_GE(ValidationTimes::Get(ValidationPhase::CheckBlock), std::chrono::milliseconds(20));
+    EXPECT_GE(ValidationTimes::Get(ValidationPhase::ScriptChecks), std::chrono::milliseconds(20));
+    ValidationTimes::Reset();
+}
@@ -0,0 +1,67 @@
+#include "googletest/googletest/include/gtest/gtest.h"
+
+#include "hash.h"
+#include "script.h"
+#include "transaction.h"
+#include "walletrescan.h"
+
+static std::vector<unsigned char> FakePubKey(unsigned char seed, std::size_t size = 33)
+{
+    std::vector<unsigned char> pubKey(size, seed);
+    pubKey[0] = (size == 33 ? 0x02 : 0x04);
+    return pubKey;
+}
+
+// every kind of script IsMine() accepts passes the filter when its key or script is in the wallet
+TEST(walletrescan_tests, filter_matches_wallet_scripts)
+{
+    const std::vector<unsigned char> myPubKey      = FakePubKey(1);
+    const std::vector<unsigned char> myFullPubKey  = FakePubKey(2, 65);
+    const std::vector<unsigned char> otherPubKey   = FakePubKey(3);
+    const CKeyID                     myKeyID       = CKeyID(Hash160(myPubKey));
+    const CKeyID                     myFullKeyID   = CKeyID(Hash160(myFullPubKey));
+    const CKeyID                     otherKeyID    = CKeyID(Hash160(otherPubKey));
+    const CScript                    redeemScript  = CScript() << myPubKey << OP_CHECKSIG;
+    const CScriptID                  myScriptID    = redeemScript.GetID();
+    const CScriptID                  otherScriptID = (CScript() << otherPubKey << OP_CHECKSIG).GetID();
+
+    CWalletScanFilter filter;
+    filter.AddID(myKeyID);
+    filter.AddID(myFullKeyID);
+    filter.AddID(myScriptID);
+    EXPECT_EQ(filter.size(), 3u);
+
+    EXPECT_TRUE(filter.MayBeMine(GetScriptForDestination(myKeyID)));
+    EXPECT_TRUE(filter.MayBeMine(CScript() << myPubKey << OP_CHECKSIG));
+    EXPECT_TRUE(filter.MayBeMine(CScript() << myFullPubKey << OP_CHECKSIG));
+    EXPECT_TRUE(filter.MayBeMine(GetScriptForDestination(myScriptID)));
+    EXPECT_TRUE(filter.MayBeMine(GetScriptForStakeDelegation(myKeyID, otherKeyID)));
+    EXPECT_TRUE(filter.MayBeMine(GetScriptForStakeDelegation(otherKeyID, myKeyID)));
+    EXPECT_TRUE(filter.MayBeMine(CScript() << OP_1 << otherPubKey << myPubKey << OP_2
+                                           << OP_CHECKMULTISIG));
+
+    EXPECT_FALSE(filter.MayBeMine(GetScriptForDestination(otherKeyID)));
+    EXPECT_FALSE(filter.MayBeMine(CScript() << otherPubKey << OP_CHECKSIG));
+    EXPECT_FALSE(filter.MayBeMine(GetScriptForDestination(otherScriptID)));
+    EXPECT_FALSE(filter.MayBeMine(CScript() << OP_RETURN << std::vector<unsigned char>(20, 0)));
+    EXPECT_FALSE(filter.MayBeMine(CScript()));
+}
+
+TEST(walletrescan_tests, filter_matches_transactions_by_outputs)
+{
+    const CKeyID myKeyID(Hash160(FakePubKey(1)));
+    const CKeyID otherKeyID(Hash160(FakePubKey(2)));
+
+    CWalletScanFilter filter;
+    filter.AddID(myKeyID);
+
+    CTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << FakePubKey(1);
+    tx.vout.push_back(CTxOut(1, GetScriptForDestination(otherKeyID)));
+    // the inputs aren't looked at: spends are found through the outputs they spend
+    EXPECT_FALSE(filter.MayInvolve(tx));
+
+    tx.vout.push_back(CTxOut(2, GetScriptForDestination(myKeyID)));
+    EXPECT_TRUE(filter.MayInvolve(tx));
+}
@@ -9,6 +9,7 @@
 #include "txindex.h"
 #include "txmempool.h"
 #include "util.h"
+#include "validationtimes.h"
 #include <boost/foreach.hpp>
 
 void CTransaction::SetNull()
@@ -382,6 +383,8 @@ bool CTransaction::FetchInputs(const ITxDB& txdb, const std::map<uint256, CTxInd
     // (in which case the transaction should be stored as an orphan)
     // or because the transaction is malformed (in which case the transaction should
     // be dropped).  If tx is definitely invalid, fInvalid will be set to true.
+    const ValidationPhaseTimer timer(ValidationPhase::FetchInputs);
+
     fInvalid = false;
 
     if (IsCoinBase())
@@ -521,10 +524,10 @@ Result<void, TxValidationState> CTransaction::ConnectInputs(const ITxDB& txdb, M
                 for (ConstCBlockIndexSmartPtr pindex = boost::atomic_load(&pindexBlock);
                      pindex && pindexBlock->nHeight - pindex->nHeight < nCbM;
                      pindex = boost::atomic_load(&pindex->pprev)) {
-                    static_assert(std::is_same<decltype(pindex->blockKeyInDB),
+                    static_assert(std::is_same<decltype(pindex->GetBlockHash()),
                                                decltype(txindex.pos.nBlockPos)>::value,
                                   "Expected same types");
-                    if (pindex->blockKeyInDB == txindex.pos.nBlockPos) {
+                    if (pindex->GetBlockHash() == txindex.pos.nBlockPos) {
                         if (sourceBlockPtr) {
                             sourceBlockPtr->reject = CBlock::CBlockReject(
                                 REJECT_INVALID, "bad-txns-premature-spend-of-coinbase/coinstake",
@@ -588,6 +591,8 @@ Result<void, TxValidationState> CTransaction::ConnectInputs(const ITxDB& txdb, M
             // still computed and checked, and any change will be caught at the next checkpoint.
             if (!(fBlock &&
                   (txdb.GetBestChainHeight().value_or(0) < Checkpoints::GetTotalBlocksEstimate()))) {
+                const ValidationPhaseTimer timer(ValidationPhase::ScriptChecks);
+
                 // Verify signature
                 bool       fStrictPayToScriptHash = true;
                 const auto verifyRes =
@@ -712,14 +717,12 @@ bool CTransaction::GetCoinAge(const ITxDB& txdb, uint64_t& nCoinAge) const
         CAmount nValueIn = txPrev.vout[txin.prevout.n].nValue;
         bnCentSecond += CBigNum(nValueIn) * (nTime - txPrev.nTime) / CENT;
 
-        if (fDebug)
-            printf("coin age nValueIn=%" PRId64 " nTimeDiff=%d bnCentSecond=%s\n", nValueIn,
-                   nTime - txPrev.nTime, bnCentSecond.ToString().c_str());
+        LogPrint(LOG_STAKE, "coin age nValueIn=%" PRId64 " nTimeDiff=%d bnCentSecond=%s\n", nValueIn,
+                 nTime - txPrev.nTime, bnCentSecond.ToString().c_str());
     }
 
     CBigNum bnCoinDay = bnCentSecond * CENT / COIN / (24 * 60 * 60);
-    if (fDebug)
-        printf("coin age bnCoinDay=%s\n", bnCoinDay.ToString().c_str());
+    LogPrint(LOG_STAKE, "coin age bnCoinDay=%s\n", bnCoinDay.ToString().c_str());
     nCoinAge = bnCoinDay.getuint64();
     return true;
 }
@@ -14,11 +14,20 @@
 #include <future>
 #include <random>
 
+#ifdef LMDB_RESERVE_MAP
+#include <sys/mman.h>
+#endif
+
+#include "blockarena.h"
+#include "blockindexsnapshot.h"
 #include "globals.h"
 #include "kernel.h"
 #include "main.h"
+#include "metrics.h"
+#include "quicksyncdownloader.h"
 #include "txdb.h"
 #include "util.h"
+#include "validationtimes.h"
 
 #include "SerializationTester.h"
 
@@ -31,15 +40,73 @@ DbSmartPtrType glob_db_tx(nullptr, [](MDB_dbi*) {});
 DbSmartPtrType glob_db_ntp1Tx(nullptr, [](MDB_dbi*) {});
 DbSmartPtrType glob_db_ntp1tokenNames(nullptr, [](MDB_dbi*) {});
 DbSmartPtrType glob_db_addrsVsPubKeys(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_ntp1Balances(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_ntp1TokenStats(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_ntp1TokenHolders(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_addressIndex(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_addressUnspent(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_spentIndex(nullptr, [](MDB_dbi*) {});
+DbSmartPtrType glob_db_blockFilters(nullptr, [](MDB_dbi*) {});
 
 using namespace std;
 using namespace boost;
 
 boost::filesystem::path CTxDB::DB_DIR                         = "txlmdb";
 bool                    CTxDB::QuickSyncHigherControl_Enabled = true;
+thread_local LMDBSharedTxn CTxDB::sharedTxn;
 
 std::atomic<uint64_t> mdb_txn_safe::num_active_txns{0};
 std::atomic_flag      mdb_txn_safe::creation_gate = ATOMIC_FLAG_INIT;
+std::atomic<bool>     mdb_txn_safe::new_txns_prevented{false};
+
+static std::atomic<uint64_t> nMapResizes{0};
+static std::atomic<int64_t>  nMapResizeStallMillis{0};
+static std::atomic<int64_t>  nMapResizeMaxStallMillis{0};
+
+static void RecordMapResizeStall(int64_t nStallMillis)
+{
+    // every transaction is stopped meanwhile, so it's also exported with the other db timings
+    static CMetricHistogram& stallHistogram = Metrics().Histogram("neblio_db_map_resize_stall_seconds");
+    stallHistogram.Record(std::chrono::milliseconds(std::max<int64_t>(nStallMillis, 0)));
+
+    nMapResizes++;
+    nMapResizeStallMillis += nStallMillis;
+    int64_t nMax = nMapResizeMaxStallMillis.load();
+    while (nStallMillis > nMax && !nMapResizeMaxStallMillis.compare_exchange_weak(nMax, nStallMillis)) {
+    }
+}
+
+LMDBMapStats CTxDB::GetMapStats()
+{
+    LMDBMapStats stats;
+    if (dbEnv) {
+        MDB_envinfo mei;
+        mdb_env_info(dbEnv.get(), &mei);
+        MDB_stat mst;
+        mdb_env_stat(dbEnv.get(), &mst);
+        stats.mapSize  = mei.me_mapsize;
+        stats.usedSize = static_cast<uint64_t>(mst.ms_psize) * mei.me_last_pgno;
+    }
+    stats.resizes          = nMapResizes;
+    stats.totalStallMillis = nMapResizeStallMillis;
+    stats.maxStallMillis   = nMapResizeMaxStallMillis;
+    return stats;
+}
+
+#ifdef LMDB_RESERVE_MAP
+/** the biggest map, up to DB_RESERVED_MAPSIZE, that there's address space for (see ulimit -v) */
+static uint64_t ReservableMapSize()
+{
+    for (uint64_t size = DB_RESERVED_MAPSIZE; size > DB_DEFAULT_MAPSIZE; size /= 2) {
+        void* p = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p != MAP_FAILED) {
+            munmap(p, size);
+            return size;
+        }
+    }
+    return DB_DEFAULT_MAPSIZE;
+}
+#endif
 
 // threshold_size is used for batch transactions
 bool CTxDB::need_resize(uint64_t threshold_size)
@@ -96,6 +163,7 @@ bool CTxDB::need_resize(uint64_t threshold_size)
 void lmdb_resized(MDB_env* env)
 {
     printf("%s\n", __func__);
+    const int64_t nStallStart = GetTimeMillis();
     mdb_txn_safe::prevent_new_txns();
     BOOST_SCOPE_EXIT(void) { mdb_txn_safe::allow_new_txns(); }
     BOOST_SCOPE_EXIT_END
@@ -116,10 +184,14 @@ void lmdb_resized(MDB_env* env)
     mdb_env_info(env, &mei);
     uint64_t new_mapsize = mei.me_mapsize;
 
+    const int64_t nStallMillis = GetTimeMillis() - nStallStart;
+    RecordMapResizeStall(nStallMillis);
+
     std::stringstream ss;
     ss << "LMDB Mapsize increased."
        << "  Old: " << old / (1024 * 1024) << " MiB"
-       << ", New: " << new_mapsize / (1024 * 1024) << " MiB";
+       << ", New: " << new_mapsize / (1024 * 1024) << " MiB"
+       << "; transactions were stopped for " << nStallMillis << " ms";
     printf("%s\n", ss.str().c_str());
 }
 
@@ -132,24 +204,6 @@ void CTxDB::do_resize(uint64_t increase_size)
         increase_size = MIN_MAP_SIZE_INCREASE;
     }
 
-    const uintmax_t add_size = UINTMAX_C(1) << 30;
-
-    // check disk capacity
-    try {
-        boost::filesystem::path       path(GetDataDir() / DB_DIR);
-        boost::filesystem::space_info si = boost::filesystem::space(path);
-        if (si.available < add_size) {
-            stringstream ss;
-            ss << "!! WARNING: Insufficient free space to extend database !!: "
-               << (si.available >> UINTMAX_C(20)) << " MB available, " << (add_size >> UINTMAX_C(20))
-               << " MB needed";
-            throw std::runtime_error(ss.str());
-        }
-    } catch (...) {
-        // print something but proceed.
-        throw std::runtime_error("Unable to query free disk space.");
-    }
-
     MDB_envinfo mei;
 
     mdb_env_info(dbEnv.get(), &mei);
@@ -158,16 +212,38 @@ void CTxDB::do_resize(uint64_t increase_size)
 
     mdb_env_stat(dbEnv.get(), &mst);
 
-    // add 1Gb per resize, instead of doing a percentage increase
-    uint64_t new_mapsize = (double)mei.me_mapsize + add_size;
+    // the map grows geometrically, so that a growing database is resized fewer and fewer times; the
+    // increase_size given for a batch txn is the least it grows by
+    const uint64_t geometric_size = mei.me_mapsize / MAP_SIZE_GROWTH_DIVISOR;
+    const uint64_t add_size       = std::max({geometric_size, MIN_MAP_SIZE_INCREASE, increase_size});
+
+    uint64_t new_mapsize = mei.me_mapsize + add_size;
+    if (new_mapsize % mst.ms_psize != 0)
+        new_mapsize += mst.ms_psize - new_mapsize % mst.ms_psize;
 
-    // If given, use increase_size instead of above way of resizing.
-    // This is currently used for increasing by an estimated size at start of new
-    // batch txn.
-    if (increase_size > 0)
-        new_mapsize = mei.me_mapsize + increase_size;
+#ifdef LMDB_RESERVE_MAP
+    // the data file doesn't grow with the map, only with what's written to it
+    const uint64_t required_space = std::max(increase_size, MIN_MAP_SIZE_INCREASE);
+#else
+    const uint64_t required_space = add_size;
+#endif
+
+    // check disk capacity
+    boost::optional<uintmax_t> available_space;
+    try {
+        available_space = boost::filesystem::space(GetDataDir() / DB_DIR).available;
+    } catch (const boost::filesystem::filesystem_error& ex) {
+        // print something but proceed.
+        printf("Unable to query free disk space: %s\n", ex.what());
+    }
+    if (available_space && *available_space < required_space) {
+        stringstream ss;
+        ss << "!! WARNING: Insufficient free space to extend database !!: "
+           << (*available_space >> UINTMAX_C(20)) << " MB available, "
+           << (required_space >> UINTMAX_C(20)) << " MB needed";
+        throw std::runtime_error(ss.str());
+    }
 
-    new_mapsize += (new_mapsize % mst.ms_psize);
 #ifdef DEEP_LMDB_LOGGING
     printf("Requesting to increase map size by: %zu\n", increase_size);
     printf("Current map size                  : %zu\n", mei.me_mapsize);
@@ -175,11 +251,13 @@ void CTxDB::do_resize(uint64_t increase_size)
     printf("System page size                  : %u\n", mst.ms_psize);
 #endif
 
+    // every transaction is stopped from here until the map is resized
+    const int64_t nStallStart = GetTimeMillis();
     mdb_txn_safe::prevent_new_txns();
     BOOST_SCOPE_EXIT(void) { mdb_txn_safe::allow_new_txns(); }
     BOOST_SCOPE_EXIT_END
 
-    if (activeBatch) {
+    if (ActiveTxn()) {
         throw std::runtime_error(
             "attempting resize with write transaction in progress, this should not happen!");
     }
@@ -190,10 +268,14 @@ void CTxDB::do_resize(uint64_t increase_size)
     if (result)
         throw std::runtime_error("Failed to set new mapsize: " + std::to_string(result));
 
+    const int64_t nStallMillis = GetTimeMillis() - nStallStart;
+    RecordMapResizeStall(nStallMillis);
+
     std::stringstream ss;
     ss << "LMDB Mapsize increased."
        << "  Old: " << mei.me_mapsize / (1024 * 1024) << " MiB"
-       << ", New: " << new_mapsize / (1024 * 1024) << " MiB";
+       << ", New: " << new_mapsize / (1024 * 1024) << " MiB"
+       << "; transactions were stopped for " << nStallMillis << " ms";
     printf("%s\n", ss.str().c_str());
 }
 
@@ -206,70 +288,17 @@ bool IsQuickSyncOSCompatible(const std::string& osValue)
     }
 }
 
-void DownloadQuickSyncFile(const json_spirit::Value& fileVal, const filesystem::path& dbdir)
+// downloads a QuickSync file in one piece, for mirrors that don't support range requests
+static void DownloadWholeQuickSyncFile(const std::vector<std::string>& urls, const std::string& sumBin,
+                                       const filesystem::path& downloadTarget)
 {
-    // get json fields of this file
-    const json_spirit::Array urlsObj = NTP1Tools::GetArrayField(fileVal.get_obj(), "url");
-    const std::string        sum     = NTP1Tools::GetStrField(fileVal.get_obj(), "sha256sum");
-    const std::string        sumBin  = boost::algorithm::unhex(sum);
-
-    if (urlsObj.empty()) {
-        std::string jsonData = json_spirit::write(fileVal);
-        throw std::runtime_error("Empty list of urls retrieved: " + jsonData);
-    }
-
-    std::vector<std::string> urls;
-    for (auto urlObj : urlsObj) {
-        urls.push_back(urlObj.get_str());
-    }
-
-    // shuffle the urls to pick a random one of them first
-    auto rng = std::default_random_engine{};
-    std::shuffle(urls.begin(), urls.end(), rng);
-
-    // Diskspace check disabled as it doesn't deliver reliable results for large files
-    std::uintmax_t fileSize = static_cast<uint64_t>(NTP1Tools::GetInt64Field(fileVal.get_obj(), "size"));
-    // check available diskspace
-    std::uintmax_t availableSpace = GetFreeDiskSpace(dbdir);
-    std::uintmax_t requiredSpace  = static_cast<std::size_t>(static_cast<double>(fileSize) * 1.2);
-    if (requiredSpace > availableSpace) {
-        throw std::runtime_error("Diskspace insufficient to download the blockchain; Available: " +
-                                 std::to_string(availableSpace / ONE_MB) +
-                                 " MB; required: " + std::to_string(requiredSpace / ONE_MB) + "MB");
-    }
-
-    std::string      leaf               = filesystem::path(urls.at(0)).filename().string();
+    std::string      leaf               = downloadTarget.filename().string();
     std::string      tempLeaf           = leaf + ".temp";
-    filesystem::path downloadTarget     = dbdir / leaf;
-    filesystem::path downloadTempTarget = dbdir / tempLeaf;
-
-    // delete files that already exist before downloading them
-    {
-        boost::system::error_code remove_error;
-        if (filesystem::exists(downloadTarget) && !filesystem::remove(downloadTarget, remove_error)) {
-            throw std::runtime_error(
-                "File " + leaf + " already exists and could not be deleted: " + remove_error.message());
-        }
-        if (filesystem::exists(downloadTempTarget) &&
-            !filesystem::remove(downloadTempTarget, remove_error)) {
-            throw std::runtime_error("File " + tempLeaf + " already exists and could not be deleted: " +
-                                     remove_error.message());
-        }
-    }
+    filesystem::path downloadTempTarget = downloadTarget.parent_path() / tempLeaf;
 
     std::atomic<float> progress;
     progress.store(0);
 
-    // ensure that all leaf file names are the same in the retrieved json data, this shows if the
-    // json data has a problem
-    for (const std::string& url : urls) {
-        if (leaf != filesystem::path(url).filename().string()) {
-            throw std::runtime_error(
-                "The URLs in the following json snippet do not all have the same file names: " +
-                json_spirit::write(fileVal));
-        }
-    }
-
     // download the file asynchronously in a new thread
     std::promise<void> downloadThreadPromise;
     std::future<void>  downloadThreadFuture = downloadThreadPromise.get_future();
@@ -323,6 +352,92 @@ void DownloadQuickSyncFile(const json_spirit::Value& fileVal, const filesystem::
                                      " to " + leaf + ". Error: " + rename_ec.message());
         }
     }
+}
+
+void DownloadQuickSyncFile(const json_spirit::Value& fileVal, const filesystem::path& dbdir)
+{
+    // get json fields of this file
+    const json_spirit::Array urlsObj = NTP1Tools::GetArrayField(fileVal.get_obj(), "url");
+    const std::string        sum     = NTP1Tools::GetStrField(fileVal.get_obj(), "sha256sum");
+    const std::string        sumBin  = boost::algorithm::unhex(sum);
+
+    if (urlsObj.empty()) {
+        std::string jsonData = json_spirit::write(fileVal);
+        throw std::runtime_error("Empty list of urls retrieved: " + jsonData);
+    }
+
+    std::vector<std::string> urls;
+    for (auto urlObj : urlsObj) {
+        urls.push_back(urlObj.get_str());
+    }
+
+    // shuffle the urls to pick a random one of them first
+    auto rng = std::default_random_engine{};
+    std::shuffle(urls.begin(), urls.end(), rng);
+
+    // the manifest may split the file in chunks, with the sha256 of each of them
+    uint64_t                 chunkSize = QUICKSYNC_DEFAULT_CHUNK_SIZE;
+    std::vector<std::string> chunkSums;
+    if (json_spirit::find_value(fileVal.get_obj(), "chunk_size").type() != json_spirit::null_type) {
+        chunkSize = NTP1Tools::GetUint64Field(fileVal.get_obj(), "chunk_size");
+        for (const json_spirit::Value& chunkSum :
+             NTP1Tools::GetArrayField(fileVal.get_obj(), "chunk_sha256sums")) {
+            chunkSums.push_back(boost::algorithm::unhex(chunkSum.get_str()));
+        }
+    }
+
+    std::string      leaf               = filesystem::path(urls.at(0)).filename().string();
+    std::string      tempLeaf           = leaf + ".temp";
+    filesystem::path downloadTarget     = dbdir / leaf;
+    filesystem::path downloadTempTarget = dbdir / tempLeaf;
+
+    // Diskspace check disabled as it doesn't deliver reliable results for large files
+    std::uintmax_t fileSize = static_cast<uint64_t>(NTP1Tools::GetInt64Field(fileVal.get_obj(), "size"));
+    // check available diskspace; a partial download of an earlier attempt already takes its share
+    std::uintmax_t availableSpace = GetFreeDiskSpace(dbdir);
+    std::uintmax_t requiredSpace  = static_cast<std::size_t>(static_cast<double>(fileSize) * 1.2);
+    {
+        boost::system::error_code size_ec;
+        const std::uintmax_t      tempSize = filesystem::file_size(downloadTempTarget, size_ec);
+        if (!size_ec) {
+            requiredSpace -= std::min(tempSize, requiredSpace);
+        }
+    }
+    if (requiredSpace > availableSpace) {
+        throw std::runtime_error("Diskspace insufficient to download the blockchain; Available: " +
+                                 std::to_string(availableSpace / ONE_MB) +
+                                 " MB; required: " + std::to_string(requiredSpace / ONE_MB) + "MB");
+    }
+
+    // ensure that all leaf file names are the same in the retrieved json data, this shows if the
+    // json data has a problem
+    for (const std::string& url : urls) {
+        if (leaf != filesystem::path(url).filename().string()) {
+            throw std::runtime_error(
+                "The URLs in the following json snippet do not all have the same file names: " +
+                json_spirit::write(fileVal));
+        }
+    }
+
+    // the partial download of an earlier attempt, if any, is resumed
+    QuickSyncDownloader downloader(urls, fileSize, sumBin, downloadTarget, chunkSize, chunkSums);
+    downloader.SetConnections(static_cast<unsigned>(
+        std::max<int64_t>(0, GetArg("-quicksyncconnections", QUICKSYNC_DEFAULT_CONNECTIONS))));
+    try {
+        downloader.Run([&leaf](uint64_t bytesDone, uint64_t bytesTotal) {
+            std::stringstream ss;
+            ss.setf(std::ios::fixed);
+            ss << "Downloading QuickSync file " << leaf << ": " << std::setprecision(2)
+               << static_cast<double>(bytesDone) / ONE_MB << " / "
+               << static_cast<double>(bytesTotal) / ONE_MB << " MB...";
+            uiInterface.InitMessage(ss.str());
+        });
+    } catch (const RangeNotSupportedError& ex) {
+        printf("QuickSync: %s; downloading %s in one piece\n", ex.what(), leaf.c_str());
+        downloader.Discard();
+        DownloadWholeQuickSyncFile(urls, sumBin, downloadTarget);
+    }
+    printf("Done downloading %s\n", leaf.c_str());
 
     uiInterface.InitMessage("Download and verification of " + leaf + " is done.");
 }
@@ -342,7 +457,14 @@ void DoQuickSync(const filesystem::path& dbdir)
             printf("%s\n", msg.c_str());
         }
         try {
-            filesystem::remove_all(dbdir);
+            // the partial downloads of earlier attempts are kept, to be resumed
+            if (filesystem::exists(dbdir)) {
+                for (filesystem::directory_iterator it(dbdir), end; it != end; ++it) {
+                    if (!QuickSyncDownloader::IsPartialDownload(it->path())) {
+                        filesystem::remove_all(it->path());
+                    }
+                }
+            }
             filesystem::create_directories(dbdir);
 
             std::string        jsonStrData = cURLTools::GetFileFromHTTPS(QuickSyncDataLink, 30, false);
@@ -388,6 +510,8 @@ void DoQuickSync(const filesystem::path& dbdir)
         throw std::runtime_error("QuickSync error: None of the files matched the correct settings or "
                                  "another error occurred.");
     }
+    // files of a set that wasn't picked this time would otherwise stay around forever
+    QuickSyncDownloader::RemovePartialDownloads(dbdir);
     printf("QuickSync done\n");
 }
 
@@ -487,6 +611,9 @@ void CTxDB::init_blockindex(bool fRemoveOld)
                    ex.what());
             filesystem::remove_all(directory);
         }
+    } else {
+        // a quicksync that was interrupted won't be resumed, e.g. because it's disabled now
+        QuickSyncDownloader::RemovePartialDownloads(directory);
     }
 
     OpenDatabase();
@@ -586,6 +713,9 @@ void CTxDB::OpenDatabase()
     std::size_t currMapSize = mei.me_mapsize;
 
     std::size_t mapSize = DB_DEFAULT_MAPSIZE;
+#ifdef LMDB_RESERVE_MAP
+    mapSize = std::max<std::size_t>(mapSize, ReservableMapSize());
+#endif
 
     if (currMapSize < mapSize) {
         if (auto mapSizeErr = mdb_env_set_mapsize(dbEnv.get(), mapSize))
@@ -610,13 +740,20 @@ void CTxDB::OpenDatabase()
             "; message: " + std::string(mdb_strerror(mdb_res)));
     }
 
-    glob_db_main           = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_blockIndex     = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_blocks         = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_tx             = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_ntp1Tx         = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_ntp1tokenNames = DbSmartPtrType(new MDB_dbi, dbDeleter);
-    glob_db_addrsVsPubKeys = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_main             = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_blockIndex       = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_blocks           = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_tx               = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_ntp1Tx           = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_ntp1tokenNames   = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_addrsVsPubKeys   = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_ntp1Balances     = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_ntp1TokenStats   = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_ntp1TokenHolders = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_addressIndex     = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_addressUnspent   = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_spentIndex       = DbSmartPtrType(new MDB_dbi, dbDeleter);
+    glob_db_blockFilters     = DbSmartPtrType(new MDB_dbi, dbDeleter);
 
     // MDB_CREATE: Create the named database if it doesn't exist.
     CTxDB::lmdb_db_open(txn, LMDB_MAINDB.c_str(), MDB_CREATE, *glob_db_main,
@@ -633,6 +770,21 @@ void CTxDB::OpenDatabase()
                         *glob_db_ntp1tokenNames, "Failed to open db handle for glob_db_ntp1Tx");
     CTxDB::lmdb_db_open(txn, LMDB_ADDRSVSPUBKEYSDB.c_str(), MDB_CREATE, *glob_db_addrsVsPubKeys,
                         "Failed to open db handle for glob_db_ntp1Tx");
+    CTxDB::lmdb_db_open(txn, LMDB_NTP1BALANCESDB.c_str(), MDB_CREATE, *glob_db_ntp1Balances,
+                        "Failed to open db handle for glob_db_ntp1Balances");
+    CTxDB::lmdb_db_open(txn, LMDB_NTP1TOKENSTATSDB.c_str(), MDB_CREATE, *glob_db_ntp1TokenStats,
+                        "Failed to open db handle for glob_db_ntp1TokenStats");
+    CTxDB::lmdb_db_open(txn, LMDB_NTP1TOKENHOLDERSDB.c_str(), MDB_CREATE | MDB_DUPSORT,
+                        *glob_db_ntp1TokenHolders,
+                        "Failed to open db handle for glob_db_ntp1TokenHolders");
+    CTxDB::lmdb_db_open(txn, LMDB_ADDRESSINDEXDB.c_str(), MDB_CREATE | MDB_DUPSORT,
+                        *glob_db_addressIndex, "Failed to open db handle for glob_db_addressIndex");
+    CTxDB::lmdb_db_open(txn, LMDB_ADDRESSUNSPENTDB.c_str(), MDB_CREATE | MDB_DUPSORT,
+                        *glob_db_addressUnspent, "Failed to open db handle for glob_db_addressUnspent");
+    CTxDB::lmdb_db_open(txn, LMDB_SPENTINDEXDB.c_str(), MDB_CREATE, *glob_db_spentIndex,
+                        "Failed to open db handle for glob_db_spentIndex");
+    CTxDB::lmdb_db_open(txn, LMDB_BLOCKFILTERSDB.c_str(), MDB_CREATE, *glob_db_blockFilters,
+                        "Failed to open db handle for glob_db_blockFilters");
 
     // commit the transaction
     txn.commit();
@@ -658,6 +810,27 @@ void CTxDB::OpenDatabase()
     if (!glob_db_addrsVsPubKeys) {
         throw std::runtime_error("LMDB nullptr after opening the db_addrsVsPubKeys database.");
     }
+    if (!glob_db_ntp1Balances) {
+        throw std::runtime_error("LMDB nullptr after opening the db_ntp1Balances database.");
+    }
+    if (!glob_db_ntp1TokenStats) {
+        throw std::runtime_error("LMDB nullptr after opening the db_ntp1TokenStats database.");
+    }
+    if (!glob_db_ntp1TokenHolders) {
+        throw std::runtime_error("LMDB nullptr after opening the db_ntp1TokenHolders database.");
+    }
+    if (!glob_db_addressIndex) {
+        throw std::runtime_error("LMDB nullptr after opening the db_addressIndex database.");
+    }
+    if (!glob_db_addressUnspent) {
+        throw std::runtime_error("LMDB nullptr after opening the db_addressUnspent database.");
+    }
+    if (!glob_db_spentIndex) {
+        throw std::runtime_error("LMDB nullptr after opening the db_spentIndex database.");
+    }
+    if (!glob_db_blockFilters) {
+        throw std::runtime_error("LMDB nullptr after opening the db_blockFilters database.");
+    }
 
     printf("Done opening the database\n");
     uiInterface.InitMessage("Done opening the database");
@@ -674,6 +847,23 @@ void CTxDB::__deleteDb()
 bool CTxDB::TxnBegin(size_t required_size)
 {
     assert(activeBatch == nullptr);
+    if (sharedTxn.current) {
+        // nested in the shared transaction. It isn't counted as active, since the shared one is, so
+        // that a resize waiting for that one doesn't keep this thread from committing it. The map
+        // is only resized between shared transactions.
+        sharedTxnParent = sharedTxn.current;
+        activeBatch     = std::unique_ptr<mdb_txn_safe>(new mdb_txn_safe(false));
+        if (auto res = lmdb_txn_begin(dbEnv.get(), sharedTxnParent, 0, *activeBatch)) {
+            printf("Failed to begin nested transaction with error code %i; with error: %s\n", res,
+                   mdb_strerror(res));
+            // the block's writes would otherwise go straight into the shared transaction
+            activeBatch.reset();
+            sharedTxnParent = nullptr;
+            return false;
+        }
+        sharedTxn.current = *activeBatch;
+        return true;
+    }
     if (CTxDB::need_resize(required_size)) {
         printf("LMDB memory map needs to be resized, doing that now.\n");
         CTxDB::do_resize(required_size);
@@ -683,14 +873,25 @@ bool CTxDB::TxnBegin(size_t required_size)
         printf("Failed to begin transaction at read with error code %i; with error: %s\n", res,
                mdb_strerror(res));
         activeBatch.reset();
+        return false;
     }
     return true;
 }
 
 bool CTxDB::TxnCommit()
 {
+    static CMetricHistogram& commitHistogram = Metrics().Histogram("neblio_db_commit_seconds");
+
+    const ValidationPhaseTimer timer(ValidationPhase::DbCommit);
+    const CMetricTimer         commitTimer(commitHistogram);
+
     assert(activeBatch);
     if (activeBatch) {
+        if (sharedTxnParent) {
+            // only the shared transaction is written to disk when it's committed
+            sharedTxn.current = sharedTxnParent;
+            sharedTxnParent   = nullptr;
+        }
         activeBatch->commit();
         activeBatch.reset();
     }
@@ -701,12 +902,81 @@ bool CTxDB::TxnAbort()
 {
     assert(activeBatch);
     if (activeBatch) {
+        if (sharedTxnParent) {
+            sharedTxn.current = sharedTxnParent;
+            sharedTxnParent   = nullptr;
+        }
         activeBatch->abort();
         activeBatch.reset();
     }
     return true;
 }
 
+bool CTxDB::SharedTxnBegin(size_t required_size)
+{
+    assert(!sharedTxn.root);
+    if (CTxDB::need_resize(required_size)) {
+        printf("LMDB memory map needs to be resized, doing that now.\n");
+        CTxDB().do_resize(required_size);
+    }
+    sharedTxn.root = std::unique_ptr<mdb_txn_safe>(new mdb_txn_safe);
+    if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, *sharedTxn.root)) {
+        printf("Failed to begin shared transaction with error code %i; with error: %s\n", res,
+               mdb_strerror(res));
+        sharedTxn.root.reset();
+        return false;
+    }
+    sharedTxn.current    = *sharedTxn.root;
+    sharedTxn.dirtyBytes = 0;
+    return true;
+}
+
+bool CTxDB::SharedTxnCommit()
+{
+    static CMetricHistogram& commitHistogram = Metrics().Histogram("neblio_db_commit_seconds");
+
+    const ValidationPhaseTimer timer(ValidationPhase::DbCommit);
+    const CMetricTimer         commitTimer(commitHistogram);
+
+    assert(sharedTxn.root);
+    // a transaction nested in it would still be open
+    assert(sharedTxn.current == sharedTxn.root->rawPtr());
+
+    std::unique_ptr<mdb_txn_safe> root = std::move(sharedTxn.root);
+    sharedTxn.current                  = nullptr;
+    sharedTxn.dirtyBytes               = 0;
+    root->commit("Failed to commit the shared transaction");
+    return true;
+}
+
+bool CTxDB::IsSharedTxnOpen() { return sharedTxn.root != nullptr && !sharedTxn.readOnly; }
+
+bool CTxDB::ReadSnapshotBegin()
+{
+    assert(!sharedTxn.root);
+    sharedTxn.root = std::unique_ptr<mdb_txn_safe>(new mdb_txn_safe);
+    if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, *sharedTxn.root)) {
+        printf("Failed to begin read snapshot with error code %i; with error: %s\n", res,
+               mdb_strerror(res));
+        sharedTxn.root.reset();
+        return false;
+    }
+    sharedTxn.current  = *sharedTxn.root;
+    sharedTxn.readOnly = true;
+    return true;
+}
+
+void CTxDB::ReadSnapshotEnd()
+{
+    assert(sharedTxn.root && sharedTxn.readOnly);
+    sharedTxn.root->abort();
+    sharedTxn.root.reset();
+    sharedTxn.current  = nullptr;
+    sharedTxn.readOnly = false;
+}
+
+uint64_t CTxDB::GetSharedTxnDirtyBytes() { return sharedTxn.dirtyBytes; }
+
 bool CTxDB::test1_WriteStrKeyVal(const string& key, const string& val)
 {
     return Write(key, val, db_main);
@@ -819,6 +1089,222 @@ bool CTxDB::WriteNTP1Tx(const uint256& hash, const NTP1Transaction& ntp1tx)
     return Write(hash, ntp1tx, db_ntp1Tx);
 }
 
+bool CTxDB::ReadNTP1AddressBalances(const std::string&               address,
+                                    std::map<std::string, NTP1Int>& balances) const
+{
+    balances.clear();
+    // an address without tokens isn't an error, so we avoid Read() printing one
+    if (!Exists(address, db_ntp1Balances)) {
+        return true;
+    }
+    return Read(address, balances, db_ntp1Balances);
+}
+
+bool CTxDB::WriteNTP1AddressBalances(const std::string&                    address,
+                                     const std::map<std::string, NTP1Int>& balances)
+{
+    return Write(address, balances, db_ntp1Balances);
+}
+
+bool CTxDB::EraseNTP1AddressBalances(const std::string& address)
+{
+    return Erase(address, db_ntp1Balances);
+}
+
+bool CTxDB::ReadNTP1TokenIndexStats(const std::string& tokenId, NTP1TokenIndexStats& stats) const
+{
+    stats = NTP1TokenIndexStats();
+    if (!Exists(tokenId, db_ntp1TokenStats)) {
+        return true;
+    }
+    return Read(tokenId, stats, db_ntp1TokenStats);
+}
+
+bool CTxDB::WriteNTP1TokenIndexStats(const std::string& tokenId, const NTP1TokenIndexStats& stats)
+{
+    return Write(tokenId, stats, db_ntp1TokenStats);
+}
+
+bool CTxDB::EraseNTP1TokenIndexStats(const std::string& tokenId)
+{
+    return Erase(tokenId, db_ntp1TokenStats);
+}
+
+bool CTxDB::ReadNTP1TokenHolders(const std::string& tokenId, std::vector<std::string>& addresses) const
+{
+    return ReadMultiple(tokenId, addresses, db_ntp1TokenHolders);
+}
+
+bool CTxDB::AddNTP1TokenHolder(const std::string& tokenId, const std::string& address)
+{
+    return Write(tokenId, address, db_ntp1TokenHolders);
+}
+
+bool CTxDB::EraseNTP1TokenHolder(const std::string& tokenId, const std::string& address)
+{
+    return EraseKeyValue(tokenId, address, db_ntp1TokenHolders);
+}
+
+bool CTxDB::IsNTP1TokenIndexComplete() const { return Exists(string("ntp1tokenindex"), db_main); }
+
+bool CTxDB::WriteNTP1TokenIndexComplete(bool fComplete)
+{
+    if (fComplete) {
+        return Write(string("ntp1tokenindex"), 1, db_main);
+    }
+    return !IsNTP1TokenIndexComplete() || Erase(string("ntp1tokenindex"), db_main);
+}
+
+bool CTxDB::ClearNTP1TokenIndex()
+{
+    return WriteNTP1TokenIndexComplete(false) && ClearDb(db_ntp1Balances) &&
+           ClearDb(db_ntp1TokenStats) && ClearDb(db_ntp1TokenHolders);
+}
+
+bool CTxDB::ReadAddressIndex(const std::string&               address,
+                             std::vector<CAddressIndexEntry>& entries) const
+{
+    return ReadMultiple(address, entries, db_addressIndex);
+}
+
+bool CTxDB::ReadAddressIndex(const std::string& address, int nStart, int nEnd,
+                             std::vector<CAddressIndexEntry>& entries) const
+{
+    // the values start with the big-endian height, so this is where the entries of nStart begin
+    uint32_t nStartBigEndian = static_cast<uint32_t>(std::max(nStart, 0));
+    MakeBigEndian(nStartBigEndian);
+    const std::string valueFrom(reinterpret_cast<const char*>(&nStartBigEndian),
+                                sizeof(nStartBigEndian));
+    return ReadMultipleFrom(
+        address, valueFrom, entries,
+        [nEnd](const CAddressIndexEntry& entry) { return entry.nHeight > nEnd; }, db_addressIndex);
+}
+
+bool CTxDB::AddAddressIndexEntry(const std::string& address, const CAddressIndexEntry& entry)
+{
+    return Write(address, entry, db_addressIndex);
+}
+
+bool CTxDB::EraseAddressIndexEntry(const std::string& address, const CAddressIndexEntry& entry)
+{
+    return EraseKeyValue(address, entry, db_addressIndex);
+}
+
+bool CTxDB::ReadAddressUnspentOutputs(const std::string&                 address,
+                                      std::vector<CAddressUnspentEntry>& outputs) const
+{
+    return ReadMultiple(address, outputs, db_addressUnspent);
+}
+
+bool CTxDB::AddAddressUnspentOutput(const std::string& address, const CAddressUnspentEntry& output)
+{
+    return Write(address, output, db_addressUnspent);
+}
+
+bool CTxDB::EraseAddressUnspentOutput(const std::string& address, const CAddressUnspentEntry& output)
+{
+    return EraseKeyValue(address, output, db_addressUnspent);
+}
+
+bool CTxDB::ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value) const
+{
+    // unspent outputs are the common case, so we avoid Read() printing an error for them
+    return Exists(outpoint, db_spentIndex) && Read(outpoint, value, db_spentIndex);
+}
+
+bool CTxDB::WriteSpentIndex(const COutPoint& outpoint, const CSpentIndexValue& value)
+{
+    return Write(outpoint, value, db_spentIndex);
+}
+
+bool CTxDB::EraseSpentIndex(const COutPoint& outpoint) { return Erase(outpoint, db_spentIndex); }
+
+bool CTxDB::IsAddressIndexComplete() const
+{
+    // the flag is the version of the entries, so an index of an older version is rebuilt
+    int nVersion = 0;
+    return Exists(string("addressindex"), db_main) && Read(string("addressindex"), nVersion, db_main) &&
+           nVersion == CAddressIndexEntry::CURRENT_VERSION;
+}
+
+bool CTxDB::WriteAddressIndexComplete(bool fComplete)
+{
+    if (fComplete) {
+        return Write(string("addressindex"), CAddressIndexEntry::CURRENT_VERSION, db_main);
+    }
+    return !Exists(string("addressindex"), db_main) || Erase(string("addressindex"), db_main);
+}
+
+bool CTxDB::ClearAddressIndex()
+{
+    return WriteAddressIndexComplete(false) && ClearDb(db_addressIndex) && ClearDb(db_addressUnspent);
+}
+
+bool CTxDB::IsSpentIndexComplete() const { return Exists(string("spentindex"), db_main); }
+
+bool CTxDB::WriteSpentIndexComplete(bool fComplete)
+{
+    if (fComplete) {
+        return Write(string("spentindex"), 1, db_main);
+    }
+    return !IsSpentIndexComplete() || Erase(string("spentindex"), db_main);
+}
+
+bool CTxDB::ClearSpentIndex() { return WriteSpentIndexComplete(false) && ClearDb(db_spentIndex); }
+
+bool CTxDB::ReadBlockFilter(const uint256& blockHash, CBlockFilterIndexEntry& entry) const
+{
+    return ContainsBlockFilter(blockHash) && Read(blockHash, entry, db_blockFilters);
+}
+
+bool CTxDB::WriteBlockFilter(const uint256& blockHash, const CBlockFilterIndexEntry& entry)
+{
+    return Write(blockHash, entry, db_blockFilters);
+}
+
+bool CTxDB::ContainsBlockFilter(const uint256& blockHash) const
+{
+    return Exists(blockHash, db_blockFilters);
+}
+
+bool CTxDB::IsBlockFilterIndexComplete() const { return Exists(string("blockfilterindex"), db_main); }
+
+bool CTxDB::WriteBlockFilterIndexComplete(bool fComplete)
+{
+    if (fComplete) {
+        return Write(string("blockfilterindex"), 1, db_main);
+    }
+    return !IsBlockFilterIndexComplete() || Erase(string("blockfilterindex"), db_main);
+}
+
+bool CTxDB::ClearBlockFilterIndex()
+{
+    return WriteBlockFilterIndexComplete(false) && ClearDb(db_blockFilters);
+}
+
+bool CTxDB::ClearDb(MDB_dbi* dbPtr)
+{
+    mdb_txn_safe localTxn(false);
+    if (!ActiveTxn()) {
+        localTxn = mdb_txn_safe();
+        if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, localTxn)) {
+            return error("Failed to begin transaction to clear a db with error code %i; and error: %s",
+                         res, mdb_strerror(res));
+        }
+    }
+
+    // 0 empties the db but keeps its handle open
+    if (auto ret = mdb_drop(ActiveTxnOr(localTxn), *dbPtr, 0)) {
+        if (localTxn.rawPtr()) {
+            localTxn.abort();
+        }
+        return error("Failed to clear lmdb db; Code %i; Error message: %s", ret, mdb_strerror(ret));
+    }
+
+    localTxn.commitIfValid("Tx while clearing a db");
+    return true;
+}
+
 bool CTxDB::ReadAllIssuanceTxs(std::vector<uint256>& txs) const
 {
     // the key is empty because we want to get all keys in the database
@@ -842,6 +1328,11 @@ bool CTxDB::ReadBlock(const uint256& hash, CBlock& blk, bool fReadTransactions)
     return Read(hash, blk, db_blocks, modifiers);
 }
 
+bool CTxDB::ReadBlockReusingStorage(const uint256& hash, CBlock& blk) const
+{
+    return Read(hash, blk, db_blocks, SER_REUSE_STORAGE);
+}
+
 bool CTxDB::WriteBlock(const uint256& hash, const CBlock& blk)
 {
     assert(blk.GetHash() != 0);
@@ -879,6 +1370,14 @@ bool CTxDB::ReadDiskTx(const COutPoint& outpoint, CTransaction& tx) const
     return ReadDiskTx(outpoint.hash, tx, txindex);
 }
 
+bool CTxDB::ReadBlockIndex(const uint256& hash, CDiskBlockIndex& blockindex) const
+{
+    if (!Read(hash, blockindex, db_blockIndex))
+        return false;
+    blockindex.SetBlockHash(hash);
+    return true;
+}
+
 bool CTxDB::WriteBlockIndex(const CDiskBlockIndex& blockindex)
 {
     return Write(blockindex.GetBlockHash(), blockindex, db_blockIndex);
@@ -894,6 +1393,18 @@ bool CTxDB::WriteHashBestChain(const uint256& hashBestChain)
     return Write(string("hashBestChain"), hashBestChain, db_main);
 }
 
+bool CTxDB::ReadLastVerifiedBlock(uint256& hash) const
+{
+    return Read(string("hashLastVerifiedBlock"), hash, db_main);
+}
+
+bool CTxDB::WriteLastVerifiedBlock(const uint256& hash)
+{
+    return Write(string("hashLastVerifiedBlock"), hash, db_main);
+}
+
+bool CTxDB::EraseLastVerifiedBlock() { return Erase(string("hashLastVerifiedBlock"), db_main); }
+
 bool CTxDB::ReadBestInvalidTrust(CBigNum& bnBestInvalidTrust) const
 {
     return Read(string("bnBestInvalidTrust"), bnBestInvalidTrust, db_main);
@@ -930,6 +1441,64 @@ std::string LmdbValToString(const MDB_val& val)
     return std::string((const char*)val.mv_data, val.mv_size);
 }
 
+/** A block index record as read from the db, decoded off the cursor thread */
+struct DecodedBlockIndex
+{
+    uint256         blockHash;
+    CDiskBlockIndex diskindex;
+    uint256         blockTrust;
+};
+
+/** Deserializes raw block index records using all available cores. Returns false if any record
+ * couldn't be decoded. */
+static bool DecodeBlockIndexRecords(const std::vector<std::pair<std::string, std::string>>& raw,
+                                    std::vector<DecodedBlockIndex>&                          decoded)
+{
+    decoded.resize(raw.size());
+
+    const std::size_t threadCount =
+        std::max<std::size_t>(1, std::min<std::size_t>(boost::thread::hardware_concurrency(),
+                                                        raw.size() / 1000 + 1));
+    const std::size_t chunkSize = (raw.size() + threadCount - 1) / threadCount;
+
+    boost::atomic<bool> failed{false};
+
+    auto decodeRange = [&](std::size_t begin, std::size_t end) {
+        try {
+            for (std::size_t i = begin; i < end && !failed; i++) {
+                CDataStream ssKey(raw[i].first.data(), raw[i].first.data() + raw[i].first.size(),
+                                  SER_DISK, CLIENT_VERSION);
+                CDataStream ssValue(raw[i].second.data(), raw[i].second.data() + raw[i].second.size(),
+                                    SER_DISK, CLIENT_VERSION);
+                DecodedBlockIndex& entry = decoded[i];
+                ssKey >> entry.blockHash;
+                ssValue >> entry.diskindex;
+                // (Changed by Sam) previously, using diskindex.GetBlockHash retrieved the block hash AND
+                // set it inside the diskindex object with a const_cast. Now this is fixed to be correct
+                entry.diskindex.SetBlockHash(entry.blockHash);
+                // the trust of a single block depends only on its header, so it's computed here
+                // instead of in the serial chain trust pass
+                entry.blockTrust = entry.diskindex.GetBlockTrust();
+            }
+        } catch (std::exception& ex) {
+            printf("LoadBlockIndex() : failed to decode a block index record: %s\n", ex.what());
+            failed = true;
+        }
+    };
+
+    boost::thread_group threads;
+    for (std::size_t t = 1; t < threadCount; t++) {
+        const std::size_t begin = t * chunkSize;
+        const std::size_t end   = std::min(raw.size(), begin + chunkSize);
+        if (begin < end)
+            threads.create_thread(std::bind(decodeRange, begin, end));
+    }
+    decodeRange(0, std::min(raw.size(), chunkSize));
+    threads.join_all();
+
+    return !failed;
+}
+
 bool CTxDB::LoadBlockIndex()
 {
     if (mapBlockIndex.size() > 0) {
@@ -938,9 +1507,22 @@ bool CTxDB::LoadBlockIndex()
         return true;
     }
 
+    if (GetBoolArg("-blockindexsnapshot", true) && LoadBlockIndexSnapshot())
+        return true;
+
     // The block index is an in-memory structure that maps hashes to on-disk
     // locations where the contents of the block can be found. Here, we scan it
     // out of the DB and into mapBlockIndex.
+    //
+    // Loading happens in three phases: records are read from the cursor in batches and decoded in
+    // parallel, then linked into the index by a single thread, then chain trust and stake modifier
+    // checksums are computed in one pass in height order. Verifying the most recent blocks is left to
+    // VerifyRecentBlocks(), which runs in the background after the node is started.
+
+    const int64_t nLoadStart   = GetTimeMillis();
+    int64_t       nReadMillis   = 0;
+    int64_t       nDecodeMillis = 0;
+    int64_t       nLinkMillis   = 0;
 
     MDB_cursor*  cursorRawPtr = nullptr;
     mdb_txn_safe localTxn;
@@ -975,76 +1557,85 @@ bool CTxDB::LoadBlockIndex()
 
     BlockIndexMapType::MapType loadedBlockIndex;
 
-    // Now read each entry.
-    do {
-        // if the first item is empty, break immediately
-        if (itemRes) {
-            break;
-        }
+    static const std::size_t LOAD_BATCH_SIZE = 50000;
 
-        std::string keyStr = LmdbValToString(key);
-        std::string valStr = LmdbValToString(data);
+    std::vector<std::pair<std::string, std::string>> rawBatch;
+    std::vector<DecodedBlockIndex>                   decodedBatch;
+    rawBatch.reserve(LOAD_BATCH_SIZE);
 
-        // Unpack keys and values.
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.write(keyStr.data(), keyStr.size());
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.write(valStr.data(), valStr.size());
+    // Now read each entry.
+    while (itemRes == 0 && !fRequestShutdown) {
+        int64_t nPhaseStart = GetTimeMillis();
 
-        if (fRequestShutdown)
-            break;
+        rawBatch.clear();
+        while (itemRes == 0 && rawBatch.size() < LOAD_BATCH_SIZE) {
+            rawBatch.push_back(std::make_pair(LmdbValToString(key), LmdbValToString(data)));
+            itemRes = mdb_cursor_get(cursorRawPtr, &key, &data, MDB_NEXT);
+        }
+        if (itemRes != 0 && itemRes != MDB_NOTFOUND) {
+            return error("LoadBlockIndex() : Error while reading the block index. Error code %i, and "
+                         "error: %s\n",
+                         itemRes, mdb_strerror(itemRes));
+        }
+        nReadMillis += GetTimeMillis() - nPhaseStart;
 
-        uint256 blockHash;
-        ssKey >> blockHash;
-
-        CDiskBlockIndex diskindex;
-        ssValue >> diskindex;
-
-        // (Changed by Sam) previously, using diskindex.GetBlockHash retrieved the block hash AND set it
-        // inside the diskindex object with a const_cast. Now this is fixed to be correct
-        diskindex.SetBlockHash(blockHash);
-
-        // Construct block index object
-        CBlockIndexSmartPtr pindexNew = InsertBlockIndex(blockHash, loadedBlockIndex);
-        pindexNew->pprev              = InsertBlockIndex(diskindex.hashPrev, loadedBlockIndex);
-        pindexNew->pnext              = InsertBlockIndex(diskindex.hashNext, loadedBlockIndex);
-        pindexNew->blockKeyInDB       = diskindex.blockKeyInDB;
-        pindexNew->nHeight            = diskindex.nHeight;
-        pindexNew->nMint              = diskindex.nMint;
-        pindexNew->nMoneySupply       = diskindex.nMoneySupply;
-        pindexNew->nFlags             = diskindex.nFlags;
-        pindexNew->nStakeModifier     = diskindex.nStakeModifier;
-        pindexNew->prevoutStake       = diskindex.prevoutStake;
-        pindexNew->nStakeTime         = diskindex.nStakeTime;
-        pindexNew->hashProof          = diskindex.hashProof;
-        pindexNew->nVersion           = diskindex.nVersion;
-        pindexNew->hashMerkleRoot     = diskindex.hashMerkleRoot;
-        pindexNew->nTime              = diskindex.nTime;
-        pindexNew->nBits              = diskindex.nBits;
-        pindexNew->nNonce             = diskindex.nNonce;
-
-        // Watch for genesis block
-        if (pindexGenesisBlock == nullptr && blockHash == Params().GenesisBlockHash())
-            pindexGenesisBlock = pindexNew;
-
-        if (!pindexNew->CheckIndex()) {
+        nPhaseStart = GetTimeMillis();
+        if (!DecodeBlockIndexRecords(rawBatch, decodedBatch)) {
             cursorPtr.reset();
-            return error("LoadBlockIndex() : CheckIndex failed at %d", pindexNew->nHeight);
+            return error("LoadBlockIndex() : failed to decode the block index");
         }
+        nDecodeMillis += GetTimeMillis() - nPhaseStart;
+
+        nPhaseStart = GetTimeMillis();
+        for (const DecodedBlockIndex& entry : decodedBatch) {
+            const uint256&         blockHash = entry.blockHash;
+            const CDiskBlockIndex& diskindex = entry.diskindex;
+
+            // the in-memory index doesn't store the block key; blocks are always stored under their
+            // hash
+            if (diskindex.blockKeyInDB != blockHash) {
+                cursorPtr.reset();
+                return error("LoadBlockIndex() : block %s is stored under a different key %s",
+                             blockHash.ToString().c_str(), diskindex.blockKeyInDB.ToString().c_str());
+            }
 
-        // NovaCoin: build setStakeSeen
-        if (pindexNew->IsProofOfStake())
-            setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
-
-        itemRes = mdb_cursor_get(cursorRawPtr, &key, &data, MDB_NEXT);
+            // Construct block index object
+            CBlockIndexSmartPtr pindexNew = InsertBlockIndex(blockHash, loadedBlockIndex);
+            pindexNew->pprev              = InsertBlockIndex(diskindex.hashPrev, loadedBlockIndex);
+            pindexNew->pnext              = InsertBlockIndex(diskindex.hashNext, loadedBlockIndex);
+            pindexNew->nHeight            = diskindex.nHeight;
+            pindexNew->nMint              = diskindex.nMint;
+            pindexNew->nMoneySupply       = diskindex.nMoneySupply;
+            pindexNew->nFlags             = diskindex.nFlags;
+            pindexNew->nStakeModifier     = diskindex.nStakeModifier;
+            pindexNew->hashProof          = diskindex.hashProof;
+            pindexNew->nVersion           = diskindex.nVersion;
+            pindexNew->hashMerkleRoot     = diskindex.hashMerkleRoot;
+            pindexNew->nTime              = diskindex.nTime;
+            pindexNew->nBits              = diskindex.nBits;
+            pindexNew->nNonce             = diskindex.nNonce;
+            // holds the trust of this block alone until the chain trust pass below
+            pindexNew->nChainTrust = entry.blockTrust;
+
+            // Watch for genesis block
+            if (pindexGenesisBlock == nullptr && blockHash == Params().GenesisBlockHash())
+                pindexGenesisBlock = pindexNew;
+
+            if (!pindexNew->CheckIndex()) {
+                cursorPtr.reset();
+                return error("LoadBlockIndex() : CheckIndex failed at %d", pindexNew->nHeight);
+            }
 
-        loadedCount++;
-        if (loadedCount % 10000 == 0) {
-            uiInterface.InitMessage(_("Loading block index...") +
-                                    " (block: " + std::to_string(loadedCount) + ")");
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(make_pair(diskindex.prevoutStake, diskindex.nStakeTime));
         }
-        //        std::cout << "Read status: " << itemRes << "\t" << mdb_strerror(itemRes) << std::endl;
-    } while (itemRes == 0);
+        nLinkMillis += GetTimeMillis() - nPhaseStart;
+
+        loadedCount += decodedBatch.size();
+        uiInterface.InitMessage(_("Loading block index...") +
+                                " (block: " + std::to_string(loadedCount) + ")");
+    }
     printf("Done reading block index\n");
     uiInterface.InitMessage(_("Loading block index...") + " (done reading block index)");
 
@@ -1054,28 +1645,40 @@ bool CTxDB::LoadBlockIndex()
     if (fRequestShutdown)
         return true;
 
+    printf("LoadBlockIndex(): read %" PRIu64 " records in %" PRId64 "ms, decoded in %" PRId64
+           "ms, linked in %" PRId64 "ms\n",
+           loadedCount, nReadMillis, nDecodeMillis, nLinkMillis);
+
     // Calculate nChainTrust
-    vector<pair<int, CBlockIndex*>> vSortedByHeight;
-    vSortedByHeight.reserve(loadedBlockIndex.size());
-    uiInterface.InitMessage("Building chain trust... (allocating memory...)");
+    const int64_t nTrustStart = GetTimeMillis();
+    uiInterface.InitMessage("Building chain trust... (sorting...)");
+
+    // counting sort by height; parents always have a lower height than their children
+    int maxHeight = 0;
     for (const PAIRTYPE(const uint256, CBlockIndexSmartPtr) & item : loadedBlockIndex) {
-        CBlockIndex* pindex = item.second.get();
-        vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
+        maxHeight = std::max(maxHeight, item.second->nHeight);
     }
-    // use heap-sort to guarantee O(n*log(n)) performance, since std::sort() can have O(n^2) complexity
-    uiInterface.InitMessage("Building chain trust... (sorting...)");
-    std::make_heap(vSortedByHeight.begin(), vSortedByHeight.end());
-    std::sort_heap(vSortedByHeight.begin(), vSortedByHeight.end());
+    std::vector<std::size_t> heightOffsets(maxHeight + 2, 0);
+    for (const PAIRTYPE(const uint256, CBlockIndexSmartPtr) & item : loadedBlockIndex) {
+        heightOffsets[item.second->nHeight + 1]++;
+    }
+    for (std::size_t i = 1; i < heightOffsets.size(); i++) {
+        heightOffsets[i] += heightOffsets[i - 1];
+    }
+    std::vector<CBlockIndex*> vSortedByHeight(loadedBlockIndex.size());
+    for (const PAIRTYPE(const uint256, CBlockIndexSmartPtr) & item : loadedBlockIndex) {
+        vSortedByHeight[heightOffsets[item.second->nHeight]++] = item.second.get();
+    }
+
     loadedCount = 0;
-    for (const PAIRTYPE(int, CBlockIndex*) & item : vSortedByHeight) {
+    for (CBlockIndex* pindex : vSortedByHeight) {
         loadedCount++;
         if (loadedCount % 50000 == 0) {
             uiInterface.InitMessage(
                 "Building chain trust... (chaining block: " + std::to_string(loadedCount) + "/" +
                 std::to_string(vSortedByHeight.size()) + ")");
         }
-        CBlockIndex* pindex = item.second;
-        pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + pindex->GetBlockTrust();
+        pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + pindex->nChainTrust;
         // NovaCoin: calculate stake modifier checksum
         pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
         if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
@@ -1083,6 +1686,8 @@ bool CTxDB::LoadBlockIndex()
                          "modifier=0x%016" PRIx64,
                          pindex->nHeight, pindex->nStakeModifier);
     }
+    printf("LoadBlockIndex(): chain trust computed in %" PRId64 "ms\n",
+           GetTimeMillis() - nTrustStart);
 
     // Load hashBestChain pointer to end of best chain
     uint256 hashBestChainTemp = 0;
@@ -1093,13 +1698,12 @@ bool CTxDB::LoadBlockIndex()
     }
     if (!loadedBlockIndex.count(hashBestChainTemp))
         return error("CTxDB::LoadBlockIndex() : hashBestChain not found in the block index");
-    //    bestChain.setBestChain(loadedBlockIndex.at(hashBestChainTemp), false);
 
     const int bestHeight = loadedBlockIndex.at(hashBestChainTemp)->nHeight;
 
     printf("LoadBlockIndex(): hashBestChain=%s  height=%d  trust=%s  date=%s\n",
            hashBestChainTemp.ToString().substr(0, 20).c_str(), bestHeight,
-           CBigNum(GetBestChainTrust().value_or(0)).ToString().c_str(),
+           CBigNum(loadedBlockIndex.at(hashBestChainTemp)->nChainTrust).ToString().c_str(),
            DateTimeStrFormat("%x %H:%M:%S", loadedBlockIndex.at(hashBestChainTemp)->GetBlockTime())
                .c_str());
 
@@ -1108,7 +1712,109 @@ bool CTxDB::LoadBlockIndex()
     ReadBestInvalidTrust(bnBestInvalidTrust);
     nBestInvalidTrust = bnBestInvalidTrust.getuint256();
 
-    CTxDB txdb;
+    mapBlockIndex.setInternalMap(std::move(loadedBlockIndex));
+    chainActive.SetTip(LookupBlockIndex(hashBestChainTemp));
+
+    printf("LoadBlockIndex(): done in %" PRId64 "ms\n", GetTimeMillis() - nLoadStart);
+
+    return true;
+}
+
+bool CTxDB::LoadBlockIndexSnapshot()
+{
+    const boost::filesystem::path path = GetBlockIndexSnapshotPath();
+    if (!boost::filesystem::exists(path))
+        return false;
+
+    const int64_t nStart = GetTimeMillis();
+
+    uint256  hashBestChainTemp = 0;
+    MDB_stat stat;
+    {
+        mdb_txn_safe localTxn;
+        if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
+            return error("Failed to begin transaction at read with error code %i; and error: %s\n", res,
+                         mdb_strerror(res));
+        }
+        if (auto rc = mdb_stat(localTxn, *db_blockIndex, &stat)) {
+            return error("LoadBlockIndexSnapshot() : mdb_stat failed with error code %d; and error: "
+                         "%s\n",
+                         rc, mdb_strerror(rc));
+        }
+        localTxn.commit();
+    }
+
+    BlockIndexMapType::MapType loadedBlockIndex;
+    StakeSeenSetType           loadedStakeSeen;
+    const bool                 fLoaded =
+        ReadHashBestChain(hashBestChainTemp) &&
+        ReadBlockIndexSnapshot(path, hashBestChainTemp, stat.ms_entries, loadedBlockIndex,
+                               loadedStakeSeen);
+
+    // the snapshot describes the index at shutdown; it's stale as soon as this run changes anything
+    boost::system::error_code ec;
+    boost::filesystem::remove(path, ec);
+
+    if (!fLoaded) {
+        printf("LoadBlockIndex(): block index snapshot isn't usable; loading from the db\n");
+        return false;
+    }
+
+    const auto itGenesis = loadedBlockIndex.find(Params().GenesisBlockHash());
+    if (itGenesis != loadedBlockIndex.end())
+        pindexGenesisBlock = itGenesis->second;
+
+    setStakeSeen = std::move(loadedStakeSeen);
+
+    // Load bnBestInvalidTrust, OK if it doesn't exist
+    CBigNum bnBestInvalidTrust;
+    ReadBestInvalidTrust(bnBestInvalidTrust);
+    nBestInvalidTrust = bnBestInvalidTrust.getuint256();
+
+    const std::size_t loadedCount = loadedBlockIndex.size();
+    mapBlockIndex.setInternalMap(std::move(loadedBlockIndex));
+    chainActive.SetTip(LookupBlockIndex(hashBestChainTemp));
+
+    printf("LoadBlockIndex(): loaded %" PRIszu " entries from the snapshot in %" PRId64 "ms\n",
+           loadedCount, GetTimeMillis() - nStart);
+
+    return true;
+}
+
+bool CTxDB::VerifyRecentBlocks()
+{
+    CBlockIndexSmartPtr pindexFork   = nullptr;
+    const bool          fBlocksValid = VerifyRecentBlocksInSnapshot(pindexFork);
+    if (!pindexFork)
+        return fBlocksValid;
+
+    // the best chain isn't moved back from here, as other threads keep connecting blocks to it; the
+    // next start moves it back before any block is connected, see RollBackToLastVerifiedBlock()
+    if (!WriteLastVerifiedBlock(pindexFork->GetBlockHash()))
+        printf("VerifyRecentBlocks() : failed to save the last good block\n");
+    return error("VerifyRecentBlocks() : *** the best chain is bad after block %d",
+                 pindexFork->nHeight);
+}
+
+bool CTxDB::VerifyRecentBlocksInSnapshot(CBlockIndexSmartPtr& pindexFork)
+{
+    const int64_t nVerifyStart = GetTimeMillis();
+
+    // blocks keep being connected meanwhile, so everything is read from one snapshot, from its best
+    // block, or the spends of the blocks connected after it would look bad
+    if (!ReadSnapshotBegin())
+        return error("VerifyRecentBlocks() : failed to begin a read snapshot");
+    BOOST_SCOPE_EXIT(void) { CTxDB::ReadSnapshotEnd(); }
+    BOOST_SCOPE_EXIT_END
+
+    uint256 hashBestChainTemp = 0;
+    if (!ReadHashBestChain(hashBestChainTemp))
+        return true;
+    const CBlockIndexSmartPtr pindexBest = mapBlockIndex.get(hashBestChainTemp).value_or(nullptr);
+    if (!pindexBest)
+        return error("VerifyRecentBlocks() : hashBestChain not found in the block index");
+    const int bestHeight = pindexBest->nHeight;
+
     // Verify blocks in the best chain
     int nCheckLevel = GetArg("-checklevel", 1);
     int nCheckDepth = GetArg("-checkblocks", 2500);
@@ -1117,49 +1823,56 @@ bool CTxDB::LoadBlockIndex()
     if (nCheckDepth > bestHeight)
         nCheckDepth = bestHeight;
     printf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
-    CBlockIndexSmartPtr              pindexFork = nullptr;
     map<uint256, const CBlockIndex*> mapBlockPos;
-    loadedCount = 0;
-    for (ConstCBlockIndexSmartPtr pindex = loadedBlockIndex.at(hashBestChainTemp);
-         pindex && pindex->pprev; pindex = pindex->pprev) {
-
-        if (loadedCount % 100 == 0) {
-            uiInterface.InitMessage("Verifying latest blocks (" + std::to_string(loadedCount) + "/" +
-                                    std::to_string(nCheckDepth) + ")");
+    CBlockArena                      blockArena;
+    int                              verifiedCount = 0;
+    for (ConstCBlockIndexSmartPtr pindex = pindexBest; pindex && pindex->pprev;
+         pindex                          = boost::atomic_load(&pindex->pprev)) {
+
+        // this runs in the background, after the splash screen is gone, so the progress is only logged
+        if (verifiedCount % 100 == 0) {
+            LogPrint(LOG_VALIDATION, "VerifyRecentBlocks() : verified %i/%i blocks\n", verifiedCount,
+                     nCheckDepth);
         }
-        loadedCount++;
+        verifiedCount++;
 
-        if (fRequestShutdown || pindex->nHeight < bestHeight - nCheckDepth)
+        if (fShutdown || fRequestShutdown || pindex->nHeight < bestHeight - nCheckDepth)
             break;
-        CBlock block;
-        if (!block.ReadFromDisk(pindex.get()))
-            return error("LoadBlockIndex() : block.ReadFromDisk failed");
+        if (mdb_txn_safe::are_new_txns_prevented()) {
+            // the snapshot would keep the map from being resized, and so every writer waiting
+            printf("VerifyRecentBlocks() : stopped after %i blocks for the db map to be resized\n",
+                   verifiedCount - 1);
+            break;
+        }
+        if (!blockArena.ReadFromDisk(pindex.get(), *this))
+            return error("VerifyRecentBlocks() : block.ReadFromDisk failed");
+        CBlock& block = blockArena.GetBlock();
         // check level 1: verify block validity
         // check level 7: verify block signature too
-        if (nCheckLevel > 0 && !block.CheckBlock(txdb, true, true, (nCheckLevel > 6))) {
-            printf("LoadBlockIndex() : *** found bad block at %d, hash=%s\n", pindex->nHeight,
+        if (nCheckLevel > 0 && !block.CheckBlock(*this, true, true, (nCheckLevel > 6))) {
+            printf("VerifyRecentBlocks() : *** found bad block at %d, hash=%s\n", pindex->nHeight,
                    pindex->GetBlockHash().ToString().c_str());
             pindexFork = pindex->pprev;
         }
         // check level 2: verify transaction index validity
         if (nCheckLevel > 1) {
-            uint256 pos      = pindex->blockKeyInDB;
+            uint256 pos      = pindex->GetBlockHash();
             mapBlockPos[pos] = pindex.get();
             for (const CTransaction& tx : block.vtx) {
                 uint256  hashTx = tx.GetHash();
                 CTxIndex txindex;
                 if (ReadTxIndex(hashTx, txindex)) {
                     // check level 3: checker transaction hashes
-                    if (nCheckLevel > 2 || pindex->blockKeyInDB != txindex.pos.nBlockPos) {
+                    if (nCheckLevel > 2 || pindex->GetBlockHash() != txindex.pos.nBlockPos) {
                         // either an error or a duplicate transaction
                         CTransaction txFound;
-                        if (!txFound.ReadFromDisk(txindex.pos, txdb)) {
-                            printf("LoadBlockIndex() : *** cannot read mislocated transaction %s\n",
+                        if (!txFound.ReadFromDisk(txindex.pos, *this)) {
+                            printf("VerifyRecentBlocks() : *** cannot read mislocated transaction %s\n",
                                    hashTx.ToString().c_str());
                             pindexFork = pindex->pprev;
                         } else if (txFound.GetHash() != hashTx) // not a duplicate tx
                         {
-                            printf("LoadBlockIndex(): *** invalid tx position for %s\n",
+                            printf("VerifyRecentBlocks(): *** invalid tx position for %s\n",
                                    hashTx.ToString().c_str());
                             pindexFork = pindex->pprev;
                         }
@@ -1171,8 +1884,8 @@ bool CTxDB::LoadBlockIndex()
                             if (!txpos.IsNull()) {
                                 uint256 posFind = txpos.nBlockPos;
                                 if (!mapBlockPos.count(posFind)) {
-                                    printf("LoadBlockIndex(): *** found bad spend at %d, hashBlock=%s, "
-                                           "hashTx=%s\n",
+                                    printf("VerifyRecentBlocks(): *** found bad spend at %d, "
+                                           "hashBlock=%s, hashTx=%s\n",
                                            pindex->nHeight, pindex->GetBlockHash().ToString().c_str(),
                                            hashTx.ToString().c_str());
                                     pindexFork = pindex->pprev;
@@ -1181,14 +1894,14 @@ bool CTxDB::LoadBlockIndex()
                                 // transaction that consume them
                                 if (nCheckLevel > 5) {
                                     CTransaction txSpend;
-                                    if (!txSpend.ReadFromDisk(txpos, txdb)) {
-                                        printf("LoadBlockIndex(): *** cannot read spending transaction "
-                                               "of %s:%i from disk\n",
+                                    if (!txSpend.ReadFromDisk(txpos, *this)) {
+                                        printf("VerifyRecentBlocks(): *** cannot read spending "
+                                               "transaction of %s:%i from disk\n",
                                                hashTx.ToString().c_str(), nOutput);
                                         pindexFork = pindex->pprev;
-                                    } else if (txSpend.CheckTransaction(txdb).isErr()) {
-                                        printf("LoadBlockIndex(): *** spending transaction of %s:%i is "
-                                               "invalid\n",
+                                    } else if (txSpend.CheckTransaction(*this).isErr()) {
+                                        printf("VerifyRecentBlocks(): *** spending transaction of "
+                                               "%s:%i is invalid\n",
                                                hashTx.ToString().c_str(), nOutput);
                                         pindexFork = pindex->pprev;
                                     } else {
@@ -1197,8 +1910,8 @@ bool CTxDB::LoadBlockIndex()
                                             if (txin.prevout.hash == hashTx && txin.prevout.n == nOutput)
                                                 fFound = true;
                                         if (!fFound) {
-                                            printf("LoadBlockIndex(): *** spending transaction of %s:%i "
-                                                   "does not spend it\n",
+                                            printf("VerifyRecentBlocks(): *** spending transaction of "
+                                                   "%s:%i does not spend it\n",
                                                    hashTx.ToString().c_str(), nOutput);
                                             pindexFork = pindex->pprev;
                                         }
@@ -1216,7 +1929,7 @@ bool CTxDB::LoadBlockIndex()
                         if (ReadTxIndex(txin.prevout.hash, txindex))
                             if (txindex.vSpent.size() - 1 < txin.prevout.n ||
                                 txindex.vSpent[txin.prevout.n].IsNull()) {
-                                printf("LoadBlockIndex(): *** found unspent prevout %s:%i in %s\n",
+                                printf("VerifyRecentBlocks(): *** found unspent prevout %s:%i in %s\n",
                                        txin.prevout.hash.ToString().c_str(), txin.prevout.n,
                                        hashTx.ToString().c_str());
                                 pindexFork = pindex->pprev;
@@ -1227,23 +1940,9 @@ bool CTxDB::LoadBlockIndex()
         }
     }
 
-    printf("Verifying latest blocks done.\n");
-    uiInterface.InitMessage("Verifying latest blocks done");
+    printf("Verified latest blocks in %" PRId64 "ms\n", GetTimeMillis() - nVerifyStart);
 
-    if (pindexFork && !fRequestShutdown) {
-        // Reorg back to the fork
-        printf("LoadBlockIndex() : *** moving best chain pointer back to block %d\n",
-               pindexFork->nHeight);
-        CBlock block;
-        if (!block.ReadFromDisk(pindexFork.get()))
-            return error("LoadBlockIndex() : block.ReadFromDisk failed");
-        CTxDB txdb;
-        block.SetBestChain(txdb, pindexFork);
-    }
-
-    mapBlockIndex.setInternalMap(std::move(loadedBlockIndex));
-
-    return true;
+    return !pindexFork;
 }
 
 boost::optional<int> CTxDB::GetBestChainHeight() const
@@ -1403,6 +2102,7 @@ void mdb_txn_safe::prevent_new_txns()
     while (creation_gate.test_and_set()) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+    new_txns_prevented = true;
 }
 
 void mdb_txn_safe::wait_no_active_txns()
@@ -1412,11 +2112,21 @@ void mdb_txn_safe::wait_no_active_txns()
     }
 }
 
-void mdb_txn_safe::allow_new_txns() { creation_gate.clear(); }
+void mdb_txn_safe::allow_new_txns()
+{
+    new_txns_prevented = false;
+    creation_gate.clear();
+}
+
+bool mdb_txn_safe::are_new_txns_prevented() { return new_txns_prevented; }
 
 CTxDB::~CTxDB()
 {
     // Note that this is not the same as Close() because it deletes only
     // data scoped to this TxDB object.
+    if (activeBatch && sharedTxnParent) {
+        // a nested transaction isn't aborted by its destructor, and the shared one has to go on
+        TxnAbort();
+    }
     resetDbPointers();
 }
@@ -18,9 +18,13 @@
 
 #include "liblmdb/lmdb.h"
 
+#include "addressindex.h"
+#include "blockfilterindex.h"
 #include "diskblockindex.h"
 #include "disktxpos.h"
 #include "itxdb.h"
+#include "metrics.h"
+#include "ntp1tokenindex.h"
 #include "outpoint.h"
 #include "txindex.h"
 #include "util.h"
@@ -44,17 +48,41 @@ extern DbSmartPtrType glob_db_tx;
 extern DbSmartPtrType glob_db_ntp1Tx;
 extern DbSmartPtrType glob_db_ntp1tokenNames;
 extern DbSmartPtrType glob_db_addrsVsPubKeys;
-
-const std::string LMDB_MAINDB           = "MainDb";
-const std::string LMDB_BLOCKINDEXDB     = "BlockIndexDb";
-const std::string LMDB_BLOCKSDB         = "BlocksDb";
-const std::string LMDB_TXDB             = "TxDb";
-const std::string LMDB_NTP1TXDB         = "Ntp1txDb";
-const std::string LMDB_NTP1TOKENNAMESDB = "Ntp1NamesDb";
-const std::string LMDB_ADDRSVSPUBKEYSDB = "AddrsVsPubKeysDb";
+extern DbSmartPtrType glob_db_ntp1Balances;
+extern DbSmartPtrType glob_db_ntp1TokenStats;
+extern DbSmartPtrType glob_db_ntp1TokenHolders;
+extern DbSmartPtrType glob_db_addressIndex;
+extern DbSmartPtrType glob_db_addressUnspent;
+extern DbSmartPtrType glob_db_spentIndex;
+extern DbSmartPtrType glob_db_blockFilters;
+
+const std::string LMDB_MAINDB             = "MainDb";
+const std::string LMDB_BLOCKINDEXDB       = "BlockIndexDb";
+const std::string LMDB_BLOCKSDB           = "BlocksDb";
+const std::string LMDB_TXDB               = "TxDb";
+const std::string LMDB_NTP1TXDB           = "Ntp1txDb";
+const std::string LMDB_NTP1TOKENNAMESDB   = "Ntp1NamesDb";
+const std::string LMDB_ADDRSVSPUBKEYSDB   = "AddrsVsPubKeysDb";
+const std::string LMDB_NTP1BALANCESDB     = "Ntp1BalancesDb";
+const std::string LMDB_NTP1TOKENSTATSDB   = "Ntp1TokenStatsDb";
+const std::string LMDB_NTP1TOKENHOLDERSDB = "Ntp1TokenHoldersDb";
+const std::string LMDB_ADDRESSINDEXDB     = "AddressIndexDb";
+const std::string LMDB_ADDRESSUNSPENTDB   = "AddressUnspentDb";
+const std::string LMDB_SPENTINDEXDB       = "SpentIndexDb";
+const std::string LMDB_BLOCKFILTERSDB     = "BlockFiltersDb";
 
 constexpr static float    DB_RESIZE_PERCENT     = 0.9f;
 constexpr static uint64_t MIN_MAP_SIZE_INCREASE = UINT64_C(1) << 28; // ~256 MiB
+// the map grows by at least this fraction of its size, so that it's resized fewer and fewer times
+constexpr static uint64_t MAP_SIZE_GROWTH_DIVISOR = 2;
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__) || defined(__powerpc64__))
+// On 64-bit Linux the data file only grows with the data written to it (the map isn't MDB_WRITEMAP),
+// so a map much bigger than the database costs nothing but address space. Reserving one up front means
+// that the map, whose resizes stop every transaction, practically never has to grow.
+#define LMDB_RESERVE_MAP
+constexpr static uint64_t DB_RESERVED_MAPSIZE = UINT64_C(1) << 40; // 1 TiB
+#endif
 
 const std::string QuickSyncDataLink =
     "https://raw.githubusercontent.com/NeblioTeam/neblio-quicksync/master/download.json";
@@ -141,6 +169,16 @@ class CTxDB;
 
 void lmdb_resized(MDB_env* env);
 
+/** The memory map of the database, and how long its resizes stopped all transactions since startup */
+struct LMDBMapStats
+{
+    uint64_t mapSize          = 0;
+    uint64_t usedSize         = 0;
+    uint64_t resizes          = 0;
+    int64_t  totalStallMillis = 0;
+    int64_t  maxStallMillis   = 0;
+};
+
 inline int lmdb_txn_begin(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** txn)
 {
     int res = mdb_txn_begin(env, parent, flags, txn);
@@ -183,6 +221,8 @@ struct mdb_txn_safe
     static void prevent_new_txns();
     static void wait_no_active_txns();
     static void allow_new_txns();
+    // whether a map resize is waiting for the active transactions to end
+    static bool are_new_txns_prevented();
 
     MDB_txn*                     m_txn;
     bool                         m_batch_txn = false;
@@ -191,6 +231,19 @@ struct mdb_txn_safe
 
     // could use a mutex here, but this should be sufficient.
     static std::atomic_flag creation_gate;
+    static std::atomic<bool> new_txns_prevented;
+};
+
+/** The write transaction of a thread that outlives its CTxDB instances; see CTxDB::SharedTxnBegin() */
+struct LMDBSharedTxn
+{
+    std::unique_ptr<mdb_txn_safe> root;
+    // a read snapshot, see CTxDB::ReadSnapshotBegin()
+    bool readOnly = false;
+    // the innermost open transaction: the root, or the last one that TxnBegin() nested in it
+    MDB_txn* current = nullptr;
+    // the size of the keys and values written since the root began
+    uint64_t dirtyBytes = 0;
 };
 
 // Class that provides access to a LevelDB. Note that this class is frequently
@@ -236,13 +289,24 @@ private:
     MDB_dbi* db_ntp1Tx;
     MDB_dbi* db_ntp1tokenNames;
     MDB_dbi* db_addrsVsPubKeys;
+    MDB_dbi* db_ntp1Balances;
+    MDB_dbi* db_ntp1TokenStats;
+    MDB_dbi* db_ntp1TokenHolders;
+    MDB_dbi* db_addressIndex;
+    MDB_dbi* db_addressUnspent;
+    MDB_dbi* db_spentIndex;
+    MDB_dbi* db_blockFilters;
 
     // A batch stores up writes and deletes for atomic application. When this
     // field is non-NULL, writes/deletes go there instead of directly to disk.
     std::unique_ptr<mdb_txn_safe> activeBatch;
+    // when activeBatch is nested in the shared transaction, what was its innermost transaction before
+    MDB_txn*                      sharedTxnParent = nullptr;
     bool                          fReadOnly;
     int                           nVersion;
 
+    static thread_local LMDBSharedTxn sharedTxn;
+
     void (*dbDeleter)(MDB_dbi*) = [](MDB_dbi* p) {
         if (p) {
             mdb_close(dbEnv.get(), *p);
@@ -251,6 +315,16 @@ private:
     };
 
 protected:
+    // The transaction that reads and writes go through instead of one of their own: the one of
+    // TxnBegin(), or else the shared transaction of this thread, if any
+    MDB_txn* ActiveTxn() const { return activeBatch ? activeBatch->rawPtr() : sharedTxn.current; }
+
+    MDB_txn* ActiveTxnOr(const mdb_txn_safe& localTxn) const
+    {
+        MDB_txn* txn = ActiveTxn();
+        return txn ? txn : localTxn.rawPtr();
+    }
+
     // Returns true and sets (value,false) if activeBatch contains the given key
     // or leaves value alone and sets deleted = true if activeBatch contains a
     // delete for it.
@@ -260,13 +334,16 @@ protected:
     bool Read(const K& key, T& value, MDB_dbi* dbPtr, int serializationTypeModifiers = 0,
               size_t offset = 0) const
     {
+        static CMetricHistogram& readHistogram = Metrics().Histogram("neblio_db_read_seconds");
+        const CMetricTimer       timer(readHistogram);
+
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
 
         // if there's no active transaction, we start one for this read
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error code: %s\n",
@@ -274,19 +351,19 @@ protected:
             }
         }
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin = ssKey.str();
         MDB_val       kS     = {keyBin.size(), (void*)(keyBin.c_str())};
         MDB_val       vS     = {0, nullptr};
-        if (auto ret = mdb_get((!activeBatch ? localTxn : *activeBatch), *dbPtr, &kS, &vS)) {
-            std::string dbgKey = KeyAsString(key, ssKey.str());
-
+        if (auto ret = mdb_get(ActiveTxnOr(localTxn), *dbPtr, &kS, &vS)) {
+            // missing keys are expected in many lookups, so they're only logged with -debug=db
             if (ret == MDB_NOTFOUND) {
-                printf("Failed to read lmdb key %s as it doesn't exist\n", dbgKey.c_str());
+                LogPrint(LOG_DB, "Failed to read lmdb key %s as it doesn't exist\n",
+                         KeyAsString(key, ssKey.str()).c_str());
             } else {
                 printf("Failed to read lmdb key %s with an unknown error of code %i; and error: %s\n",
-                       dbgKey.c_str(), ret, mdb_strerror(ret));
+                       KeyAsString(key, ssKey.str()).c_str(), ret, mdb_strerror(ret));
             }
             if (localTxn.rawPtr()) {
                 localTxn.abort();
@@ -325,7 +402,7 @@ protected:
         ssKey << key;
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error code: %s\n",
@@ -333,13 +410,13 @@ protected:
             }
         }
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin       = ssKey.str();
         MDB_val       kS           = {keyBin.size(), (void*)(keyBin.c_str())};
         MDB_val       vS           = {0, nullptr};
         MDB_cursor*   cursorRawPtr = nullptr;
-        if (auto rc = mdb_cursor_open((!activeBatch ? localTxn : *activeBatch), *dbPtr, &cursorRawPtr)) {
+        if (auto rc = mdb_cursor_open(ActiveTxnOr(localTxn), *dbPtr, &cursorRawPtr)) {
             return error("ReadMultiple: Failed to open lmdb cursor with error code %d; and error: %s\n",
                          rc, mdb_strerror(rc));
         }
@@ -354,11 +431,10 @@ protected:
         // set the pointer to the first value
         itemRes = mdb_cursor_get(cursorPtr.get(), &kS, &vS, MDB_SET_RANGE);
         if (itemRes) {
-            std::string dbgKey = KeyAsString(key, ssKey.str());
             if (itemRes != 0 && itemRes != MDB_NOTFOUND) {
                 printf("txdb-lmdb: Cursor with key %s does not exist; with an error of code %i; and "
                        "error: %s\n",
-                       dbgKey.c_str(), itemRes, mdb_strerror(itemRes));
+                       KeyAsString(key, ssKey.str()).c_str(), itemRes, mdb_strerror(itemRes));
                 if (localTxn.rawPtr()) {
                     localTxn.abort();
                 }
@@ -406,6 +482,84 @@ protected:
         return true;
     }
 
+    /**
+     * Reads the values of "key" in a dupsort db in their (memcmp) order, starting at the first one
+     * whose serialized bytes are >= valueFrom, until fStop(value) returns true
+     */
+    template <typename K, typename T, typename Stop>
+    bool ReadMultipleFrom(const K& key, const std::string& valueFrom, std::vector<T>& values,
+                          Stop fStop, MDB_dbi* dbPtr) const
+    {
+        values.clear();
+
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(1000);
+        ssKey << key;
+
+        mdb_txn_safe localTxn(false);
+        if (!ActiveTxn()) {
+            localTxn = mdb_txn_safe();
+            if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
+                printf("Failed to begin transaction at read with error code %i; and error code: %s\n",
+                       res, mdb_strerror(res));
+            }
+        }
+        // only one of them should be active
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
+
+        std::string&& keyBin       = ssKey.str();
+        MDB_val       kS           = {keyBin.size(), (void*)(keyBin.c_str())};
+        MDB_val       vS           = {valueFrom.size(), (void*)(valueFrom.c_str())};
+        MDB_cursor*   cursorRawPtr = nullptr;
+        if (auto rc = mdb_cursor_open(ActiveTxnOr(localTxn), *dbPtr, &cursorRawPtr)) {
+            return error("ReadMultipleFrom: Failed to open lmdb cursor with error code %d; and error: "
+                         "%s\n",
+                         rc, mdb_strerror(rc));
+        }
+
+        std::unique_ptr<MDB_cursor, void (*)(MDB_cursor*)> cursorPtr(cursorRawPtr, [](MDB_cursor* p) {
+            if (p)
+                mdb_cursor_close(p);
+        });
+
+        int itemRes = mdb_cursor_get(cursorPtr.get(), &kS, &vS, MDB_GET_BOTH_RANGE);
+        if (itemRes != 0 && itemRes != MDB_NOTFOUND) {
+            printf("txdb-lmdb: Cursor with key %s does not exist; with an error of code %i; and "
+                   "error: %s\n",
+                   KeyAsString(key, ssKey.str()).c_str(), itemRes, mdb_strerror(itemRes));
+            return false;
+        }
+        // MDB_NEXT_DUP stays within the values of the key
+        while (itemRes == 0) {
+            assert(vS.mv_data != nullptr);
+            T value;
+            try {
+                CDataStream ssValue(static_cast<const char*>(vS.mv_data),
+                                    static_cast<const char*>(vS.mv_data) + vS.mv_size, SER_DISK,
+                                    CLIENT_VERSION);
+                ssValue >> value;
+            } catch (const std::exception& e) {
+                unsigned int sz = static_cast<unsigned int>(values.size());
+                printf("Failed to deserialized element number %u in lmdb ReadMultipleFrom() data "
+                       "when reading for key %s\n",
+                       sz, ssKey.str().c_str());
+                return false;
+            }
+            if (fStop(value)) {
+                break;
+            }
+            values.push_back(value);
+
+            itemRes = mdb_cursor_get(cursorRawPtr, &kS, &vS, MDB_NEXT_DUP);
+        }
+
+        cursorPtr.reset();
+        if (localTxn.rawPtr()) {
+            localTxn.abort();
+        }
+        return true;
+    }
+
     /**
      * ReadMultipleWithKeys reads all keys and values in a db
      */
@@ -415,7 +569,7 @@ protected:
         values.clear();
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error code: %s\n",
@@ -423,12 +577,12 @@ protected:
             }
         }
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         MDB_val     kS           = {0, nullptr};
         MDB_val     vS           = {0, nullptr};
         MDB_cursor* cursorRawPtr = nullptr;
-        if (auto rc = mdb_cursor_open((!activeBatch ? localTxn : *activeBatch), *dbPtr, &cursorRawPtr)) {
+        if (auto rc = mdb_cursor_open(ActiveTxnOr(localTxn), *dbPtr, &cursorRawPtr)) {
             return error("ReadMultiple: Failed to open lmdb cursor with error code %d; and error: %s\n",
                          rc, mdb_strerror(rc));
         }
@@ -494,6 +648,9 @@ protected:
     template <typename K, typename T>
     bool Write(const K& key, const T& value, MDB_dbi* dbPtr)
     {
+        static CMetricHistogram& writeHistogram = Metrics().Histogram("neblio_db_write_seconds");
+        const CMetricTimer       timer(writeHistogram);
+
         if (fReadOnly) {
             printf("Accessing lmdb write function in read only mode");
             assert("Write called on database in read-only mode");
@@ -508,13 +665,13 @@ protected:
         ssValue << value;
 
         // you can't resize the db when a tx is active
-        if (!activeBatch && CTxDB::need_resize()) {
+        if (!ActiveTxn() && CTxDB::need_resize()) {
             printf("LMDB memory map needs to be resized, doing that now.\n");
             CTxDB::do_resize();
         }
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error: %s\n", res,
@@ -523,14 +680,14 @@ protected:
         }
 
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin = ssKey.str();
         MDB_val       kS     = {keyBin.size(), (void*)(keyBin.c_str())};
         std::string&& valBin = ssValue.str();
         MDB_val       vS     = {valBin.size(), (void*)(valBin.c_str())};
 
-        if (auto ret = mdb_put((!activeBatch ? localTxn : *activeBatch), *dbPtr, &kS, &vS, 0)) {
+        if (auto ret = mdb_put(ActiveTxnOr(localTxn), *dbPtr, &kS, &vS, 0)) {
             std::string dbgKey = KeyAsString(key, ssKey.str());
             if (ret == MDB_MAP_FULL) {
                 if (need_resize()) {
@@ -548,6 +705,9 @@ protected:
             }
             return false;
         }
+        if (sharedTxn.current) {
+            sharedTxn.dirtyBytes += kS.mv_size + vS.mv_size;
+        }
         if (localTxn.rawPtr()) {
             localTxn.commitIfValid("Tx while writing");
         }
@@ -570,7 +730,7 @@ protected:
         ssKey << key;
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error: %s\n", res,
@@ -579,13 +739,63 @@ protected:
         }
 
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin = ssKey.str();
         MDB_val       kS     = {keyBin.size(), (void*)(keyBin.c_str())};
         MDB_val       vS{0, nullptr};
 
-        if (auto ret = mdb_del((!activeBatch ? localTxn : *activeBatch), *dbPtr, &kS, &vS)) {
+        if (auto ret = mdb_del(ActiveTxnOr(localTxn), *dbPtr, &kS, &vS)) {
+            std::string dbgKey = KeyAsString(key, ssKey.str());
+            printf("Failed to delete entry with key %s with lmdb; Code %i; Error message: %s\n",
+                   dbgKey.c_str(), ret, mdb_strerror(ret));
+            if (localTxn.rawPtr()) {
+                localTxn.abort();
+            }
+            return false;
+        }
+
+        localTxn.commitIfValid("Tx while erasing");
+        return true;
+    }
+
+    /** Erases a single key/value pair from a db with duplicate keys, keeping the key's other values */
+    template <typename K, typename T>
+    bool EraseKeyValue(const K& key, const T& value, MDB_dbi* dbPtr)
+    {
+        if (!dbPtr)
+            return false;
+        if (fReadOnly) {
+            printf("Accessing lmdb erase function in read-only mode.");
+            assert("Erase called on database in read-only mode");
+            return false;
+        }
+
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(1000);
+        ssKey << key;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.reserve(1000);
+        ssValue << value;
+
+        mdb_txn_safe localTxn(false);
+        if (!ActiveTxn()) {
+            localTxn = mdb_txn_safe();
+            if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, localTxn)) {
+                printf("Failed to begin transaction at read with error code %i; and error: %s\n", res,
+                       mdb_strerror(res));
+            }
+        }
+
+        // only one of them should be active
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
+
+        std::string&& keyBin   = ssKey.str();
+        std::string&& valueBin = ssValue.str();
+        MDB_val       kS       = {keyBin.size(), (void*)(keyBin.c_str())};
+        MDB_val       vS       = {valueBin.size(), (void*)(valueBin.c_str())};
+
+        if (auto ret = mdb_del(ActiveTxnOr(localTxn), *dbPtr, &kS, &vS)) {
             std::string dbgKey = KeyAsString(key, ssKey.str());
             printf("Failed to delete entry with key %s with lmdb; Code %i; Error message: %s\n",
                    dbgKey.c_str(), ret, mdb_strerror(ret));
@@ -615,7 +825,7 @@ protected:
         ssKey << key;
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, 0, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error: %s\n", res,
@@ -624,14 +834,14 @@ protected:
         }
 
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin = ssKey.str();
         MDB_val       kS     = {keyBin.size(), (void*)(keyBin.c_str())};
         MDB_val       vS{0, nullptr};
 
         MDB_cursor* cursorRawPtr = nullptr;
-        if (auto rc = mdb_cursor_open((!activeBatch ? localTxn : *activeBatch), *dbPtr, &cursorRawPtr)) {
+        if (auto rc = mdb_cursor_open(ActiveTxnOr(localTxn), *dbPtr, &cursorRawPtr)) {
             return error("EraseDup: Failed to open lmdb cursor with error code %d; and error: %s\n", rc,
                          mdb_strerror(rc));
         }
@@ -678,7 +888,7 @@ protected:
         std::string unused;
 
         mdb_txn_safe localTxn(false);
-        if (!activeBatch) {
+        if (!ActiveTxn()) {
             localTxn = mdb_txn_safe();
             if (auto res = lmdb_txn_begin(dbEnv.get(), nullptr, MDB_RDONLY, localTxn)) {
                 printf("Failed to begin transaction at read with error code %i; and error: %s\n", res,
@@ -687,13 +897,13 @@ protected:
         }
 
         // only one of them should be active
-        assert(localTxn.rawPtr() == nullptr || activeBatch == nullptr);
+        assert(localTxn.rawPtr() == nullptr || ActiveTxn() == nullptr);
 
         std::string&& keyBin = ssKey.str();
         MDB_val       kS     = {keyBin.size(), (void*)(keyBin.c_str())};
         MDB_val       vS{0, nullptr};
 
-        if (auto ret = mdb_get((!activeBatch ? localTxn : *activeBatch), *dbPtr, &kS, &vS)) {
+        if (auto ret = mdb_get(ActiveTxnOr(localTxn), *dbPtr, &kS, &vS)) {
             if (localTxn.rawPtr()) {
                 localTxn.abort();
             }
@@ -731,6 +941,27 @@ public:
     bool        TxnCommit();
     bool        TxnAbort();
 
+    /**
+     * Begins a write transaction that's shared by every CTxDB of this thread until SharedTxnCommit(),
+     * so that many changes pay for one commit (and its fsync). Until then, the CTxDB instances of this
+     * thread read and write through it, and TxnBegin() nests a transaction in it that TxnAbort() can
+     * still discard alone. Other threads see the database as of the last commit, and a crash loses
+     * what wasn't committed, as LMDB commits are atomic.
+     */
+    static bool     SharedTxnBegin(std::size_t required_size = 0);
+    static bool     SharedTxnCommit();
+    static bool     IsSharedTxnOpen();
+    static uint64_t GetSharedTxnDirtyBytes();
+
+    /**
+     * Begins a read-only transaction that every CTxDB of this thread reads through until
+     * ReadSnapshotEnd(), so that what's read is the database as of one commit, whatever other threads
+     * commit meanwhile. The map can't be resized while it's open, so long readers should end it when
+     * mdb_txn_safe::are_new_txns_prevented().
+     */
+    static bool ReadSnapshotBegin();
+    static void ReadSnapshotEnd();
+
     // for tests
     bool test1_WriteStrKeyVal(const std::string& key, const std::string& val);
     bool test1_ReadStrKeyVal(const std::string& key, std::string& val);
@@ -764,13 +995,72 @@ public:
     bool ReadDiskTx(const COutPoint& outpoint, CTransaction& tx, CTxIndex& txindex) const override;
     bool ReadDiskTx(const COutPoint& outpoint, CTransaction& tx) const override;
     bool ReadBlock(const uint256& hash, CBlock& blk, bool fReadTransactions = true) const override;
+    /** Reads the block over blk, reusing the storage of its transactions; see CBlockArena */
+    bool ReadBlockReusingStorage(const uint256& hash, CBlock& blk) const;
     bool WriteBlock(const uint256& hash, const CBlock& blk) override;
+    bool ReadBlockIndex(const uint256& hash, CDiskBlockIndex& blockindex) const override;
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex) override;
     bool ReadHashBestChain(uint256& hashBestChain) const override;
     bool WriteHashBestChain(const uint256& hashBestChain) override;
     bool ReadBestInvalidTrust(CBigNum& bnBestInvalidTrust) const override;
     bool WriteBestInvalidTrust(const CBigNum& bnBestInvalidTrust) override;
     bool LoadBlockIndex() override;
+    /** Loads the block index from the snapshot written on the last clean shutdown, if it's usable */
+    bool LoadBlockIndexSnapshot();
+    /** Verifies the last -checkblocks blocks of the best chain at -checklevel within one read snapshot,
+     * from its best block; returns false if one fails, and saves the last good block before it for
+     * the next start to move the best chain back to. Meant to run in the background after startup */
+    bool VerifyRecentBlocks();
+    // the last good block before a bad one found by VerifyRecentBlocks(); see
+    // RollBackToLastVerifiedBlock()
+    bool ReadLastVerifiedBlock(uint256& hash) const;
+    bool WriteLastVerifiedBlock(const uint256& hash);
+    bool EraseLastVerifiedBlock();
+    // tables of the NTP1 token index (-ntp1index); see ntp1tokenindex.h
+    bool ReadNTP1AddressBalances(const std::string&               address,
+                                 std::map<std::string, NTP1Int>& balances) const;
+    bool WriteNTP1AddressBalances(const std::string&                    address,
+                                  const std::map<std::string, NTP1Int>& balances);
+    bool EraseNTP1AddressBalances(const std::string& address);
+    bool ReadNTP1TokenIndexStats(const std::string& tokenId, NTP1TokenIndexStats& stats) const;
+    bool WriteNTP1TokenIndexStats(const std::string& tokenId, const NTP1TokenIndexStats& stats);
+    bool EraseNTP1TokenIndexStats(const std::string& tokenId);
+    bool ReadNTP1TokenHolders(const std::string& tokenId, std::vector<std::string>& addresses) const;
+    bool AddNTP1TokenHolder(const std::string& tokenId, const std::string& address);
+    bool EraseNTP1TokenHolder(const std::string& tokenId, const std::string& address);
+    /** The index tables are only usable if they were built from the genesis block */
+    bool IsNTP1TokenIndexComplete() const;
+    bool WriteNTP1TokenIndexComplete(bool fComplete);
+    bool ClearNTP1TokenIndex();
+    // tables of the address and spent indexes (-addressindex, -spentindex); see addressindex.h
+    bool ReadAddressIndex(const std::string& address, std::vector<CAddressIndexEntry>& entries) const;
+    /** The entries of the address from height nStart to nEnd (inclusive), sorted by height */
+    bool ReadAddressIndex(const std::string& address, int nStart, int nEnd,
+                          std::vector<CAddressIndexEntry>& entries) const;
+    bool AddAddressIndexEntry(const std::string& address, const CAddressIndexEntry& entry);
+    bool EraseAddressIndexEntry(const std::string& address, const CAddressIndexEntry& entry);
+    bool ReadAddressUnspentOutputs(const std::string&                 address,
+                                   std::vector<CAddressUnspentEntry>& outputs) const;
+    bool AddAddressUnspentOutput(const std::string& address, const CAddressUnspentEntry& output);
+    bool EraseAddressUnspentOutput(const std::string& address, const CAddressUnspentEntry& output);
+    /** Returns false if the output isn't spent in the main chain */
+    bool ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value) const;
+    bool WriteSpentIndex(const COutPoint& outpoint, const CSpentIndexValue& value);
+    bool EraseSpentIndex(const COutPoint& outpoint);
+    bool IsAddressIndexComplete() const;
+    bool WriteAddressIndexComplete(bool fComplete);
+    bool ClearAddressIndex();
+    bool IsSpentIndexComplete() const;
+    bool WriteSpentIndexComplete(bool fComplete);
+    bool ClearSpentIndex();
+    // table of the block filter index (-blockfilterindex); see blockfilterindex.h
+    /** Returns false if the block isn't indexed */
+    bool ReadBlockFilter(const uint256& blockHash, CBlockFilterIndexEntry& entry) const;
+    bool WriteBlockFilter(const uint256& blockHash, const CBlockFilterIndexEntry& entry);
+    bool ContainsBlockFilter(const uint256& blockHash) const;
+    bool IsBlockFilterIndexComplete() const;
+    bool WriteBlockFilterIndexComplete(bool fComplete);
+    bool ClearBlockFilterIndex();
     boost::optional<int>           GetBestChainHeight() const override;
     boost::optional<uint256>       GetBestChainTrust() const override;
     boost::shared_ptr<CBlockIndex> GetBestBlockIndex() const override;
@@ -778,34 +1068,52 @@ public:
 
     static uintmax_t GetCurrentDiskUsage();
 
+    static LMDBMapStats GetMapStats();
+
     void init_blockindex(bool fRemoveOld = false);
 
 private:
     inline void        loadDbPointers();
     inline void        resetDbPointers();
     static inline void resetGlobalDbPointers();
+    bool               ClearDb(MDB_dbi* dbPtr);
+    bool               VerifyRecentBlocksInSnapshot(CBlockIndexSmartPtr& pindexFork);
 };
 
 void CTxDB::loadDbPointers()
 {
-    db_main           = glob_db_main.get();
-    db_blockIndex     = glob_db_blockIndex.get();
-    db_blocks         = glob_db_blocks.get();
-    db_tx             = glob_db_tx.get();
-    db_ntp1Tx         = glob_db_ntp1Tx.get();
-    db_ntp1tokenNames = glob_db_ntp1tokenNames.get();
-    db_addrsVsPubKeys = glob_db_addrsVsPubKeys.get();
+    db_main             = glob_db_main.get();
+    db_blockIndex       = glob_db_blockIndex.get();
+    db_blocks           = glob_db_blocks.get();
+    db_tx               = glob_db_tx.get();
+    db_ntp1Tx           = glob_db_ntp1Tx.get();
+    db_ntp1tokenNames   = glob_db_ntp1tokenNames.get();
+    db_addrsVsPubKeys   = glob_db_addrsVsPubKeys.get();
+    db_ntp1Balances     = glob_db_ntp1Balances.get();
+    db_ntp1TokenStats   = glob_db_ntp1TokenStats.get();
+    db_ntp1TokenHolders = glob_db_ntp1TokenHolders.get();
+    db_addressIndex     = glob_db_addressIndex.get();
+    db_addressUnspent   = glob_db_addressUnspent.get();
+    db_spentIndex       = glob_db_spentIndex.get();
+    db_blockFilters     = glob_db_blockFilters.get();
 }
 
 void CTxDB::resetDbPointers()
 {
-    db_main           = nullptr;
-    db_blockIndex     = nullptr;
-    db_blocks         = nullptr;
-    db_tx             = nullptr;
-    db_ntp1Tx         = nullptr;
-    db_ntp1tokenNames = nullptr;
-    db_addrsVsPubKeys = nullptr;
+    db_main             = nullptr;
+    db_blockIndex       = nullptr;
+    db_blocks           = nullptr;
+    db_tx               = nullptr;
+    db_ntp1Tx           = nullptr;
+    db_ntp1tokenNames   = nullptr;
+    db_addrsVsPubKeys   = nullptr;
+    db_ntp1Balances     = nullptr;
+    db_ntp1TokenStats   = nullptr;
+    db_ntp1TokenHolders = nullptr;
+    db_addressIndex     = nullptr;
+    db_addressUnspent   = nullptr;
+    db_spentIndex       = nullptr;
+    db_blockFilters     = nullptr;
 }
 
 void CTxDB::resetGlobalDbPointers()
@@ -817,6 +1125,13 @@ void CTxDB::resetGlobalDbPointers()
     glob_db_ntp1Tx.reset();
     glob_db_ntp1tokenNames.reset();
     glob_db_addrsVsPubKeys.reset();
+    glob_db_ntp1Balances.reset();
+    glob_db_ntp1TokenStats.reset();
+    glob_db_ntp1TokenHolders.reset();
+    glob_db_addressIndex.reset();
+    glob_db_addressUnspent.reset();
+    glob_db_spentIndex.reset();
+    glob_db_blockFilters.reset();
 
     dbEnv.reset();
 }
@@ -601,6 +601,12 @@ struct hash<uint256>
 {
     std::size_t operator()(const uint256& k) const { return std::hash<uint64_t>()(k.Get64(0)); }
 };
+
+template <>
+struct hash<uint160>
+{
+    std::size_t operator()(const uint160& k) const { return std::hash<uint64_t>()(k.Get64(0)); }
+};
 } // namespace std
 
 inline bool operator==(const uint256& a, uint64_t b)                         { return (base_uint256)a == b; }
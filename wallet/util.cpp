@@ -190,57 +190,106 @@ uint256 GetRandHash()
     return hash;
 }
 
-inline int OutputDebugStringF(const char* pszFormat, ...)
+// This routine may be called by global destructors during shutdown. Since the order of destruction of
+// static/global objects is undefined, the objects used to write the debug log are allocated on the heap
+// the first time they're used and never destroyed.
+static boost::mutex& DebugLogMutex()
+{
+    static boost::mutex* mutexDebugLog = new boost::mutex();
+    return *mutexDebugLog;
+}
+
+static CAsyncLogWriter& DebugLogWriter()
+{
+    static CAsyncLogWriter* writer = new CAsyncLogWriter();
+    return *writer;
+}
+
+static CLogRateLimiter& DebugLogRateLimiter()
+{
+    static CLogRateLimiter* rateLimiter = new CLogRateLimiter();
+    return *rateLimiter;
+}
+
+// debug.log, opened or reopened (if requested) as needed; DebugLogMutex() must be held
+static FILE* DebugLogFile()
+{
+    static FILE* fileout = NULL;
+
+    if (!fileout) {
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        fileout                           = fopen(pathDebug.string().c_str(), "a");
+        if (fileout)
+            setbuf(fileout, NULL); // unbuffered
+    } else if (fReopenDebugLog) {
+        fReopenDebugLog                   = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(), "a", fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
+    return fileout;
+}
+
+static void WriteDebugLog(const std::string& str)
+{
+    boost::mutex::scoped_lock scoped_lock(DebugLogMutex());
+    FILE*                     fileout = DebugLogFile();
+    if (fileout)
+        fwrite(str.data(), 1, str.size(), fileout);
+}
+
+void StartAsyncDebugLog() { DebugLogWriter().Start(WriteDebugLog, fLogTimestamps); }
+
+void StopAsyncDebugLog() { DebugLogWriter().Stop(); }
+
+void SetDebugLogRateLimit(uint32_t nMaxPerMinute) { DebugLogRateLimiter().SetLimit(nMaxPerMinute); }
+
+// whether the rate limit lets a message with pszFormat through; messages are limited per the format
+// the caller wrote, so pass that one rather than the format of a wrapper
+static bool DebugLogRateLimitAllows(const char* pszFormat)
+{
+    uint32_t nSuppressed = 0;
+    if (!DebugLogRateLimiter().Allow(pszFormat, GetTime(), nSuppressed))
+        return false;
+    if (nSuppressed > 0)
+        OutputDebugStringF("(%u more messages like \"%.60s\" were suppressed in the last minute)\n",
+                           nSuppressed, pszFormat);
+    return true;
+}
+
+static int VOutputDebugString(const char* pszFormat, va_list ap)
 {
     int ret = 0;
+
     if (fPrintToConsole) {
         // print to console
         va_list arg_ptr;
-        va_start(arg_ptr, pszFormat);
+        va_copy(arg_ptr, ap);
         ret = vprintf(pszFormat, arg_ptr);
         va_end(arg_ptr);
     } else if (!fPrintToDebugger) {
         // print to debug.log
-        static FILE* fileout = NULL;
-
-        if (!fileout) {
-            boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-            fileout                           = fopen(pathDebug.string().c_str(), "a");
-            if (fileout)
-                setbuf(fileout, NULL); // unbuffered
-        }
-        if (fileout) {
-            static bool fStartedNewLine = true;
-
-            // This routine may be called by global destructors during shutdown.
-            // Since the order of destruction of static/global objects is undefined,
-            // allocate mutexDebugLog on the heap the first time this routine
-            // is called to avoid crashes during shutdown.
-            static boost::mutex* mutexDebugLog = NULL;
-            if (mutexDebugLog == NULL)
-                mutexDebugLog = new boost::mutex();
-            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
-
-            // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog                   = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(), "a", fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
+        va_list arg_ptr;
+        va_copy(arg_ptr, ap);
+        std::string str = vstrprintf(pszFormat, arg_ptr);
+        va_end(arg_ptr);
+        ret = str.size();
+
+        // the async writer timestamps the messages it writes itself
+        if (!DebugLogWriter().Push(GetTime(), str)) {
+            boost::mutex::scoped_lock scoped_lock(DebugLogMutex());
+            FILE*                     fileout = DebugLogFile();
+            if (fileout) {
+                static bool fStartedNewLine = true;
+
+                // Debug print useful for profiling
+                if (fLogTimestamps && fStartedNewLine)
+                    fprintf(fileout, "%s ", DateTimeStrFormat("%x %H:%M:%S", GetTime()).c_str());
+                if (!str.empty())
+                    fStartedNewLine = (str.back() == '\n');
+
+                fwrite(str.data(), 1, str.size(), fileout);
             }
-
-            // Debug print useful for profiling
-            if (fLogTimestamps && fStartedNewLine)
-                fprintf(fileout, "%s ", DateTimeStrFormat("%x %H:%M:%S", GetTime()).c_str());
-            if (pszFormat[strlen(pszFormat) - 1] == '\n')
-                fStartedNewLine = true;
-            else
-                fStartedNewLine = false;
-
-            va_list arg_ptr;
-            va_start(arg_ptr, pszFormat);
-            ret = vfprintf(fileout, pszFormat, arg_ptr);
-            va_end(arg_ptr);
         }
     }
 
@@ -254,7 +303,7 @@ inline int OutputDebugStringF(const char* pszFormat, ...)
             static std::string buffer;
 
             va_list arg_ptr;
-            va_start(arg_ptr, pszFormat);
+            va_copy(arg_ptr, ap);
             buffer += vstrprintf(pszFormat, arg_ptr);
             va_end(arg_ptr);
 
@@ -270,6 +319,30 @@ inline int OutputDebugStringF(const char* pszFormat, ...)
     return ret;
 }
 
+int OutputDebugStringF(const char* pszFormat, ...)
+{
+    // only messages that end a line are limited, so that lines aren't cut
+    if (pszFormat[0] != '\0' && pszFormat[strlen(pszFormat) - 1] == '\n' &&
+        !DebugLogRateLimitAllows(pszFormat))
+        return 0;
+
+    va_list arg_ptr;
+    va_start(arg_ptr, pszFormat);
+    const int ret = VOutputDebugString(pszFormat, arg_ptr);
+    va_end(arg_ptr);
+    return ret;
+}
+
+// writes a message without applying the rate limit, for callers that applied it already
+static int OutputDebugStringUnlimited(const char* pszFormat, ...)
+{
+    va_list arg_ptr;
+    va_start(arg_ptr, pszFormat);
+    const int ret = VOutputDebugString(pszFormat, arg_ptr);
+    va_end(arg_ptr);
+    return ret;
+}
+
 string vstrprintf(const char* format, va_list ap)
 {
     char  buffer[50000];
@@ -320,11 +393,15 @@ string real_strprintf(const std::string& format, int dummy, ...)
 
 bool error(const char* format, ...)
 {
+    // every caller's errors have their own budget, rather than all sharing the one of "ERROR: %s"
+    if (!DebugLogRateLimitAllows(format))
+        return false;
+
     va_list arg_ptr;
     va_start(arg_ptr, format);
     std::string str = vstrprintf(format, arg_ptr);
     va_end(arg_ptr);
-    printf("ERROR: %s\n", str.c_str());
+    OutputDebugStringUnlimited("ERROR: %s\n", str.c_str());
     return false;
 }
 
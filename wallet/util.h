@@ -38,7 +38,9 @@
 
 #include "ThreadSafeHashMap.h"
 #include "amount.h"
+#include "logging.h"
 #include "netbase.h" // for AddTimeData
+#include "prevector.h"
 
 // to obtain PRId64 on some old systems
 #define __STDC_FORMAT_MACROS 1
@@ -172,6 +174,13 @@ void RandAddSeed();
 void RandAddSeedPerfmon();
 int  ATTR_WARN_PRINTF(1, 2) OutputDebugStringF(const char* pszFormat, ...);
 
+/** moves writing debug.log to a background thread (see CAsyncLogWriter) */
+void StartAsyncDebugLog();
+/** writes the messages left in the queue and goes back to writing debug.log on the logging threads */
+void StopAsyncDebugLog();
+/** logs at most nMaxPerMinute messages per minute from the same place in the code; 0 for no limit */
+void SetDebugLogRateLimit(uint32_t nMaxPerMinute);
+
 /*
   Rationale for the real_strprintf / strprintf construction:
     It is not allowed to use va_start with a pass-by-reference argument.
@@ -367,6 +376,12 @@ inline std::string HexStr(const std::vector<unsigned char>& vch, bool fSpaces =
     return HexStr(vch.begin(), vch.end(), fSpaces);
 }
 
+template <unsigned int N>
+inline std::string HexStr(const prevector<N, unsigned char>& vch, bool fSpaces = false)
+{
+    return HexStr(vch.begin(), vch.end(), fSpaces);
+}
+
 inline int64_t GetPerformanceCounter()
 {
     int64_t nCounter = 0;
@@ -0,0 +1,102 @@
+#include "validationinterface.h"
+
+#include "util.h"
+
+ValidationInterfaceQueue validationInterfaceQueue;
+
+ValidationInterfaceQueue::~ValidationInterfaceQueue() { Stop(); }
+
+void ValidationInterfaceQueue::Start()
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+    if (fRunning)
+        return;
+    fRunning       = true;
+    fStopRequested = false;
+    thread         = boost::thread(&ValidationInterfaceQueue::ThreadMain, this);
+}
+
+void ValidationInterfaceQueue::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        if (!fRunning)
+            return;
+        fStopRequested = true;
+    }
+    cond.notify_all();
+    if (thread.joinable() && thread.get_id() != boost::this_thread::get_id())
+        thread.join();
+}
+
+bool ValidationInterfaceQueue::IsRunning() const
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+    return fRunning;
+}
+
+void ValidationInterfaceQueue::Push(Callback callback)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        if (fRunning) {
+            queue.push_back(std::move(callback));
+            nPushed++;
+            cond.notify_all();
+            return;
+        }
+    }
+    callback();
+}
+
+void ValidationInterfaceQueue::Sync()
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+    // a callback waiting for the queue it's running in would never return
+    if (!fRunning || thread.get_id() == boost::this_thread::get_id())
+        return;
+    const uint64_t nTarget = nPushed;
+    while (fRunning && nProcessed < nTarget) {
+        cond.wait(lock);
+    }
+}
+
+std::size_t ValidationInterfaceQueue::Size() const
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+    return queue.size();
+}
+
+void ValidationInterfaceQueue::ThreadMain()
+{
+    RenameThread("neblio-notify");
+
+    boost::unique_lock<boost::mutex> lock(mtx);
+    while (true) {
+        while (queue.empty() && !fStopRequested) {
+            cond.wait(lock);
+        }
+        if (queue.empty())
+            break;
+
+        Callback callback = std::move(queue.front());
+        queue.pop_front();
+
+        lock.unlock();
+        try {
+            callback();
+        } catch (std::exception& ex) {
+            PrintExceptionContinue(&ex, "ValidationInterfaceQueue");
+        } catch (...) {
+            PrintExceptionContinue(nullptr, "ValidationInterfaceQueue");
+        }
+        lock.lock();
+
+        nProcessed++;
+        cond.notify_all();
+    }
+    fRunning = false;
+    cond.notify_all();
+}
+
+void SyncWithValidationInterfaceQueue() { validationInterfaceQueue.Sync(); }
@@ -0,0 +1,60 @@
+#ifndef VALIDATIONINTERFACE_H
+#define VALIDATIONINTERFACE_H
+
+#include <boost/thread.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/**
+ * A FIFO of notifications from block/transaction validation to the wallets (and through them, the UI),
+ * processed in order by a single dedicated thread so that validation doesn't wait for wallet work.
+ *
+ * While the thread isn't running (before Start() and after Stop()), pushed callbacks are executed
+ * immediately in the calling thread.
+ */
+class ValidationInterfaceQueue
+{
+public:
+    using Callback = std::function<void()>;
+
+private:
+    mutable boost::mutex      mtx;
+    boost::condition_variable cond;
+    std::deque<Callback>      queue;
+    uint64_t                  nPushed        = 0;
+    uint64_t                  nProcessed     = 0;
+    bool                      fRunning       = false;
+    bool                      fStopRequested = false;
+    boost::thread             thread;
+
+    void ThreadMain();
+
+public:
+    ValidationInterfaceQueue() = default;
+    ~ValidationInterfaceQueue();
+
+    ValidationInterfaceQueue(const ValidationInterfaceQueue&) = delete;
+    ValidationInterfaceQueue& operator=(const ValidationInterfaceQueue&) = delete;
+
+    void Start();
+
+    /** Processes everything that's still queued, then joins the thread */
+    void Stop();
+
+    bool IsRunning() const;
+
+    void Push(Callback callback);
+
+    /** Blocks until every callback that was queued when this was called has been processed */
+    void Sync();
+
+    std::size_t Size() const;
+};
+
+extern ValidationInterfaceQueue validationInterfaceQueue;
+
+/** Waits for the global validation interface queue; must not be called with cs_main held */
+void SyncWithValidationInterfaceQueue();
+
+#endif // VALIDATIONINTERFACE_H
@@ -0,0 +1,56 @@
+#include "validationtimes.h"
+
+std::atomic<int64_t> ValidationTimes::totalNanos[static_cast<unsigned>(ValidationPhase::Count)];
+
+std::chrono::nanoseconds ValidationTimes::Get(ValidationPhase phase)
+{
+    return std::chrono::nanoseconds(
+        totalNanos[static_cast<unsigned>(phase)].load(std::memory_order_relaxed));
+}
+
+thread_local ValidationPhaseTimer* ValidationPhaseTimer::current = nullptr;
+
+ValidationPhaseTimer::ValidationPhaseTimer(ValidationPhase phaseIn)
+    : phase(phaseIn), outer(current), start(std::chrono::steady_clock::now())
+{
+    if (outer) {
+        ValidationTimes::Add(outer->phase, start - outer->start);
+    }
+    current = this;
+}
+
+ValidationPhaseTimer::~ValidationPhaseTimer()
+{
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    ValidationTimes::Add(phase, end - start);
+    if (outer) {
+        outer->start = end;
+    }
+    current = outer;
+}
+
+void ValidationTimes::Reset()
+{
+    for (std::atomic<int64_t>& total : totalNanos) {
+        total.store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* ValidationTimes::PhaseName(ValidationPhase phase)
+{
+    switch (phase) {
+    case ValidationPhase::CheckBlock:
+        return "CheckBlock";
+    case ValidationPhase::FetchInputs:
+        return "FetchInputs";
+    case ValidationPhase::ScriptChecks:
+        return "ScriptChecks";
+    case ValidationPhase::NTP1:
+        return "NTP1";
+    case ValidationPhase::DbCommit:
+        return "DbCommit";
+    case ValidationPhase::Count:
+        break;
+    }
+    return "Unknown";
+}
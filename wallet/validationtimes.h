@@ -0,0 +1,67 @@
+#ifndef VALIDATIONTIMES_H
+#define VALIDATIONTIMES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * The phases of validating and storing blocks whose time is measured. They don't overlap: the time of a
+ * phase measured within another one, such as the inputs fetched while checking NTP1 data, only counts
+ * for the inner phase. Their sum is thus the part of connecting a block that they account for.
+ */
+enum class ValidationPhase : unsigned
+{
+    CheckBlock,   // CBlock::CheckBlock(), both before a block is stored and when it's connected
+    FetchInputs,  // reading the transactions that the inputs spend
+    ScriptChecks, // verifying the scripts and signatures of inputs
+    NTP1,         // reading, checking and storing the NTP1 data of transactions
+    DbCommit,     // committing database transactions
+
+    Count
+};
+
+/**
+ * The time spent in each phase, summed over all threads since the start or the last Reset(). It's
+ * always measured, as reading the clock twice doesn't show next to the work measured; bench_neblio
+ * -replay reports it.
+ */
+class ValidationTimes
+{
+    static std::atomic<int64_t> totalNanos[static_cast<unsigned>(ValidationPhase::Count)];
+
+public:
+    static void Add(ValidationPhase phase, std::chrono::steady_clock::duration elapsed)
+    {
+        totalNanos[static_cast<unsigned>(phase)].fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+    }
+
+    static std::chrono::nanoseconds Get(ValidationPhase phase);
+    static void                     Reset();
+    static const char*              PhaseName(ValidationPhase phase);
+};
+
+/**
+ * Adds the time from its construction to its destruction to a phase, except for the time of timers
+ * constructed within its lifetime on the same thread, which is paused while they run.
+ */
+class ValidationPhaseTimer
+{
+    const ValidationPhase                 phase;
+    ValidationPhaseTimer* const           outer;
+    std::chrono::steady_clock::time_point start;
+
+    // the innermost running timer of the thread
+    static thread_local ValidationPhaseTimer* current;
+
+public:
+    explicit ValidationPhaseTimer(ValidationPhase phaseIn);
+    ~ValidationPhaseTimer();
+
+    ValidationPhaseTimer(const ValidationPhaseTimer&) = delete;
+    ValidationPhaseTimer& operator=(const ValidationPhaseTimer&) = delete;
+};
+
+#endif // VALIDATIONTIMES_H
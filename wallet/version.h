@@ -32,7 +32,7 @@ static const int DATABASE_VERSION = 70516;
 // network protocol versioning
 //
 
-static const int PROTOCOL_VERSION = 60320;
+static const int PROTOCOL_VERSION = 60321;
 
 // intial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -51,4 +51,7 @@ static const int BIP0031_VERSION = 60000;
 // "mempool" command, enhanced "getdata" behavior starts with this version:
 static const int MEMPOOL_GD_VERSION = 60002;
 
+// "sendcmpct", "cmpctblock", "getblocktxn" and "blocktxn" (compact block relay) start with this version
+static const int COMPACT_BLOCKS_VERSION = 60321;
+
 #endif
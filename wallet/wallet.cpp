@@ -6,6 +6,7 @@
 #include "wallet.h"
 #include "base58.h"
 #include "block.h"
+#include "blockarena.h"
 #include "coincontrol.h"
 #include "crypter.h"
 #include "kernel.h"
@@ -15,6 +16,7 @@
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "walletdb.h"
+#include "walletrescan.h"
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/make_shared.hpp>
 
@@ -177,7 +179,8 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
         std::string strAddr = CBitcoinAddress(redeemScript.GetID()).ToString();
         printf("%s: Warning: This wallet contains a redeemScript of size %" PRIszu
                " which exceeds maximum size %i thus can never be redeemed. Do not use address %s.\n",
-               __func__, redeemScript.size(), MAX_SCRIPT_ELEMENT_SIZE, strAddr.c_str());
+               __func__, static_cast<std::size_t>(redeemScript.size()), MAX_SCRIPT_ELEMENT_SIZE,
+               strAddr.c_str());
         return true;
     }
 
@@ -593,6 +596,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             wtx.hashBlock = hashBlock;
             wtx.MarkDirty();
             wtx.WriteToDisk(&walletdb);
+            ntp1WalletCache.TransactionChanged(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them
             // conflicted too
             auto                     txSpends = mapTxSpends.get();
@@ -653,6 +657,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         wtx.BindWallet(this);
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         AddToSpends(hash);
+        ntp1WalletCache.TransactionChanged(wtx);
     } else {
 
         LOCK(cs_wallet);
@@ -717,6 +722,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
+        ntp1WalletCache.TransactionChanged(wtx);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -790,6 +796,7 @@ bool CWallet::EraseFromWallet(uint256 hash)
         LOCK(cs_wallet);
         if (mapWallet.erase(hash))
             CWalletDB(strWalletFile).EraseTx(hash);
+        ntp1WalletCache.TransactionErased(hash);
     }
     return true;
 }
@@ -1067,44 +1074,114 @@ bool CWalletTx::WriteToDisk(CWalletDB* pwalletdb)
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     int ret = 0;
+    if (!pindexStart)
+        return ret;
+
+    // the blocks to scan; there's no need to scan the blocks created before our wallet birthday (as
+    // adjusted for block time variability)
+    std::vector<const CBlockIndex*> blocks;
+    for (int h = pindexStart->nHeight; h <= chainActive.Height(); h++) {
+        const CBlockIndex* pindex = chainActive[h];
+        if (!pindex)
+            break;
+        if (nTimeFirstKey && (pindex->nTime < (nTimeFirstKey - 7200)))
+            continue;
+        blocks.push_back(pindex);
+    }
+    printf("Starting wallet rescan of %" PRIszu " blocks...\n", blocks.size());
+    const int64_t nStart = GetTimeMillis();
 
-    CBlockIndex* pindex = pindexStart;
+    // the outputs whose spenders are looked for: those the wallet has and those spent by its
+    // transactions, to find conflicts; the prefilter adds those it finds
+    CWalletScanFilter   filter;
+    std::set<COutPoint> outpoints;
+    {
+        LOCK(cs_wallet);
+        std::set<CKeyID> setKeys;
+        GetKeys(setKeys);
+        for (const CKeyID& keyID : setKeys)
+            filter.AddID(keyID);
+        {
+            LOCK(cs_KeyStore);
+            for (const ScriptMap::value_type& script : mapScripts)
+                filter.AddID(script.first);
+        }
+        for (const std::pair<const uint256, CWalletTx>& item : mapWallet) {
+            for (unsigned int n = 0; n < item.second.vout.size(); n++) {
+                if (filter.MayBeMine(item.second.vout[n].scriptPubKey))
+                    outpoints.insert(COutPoint(item.first, n));
+            }
+        }
+        auto lock = mapTxSpends.get_lock();
+        for (const TxSpends::value_type& spend : mapTxSpends.get())
+            outpoints.insert(spend.first);
+    }
 
-    uint64_t blockCount = pindexStart->nHeight;
+    std::vector<CWalletScanMatch> matches;
+    if (!PrefilterWalletBlocks(blocks, filter, matches, outpoints)) {
+        printf("Wallet rescan interrupted\n");
+        return ret;
+    }
 
     {
         CTxDB txdb;
         LOCK2(cs_main, cs_wallet);
-        const int bestHeight = txdb.GetBestChainHeight().value_or(0);
-        printf("Starting wallet rescan of %d blocks...\n", bestHeight);
-        while (pindex) {
-            blockCount++;
-
-            if (blockCount % 1000 == 0) {
-                uiInterface.InitMessage(_("Rescanning... ") + "(block: " + std::to_string(blockCount) +
-                                        "/" + std::to_string(bestHeight) + ")");
-                printf("Done scanning %" PRIu64 " blocks\n", blockCount);
+
+        // the blocks to read again, with the transactions found in them
+        std::map<std::size_t, std::set<unsigned int>> candidates;
+        for (const CWalletScanMatch& match : matches)
+            candidates[match.nBlock].insert(match.nTx);
+
+        // the transactions spending the outputs are found through the tx index instead of by checking
+        // every input of the chain
+        std::unordered_map<uint256, std::size_t> blockPositions;
+        for (std::size_t i = 0; i < blocks.size(); i++)
+            blockPositions[blocks[i]->GetBlockHash()] = i;
+        uint256  lastHash;
+        CTxIndex txindex;
+        bool     fHaveTxIndex = false;
+        for (const COutPoint& outpoint : outpoints) {
+            if (outpoint.hash != lastHash) {
+                lastHash     = outpoint.hash;
+                fHaveTxIndex = txdb.ReadTxIndex(outpoint.hash, txindex);
             }
+            if (!fHaveTxIndex || outpoint.n >= txindex.vSpent.size() ||
+                txindex.vSpent[outpoint.n].IsNull())
+                continue;
+            const auto it = blockPositions.find(txindex.vSpent[outpoint.n].nBlockPos);
+            if (it != blockPositions.end())
+                candidates[it->second];
+        }
+
+        printf("Wallet rescan: %" PRIszu " candidate blocks found in %" PRId64 "ms\n", candidates.size(),
+               GetTimeMillis() - nStart);
 
-            // no need to read and scan block, if block was created before
-            // our wallet birthday (as adjusted for block time variability)
-            if (nTimeFirstKey && (pindex->nTime < (nTimeFirstKey - 7200))) {
-                pindex = boost::atomic_load(&pindex->pnext).get();
+        CBlockArena blockArena;
+        for (const std::pair<const std::size_t, std::set<unsigned int>>& candidate : candidates) {
+            const CBlockIndex* pindex = blocks[candidate.first];
+            // the chain may have been reorganized since the blocks were scanned; the blocks connected
+            // since then are synced with the wallet already
+            if (!chainActive.Contains(pindex))
+                continue;
+            if (!blockArena.ReadFromDisk(pindex, txdb)) {
+                printf("Wallet rescan: failed to read block %s\n",
+                       pindex->GetBlockHash().ToString().c_str());
                 continue;
             }
-
-            CBlock block;
-            block.ReadFromDisk(pindex, true);
-            for (CTransaction& tx : block.vtx) {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+            const CBlock& block = blockArena.GetBlock();
+            for (unsigned int i = 0; i < block.vtx.size(); i++) {
+                const CTransaction& tx = block.vtx[i];
+                bool fCandidate = candidate.second.count(i) > 0;
+                for (unsigned int j = 0; j < tx.vin.size() && !fCandidate; j++)
+                    fCandidate = outpoints.count(tx.vin[j].prevout) > 0;
+                if (fCandidate && AddToWalletIfInvolvingMe(tx, &block, fUpdate))
                     ret++;
             }
-            pindex = boost::atomic_load(&pindex->pnext).get();
         }
         uiInterface.InitMessage(_("Updating wallet on disk (do not shutdown)..."));
         FlushWalletDB(true, strWalletFile, nullptr);
         uiInterface.InitMessage(_("Rescanning... ") + "(done)");
-        printf("Done rescanning wallet.\n");
+        printf("Done rescanning wallet in %" PRId64 "ms.\n", GetTimeMillis() - nStart);
     }
     return ret;
 }
@@ -1308,6 +1385,73 @@ CAmount CWallet::GetImmatureBalance() const
     return nTotal;
 }
 
+bool CWallet::IsAvailableCoinTx(const CWalletTx& coin, bool fOnlyConfirmed, int& nDepthRet) const
+{
+    if (!IsFinalTx(coin))
+        return false;
+
+    if (fOnlyConfirmed && !coin.IsTrusted())
+        return false;
+
+    if (coin.IsCoinBase() && coin.GetBlocksToMaturity() > 0)
+        return false;
+
+    if (coin.IsCoinStake() && coin.GetBlocksToMaturity() > 0)
+        return false;
+
+    nDepthRet = coin.GetDepthInMainChain();
+    if (nDepthRet == 0 && !coin.InMempool())
+        return false;
+
+    return true;
+}
+
+bool CWallet::IsAvailableCoinOutput(const CWalletTx& coin, unsigned int i, bool fIncludeColdStaking,
+                                    bool fIncludeDelegated, const CCoinControl* coinControl) const
+{
+    isminetype mine = IsMine(coin.vout[i]);
+    if (mine == ISMINE_NO)
+        return false;
+
+    if (IsMineCheck(mine, ISMINE_WATCH_ONLY))
+        return false;
+
+    if (coin.vout[i].nValue < nMinimumInputValue)
+        return false;
+
+    if (IsSpent(coin.GetHash(), i))
+        return false;
+
+    if (!(!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(coin.GetHash(), i)))
+        return false;
+
+    // --Skip P2CS outputs
+    // skip cold coins
+    if (mine == ISMINE_COLD && (!fIncludeColdStaking || !HasDelegator(coin.vout[i])))
+        return false;
+    // skip delegated coins
+    if (mine == ISMINE_SPENDABLE_DELEGATED && !fIncludeDelegated)
+        return false;
+    // skip auto-delegated coins
+    if (mine == ISMINE_SPENDABLE_STAKEABLE && !fIncludeColdStaking && !fIncludeDelegated)
+        return false;
+
+    // bool fIsValid =
+    //     (((mine &
+    //        ISMINE_SPENDABLE) !=
+    //       ISMINE_NO) ||
+    //      ((mine &
+    //        (ISMINE_MULTISIG |
+    //         (fIncludeColdStaking ? ISMINE_COLD
+    //                              : ISMINE_NO) |
+    //         (fIncludeDelegated
+    //              ? ISMINE_SPENDABLE_DELEGATED
+    //              : ISMINE_NO))) !=
+    //       ISMINE_NO));
+
+    return true;
+}
+
 // populate vCoins with vector of spendable COutputs
 void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, bool fIncludeColdStaking,
                              bool fIncludeDelegated, const CCoinControl* coinControl) const
@@ -1319,64 +1463,15 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, bool
              ++it) {
             const CWalletTx* pcoin = &(*it).second;
 
-            if (!IsFinalTx(*pcoin))
-                continue;
-
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
-
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            if (pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth == 0 && !pcoin->InMempool())
+            int nDepth = 0;
+            if (!IsAvailableCoinTx(*pcoin, fOnlyConfirmed, nDepth))
                 continue;
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (mine == ISMINE_NO)
+                if (!IsAvailableCoinOutput(*pcoin, i, fIncludeColdStaking, fIncludeDelegated,
+                                           coinControl))
                     continue;
 
-                if (IsMineCheck(mine, ISMINE_WATCH_ONLY))
-                    continue;
-
-                if (pcoin->vout[i].nValue < nMinimumInputValue)
-                    continue;
-
-                if (IsSpent(pcoin->GetHash(), i))
-                    continue;
-
-                if (!(!coinControl || !coinControl->HasSelected() ||
-                      coinControl->IsSelected((*it).first, i)))
-                    continue;
-
-                // --Skip P2CS outputs
-                // skip cold coins
-                if (mine == ISMINE_COLD && (!fIncludeColdStaking || !HasDelegator(pcoin->vout[i])))
-                    continue;
-                // skip delegated coins
-                if (mine == ISMINE_SPENDABLE_DELEGATED && !fIncludeDelegated)
-                    continue;
-                // skip auto-delegated coins
-                if (mine == ISMINE_SPENDABLE_STAKEABLE && !fIncludeColdStaking && !fIncludeDelegated)
-                    continue;
-
-                // bool fIsValid =
-                //     (((mine &
-                //        ISMINE_SPENDABLE) !=
-                //       ISMINE_NO) ||
-                //      ((mine &
-                //        (ISMINE_MULTISIG |
-                //         (fIncludeColdStaking ? ISMINE_COLD
-                //                              : ISMINE_NO) |
-                //         (fIncludeDelegated
-                //              ? ISMINE_SPENDABLE_DELEGATED
-                //              : ISMINE_NO))) !=
-                //       ISMINE_NO));
-
                 vCoins.push_back(COutput(pcoin, i, nDepth));
             }
         }
@@ -1704,7 +1799,7 @@ bool CWallet::SelectCoinsMinConf(CAmount nTargetValue, unsigned int nSpendTime,
                 nValueRet += vValue[i].first;
             }
 
-        if (fDebug) {
+        if (LogAcceptCategory(LOG_WALLET)) {
             //// debug print
             printf("SelectCoins() best subset: ");
             for (unsigned int i = 0; i < vValue.size(); i++)
@@ -2810,7 +2905,7 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
         if (!HaveKey(keypool.vchPubKey.GetID()))
             throw runtime_error("ReserveKeyFromKeyPool() : unknown key in key pool");
         assert(keypool.vchPubKey.IsValid());
-        if (fDebug && GetBoolArg("-printkeypool"))
+        if (LogAcceptCategory(LOG_WALLET) && GetBoolArg("-printkeypool"))
             printf("keypool reserve %" PRId64 "\n", nIndex);
     }
 }
@@ -2837,8 +2932,7 @@ void CWallet::KeepKey(int64_t nIndex)
         CWalletDB walletdb(strWalletFile);
         walletdb.ErasePool(nIndex);
     }
-    if (fDebug)
-        printf("keypool keep %" PRId64 "\n", nIndex);
+    LogPrint(LOG_WALLET, "keypool keep %" PRId64 "\n", nIndex);
 }
 
 void CWallet::ReturnKey(int64_t nIndex)
@@ -2848,8 +2942,7 @@ void CWallet::ReturnKey(int64_t nIndex)
         LOCK(cs_wallet);
         setKeyPool.insert(nIndex);
     }
-    if (fDebug)
-        printf("keypool return %" PRId64 "\n", nIndex);
+    LogPrint(LOG_WALLET, "keypool return %" PRId64 "\n", nIndex);
 }
 
 bool CWallet::GetKeyFromPool(CPubKey& result)
@@ -3183,6 +3276,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             wtx.setAbandoned();
             wtx.MarkDirty();
             wtx.WriteToDisk(&walletdb);
+            ntp1WalletCache.TransactionChanged(wtx);
             NotifyTransactionChanged(this, wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them
             // abandoned too
@@ -11,11 +11,13 @@
 
 #include <stdlib.h>
 
+#include "ThreadSafeMap.h"
 #include "addressbook.h"
 #include "key.h"
 #include "keystore.h"
 #include "merkletx.h"
 #include "ntp1/ntp1sendtxdata.h"
+#include "ntp1/ntp1walletcache.h"
 #include "script.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -115,6 +117,10 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+protected:
+    // decrypted keys are only cached for staking (-stakingkeycache), never after a full unlock
+    bool CanCacheDecryptedKeys() const override { return fWalletUnlockStakingOnly; }
+
 public:
     /// Main wallet lock.
     /// This lock protects all the fields added by CWallet
@@ -128,6 +134,10 @@ public:
                                CAmount& nValueRet, bool fIncludeColdStaking = true,
                                bool fIncludeDelegated = false) const;
 
+    /// decoded NTP1 outputs of the wallet, kept up to date as transactions are added or change state;
+    /// guarded by cs_wallet
+    NTP1WalletCache ntp1WalletCache;
+
     // this function is supposed to be called every time a new transcation is added to the wallet
     boost::shared_ptr<WalletNewTxUpdateFunctor> walletNewTxUpdateFunctor;
     void setFunctorOnTxInsert(boost::shared_ptr<WalletNewTxUpdateFunctor> func)
@@ -193,6 +203,12 @@ public:
                         bool fIncludeColdStaking = false, bool fIncludeDelegated = true,
                         const CCoinControl* coinControl = nullptr) const;
 
+    // the per-transaction and per-output checks of AvailableCoins(), for callers that track outputs
+    bool IsAvailableCoinTx(const CWalletTx& coin, bool fOnlyConfirmed, int& nDepthRet) const;
+    bool IsAvailableCoinOutput(const CWalletTx& coin, unsigned int i, bool fIncludeColdStaking = false,
+                               bool fIncludeDelegated = true,
+                               const CCoinControl* coinControl = nullptr) const;
+
     // Get available p2cs utxo
     bool GetAvailableP2CSCoins(std::vector<COutput>& vCoins) const;
 
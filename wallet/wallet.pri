@@ -21,12 +21,14 @@ HEADERS += qt/bitcoingui.h \
     coincontrol.h \
     sync.h \
     util.h \
+    logging.h \
     hash.h \
     uint256.h \
     kernel.h \
     scrypt.h \
     pbkdf2.h \
     serialize.h \
+    prevector.h \
     main.h \
     miner.h \
     net.h \
@@ -59,6 +61,7 @@ HEADERS += qt/bitcoingui.h \
     qt/bitcoinamountfield.h \
     wallet.h \
     keystore.h \
+    walletrescan.h \
     qt/transactionfilterproxy.h \
     qt/transactionview.h \
     qt/walletmodel.h \
@@ -109,8 +112,11 @@ HEADERS += qt/bitcoingui.h \
     qt/ntp1/ntp1tokenlistfilterproxy.h \
     ntp1/ntp1tokenmetadata.h \
     ntp1/ntp1wallet.h \
+    ntp1/ntp1walletcache.h \
+    ntp1/ntp1checkedint.h \
     qt/ntp1/ntp1tokenlistitemdelegate.h \
     ThreadSafeHashMap.h \
+    LockFreeHashMap.h \
     qt/ntp1sendtokensfeewidget.h \
     ntp1/ntp1script_burn.h \
     ntp1/ntp1tokenminimalmetadata.h \
@@ -131,6 +137,21 @@ HEADERS += qt/bitcoingui.h \
     SerializationTester.h \
     blockindexcatalog.h   \
     blockindex.h          \
+    activechain.h         \
+    blockindexsnapshot.h  \
+    validationinterface.h \
+    validationtimes.h     \
+    metrics.h             \
+    nodemetrics.h         \
+    locksite.h            \
+    optionalindex.h       \
+    ntp1tokenindex.h      \
+    addressindex.h        \
+    blockfilter.h         \
+    blockfilterindex.h    \
+    blockarena.h          \
+    blockencodings.h      \
+    quicksyncdownloader.h \
     outpoint.h            \
     inpoint.h             \
     block.h               \
@@ -202,6 +223,7 @@ SOURCES += qt/bitcoin.cpp \
     version.cpp \
     sync.cpp \
     util.cpp \
+    logging.cpp \
     hash.cpp \
     netbase.cpp \
     key.cpp \
@@ -215,6 +237,7 @@ SOURCES += qt/bitcoin.cpp \
     addrman.cpp \
     db.cpp \
     walletdb.cpp \
+    walletrescan.cpp \
     qt/clientmodel.cpp \
     qt/guiutil.cpp \
     qt/transactionrecord.cpp \
@@ -270,6 +293,7 @@ SOURCES += qt/bitcoin.cpp \
     qt/ntp1/ntp1tokenlistfilterproxy.cpp \
     ntp1/ntp1tokenmetadata.cpp \
     ntp1/ntp1wallet.cpp \
+    ntp1/ntp1walletcache.cpp \
     qt/ntp1/ntp1tokenlistitemdelegate.cpp \
     ThreadSafeHashMap.cpp \
     ntp1/ntp1sendtokensonerecipientdata.cpp \
@@ -292,6 +316,20 @@ SOURCES += qt/bitcoin.cpp \
     SerializationTester.cpp \
     blockindexcatalog.cpp \
     blockindex.cpp        \
+    activechain.cpp       \
+    blockindexsnapshot.cpp \
+    validationinterface.cpp \
+    validationtimes.cpp \
+    metrics.cpp \
+    nodemetrics.cpp \
+    optionalindex.cpp \
+    ntp1tokenindex.cpp \
+    addressindex.cpp      \
+    blockfilter.cpp       \
+    blockfilterindex.cpp  \
+    blockarena.cpp        \
+    blockencodings.cpp    \
+    quicksyncdownloader.cpp \
     outpoint.cpp          \
     inpoint.cpp           \
     block.cpp             \
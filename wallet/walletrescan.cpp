@@ -0,0 +1,113 @@
+#include "walletrescan.h"
+
+#include "blockarena.h"
+#include "blockindex.h"
+#include "hash.h"
+#include "script.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "util.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+
+bool CWalletScanFilter::MayBeMine(const CScript& scriptPubKey) const
+{
+    CScript::const_iterator    pc = scriptPubKey.begin();
+    opcodetype                 opcode;
+    std::vector<unsigned char> data;
+    while (scriptPubKey.GetOp(pc, opcode, data)) {
+        if (data.size() == 20) {
+            if (ids.count(uint160(data))) {
+                return true;
+            }
+        } else if (data.size() == 33 || data.size() == 65) {
+            if (ids.count(Hash160(data))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CWalletScanFilter::MayInvolve(const CTransaction& tx) const
+{
+    for (const CTxOut& txout : tx.vout) {
+        if (MayBeMine(txout.scriptPubKey)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PrefilterWalletBlocks(const std::vector<const CBlockIndex*>& blocks,
+                           const CWalletScanFilter& filter, std::vector<CWalletScanMatch>& matches,
+                           std::set<COutPoint>& outpoints)
+{
+    const std::size_t threadCount =
+        std::max<std::size_t>(1, std::min<std::size_t>(boost::thread::hardware_concurrency(),
+                                                        blocks.size() / 1000 + 1));
+    const std::size_t chunkSize = (blocks.size() + threadCount - 1) / threadCount;
+
+    std::vector<std::vector<CWalletScanMatch>> threadMatches(threadCount);
+    std::vector<std::set<COutPoint>>           threadOutpoints(threadCount);
+    boost::atomic<std::size_t>                 scanned{0};
+    boost::atomic<bool>                        failed{false};
+
+    auto scanRange = [&](std::size_t t) {
+        const std::size_t begin = t * chunkSize;
+        const std::size_t end   = std::min(blocks.size(), begin + chunkSize);
+
+        const CTxDB txdb;
+        CBlockArena blockArena;
+        for (std::size_t i = begin; i < end && !failed && !fShutdown; i++) {
+            if (!blockArena.ReadFromDisk(blocks[i], txdb)) {
+                printf("Wallet rescan: failed to read block at height %d\n", blocks[i]->nHeight);
+                failed = true;
+                break;
+            }
+            const CBlock& block = blockArena.GetBlock();
+            for (unsigned int j = 0; j < block.vtx.size(); j++) {
+                const CTransaction& tx = block.vtx[j];
+                if (!filter.MayInvolve(tx)) {
+                    continue;
+                }
+                threadMatches[t].push_back(CWalletScanMatch{i, j});
+                const uint256 hash = tx.GetHash();
+                for (unsigned int n = 0; n < tx.vout.size(); n++) {
+                    if (filter.MayBeMine(tx.vout[n].scriptPubKey)) {
+                        threadOutpoints[t].insert(COutPoint(hash, n));
+                    }
+                }
+            }
+
+            scanned++;
+            // progress is reported by the calling thread only
+            if (t == 0 && (i - begin) % 1000 == 999) {
+                const std::size_t nScanned = scanned;
+                uiInterface.InitMessage(_("Rescanning... ") + "(block: " + std::to_string(nScanned) +
+                                        "/" + std::to_string(blocks.size()) + ")");
+                printf("Done scanning %" PRIszu " blocks\n", nScanned);
+            }
+        }
+    };
+
+    boost::thread_group threads;
+    for (std::size_t t = 1; t < threadCount; t++) {
+        threads.create_thread(std::bind(scanRange, t));
+    }
+    scanRange(0);
+    threads.join_all();
+
+    if (failed || fShutdown) {
+        return false;
+    }
+
+    // the ranges are in order, so the matches are too
+    matches.clear();
+    for (std::size_t t = 0; t < threadCount; t++) {
+        matches.insert(matches.end(), threadMatches[t].begin(), threadMatches[t].end());
+        outpoints.insert(threadOutpoints[t].begin(), threadOutpoints[t].end());
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef WALLETRESCAN_H
+#define WALLETRESCAN_H
+
+#include "outpoint.h"
+#include "uint256.h"
+
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+class CBlockIndex;
+class CScript;
+class CTransaction;
+
+/**
+ * The prefilter of wallet rescans (see CWallet::ScanForWalletTransactions()). Asking the wallet whether
+ * every output of the chain is mine means solving every script and looking up its keys under the wallet
+ * lock; instead, a rescan first goes through the blocks in parallel, without any lock, looking for the
+ * outputs whose scripts refer to one of the wallet's keys or scripts, and only asks the wallet about
+ * the transactions found that way and those spending their outputs.
+ *
+ * Every script that IsMine() accepts holds the id of a key or script of the wallet, or a public key of
+ * it, so the filter never misses an output of the wallet; it may match outputs that aren't the
+ * wallet's, like multisig outputs with only some of the keys in the wallet.
+ */
+class CWalletScanFilter
+{
+    std::unordered_set<uint160> ids;
+
+public:
+    /** adds the id of a key (CKeyID) or script (CScriptID) of the wallet */
+    void AddID(const uint160& id) { ids.insert(id); }
+
+    bool MayBeMine(const CScript& scriptPubKey) const;
+
+    /** whether an output of tx may be mine */
+    bool MayInvolve(const CTransaction& tx) const;
+
+    std::size_t size() const { return ids.size(); }
+};
+
+/** a transaction found by the prefilter, by its position in the blocks scanned */
+struct CWalletScanMatch
+{
+    std::size_t  nBlock;
+    unsigned int nTx;
+
+    friend bool operator<(const CWalletScanMatch& a, const CWalletScanMatch& b)
+    {
+        return a.nBlock < b.nBlock || (a.nBlock == b.nBlock && a.nTx < b.nTx);
+    }
+};
+
+/**
+ * Reads the blocks using all available cores and returns, sorted, the transactions with outputs that may
+ * be mine. The outputs themselves are added to outpoints, so that the transactions spending them can be
+ * looked up. No lock is needed. Returns false if a block can't be read.
+ */
+bool PrefilterWalletBlocks(const std::vector<const CBlockIndex*>& blocks,
+                           const CWalletScanFilter& filter, std::vector<CWalletScanMatch>& matches,
+                           std::set<COutPoint>& outpoints);
+
+#endif // WALLETRESCAN_H
@@ -22,9 +22,8 @@ int64_t GetProofOfWorkReward(int64_t nFees)
         nSubsidy = 0;
     }
 
-    if (fDebug)
-        printf("GetProofOfWorkReward() : create=%s nSubsidy=%" PRId64 "\n",
-               FormatMoney(nSubsidy).c_str(), nSubsidy);
+    LogPrint(LOG_STAKE, "GetProofOfWorkReward() : create=%s nSubsidy=%" PRId64 "\n",
+             FormatMoney(nSubsidy).c_str(), nSubsidy);
 
     return nSubsidy + nFees;
 }
@@ -42,9 +41,8 @@ int64_t GetProofOfStakeReward(int64_t nCoinAge, int64_t nFees)
     printf("coin-Subsidy %" PRId64 "\n", nSubsidy);
     printf("coin-Age %" PRId64 "\n", nCoinAge);
     printf("Coin Reward %" PRId64 "\n", nRewardCoinYear);
-    if (fDebug)
-        printf("GetProofOfStakeReward(): create=%s nCoinAge=%" PRId64 "\n",
-               FormatMoney(nSubsidy).c_str(), nCoinAge);
+    LogPrint(LOG_STAKE, "GetProofOfStakeReward(): create=%s nCoinAge=%" PRId64 "\n",
+             FormatMoney(nSubsidy).c_str(), nCoinAge);
 
     return nSubsidy + nFees;
 }